@@ -1,6 +1,6 @@
 #! /bin/bash
 #
-# Copyright (c) 2014-2015, Intel Corporation
+# Copyright (c) 2015, Intel Corporation
 #
 # Redistribution and use in source and binary forms, with or without
 # modification, are permitted provided that the following conditions
@@ -30,34 +30,41 @@
 # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-MAX_THREADS=32
-OPERATIONS_PER_THREAD=200
-RUNS=`seq $MAX_THREADS`
-BLK_SIZE=512
-BLK_FILE="./blkfile.tmp"
-IO_FILE="./iofile.tmp"
-FILE_SIZE=1024 #MB
-PMEMBLK_OUT=benchmark_mt_pmemblk.out
-FILEIOBLK_OUT=benchmark_mt_fileio.out
 
-rm -f $IO_FILE;
-rm -f $BLK_FILE;
+#
+# RUN.sh -- measure PMEMrwlock read scalability with and without
+#           reader-biased locks
+#
+# Usage: RUN.sh [POOL_DIR] [MAX_THREADS] [WRITE_PERCENT] [OPS_PER_THREAD]
+#
+POOL_DIR="/tmp"
+MAX_THREADS=`nproc`
+WRITE_PERCENT=1
+OPS_PER_THREAD=1000000
 
-./blk_mt -b $BLK_SIZE -s $FILE_SIZE -c -o $OPERATIONS_PER_THREAD $MAX_THREADS $BLK_FILE;
+[ -n "$1" ] && POOL_DIR=$1
+[ -n "$2" ] && MAX_THREADS=$2
+[ -n "$3" ] && WRITE_PERCENT=$3
+[ -n "$4" ] && OPS_PER_THREAD=$4
 
-rm -f $PMEMBLK_OUT;
+RUNS=`seq $MAX_THREADS`
+POOL_FILE=$POOL_DIR/obj_rwlock_mt.tmp
+PTHREAD_OUT=obj_rwlock_mt_pthread.out
+BIASED_OUT=obj_rwlock_mt_biased.out
 
-rm -f $FILEIOBLK_OUT;
+rm -f $PTHREAD_OUT $BIASED_OUT
 
 for i in $RUNS ; do
-	echo ./blk_mt -b $BLK_SIZE -s $FILE_SIZE -o $OPERATIONS_PER_THREAD $i $BLK_FILE;
-	./blk_mt -b $BLK_SIZE -s $FILE_SIZE -o $OPERATIONS_PER_THREAD $i $BLK_FILE >> $PMEMBLK_OUT;
+	echo ./obj_rwlock_mt -w $WRITE_PERCENT -o $OPS_PER_THREAD $i $POOL_FILE
+	./obj_rwlock_mt -w $WRITE_PERCENT -o $OPS_PER_THREAD $i $POOL_FILE \
+		>> $PTHREAD_OUT
+	echo PMEMOBJ_BIASED_RWLOCKS=1 \
+		./obj_rwlock_mt -w $WRITE_PERCENT -o $OPS_PER_THREAD $i $POOL_FILE
+	PMEMOBJ_BIASED_RWLOCKS=1 \
+		./obj_rwlock_mt -w $WRITE_PERCENT -o $OPS_PER_THREAD $i $POOL_FILE \
+		>> $BIASED_OUT
 done
 
-for i in $RUNS ; do
-	echo ./blk_mt -b $BLK_SIZE -s $FILE_SIZE -o $OPERATIONS_PER_THREAD -i $i $IO_FILE
-	./blk_mt -b $BLK_SIZE -s $FILE_SIZE -o $OPERATIONS_PER_THREAD -i $i $IO_FILE >> $FILEIOBLK_OUT;
-	rm $IO_FILE;
-done
+rm -f $POOL_FILE
 
-gnuplot *.p
+gnuplot gnuplot_obj_rwlock_mt.p
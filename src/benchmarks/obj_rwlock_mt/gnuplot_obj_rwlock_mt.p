@@ -0,0 +1,18 @@
+set terminal png size 1000,500
+date=system("date +%F_%H-%M-%S")
+filename='benchmark_obj_rwlock_mt_'.date.'.png'
+set output filename
+set autoscale
+set datafile separator ';'
+unset log
+unset label
+set grid
+set xtic auto
+set size ratio 0.5
+set ytic auto
+set title "PMEMrwlock thread scaling"
+set xlabel "Threads"
+set ylabel "Operations per second"
+set key inside left top
+plot "obj_rwlock_mt_pthread.out" using 1:5 title "pthread rwlock" with linespoints, \
+"obj_rwlock_mt_biased.out" using 1:5 title "reader-biased rwlock" with linespoints
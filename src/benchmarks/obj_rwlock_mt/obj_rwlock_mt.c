@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_rwlock_mt.c -- multithreaded benchmark of pmem resident rwlocks
+ *
+ * Every thread repeatedly reads a small table guarded by a single
+ * PMEMrwlock, and occasionally updates it under the write lock.  Writes
+ * are done either through the non-tx API or in a transaction with
+ * TX_LOCK_RWLOCK.  Run with PMEMOBJ_BIASED_RWLOCKS=1 to measure the
+ * reader-biased locks (see RUN.sh).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <libpmemobj.h>
+
+#define	NANOSEC_IN_SEC 1000000000.0
+#define	TABLE_SIZE 16
+#define	LAYOUT_NAME "obj_rwlock_mt"
+
+POBJ_LAYOUT_BEGIN(obj_rwlock_mt);
+POBJ_LAYOUT_ROOT(obj_rwlock_mt, struct root);
+POBJ_LAYOUT_END(obj_rwlock_mt);
+
+struct root {
+	PMEMrwlock lock;
+	uint64_t table[TABLE_SIZE];
+};
+
+struct worker_args {
+	PMEMobjpool *pop;
+	struct root *rootp;
+	unsigned long ops;
+	unsigned write_pct;
+	int tx;
+	unsigned seed;
+};
+
+/*
+ * elapsed -- return time between two timestamps in seconds
+ */
+static double
+elapsed(struct timespec *start, struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) +
+		(stop->tv_nsec - start->tv_nsec) / NANOSEC_IN_SEC;
+}
+
+/*
+ * do_write -- update the table under the write lock
+ */
+static void
+do_write(struct worker_args *a, uint64_t val)
+{
+	struct root *rootp = a->rootp;
+
+	if (a->tx) {
+		TX_BEGIN_LOCK(a->pop, TX_LOCK_RWLOCK, &rootp->lock) {
+			pmemobj_tx_add_range_direct(rootp->table,
+				sizeof (rootp->table));
+			for (int i = 0; i < TABLE_SIZE; i++)
+				rootp->table[i] = val;
+		} TX_END
+		return;
+	}
+
+	pmemobj_rwlock_wrlock(a->pop, &rootp->lock);
+	for (int i = 0; i < TABLE_SIZE; i++)
+		rootp->table[i] = val;
+	pmemobj_persist(a->pop, rootp->table, sizeof (rootp->table));
+	pmemobj_rwlock_unlock(a->pop, &rootp->lock);
+}
+
+/*
+ * do_read -- read the table under the read lock and check it is consistent
+ */
+static int
+do_read(struct worker_args *a)
+{
+	struct root *rootp = a->rootp;
+	int ret = 0;
+
+	pmemobj_rwlock_rdlock(a->pop, &rootp->lock);
+	uint64_t first = rootp->table[0];
+	for (int i = 1; i < TABLE_SIZE; i++)
+		if (rootp->table[i] != first)
+			ret = -1;
+	pmemobj_rwlock_unlock(a->pop, &rootp->lock);
+
+	return ret;
+}
+
+/*
+ * worker -- thread body, performs the requested mix of reads and writes
+ */
+static void *
+worker(void *arg)
+{
+	struct worker_args *a = arg;
+
+	for (unsigned long i = 0; i < a->ops; i++) {
+		if ((unsigned)rand_r(&a->seed) % 100 < a->write_pct)
+			do_write(a, i);
+		else if (do_read(a)) {
+			fprintf(stderr, "inconsistent table read\n");
+			return (void *)(uintptr_t)1;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * print_usage -- print usage of the program
+ */
+static void
+print_usage(char *name)
+{
+	printf("Usage: %s [-w write_percent] [-o ops_per_thread] [-t] "
+		"<threads> <pool_file>\n", name);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned write_pct = 1;
+	unsigned long ops = 1000000;
+	int tx = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "w:o:t")) != -1) {
+		switch (opt) {
+		case 'w':
+			write_pct = (unsigned)atoi(optarg);
+			break;
+		case 'o':
+			ops = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			tx = 1;
+			break;
+		default:
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (optind + 2 > argc || write_pct > 100) {
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	int nthreads = atoi(argv[optind]);
+	char *path = argv[optind + 1];
+	if (nthreads < 1) {
+		print_usage(argv[0]);
+		return -1;
+	}
+
+	unlink(path);
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+			0666);
+	if (pop == NULL) {
+		perror("pmemobj_create");
+		return -1;
+	}
+
+	TOID(struct root) root = POBJ_ROOT(pop, struct root);
+
+	pthread_t *threads = malloc(nthreads * sizeof (*threads));
+	struct worker_args *args = malloc(nthreads * sizeof (*args));
+	if (threads == NULL || args == NULL) {
+		perror("malloc");
+		return -1;
+	}
+
+	struct timespec time_start, time_stop;
+	clock_gettime(CLOCK_MONOTONIC, &time_start);
+
+	for (int i = 0; i < nthreads; i++) {
+		args[i].pop = pop;
+		args[i].rootp = D_RW(root);
+		args[i].ops = ops;
+		args[i].write_pct = write_pct;
+		args[i].tx = tx;
+		args[i].seed = (unsigned)i;
+		if ((errno = pthread_create(&threads[i], NULL, worker,
+				&args[i])) != 0) {
+			perror("pthread_create");
+			return -1;
+		}
+	}
+
+	int ret = 0;
+	for (int i = 0; i < nthreads; i++) {
+		void *result;
+		pthread_join(threads[i], &result);
+		if (result != NULL)
+			ret = -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &time_stop);
+	double time = elapsed(&time_start, &time_stop);
+
+	printf("%d;%u;%lu;%f;%f\n", nthreads, write_pct, ops * nthreads,
+		time, ops * nthreads / time);
+
+	free(args);
+	free(threads);
+	pmemobj_close(pop);
+
+	return ret;
+}
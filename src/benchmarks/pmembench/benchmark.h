@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * benchmark.h -- interface between pmembench and the workloads
+ *
+ * A workload is described by a struct benchmark_info and registered with
+ * REGISTER_BENCHMARK().  pmembench creates n_threads worker threads, calls
+ * the optional init_worker() in each of them, and then times every call
+ * to operation().  init() and exit() are called once per run, outside of
+ * the measured region, and are expected to create and close the pool.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct benchmark;
+struct scenario;
+
+/*
+ * benchmark_opt -- an option specific to a workload
+ *
+ * The value comes from the scenario file or from the command line, the
+ * default is used otherwise.
+ */
+struct benchmark_opt {
+	const char *name;
+	const char *def;	/* default value */
+	const char *help;
+};
+
+/*
+ * benchmark_args -- parameters of a single run
+ */
+struct benchmark_args {
+	const char *fname;	/* file used by the workload */
+	size_t fsize;		/* size of the file, 0 picks a default */
+	unsigned n_threads;	/* number of worker threads */
+	size_t n_ops;		/* number of operations per thread */
+	size_t dsize;		/* data size of a single operation */
+	unsigned seed;		/* seed of the per-thread random generators */
+	const struct scenario *sc;	/* source of workload options */
+};
+
+/*
+ * worker_info -- state of a single worker thread
+ */
+struct worker_info {
+	unsigned index;		/* thread index */
+	unsigned seed;		/* for rand_r() */
+	void *priv;		/* set by init_worker() */
+};
+
+/*
+ * operation_info -- a single timed call of operation()
+ */
+struct operation_info {
+	struct worker_info *worker;
+	struct benchmark_args *args;
+	size_t index;		/* operation index within the thread */
+};
+
+struct benchmark_info {
+	const char *name;
+	const char *brief;
+	const struct benchmark_opt *opts;	/* terminated by a NULL name */
+	int (*init)(struct benchmark *bench, struct benchmark_args *args);
+	int (*exit)(struct benchmark *bench, struct benchmark_args *args);
+	int (*init_worker)(struct benchmark *bench,
+			struct benchmark_args *args,
+			struct worker_info *worker);
+	void (*free_worker)(struct benchmark *bench,
+			struct benchmark_args *args,
+			struct worker_info *worker);
+	int (*operation)(struct benchmark *bench, struct operation_info *info);
+};
+
+void pmembench_register(struct benchmark_info *info);
+void *pmembench_get_priv(struct benchmark *bench);
+void pmembench_set_priv(struct benchmark *bench, void *priv);
+
+const char *benchmark_opt_str(struct benchmark_args *args, const char *name);
+size_t benchmark_opt_size(struct benchmark_args *args, const char *name);
+int benchmark_opt_bool(struct benchmark_args *args, const char *name);
+
+#define	REGISTER_BENCHMARK(info)\
+__attribute__((constructor))\
+static void \
+register_##info(void)\
+{\
+	pmembench_register(&info);\
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * blk.c -- libpmemblk workload: reads or writes of random blocks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libpmemblk.h>
+
+#include "benchmark.h"
+
+struct blk_bench {
+	PMEMblkpool *pbp;
+	size_t nblocks;
+	int write;		/* time the writes instead of the reads */
+	int random;		/* random instead of sequential blocks */
+};
+
+/*
+ * blk_init -- create the pool, data-size is the block size
+ *
+ * The reads of blocks that were never written do not touch the media, so
+ * the pool is filled first when the reads are timed.
+ */
+static int
+blk_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct blk_bench *bb = calloc(1, sizeof (*bb));
+	if (bb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, "read") && strcmp(op, "write")) {
+		fprintf(stderr, "op: expected read or write, got \"%s\"\n",
+				op);
+		free(bb);
+		return -1;
+	}
+	bb->write = strcmp(op, "write") == 0;
+	bb->random = benchmark_opt_bool(args, "random");
+
+	size_t poolsize = args->fsize;
+	if (poolsize == 0) {
+		poolsize = 2 * args->n_threads * args->n_ops * args->dsize;
+		if (poolsize < PMEMBLK_MIN_POOL)
+			poolsize = PMEMBLK_MIN_POOL;
+	}
+
+	bb->pbp = pmemblk_create(args->fname, args->dsize, poolsize, 0666);
+	if (bb->pbp == NULL) {
+		perror(args->fname);
+		free(bb);
+		return -1;
+	}
+	bb->nblocks = pmemblk_nblock(bb->pbp);
+
+	if (!bb->write) {
+		char *buf = calloc(1, args->dsize);
+		for (size_t b = 0; buf && b < bb->nblocks; ++b) {
+			if (pmemblk_write(bb->pbp, buf, (off_t)b)) {
+				perror("pmemblk_write");
+				break;
+			}
+		}
+		free(buf);
+	}
+
+	pmembench_set_priv(bench, bb);
+	return 0;
+}
+
+/*
+ * blk_exit -- close the pool
+ */
+static int
+blk_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct blk_bench *bb = pmembench_get_priv(bench);
+
+	pmemblk_close(bb->pbp);
+	free(bb);
+	return 0;
+}
+
+/*
+ * blk_init_worker -- allocate the block buffer of the thread
+ */
+static int
+blk_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	if ((worker->priv = malloc(args->dsize)) == NULL)
+		return -1;
+
+	memset(worker->priv, (int)worker->index + 1, args->dsize);
+	return 0;
+}
+
+/*
+ * blk_free_worker -- free the block buffer of the thread
+ */
+static void
+blk_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	free(worker->priv);
+}
+
+/*
+ * blk_op -- read or write a single block
+ *
+ * In the sequential mode every thread walks its own part of the pool.
+ */
+static int
+blk_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct blk_bench *bb = pmembench_get_priv(bench);
+	struct worker_info *worker = info->worker;
+	size_t lba;
+
+	if (bb->random) {
+		lba = (size_t)rand_r(&worker->seed) % bb->nblocks;
+	} else {
+		size_t part = bb->nblocks / info->args->n_threads;
+		lba = worker->index * part + info->index % (part ? part : 1);
+	}
+
+	if (bb->write)
+		return pmemblk_write(bb->pbp, worker->priv, (off_t)lba);
+
+	return pmemblk_read(bb->pbp, worker->priv, (off_t)lba);
+}
+
+static const struct benchmark_opt blk_rw_opts[] = {
+	{ "op", "write", "operation to time: read or write" },
+	{ "random", "true", "random blocks, sequential ones otherwise" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info blk_rw_info = {
+	.name = "blk_rw",
+	.brief = "pmemblk_read() or pmemblk_write() of a block of data-size",
+	.opts = blk_rw_opts,
+	.init = blk_init,
+	.exit = blk_exit,
+	.init_worker = blk_init_worker,
+	.free_worker = blk_free_worker,
+	.operation = blk_op,
+};
+
+REGISTER_BENCHMARK(blk_rw_info);
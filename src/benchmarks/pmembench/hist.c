@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * hist.c -- latency histogram with a bounded relative error
+ */
+
+#include <string.h>
+
+#include "hist.h"
+
+/*
+ * hist_index -- (internal) return the counter of the given value
+ */
+static unsigned
+hist_index(uint64_t value)
+{
+	if (value < HIST_SUB_COUNT)
+		return (unsigned)value;
+
+	/* shift that leaves HIST_SUB_BITS significant bits of the value */
+	unsigned shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS + 1;
+	unsigned sub = (unsigned)(value >> shift) - HIST_SUB_COUNT / 2;
+
+	return HIST_SUB_COUNT + (shift - 1) * (HIST_SUB_COUNT / 2) + sub;
+}
+
+/*
+ * hist_value -- (internal) return the highest value counted by a counter
+ */
+static uint64_t
+hist_value(unsigned index)
+{
+	if (index < HIST_SUB_COUNT)
+		return index;
+
+	index -= HIST_SUB_COUNT;
+	unsigned shift = index / (HIST_SUB_COUNT / 2) + 1;
+	uint64_t sub = index % (HIST_SUB_COUNT / 2) + HIST_SUB_COUNT / 2;
+
+	return ((sub + 1) << shift) - 1;
+}
+
+/*
+ * hist_init -- clear the histogram
+ */
+void
+hist_init(struct hist *h)
+{
+	memset(h, 0, sizeof (*h));
+	h->min = UINT64_MAX;
+}
+
+/*
+ * hist_record -- count a single value
+ */
+void
+hist_record(struct hist *h, uint64_t value)
+{
+	h->counts[hist_index(value)]++;
+	h->count++;
+	h->sum += (double)value;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+}
+
+/*
+ * hist_merge -- add all the values counted in src to dst
+ */
+void
+hist_merge(struct hist *dst, const struct hist *src)
+{
+	for (unsigned i = 0; i < HIST_NBUCKETS; ++i)
+		dst->counts[i] += src->counts[i];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/*
+ * hist_percentile -- return the value below which the given percentage of
+ *	the recorded values lies
+ *
+ * The result is never larger than the largest recorded value.
+ */
+uint64_t
+hist_percentile(const struct hist *h, double percentile)
+{
+	if (h->count == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)(percentile / 100.0 * (double)h->count);
+	if (rank == 0)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < HIST_NBUCKETS; ++i) {
+		seen += h->counts[i];
+		if (seen >= rank) {
+			uint64_t value = hist_value(i);
+			return value < h->max ? value : h->max;
+		}
+	}
+
+	return h->max;
+}
+
+/*
+ * hist_mean -- return the mean of the recorded values
+ */
+double
+hist_mean(const struct hist *h)
+{
+	return h->count ? h->sum / (double)h->count : 0.0;
+}
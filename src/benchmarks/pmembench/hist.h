@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014, Intel Corporation
+ * Copyright (c) 2015, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -30,35 +30,34 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <stdlib.h>
-#include <inttypes.h>
-#include <libpmemlog.h>
-#include <stdbool.h>
 
-#include "log_mt.h"
+/*
+ * hist.h -- latency histogram with a bounded relative error
+ *
+ * Values below HIST_SUB_COUNT are counted exactly.  Larger values fall into
+ * buckets of a power-of-two range, each split into HIST_SUB_COUNT / 2
+ * linear sub-buckets, so any recorded value is reported with a relative
+ * error below 2 / HIST_SUB_COUNT, regardless of its magnitude.  This is
+ * the layout of an HDR histogram with two significant digits.
+ */
+
+#include <stdint.h>
 
-/* thread routine */
-typedef int (*thread_f)(void *arg);
+#define	HIST_SUB_BITS 7
+#define	HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define	HIST_NBUCKETS\
+	(HIST_SUB_COUNT + (64 - HIST_SUB_BITS) * (HIST_SUB_COUNT / 2))
 
-/* thread info structure */
-struct thread_info {
-	thread_f func;
-	void *hndl;
-	int start;
-	int end;
-	int result;
-	struct random_data *rand_state;
-	size_t vec_size;
-	size_t el_size;
-	struct iovec *iov;
-	char *buf;
-	size_t buf_size;
-	size_t buf_ptr;
+struct hist {
+	uint64_t count;		/* number of recorded values */
+	uint64_t min;
+	uint64_t max;
+	double sum;		/* for the mean */
+	uint64_t counts[HIST_NBUCKETS];
 };
 
-int run_threads(struct prog_args *args, thread_f task,
-				void *arg, double *exec_time);
-int task_pmemlog_append(void *arg);
-int task_pmemlog_read(void *arg);
-int task_fileiolog_append(void *arg);
-int task_fileiolog_read(void *arg);
+void hist_init(struct hist *h);
+void hist_record(struct hist *h, uint64_t value);
+void hist_merge(struct hist *dst, const struct hist *src);
+uint64_t hist_percentile(const struct hist *h, double percentile);
+double hist_mean(const struct hist *h);
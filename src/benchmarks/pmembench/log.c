@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * log.c -- libpmemlog workload: appends to a log shared by all the threads
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <libpmemlog.h>
+
+#include "benchmark.h"
+
+#define	MAX_VEC 64
+
+struct log_bench {
+	PMEMlogpool *plp;
+	size_t vec;		/* number of buffers of a single append */
+};
+
+/*
+ * log_init -- create a log large enough for all the appends of the run
+ */
+static int
+log_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct log_bench *lb = calloc(1, sizeof (*lb));
+	if (lb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	lb->vec = benchmark_opt_size(args, "vector");
+	if (lb->vec > MAX_VEC) {
+		fprintf(stderr, "vector: at most %d buffers\n", MAX_VEC);
+		free(lb);
+		return -1;
+	}
+
+	size_t poolsize = args->fsize;
+	if (poolsize == 0)
+		poolsize = PMEMLOG_MIN_POOL + args->n_threads * args->n_ops *
+			args->dsize * (lb->vec ? lb->vec : 1);
+
+	if ((lb->plp = pmemlog_create(args->fname, poolsize, 0666)) == NULL) {
+		perror(args->fname);
+		free(lb);
+		return -1;
+	}
+
+	pmembench_set_priv(bench, lb);
+	return 0;
+}
+
+/*
+ * log_exit -- close the log
+ */
+static int
+log_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct log_bench *lb = pmembench_get_priv(bench);
+
+	pmemlog_close(lb->plp);
+	free(lb);
+	return 0;
+}
+
+/*
+ * log_init_worker -- allocate the data appended by the thread
+ */
+static int
+log_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	if ((worker->priv = malloc(args->dsize)) == NULL)
+		return -1;
+
+	memset(worker->priv, (int)worker->index, args->dsize);
+	return 0;
+}
+
+/*
+ * log_free_worker -- free the data of the thread
+ */
+static void
+log_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	free(worker->priv);
+}
+
+/*
+ * log_op -- append data-size bytes, or a vector of such buffers
+ */
+static int
+log_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct log_bench *lb = pmembench_get_priv(bench);
+	size_t dsize = info->args->dsize;
+
+	if (lb->vec == 0)
+		return pmemlog_append(lb->plp, info->worker->priv, dsize);
+
+	struct iovec iov[MAX_VEC];
+	for (size_t i = 0; i < lb->vec; ++i) {
+		iov[i].iov_base = info->worker->priv;
+		iov[i].iov_len = dsize;
+	}
+
+	return pmemlog_appendv(lb->plp, iov, (int)lb->vec);
+}
+
+static const struct benchmark_opt log_append_opts[] = {
+	{ "vector", "0", "append that many buffers with pmemlog_appendv()" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info log_append_info = {
+	.name = "log_append",
+	.brief = "pmemlog_append() of data-size bytes",
+	.opts = log_append_opts,
+	.init = log_init,
+	.exit = log_exit,
+	.init_worker = log_init_worker,
+	.free_worker = log_free_worker,
+	.operation = log_op,
+};
+
+REGISTER_BENCHMARK(log_append_info);
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * obj.c -- libpmemobj workloads: allocations, transactions and lists
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <libpmemobj.h>
+
+#include "benchmark.h"
+
+#define	LAYOUT_NAME "pmembench"
+#define	OBJ_OVERHEAD 128	/* assumed allocator overhead of an object */
+#define	TYPE_NUM 1
+
+/*
+ * list_entry -- layout of POBJ_LIST_ENTRY()
+ */
+struct list_entry {
+	PMEMoid pe_next;
+	PMEMoid pe_prev;
+};
+
+/*
+ * list_head -- layout of POBJ_LIST_HEAD()
+ */
+struct list_head {
+	PMEMoid pe_first;
+	PMEMmutex lock;
+};
+
+struct item {
+	struct list_entry entry;
+	char data[];
+};
+
+/*
+ * obj_bench -- state shared by all the threads of the obj workloads
+ */
+struct obj_bench {
+	PMEMobjpool *pop;
+	int free_op;		/* time free/remove instead of alloc/insert */
+	size_t ranges;		/* ranges added in every transaction */
+	struct list_head *heads;	/* a list per thread, in the pool */
+};
+
+/*
+ * obj_worker -- per-thread state of the obj workloads
+ */
+struct obj_worker {
+	PMEMoid *oids;		/* objects of obj_alloc */
+	PMEMoid obj;		/* object of obj_tx */
+};
+
+/*
+ * obj_init -- create the pool shared by all the threads
+ *
+ * By default the pool is made large enough for all the objects of the
+ * run, with some slack for fragmentation.
+ */
+static int
+obj_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct obj_bench *ob = calloc(1, sizeof (*ob));
+	if (ob == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	size_t poolsize = args->fsize;
+	if (poolsize == 0) {
+		poolsize = 2 * args->n_threads * args->n_ops *
+			(args->dsize + OBJ_OVERHEAD);
+		if (poolsize < PMEMOBJ_MIN_POOL)
+			poolsize = PMEMOBJ_MIN_POOL;
+	}
+
+	ob->pop = pmemobj_create(args->fname, LAYOUT_NAME, poolsize, 0666);
+	if (ob->pop == NULL) {
+		perror(args->fname);
+		free(ob);
+		return -1;
+	}
+
+	PMEMoid root = pmemobj_root(ob->pop,
+			args->n_threads * sizeof (struct list_head));
+	if (OID_IS_NULL(root)) {
+		perror("pmemobj_root");
+		pmemobj_close(ob->pop);
+		free(ob);
+		return -1;
+	}
+	ob->heads = pmemobj_direct(root);
+
+	pmembench_set_priv(bench, ob);
+	return 0;
+}
+
+/*
+ * obj_exit -- close the pool
+ */
+static int
+obj_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+
+	pmemobj_close(ob->pop);
+	free(ob);
+	return 0;
+}
+
+/*
+ * obj_op -- (internal) parse the "op" option, returns 1 for the removals
+ */
+static int
+obj_op(struct benchmark_args *args, const char *add, const char *remove)
+{
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, add) == 0)
+		return 0;
+	if (strcmp(op, remove) == 0)
+		return 1;
+
+	fprintf(stderr, "op: expected %s or %s, got \"%s\"\n", add, remove,
+			op);
+	return -1;
+}
+
+/*
+ * obj_alloc_init -- create the pool of obj_alloc
+ */
+static int
+obj_alloc_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	int free_op = obj_op(args, "alloc", "free");
+	if (free_op < 0 || obj_init(bench, args))
+		return -1;
+
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	ob->free_op = free_op;
+	return 0;
+}
+
+/*
+ * obj_alloc_init_worker -- prepare the objects to free, if timing free
+ */
+static int
+obj_alloc_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct obj_worker *ow = calloc(1, sizeof (*ow));
+	if (ow == NULL)
+		return -1;
+
+	if ((ow->oids = calloc(args->n_ops, sizeof (PMEMoid))) == NULL) {
+		free(ow);
+		return -1;
+	}
+	worker->priv = ow;
+
+	if (!ob->free_op)
+		return 0;
+
+	for (size_t i = 0; i < args->n_ops; ++i) {
+		if (pmemobj_alloc(ob->pop, &ow->oids[i], args->dsize,
+				TYPE_NUM, NULL, NULL)) {
+			perror("pmemobj_alloc");
+			free(ow->oids);
+			free(ow);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * obj_alloc_free_worker -- free the objects left by the thread
+ */
+static void
+obj_alloc_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_worker *ow = worker->priv;
+
+	for (size_t i = 0; i < args->n_ops; ++i)
+		if (!OID_IS_NULL(ow->oids[i]))
+			pmemobj_free(&ow->oids[i]);
+
+	free(ow->oids);
+	free(ow);
+}
+
+/*
+ * obj_alloc_op -- allocate or free a single object
+ */
+static int
+obj_alloc_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct obj_worker *ow = info->worker->priv;
+	PMEMoid *oidp = &ow->oids[info->index];
+
+	if (ob->free_op) {
+		pmemobj_free(oidp);
+		return 0;
+	}
+
+	return pmemobj_alloc(ob->pop, oidp, info->args->dsize, TYPE_NUM,
+			NULL, NULL);
+}
+
+/*
+ * obj_tx_init -- create the pool of obj_tx
+ */
+static int
+obj_tx_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	size_t ranges = benchmark_opt_size(args, "ranges");
+	if (ranges == 0) {
+		fprintf(stderr, "ranges: at least one range is needed\n");
+		return -1;
+	}
+	if (obj_init(bench, args))
+		return -1;
+
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	ob->ranges = ranges;
+	return 0;
+}
+
+/*
+ * obj_tx_init_worker -- allocate the object modified by the thread
+ */
+static int
+obj_tx_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct obj_worker *ow = calloc(1, sizeof (*ow));
+	if (ow == NULL)
+		return -1;
+
+	if (pmemobj_zalloc(ob->pop, &ow->obj, ob->ranges * args->dsize,
+			TYPE_NUM)) {
+		perror("pmemobj_zalloc");
+		free(ow);
+		return -1;
+	}
+
+	worker->priv = ow;
+	return 0;
+}
+
+/*
+ * obj_tx_free_worker -- free the object of the thread
+ */
+static void
+obj_tx_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_worker *ow = worker->priv;
+
+	pmemobj_free(&ow->obj);
+	free(ow);
+}
+
+/*
+ * obj_tx_op -- snapshot and modify the ranges in a single transaction
+ */
+static int
+obj_tx_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct obj_worker *ow = info->worker->priv;
+	size_t dsize = info->args->dsize;
+	char *data = pmemobj_direct(ow->obj);
+	volatile int ret = 0;
+
+	TX_BEGIN(ob->pop) {
+		for (size_t r = 0; r < ob->ranges; ++r) {
+			pmemobj_tx_add_range(ow->obj, r * dsize, dsize);
+			memset(data + r * dsize, (int)info->index, dsize);
+		}
+	} TX_ONABORT {
+		ret = -1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * obj_list_init -- create the pool of obj_list
+ */
+static int
+obj_list_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	int free_op = obj_op(args, "insert", "remove");
+	if (free_op < 0 || obj_init(bench, args))
+		return -1;
+
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	ob->free_op = free_op;
+	return 0;
+}
+
+/*
+ * obj_list_init_worker -- fill the list of the thread, if timing removals
+ */
+static int
+obj_list_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct list_head *head = &ob->heads[worker->index];
+
+	if (!ob->free_op)
+		return 0;
+
+	for (size_t i = 0; i < args->n_ops; ++i) {
+		if (OID_IS_NULL(pmemobj_list_insert_new(ob->pop,
+				offsetof(struct item, entry), head, OID_NULL,
+				0, sizeof (struct item) + args->dsize,
+				TYPE_NUM, NULL, NULL))) {
+			perror("pmemobj_list_insert_new");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * obj_list_free_worker -- remove the items left on the list of the thread
+ */
+static void
+obj_list_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct list_head *head = &ob->heads[worker->index];
+
+	while (!OID_IS_NULL(head->pe_first))
+		if (pmemobj_list_remove(ob->pop, offsetof(struct item, entry),
+				head, head->pe_first, 1))
+			break;
+}
+
+/*
+ * obj_list_op -- insert a new item to, or remove the first item from the
+ *	list of the thread
+ */
+static int
+obj_list_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct obj_bench *ob = pmembench_get_priv(bench);
+	struct list_head *head = &ob->heads[info->worker->index];
+
+	if (ob->free_op)
+		return pmemobj_list_remove(ob->pop,
+				offsetof(struct item, entry), head,
+				head->pe_first, 1);
+
+	PMEMoid oid = pmemobj_list_insert_new(ob->pop,
+			offsetof(struct item, entry), head, OID_NULL, 0,
+			sizeof (struct item) + info->args->dsize, TYPE_NUM,
+			NULL, NULL);
+
+	return OID_IS_NULL(oid) ? -1 : 0;
+}
+
+static const struct benchmark_opt obj_alloc_opts[] = {
+	{ "op", "alloc", "operation to time: alloc or free" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info obj_alloc_info = {
+	.name = "obj_alloc",
+	.brief = "pmemobj_alloc() or pmemobj_free() of data-size objects",
+	.opts = obj_alloc_opts,
+	.init = obj_alloc_init,
+	.exit = obj_exit,
+	.init_worker = obj_alloc_init_worker,
+	.free_worker = obj_alloc_free_worker,
+	.operation = obj_alloc_op,
+};
+
+REGISTER_BENCHMARK(obj_alloc_info);
+
+static const struct benchmark_opt obj_tx_opts[] = {
+	{ "ranges", "1", "ranges of data-size added in every transaction" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info obj_tx_info = {
+	.name = "obj_tx",
+	.brief = "transaction with pmemobj_tx_add_range() and commit",
+	.opts = obj_tx_opts,
+	.init = obj_tx_init,
+	.exit = obj_exit,
+	.init_worker = obj_tx_init_worker,
+	.free_worker = obj_tx_free_worker,
+	.operation = obj_tx_op,
+};
+
+REGISTER_BENCHMARK(obj_tx_info);
+
+static const struct benchmark_opt obj_list_opts[] = {
+	{ "op", "insert", "operation to time: insert or remove" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info obj_list_info = {
+	.name = "obj_list",
+	.brief = "atomic list insertion of a new item or removal with free",
+	.opts = obj_list_opts,
+	.init = obj_list_init,
+	.exit = obj_exit,
+	.init_worker = obj_list_init_worker,
+	.free_worker = obj_list_free_worker,
+	.operation = obj_list_op,
+};
+
+REGISTER_BENCHMARK(obj_list_info);
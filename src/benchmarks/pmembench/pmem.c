@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmem.c -- libpmem workload: copies to a mapped file made persistent with
+ * pmem_persist() or pmem_msync()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <libpmem.h>
+
+#include "benchmark.h"
+
+enum pmem_op {
+	PMEM_OP_MEMCPY,		/* pmem_memcpy_persist() */
+	PMEM_OP_PERSIST,	/* memcpy() followed by pmem_persist() */
+	PMEM_OP_MSYNC,		/* memcpy() followed by pmem_msync() */
+};
+
+struct pmem_bench {
+	char *addr;
+	size_t size;
+	size_t part;		/* bytes of the file owned by a single thread */
+	enum pmem_op op;
+	int random;
+};
+
+/*
+ * pmem_init -- create and map the file, every thread gets its own part
+ */
+static int
+pmem_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct pmem_bench *pb = calloc(1, sizeof (*pb));
+	if (pb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, "memcpy") == 0)
+		pb->op = PMEM_OP_MEMCPY;
+	else if (strcmp(op, "persist") == 0)
+		pb->op = PMEM_OP_PERSIST;
+	else if (strcmp(op, "msync") == 0)
+		pb->op = PMEM_OP_MSYNC;
+	else {
+		fprintf(stderr, "op: expected memcpy, persist or msync, "
+				"got \"%s\"\n", op);
+		goto err;
+	}
+	pb->random = benchmark_opt_bool(args, "random");
+
+	pb->size = args->fsize;
+	if (pb->size == 0)
+		pb->size = args->n_threads * args->n_ops * args->dsize;
+	pb->part = pb->size / args->n_threads;
+	if (pb->part < args->dsize) {
+		fprintf(stderr, "file-size: too small for %u threads\n",
+				args->n_threads);
+		goto err;
+	}
+
+	int fd = open(args->fname, O_RDWR|O_CREAT|O_TRUNC, 0666);
+	if (fd < 0) {
+		perror(args->fname);
+		goto err;
+	}
+
+	if ((errno = posix_fallocate(fd, 0, (off_t)pb->size)) != 0) {
+		perror("posix_fallocate");
+		close(fd);
+		goto err;
+	}
+
+	pb->addr = pmem_map(fd);
+	close(fd);
+	if (pb->addr == NULL) {
+		perror("pmem_map");
+		goto err;
+	}
+
+	pmembench_set_priv(bench, pb);
+	return 0;
+
+err:
+	free(pb);
+	return -1;
+}
+
+/*
+ * pmem_exit -- unmap the file
+ */
+static int
+pmem_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct pmem_bench *pb = pmembench_get_priv(bench);
+
+	munmap(pb->addr, pb->size);
+	free(pb);
+	return 0;
+}
+
+/*
+ * pmem_init_worker -- allocate the source buffer of the thread
+ */
+static int
+pmem_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	if ((worker->priv = malloc(args->dsize)) == NULL)
+		return -1;
+
+	memset(worker->priv, (int)worker->index + 1, args->dsize);
+	return 0;
+}
+
+/*
+ * pmem_free_worker -- free the source buffer of the thread
+ */
+static void
+pmem_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	free(worker->priv);
+}
+
+/*
+ * pmem_op -- copy data-size bytes to the thread's part of the file
+ */
+static int
+pmem_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct pmem_bench *pb = pmembench_get_priv(bench);
+	struct worker_info *worker = info->worker;
+	size_t dsize = info->args->dsize;
+	size_t nchunks = pb->part / dsize;
+	size_t chunk;
+
+	if (pb->random)
+		chunk = (size_t)rand_r(&worker->seed) % nchunks;
+	else
+		chunk = info->index % nchunks;
+
+	char *dest = pb->addr + worker->index * pb->part + chunk * dsize;
+
+	switch (pb->op) {
+	case PMEM_OP_MEMCPY:
+		pmem_memcpy_persist(dest, worker->priv, dsize);
+		break;
+	case PMEM_OP_PERSIST:
+		memcpy(dest, worker->priv, dsize);
+		pmem_persist(dest, dsize);
+		break;
+	case PMEM_OP_MSYNC:
+		memcpy(dest, worker->priv, dsize);
+		return pmem_msync(dest, dsize);
+	}
+
+	return 0;
+}
+
+static const struct benchmark_opt pmem_memcpy_opts[] = {
+	{ "op", "memcpy", "operation to time: memcpy, persist or msync" },
+	{ "random", "false", "random offsets, sequential ones otherwise" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info pmem_memcpy_info = {
+	.name = "pmem_memcpy",
+	.brief = "copy data-size bytes to a mapped file and make it durable",
+	.opts = pmem_memcpy_opts,
+	.init = pmem_init,
+	.exit = pmem_exit,
+	.init_worker = pmem_init_worker,
+	.free_worker = pmem_free_worker,
+	.operation = pmem_op,
+};
+
+REGISTER_BENCHMARK(pmem_memcpy_info);
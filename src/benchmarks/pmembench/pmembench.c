@@ -0,0 +1,929 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmembench.c -- benchmark framework for the NVM libraries
+ *
+ * usage: pmembench [-o text|csv|json] [-O key=value]... file [scenario...]
+ *        pmembench [-o text|csv|json] [-O key=value]... -b bench [key=value...]
+ *        pmembench -l
+ *
+ * Runs the scenarios of an INI-style scenario file (see scenario.h), or a
+ * single workload configured on the command line.  Every scenario is run
+ * once for each thread count of its "threads" key, and the latency of every
+ * single operation is recorded in a histogram, reported as percentiles.
+ * -O sets a key in all the scenarios, overriding the scenario file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "benchmark.h"
+#include "scenario.h"
+#include "hist.h"
+
+#define	MAX_BENCHMARKS 32
+#define	MAX_SWEEP 64		/* max number of thread counts in a sweep */
+#define	MAX_THREADS 1024
+#define	NSEC_IN_SEC 1000000000.0
+
+struct benchmark {
+	struct benchmark_info *info;
+	void *priv;
+};
+
+enum output_format {
+	OUTPUT_TEXT,
+	OUTPUT_CSV,
+	OUTPUT_JSON
+};
+
+/*
+ * result -- outcome of all the runs of a scenario with one thread count
+ */
+struct result {
+	const char *scenario;
+	const char *bench;
+	unsigned threads;
+	size_t dsize;
+	unsigned repeats;
+	uint64_t ops;		/* operations of all the threads and runs */
+	double time;		/* measured time of all the runs, in seconds */
+	struct hist *lat;	/* latency of every operation, in ns */
+};
+
+/*
+ * thread_ctx -- a worker thread of a single run
+ */
+struct thread_ctx {
+	pthread_t thread;
+	struct benchmark *bench;
+	struct benchmark_args *args;
+	struct worker_info worker;
+	pthread_barrier_t *barrier;
+	struct hist lat;
+	uint64_t start;		/* when the first operation started */
+	uint64_t stop;		/* when the last operation finished */
+	int ret;
+};
+
+static struct benchmark_info *Benchmarks[MAX_BENCHMARKS];
+static unsigned Nbenchmarks;
+
+/* keys handled by pmembench itself, valid in every scenario */
+static const struct benchmark_opt Common_opts[] = {
+	{ "bench", NULL,
+		"workload to run, the name of the scenario by default" },
+	{ "file", NULL, "file used by the workload, removed after each run" },
+	{ "file-size", "0", "size of the file, 0 picks a default" },
+	{ "threads", "1", "thread counts to sweep, e.g. 1,2,4 or 1:*2:16" },
+	{ "ops", "10000", "number of operations per thread" },
+	{ "data-size", "64", "data size of a single operation" },
+	{ "repeats", "1", "number of runs for each thread count" },
+	{ "seed", "1", "seed of the random generators" },
+	{ NULL, NULL, NULL }
+};
+
+/*
+ * pmembench_register -- add a workload, called before main()
+ */
+void
+pmembench_register(struct benchmark_info *info)
+{
+	if (Nbenchmarks == MAX_BENCHMARKS) {
+		fprintf(stderr, "too many benchmarks, %s not registered\n",
+				info->name);
+		return;
+	}
+	Benchmarks[Nbenchmarks++] = info;
+}
+
+/*
+ * pmembench_get_priv -- return the private data of the workload
+ */
+void *
+pmembench_get_priv(struct benchmark *bench)
+{
+	return bench->priv;
+}
+
+/*
+ * pmembench_set_priv -- set the private data of the workload
+ */
+void
+pmembench_set_priv(struct benchmark *bench, void *priv)
+{
+	bench->priv = priv;
+}
+
+/*
+ * parse_size -- (internal) parse a size with an optional K, M, G or T suffix
+ */
+static int
+parse_size(const char *str, size_t *sizep)
+{
+	char *end;
+	errno = 0;
+	unsigned long long size = strtoull(str, &end, 0);
+	if (errno || end == str || *str == '-')
+		return -1;
+
+	unsigned shift = 0;
+	switch (*end) {
+	case 'T': case 't':
+		shift += 10;
+		/* FALLTHROUGH */
+	case 'G': case 'g':
+		shift += 10;
+		/* FALLTHROUGH */
+	case 'M': case 'm':
+		shift += 10;
+		/* FALLTHROUGH */
+	case 'K': case 'k':
+		shift += 10;
+		end++;
+		break;
+	}
+	if (*end != '\0' || (shift && size > (SIZE_MAX >> shift)))
+		return -1;
+
+	*sizep = (size_t)(size << shift);
+	return 0;
+}
+
+/*
+ * benchmark_opt_str -- return the value of an option of the workload
+ */
+const char *
+benchmark_opt_str(struct benchmark_args *args, const char *name)
+{
+	return scenario_get(args->sc, name);
+}
+
+/*
+ * benchmark_opt_size -- return the value of a size option of the workload
+ *
+ * An invalid value terminates the program.
+ */
+size_t
+benchmark_opt_size(struct benchmark_args *args, const char *name)
+{
+	const char *str = scenario_get(args->sc, name);
+	size_t size;
+	if (str == NULL || parse_size(str, &size)) {
+		fprintf(stderr, "%s: invalid size \"%s\"\n", name,
+				str ? str : "");
+		exit(1);
+	}
+
+	return size;
+}
+
+/*
+ * benchmark_opt_bool -- return the value of a boolean option of the workload
+ *
+ * An invalid value terminates the program.
+ */
+int
+benchmark_opt_bool(struct benchmark_args *args, const char *name)
+{
+	const char *str = scenario_get(args->sc, name);
+	if (str && (strcmp(str, "true") == 0 || strcmp(str, "1") == 0 ||
+			strcmp(str, "yes") == 0))
+		return 1;
+	if (str && (strcmp(str, "false") == 0 || strcmp(str, "0") == 0 ||
+			strcmp(str, "no") == 0))
+		return 0;
+
+	fprintf(stderr, "%s: invalid boolean \"%s\"\n", name, str ? str : "");
+	exit(1);
+}
+
+/*
+ * find_benchmark -- (internal) return the workload of the given name
+ */
+static struct benchmark_info *
+find_benchmark(const char *name)
+{
+	for (unsigned i = 0; i < Nbenchmarks; ++i)
+		if (strcmp(Benchmarks[i]->name, name) == 0)
+			return Benchmarks[i];
+
+	return NULL;
+}
+
+/*
+ * find_opt -- (internal) return the option of the given name
+ */
+static const struct benchmark_opt *
+find_opt(const struct benchmark_opt *opts, const char *name)
+{
+	for (; opts && opts->name; opts++)
+		if (strcmp(opts->name, name) == 0)
+			return opts;
+
+	return NULL;
+}
+
+/*
+ * check_keys -- (internal) make sure the keys of a section are known
+ *
+ * With info == NULL the keys may belong to any of the workloads.
+ */
+static int
+check_keys(const struct scenario *sc, const struct benchmark_info *info)
+{
+	int ret = 0;
+
+	for (struct kv *kv = sc->kvs; kv; kv = kv->next) {
+		if (find_opt(Common_opts, kv->key))
+			continue;
+
+		int found = 0;
+		if (info) {
+			found = find_opt(info->opts, kv->key) != NULL;
+		} else {
+			for (unsigned i = 0; i < Nbenchmarks && !found; ++i)
+				found = find_opt(Benchmarks[i]->opts,
+						kv->key) != NULL;
+		}
+
+		if (!found) {
+			fprintf(stderr, "%s: unknown key \"%s\"\n", sc->name,
+					kv->key);
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * resolve -- (internal) return the effective value of a key of a scenario
+ */
+static const char *
+resolve(const struct scenario *overrides, const struct scenario *sc,
+		const struct benchmark_opt *opt)
+{
+	const char *value = scenario_get(overrides, opt->name);
+	if (value == NULL)
+		value = scenario_get(sc, opt->name);
+	if (value == NULL)
+		value = opt->def;
+
+	return value;
+}
+
+/*
+ * parse_threads -- (internal) parse the thread counts of a sweep
+ *
+ * The spec is a comma-separated list of counts and ranges; a range
+ * "first:+step:last" adds step, "first:*step:last" multiplies by it.
+ */
+static int
+parse_threads(const char *spec, unsigned *threads, unsigned *nthreads)
+{
+	*nthreads = 0;
+
+	while (*spec) {
+		char *end;
+		unsigned long first = strtoul(spec, &end, 10);
+		unsigned long step = 0;
+		unsigned long last = first;
+		char op = '+';
+
+		if (*end == ':') {
+			op = end[1];
+			if (op != '+' && op != '*')
+				return -1;
+			step = strtoul(end + 2, &end, 10);
+			if (*end != ':')
+				return -1;
+			last = strtoul(end + 1, &end, 10);
+			if (step == 0 || (op == '*' && step == 1))
+				return -1;
+		}
+		if (*end != ',' && *end != '\0')
+			return -1;
+		if (first == 0 || last < first || last > MAX_THREADS)
+			return -1;
+
+		for (unsigned long t = first; t <= last;
+				t = op == '+' ? t + step : t * step) {
+			if (*nthreads == MAX_SWEEP)
+				return -1;
+			threads[(*nthreads)++] = (unsigned)t;
+			if (step == 0)
+				break;
+		}
+
+		spec = *end ? end + 1 : end;
+	}
+
+	return *nthreads ? 0 : -1;
+}
+
+/*
+ * nsecs -- (internal) return a monotonic timestamp in nanoseconds
+ */
+static uint64_t
+nsecs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * remove_file -- (internal) remove the file of a workload, if it is regular
+ *
+ * Device files are left alone, so a run may use a device directly.
+ */
+static void
+remove_file(const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) == 0 && S_ISREG(st.st_mode))
+		(void) unlink(path);
+}
+
+/*
+ * worker_thread -- (internal) run the operations of a single thread
+ *
+ * The operations of all the threads start together, after every thread
+ * initialized its state, and the measured region ends when the last
+ * thread is done.
+ */
+static void *
+worker_thread(void *arg)
+{
+	struct thread_ctx *ctx = arg;
+	struct benchmark_info *info = ctx->bench->info;
+
+	if (info->init_worker)
+		ctx->ret = info->init_worker(ctx->bench, ctx->args,
+				&ctx->worker);
+	int initialized = ctx->ret == 0;
+
+	pthread_barrier_wait(ctx->barrier);
+	ctx->start = nsecs();
+
+	struct operation_info op = {
+		.worker = &ctx->worker,
+		.args = ctx->args,
+		.index = 0,
+	};
+	for (; ctx->ret == 0 && op.index < ctx->args->n_ops; op.index++) {
+		uint64_t start = nsecs();
+		ctx->ret = info->operation(ctx->bench, &op);
+		hist_record(&ctx->lat, nsecs() - start);
+	}
+
+	ctx->stop = nsecs();
+	pthread_barrier_wait(ctx->barrier);
+
+	if (initialized && info->free_worker)
+		info->free_worker(ctx->bench, ctx->args, &ctx->worker);
+
+	return NULL;
+}
+
+/*
+ * run_once -- (internal) run the workload once, adding up the results
+ */
+static int
+run_once(struct benchmark *bench, struct benchmark_args *args,
+		struct result *res)
+{
+	struct benchmark_info *info = bench->info;
+
+	remove_file(args->fname);
+
+	if (info->init && info->init(bench, args)) {
+		fprintf(stderr, "%s: initialization failed\n", info->name);
+		remove_file(args->fname);
+		return -1;
+	}
+
+	struct thread_ctx *ctx = calloc(args->n_threads, sizeof (*ctx));
+	if (ctx == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+
+	pthread_barrier_t barrier;
+	pthread_barrier_init(&barrier, NULL, args->n_threads + 1);
+
+	for (unsigned i = 0; i < args->n_threads; ++i) {
+		ctx[i].bench = bench;
+		ctx[i].args = args;
+		ctx[i].worker.index = i;
+		ctx[i].worker.seed = args->seed + i;
+		ctx[i].barrier = &barrier;
+		hist_init(&ctx[i].lat);
+
+		if ((errno = pthread_create(&ctx[i].thread, NULL,
+				worker_thread, &ctx[i])) != 0) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&barrier);
+	pthread_barrier_wait(&barrier);
+
+	int ret = 0;
+	uint64_t start = UINT64_MAX;
+	uint64_t stop = 0;
+	for (unsigned i = 0; i < args->n_threads; ++i) {
+		pthread_join(ctx[i].thread, NULL);
+		if (ctx[i].start < start)
+			start = ctx[i].start;
+		if (ctx[i].stop > stop)
+			stop = ctx[i].stop;
+		if (ctx[i].ret) {
+			fprintf(stderr, "%s: thread %u failed\n",
+					info->name, i);
+			ret = -1;
+		}
+		hist_merge(res->lat, &ctx[i].lat);
+		res->ops += ctx[i].lat.count;
+	}
+	res->time += (double)(stop - start) / NSEC_IN_SEC;
+
+	pthread_barrier_destroy(&barrier);
+	free(ctx);
+
+	if (info->exit && info->exit(bench, args)) {
+		fprintf(stderr, "%s: cleanup failed\n", info->name);
+		ret = -1;
+	}
+
+	remove_file(args->fname);
+
+	return ret;
+}
+
+/*
+ * print_str -- (internal) print a string field of the given format
+ */
+static void
+print_str(enum output_format fmt, const char *s)
+{
+	if (fmt == OUTPUT_TEXT) {
+		printf("%-20s ", s);
+		return;
+	}
+
+	if (fmt == OUTPUT_CSV && strpbrk(s, ",\"\n") == NULL) {
+		fputs(s, stdout);
+		return;
+	}
+
+	putchar('"');
+	for (; *s; s++) {
+		if (*s == '"')
+			fputs(fmt == OUTPUT_CSV ? "\"\"" : "\\\"", stdout);
+		else if (*s == '\\' && fmt == OUTPUT_JSON)
+			fputs("\\\\", stdout);
+		else if (*s == '\n' && fmt == OUTPUT_JSON)
+			fputs("\\n", stdout);
+		else
+			putchar(*s);
+	}
+	putchar('"');
+}
+
+/*
+ * print_header -- (internal) print what precedes the results
+ */
+static void
+print_header(enum output_format fmt)
+{
+	switch (fmt) {
+	case OUTPUT_TEXT:
+		printf("%-20s %-20s %7s %9s %12s %9s %9s %9s %9s %9s %9s "
+			"%9s\n", "scenario", "benchmark", "threads",
+			"data-size", "ops/s", "mean[ns]", "p50", "p90", "p99",
+			"p99.9", "p99.99", "max");
+		break;
+	case OUTPUT_CSV:
+		printf("scenario,benchmark,threads,data_size,repeats,ops,"
+			"time_s,ops_per_sec,lat_min_ns,lat_mean_ns,lat_p50_ns,"
+			"lat_p90_ns,lat_p99_ns,lat_p999_ns,lat_p9999_ns,"
+			"lat_max_ns\n");
+		break;
+	case OUTPUT_JSON:
+		printf("[");
+		break;
+	}
+}
+
+/*
+ * print_result -- (internal) print the results of one thread count
+ */
+static void
+print_result(enum output_format fmt, const struct result *res, int first)
+{
+	const struct hist *h = res->lat;
+	double ops_per_sec = res->time > 0 ? (double)res->ops / res->time : 0;
+
+	switch (fmt) {
+	case OUTPUT_TEXT:
+		print_str(fmt, res->scenario);
+		print_str(fmt, res->bench);
+		printf("%7u %9zu %12.0f %9.0f %9ju %9ju %9ju %9ju %9ju "
+			"%9ju\n", res->threads, res->dsize, ops_per_sec,
+			hist_mean(h), hist_percentile(h, 50),
+			hist_percentile(h, 90), hist_percentile(h, 99),
+			hist_percentile(h, 99.9), hist_percentile(h, 99.99),
+			h->max);
+		break;
+	case OUTPUT_CSV:
+		print_str(fmt, res->scenario);
+		putchar(',');
+		print_str(fmt, res->bench);
+		printf(",%u,%zu,%u,%ju,%f,%f,%ju,%f,%ju,%ju,%ju,%ju,%ju,%ju\n",
+			res->threads, res->dsize, res->repeats, res->ops,
+			res->time, ops_per_sec, h->count ? h->min : 0,
+			hist_mean(h), hist_percentile(h, 50),
+			hist_percentile(h, 90), hist_percentile(h, 99),
+			hist_percentile(h, 99.9), hist_percentile(h, 99.99),
+			h->max);
+		break;
+	case OUTPUT_JSON:
+		printf("%s\n  {\"scenario\": ", first ? "" : ",");
+		print_str(fmt, res->scenario);
+		printf(", \"benchmark\": ");
+		print_str(fmt, res->bench);
+		printf(", \"threads\": %u, \"data_size\": %zu, "
+			"\"repeats\": %u, \"ops\": %ju, \"time_s\": %f, "
+			"\"ops_per_sec\": %f,\n   \"latency_ns\": {"
+			"\"min\": %ju, \"mean\": %f, \"p50\": %ju, "
+			"\"p90\": %ju, \"p99\": %ju, \"p99.9\": %ju, "
+			"\"p99.99\": %ju, \"max\": %ju}}",
+			res->threads, res->dsize, res->repeats, res->ops,
+			res->time, ops_per_sec, h->count ? h->min : 0,
+			hist_mean(h), hist_percentile(h, 50),
+			hist_percentile(h, 90), hist_percentile(h, 99),
+			hist_percentile(h, 99.9), hist_percentile(h, 99.99),
+			h->max);
+		break;
+	}
+
+	fflush(stdout);
+}
+
+/*
+ * print_footer -- (internal) print what follows the results
+ */
+static void
+print_footer(enum output_format fmt)
+{
+	if (fmt == OUTPUT_JSON)
+		printf("\n]\n");
+}
+
+/*
+ * set_effective -- (internal) resolve all the options of a scenario
+ */
+static int
+set_effective(struct scenario *eff, const struct scenario *overrides,
+		const struct scenario *sc, const struct benchmark_opt *opts)
+{
+	for (; opts && opts->name; opts++) {
+		const char *value = resolve(overrides, sc, opts);
+		if (value && scenario_set(eff, opts->name, value)) {
+			perror("scenario_set");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * scenario_bench -- (internal) find the benchmark of a scenario
+ *
+ * Returns NULL when the benchmark or any of the keys are unknown.
+ */
+static struct benchmark_info *
+scenario_bench(const struct scenario *sc, const struct scenario *overrides)
+{
+	const char *name = scenario_get(overrides, "bench");
+	if (name == NULL)
+		name = scenario_get(sc, "bench");
+	if (name == NULL)
+		name = sc->name;
+
+	struct benchmark_info *info = find_benchmark(name);
+	if (info == NULL) {
+		fprintf(stderr, "%s: unknown benchmark \"%s\"\n", sc->name,
+				name);
+		return NULL;
+	}
+
+	if (check_keys(sc, info) || check_keys(overrides, info))
+		return NULL;
+
+	return info;
+}
+
+/*
+ * is_selected -- (internal) check if a scenario was named to be run
+ */
+static int
+is_selected(const struct scenario *sc, char **selected, int nselected)
+{
+	if (nselected == 0)
+		return 1;
+
+	for (int i = 0; i < nselected; ++i)
+		if (strcmp(selected[i], sc->name) == 0)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * run_scenario -- (internal) run a scenario for all its thread counts
+ */
+static int
+run_scenario(const struct scenario *sc, const struct scenario *overrides,
+		enum output_format fmt, int *first)
+{
+	struct benchmark_info *info = scenario_bench(sc, overrides);
+	if (info == NULL)
+		return -1;
+
+	struct scenarios *tmp = scenarios_new();
+	struct scenario *eff = tmp ? scenarios_add(tmp, sc->name) : NULL;
+	if (eff == NULL || set_effective(eff, overrides, sc, Common_opts) ||
+			set_effective(eff, overrides, sc, info->opts)) {
+		perror(sc->name);
+		exit(1);
+	}
+
+	int ret = -1;
+	struct benchmark_args args;
+	memset(&args, 0, sizeof (args));
+	args.sc = eff;
+
+	unsigned threads[MAX_SWEEP];
+	unsigned nthreads;
+	size_t repeats;
+	size_t seed;
+
+	args.fname = scenario_get(eff, "file");
+	if (args.fname == NULL) {
+		fprintf(stderr, "%s: no file given\n", sc->name);
+		goto out;
+	}
+	if (parse_threads(scenario_get(eff, "threads"), threads, &nthreads)) {
+		fprintf(stderr, "%s: invalid threads \"%s\"\n", sc->name,
+				scenario_get(eff, "threads"));
+		goto out;
+	}
+	args.fsize = benchmark_opt_size(&args, "file-size");
+	args.n_ops = benchmark_opt_size(&args, "ops");
+	args.dsize = benchmark_opt_size(&args, "data-size");
+	repeats = benchmark_opt_size(&args, "repeats");
+	seed = benchmark_opt_size(&args, "seed");
+	if (args.n_ops == 0 || repeats == 0) {
+		fprintf(stderr, "%s: no operations to run\n", sc->name);
+		goto out;
+	}
+
+	struct benchmark bench = { info, NULL };
+	struct hist *lat = malloc(sizeof (*lat));
+	if (lat == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+
+	ret = 0;
+	for (unsigned t = 0; t < nthreads && ret == 0; ++t) {
+		struct result res = {
+			.scenario = sc->name,
+			.bench = info->name,
+			.threads = threads[t],
+			.dsize = args.dsize,
+			.repeats = (unsigned)repeats,
+			.lat = lat,
+		};
+		hist_init(lat);
+
+		args.n_threads = threads[t];
+		for (size_t r = 0; r < repeats && ret == 0; ++r) {
+			args.seed = (unsigned)(seed + r * MAX_THREADS);
+			ret = run_once(&bench, &args, &res);
+		}
+
+		if (ret == 0) {
+			print_result(fmt, &res, *first);
+			*first = 0;
+		}
+	}
+
+	free(lat);
+out:
+	scenarios_free(tmp);
+	return ret;
+}
+
+/*
+ * print_opts -- (internal) print the options with their defaults
+ */
+static void
+print_opts(const struct benchmark_opt *opts)
+{
+	for (; opts && opts->name; opts++)
+		printf("    %-12s %-10s %s\n", opts->name,
+				opts->def ? opts->def : "-", opts->help);
+}
+
+/*
+ * list_benchmarks -- (internal) print the workloads and their options
+ */
+static void
+list_benchmarks(void)
+{
+	printf("options of all the benchmarks:\n");
+	print_opts(Common_opts);
+
+	for (unsigned i = 0; i < Nbenchmarks; ++i) {
+		printf("\n%s -- %s\n", Benchmarks[i]->name,
+				Benchmarks[i]->brief);
+		print_opts(Benchmarks[i]->opts);
+	}
+}
+
+/*
+ * usage -- (internal) print the usage and exit
+ */
+static void
+usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-o text|csv|json] [-O key=value]... "
+			"file [scenario...]\n"
+			"       %s [-o text|csv|json] [-O key=value]... "
+			"-b bench [key=value...]\n"
+			"       %s -l\n", prog, prog, prog);
+	exit(1);
+}
+
+/*
+ * set_kv -- (internal) set a key given as "key=value"
+ */
+static void
+set_kv(struct scenario *sc, const char *arg)
+{
+	char *kv = strdup(arg);
+	char *eq = kv ? strchr(kv, '=') : NULL;
+	if (eq == NULL || eq == kv) {
+		fprintf(stderr, "invalid option \"%s\", expected "
+				"key=value\n", arg);
+		exit(1);
+	}
+
+	*eq = '\0';
+	if (scenario_set(sc, kv, eq + 1)) {
+		perror("scenario_set");
+		exit(1);
+	}
+	free(kv);
+}
+
+int
+main(int argc, char *argv[])
+{
+	enum output_format fmt = OUTPUT_TEXT;
+	const char *bench_name = NULL;
+
+	struct scenarios *ss = scenarios_new();
+	struct scenarios *oss = scenarios_new();
+	struct scenario *overrides = oss ? scenarios_add(oss, "-O") : NULL;
+	if (ss == NULL || overrides == NULL) {
+		perror("scenarios_new");
+		exit(1);
+	}
+
+	int opt;
+	while ((opt = getopt(argc, argv, "o:O:b:lh")) != -1) {
+		switch (opt) {
+		case 'o':
+			if (strcmp(optarg, "text") == 0)
+				fmt = OUTPUT_TEXT;
+			else if (strcmp(optarg, "csv") == 0)
+				fmt = OUTPUT_CSV;
+			else if (strcmp(optarg, "json") == 0)
+				fmt = OUTPUT_JSON;
+			else
+				usage(argv[0]);
+			break;
+		case 'O':
+			set_kv(overrides, optarg);
+			break;
+		case 'b':
+			bench_name = optarg;
+			break;
+		case 'l':
+			list_benchmarks();
+			exit(0);
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/* scenarios to run, all of them by default */
+	int nselected = 0;
+	char **selected = NULL;
+
+	if (bench_name) {
+		struct scenario *sc = scenarios_add(ss, bench_name);
+		if (sc == NULL) {
+			perror("scenarios_add");
+			exit(1);
+		}
+		for (int i = optind; i < argc; ++i)
+			set_kv(sc, argv[i]);
+	} else {
+		if (optind >= argc)
+			usage(argv[0]);
+		if (scenarios_read(ss, argv[optind]))
+			exit(1);
+		if (ss->global && check_keys(ss->global, NULL))
+			exit(1);
+
+		selected = &argv[optind + 1];
+		nselected = argc - optind - 1;
+		for (int i = 0; i < nselected; ++i) {
+			if (scenarios_find(ss, selected[i]) == NULL) {
+				fprintf(stderr, "%s: no scenario \"%s\"\n",
+						argv[optind], selected[i]);
+				exit(1);
+			}
+		}
+	}
+
+	/* report the mistakes before anything is run */
+	for (struct scenario *sc = ss->head; sc; sc = sc->next) {
+		if (is_selected(sc, selected, nselected) &&
+				scenario_bench(sc, overrides) == NULL)
+			exit(1);
+	}
+
+	int ret = 0;
+	int first = 1;
+	print_header(fmt);
+
+	for (struct scenario *sc = ss->head; sc; sc = sc->next) {
+		if (is_selected(sc, selected, nselected) &&
+				run_scenario(sc, overrides, fmt, &first))
+			ret = 1;
+	}
+
+	print_footer(fmt);
+
+	scenarios_free(oss);
+	scenarios_free(ss);
+
+	return ret;
+}
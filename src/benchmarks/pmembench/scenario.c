@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * scenario.c -- scenario files of pmembench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "scenario.h"
+
+#define	GLOBAL_SECTION "global"
+#define	MAX_LINE 1024
+
+/*
+ * scenarios_new -- allocate an empty list of scenarios
+ */
+struct scenarios *
+scenarios_new(void)
+{
+	return calloc(1, sizeof (struct scenarios));
+}
+
+/*
+ * scenario_free -- (internal) free a scenario with all its keys
+ */
+static void
+scenario_free(struct scenario *sc)
+{
+	struct kv *kv = sc->kvs;
+	while (kv) {
+		struct kv *next = kv->next;
+		free(kv->key);
+		free(kv->value);
+		free(kv);
+		kv = next;
+	}
+	free(sc->name);
+	free(sc);
+}
+
+/*
+ * scenarios_free -- free the list of scenarios
+ */
+void
+scenarios_free(struct scenarios *ss)
+{
+	struct scenario *sc = ss->head;
+	while (sc) {
+		struct scenario *next = sc->next;
+		scenario_free(sc);
+		sc = next;
+	}
+	if (ss->global)
+		scenario_free(ss->global);
+	free(ss);
+}
+
+/*
+ * scenarios_add -- append a new, empty scenario
+ *
+ * The "global" scenario is not a part of the list, it only provides the
+ * defaults of the others, including the ones added before it.
+ */
+struct scenario *
+scenarios_add(struct scenarios *ss, const char *name)
+{
+	int global = strcmp(name, GLOBAL_SECTION) == 0;
+	if (global && ss->global)
+		return ss->global;
+
+	struct scenario *sc = calloc(1, sizeof (*sc));
+	if (sc == NULL)
+		return NULL;
+	if ((sc->name = strdup(name)) == NULL) {
+		free(sc);
+		return NULL;
+	}
+
+	if (global) {
+		ss->global = sc;
+		for (struct scenario *s = ss->head; s; s = s->next)
+			s->defaults = sc;
+		return sc;
+	}
+
+	sc->defaults = ss->global;
+	if (ss->tail)
+		ss->tail->next = sc;
+	else
+		ss->head = sc;
+	ss->tail = sc;
+
+	return sc;
+}
+
+/*
+ * scenarios_find -- return the scenario of the given name
+ */
+struct scenario *
+scenarios_find(struct scenarios *ss, const char *name)
+{
+	for (struct scenario *sc = ss->head; sc; sc = sc->next)
+		if (strcmp(sc->name, name) == 0)
+			return sc;
+
+	return NULL;
+}
+
+/*
+ * scenario_set -- set the value of a key, replacing the previous one
+ */
+int
+scenario_set(struct scenario *sc, const char *key, const char *value)
+{
+	char *v = strdup(value);
+	if (v == NULL)
+		return -1;
+
+	for (struct kv *kv = sc->kvs; kv; kv = kv->next) {
+		if (strcmp(kv->key, key) == 0) {
+			free(kv->value);
+			kv->value = v;
+			return 0;
+		}
+	}
+
+	struct kv *kv = malloc(sizeof (*kv));
+	if (kv == NULL || (kv->key = strdup(key)) == NULL) {
+		free(kv);
+		free(v);
+		return -1;
+	}
+	kv->value = v;
+	kv->next = sc->kvs;
+	sc->kvs = kv;
+
+	return 0;
+}
+
+/*
+ * scenario_get -- return the value of a key, or NULL if it is not set
+ */
+const char *
+scenario_get(const struct scenario *sc, const char *key)
+{
+	for (; sc; sc = sc->defaults)
+		for (struct kv *kv = sc->kvs; kv; kv = kv->next)
+			if (strcmp(kv->key, key) == 0)
+				return kv->value;
+
+	return NULL;
+}
+
+/*
+ * strip -- (internal) remove the leading and trailing white space in place
+ */
+static char *
+strip(char *s)
+{
+	while (isspace((unsigned char)*s))
+		s++;
+
+	char *end = s + strlen(s);
+	while (end > s && isspace((unsigned char)*(end - 1)))
+		end--;
+	*end = '\0';
+
+	return s;
+}
+
+/*
+ * scenarios_read -- add the scenarios defined in a file
+ */
+int
+scenarios_read(struct scenarios *ss, const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	char buf[MAX_LINE];
+	struct scenario *sc = NULL;
+	unsigned lineno = 0;
+	int ret = 0;
+
+	while (fgets(buf, sizeof (buf), fp) != NULL) {
+		lineno++;
+		char *line = strip(buf);
+
+		if (*line == '\0' || *line == '#' || *line == ';')
+			continue;
+
+		if (*line == '[') {
+			char *end = strchr(line, ']');
+			if (end == NULL || end[1] != '\0' || end == line + 1) {
+				fprintf(stderr, "%s:%u: invalid section\n",
+						path, lineno);
+				ret = -1;
+				break;
+			}
+			*end = '\0';
+			line = strip(line + 1);
+			if (strcmp(line, GLOBAL_SECTION) &&
+					scenarios_find(ss, line)) {
+				fprintf(stderr, "%s:%u: duplicated section "
+						"\"%s\"\n", path, lineno, line);
+				ret = -1;
+				break;
+			}
+			if ((sc = scenarios_add(ss, line)) == NULL) {
+				perror("scenarios_add");
+				ret = -1;
+				break;
+			}
+			continue;
+		}
+
+		char *eq = strchr(line, '=');
+		if (sc == NULL || eq == NULL || eq == line) {
+			fprintf(stderr, "%s:%u: expected \"key = value\" "
+					"in a section\n", path, lineno);
+			ret = -1;
+			break;
+		}
+
+		*eq = '\0';
+		if (scenario_set(sc, strip(line), strip(eq + 1))) {
+			perror("scenario_set");
+			ret = -1;
+			break;
+		}
+	}
+
+	fclose(fp);
+
+	return ret;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014, Intel Corporation
+ * Copyright (c) 2015, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -30,62 +30,40 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+
 /*
- * tasks.h -- definitions for the thread tasks
+ * scenario.h -- scenario files of pmembench
+ *
+ * A scenario file is an INI-style file: every "[name]" section is one
+ * scenario, made of "key = value" lines.  The keys of the section named
+ * "global" are the defaults of all the other scenarios.  Lines starting
+ * with '#' or ';' are comments.
  */
 
-#include <stdlib.h>
-#include <inttypes.h>
-#include <libvmem.h>
-
-#define	SUCCESS 0
-#define	FAILURE -1
-
-typedef enum allocator_e {
-	ALLOCATOR_VMEM,
-	ALLOCATOR_MALLOC,
-	MAX_ALLOCATOR
-} allocator_t;
-
-typedef enum allocation_type_e {
-	ALLOCATION_UNKNOWN,
-	ALLOCATION_STATIC,
-	ALLOCATION_RANGE
-} allocation_type_t;
-
-typedef struct arguments_s
-{
-	int thread_count;
-	int pool_per_thread;
-	uint64_t ops_count;
-	unsigned int seed;
-	unsigned int allocation_size;
-	unsigned int allocation_size_max;
-	allocation_type_t allocation_type;
-	allocator_t allocator;
-	char *dir_path;
-} arguments_t;
-
-typedef int (*task_f)(int, void *arg, struct random_data *rand_state);
-
-enum {
-	TASK_MALLOC,
-	TASK_FREE,
-	MAX_TASK
+struct kv {
+	char *key;
+	char *value;
+	struct kv *next;
 };
 
-int task_malloc(int i, void *arg, struct random_data *rand_state);
-int task_free(int i, void *arg, struct random_data *rand_state);
-
-extern task_f tasks[MAX_TASK];
-
-extern int allocation_range_min;
-extern int allocation_range_max;
-extern allocator_t allocator;
+struct scenario {
+	char *name;
+	struct kv *kvs;
+	const struct scenario *defaults;	/* consulted for missing keys */
+	struct scenario *next;
+};
 
-extern void **allocated_mem;
+struct scenarios {
+	struct scenario *head;
+	struct scenario *tail;
+	struct scenario *global;	/* the "global" section, if any */
+};
 
-extern const int allocation_sizes[];
+struct scenarios *scenarios_new(void);
+void scenarios_free(struct scenarios *ss);
+int scenarios_read(struct scenarios *ss, const char *path);
+struct scenario *scenarios_add(struct scenarios *ss, const char *name);
+struct scenario *scenarios_find(struct scenarios *ss, const char *name);
 
-int run_threads(arguments_t *arguments, task_f task,
-	int per_thread_arg, void **arg, double *elapsed);
+int scenario_set(struct scenario *sc, const char *key, const char *value);
+const char *scenario_get(const struct scenario *sc, const char *key);
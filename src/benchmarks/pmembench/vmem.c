@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vmem.c -- libvmem workloads: malloc or free from a pool shared by all the
+ * threads, creation or deletion of many pools at once, and release of
+ * a request's objects by vmem_free() or vmem_reset()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <libvmem.h>
+
+#include "benchmark.h"
+
+struct vmem_bench {
+	VMEM *vmp;
+	void *addr;		/* mapping of the file the pool lives in */
+	size_t size;
+	int free_op;		/* time vmem_free() instead of vmem_malloc() */
+};
+
+/*
+ * vmem_init -- map the file and create the pool in it
+ */
+static int
+vmem_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct vmem_bench *vb = calloc(1, sizeof (*vb));
+	if (vb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, "malloc") && strcmp(op, "free")) {
+		fprintf(stderr, "op: expected malloc or free, got \"%s\"\n",
+				op);
+		goto err;
+	}
+	vb->free_op = strcmp(op, "free") == 0;
+
+	vb->size = args->fsize;
+	if (vb->size == 0)
+		vb->size = VMEM_MIN_POOL +
+			2 * args->n_threads * args->n_ops * args->dsize;
+
+	int fd = open(args->fname, O_RDWR|O_CREAT|O_TRUNC, 0666);
+	if (fd < 0) {
+		perror(args->fname);
+		goto err;
+	}
+
+	if ((errno = posix_fallocate(fd, 0, (off_t)vb->size)) != 0) {
+		perror("posix_fallocate");
+		close(fd);
+		goto err;
+	}
+
+	vb->addr = mmap(NULL, vb->size, PROT_READ|PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	close(fd);
+	if (vb->addr == MAP_FAILED) {
+		perror("mmap");
+		goto err;
+	}
+
+	if ((vb->vmp = vmem_create_in_region(vb->addr, vb->size)) == NULL) {
+		perror("vmem_create_in_region");
+		munmap(vb->addr, vb->size);
+		goto err;
+	}
+
+	pmembench_set_priv(bench, vb);
+	return 0;
+
+err:
+	free(vb);
+	return -1;
+}
+
+/*
+ * vmem_exit -- delete the pool and unmap the file
+ */
+static int
+vmem_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+
+	vmem_delete(vb->vmp);
+	munmap(vb->addr, vb->size);
+	free(vb);
+	return 0;
+}
+
+/*
+ * vmem_init_worker -- allocate the table of the thread's pointers
+ *
+ * When the frees are timed, the allocations are done here.
+ */
+static int
+vmem_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+
+	void **ptrs = calloc(args->n_ops, sizeof (void *));
+	if (ptrs == NULL)
+		return -1;
+
+	for (size_t i = 0; vb->free_op && i < args->n_ops; ++i) {
+		if ((ptrs[i] = vmem_malloc(vb->vmp, args->dsize)) == NULL) {
+			perror("vmem_malloc");
+			while (i--)
+				vmem_free(vb->vmp, ptrs[i]);
+			free(ptrs);
+			return -1;
+		}
+	}
+
+	worker->priv = ptrs;
+	return 0;
+}
+
+/*
+ * vmem_free_worker -- free whatever the run left allocated
+ */
+static void
+vmem_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+	void **ptrs = worker->priv;
+
+	for (size_t i = 0; !vb->free_op && i < args->n_ops; ++i)
+		vmem_free(vb->vmp, ptrs[i]);
+
+	free(ptrs);
+}
+
+/*
+ * vmem_op -- a single vmem_malloc() or vmem_free()
+ */
+static int
+vmem_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+	void **ptrs = info->worker->priv;
+
+	if (vb->free_op) {
+		vmem_free(vb->vmp, ptrs[info->index]);
+		ptrs[info->index] = NULL;
+		return 0;
+	}
+
+	ptrs[info->index] = vmem_malloc(vb->vmp, info->args->dsize);
+	return ptrs[info->index] ? 0 : -1;
+}
+
+static const struct benchmark_opt vmem_malloc_opts[] = {
+	{ "op", "malloc", "operation to time: malloc or free" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info vmem_malloc_info = {
+	.name = "vmem_malloc",
+	.brief = "vmem_malloc() or vmem_free() of data-size bytes",
+	.opts = vmem_malloc_opts,
+	.init = vmem_init,
+	.exit = vmem_exit,
+	.init_worker = vmem_init_worker,
+	.free_worker = vmem_free_worker,
+	.operation = vmem_op,
+};
+
+REGISTER_BENCHMARK(vmem_malloc_info);
+
+/*
+ * vmem_pools_worker -- the pools of a thread and the regions they live in
+ */
+struct vmem_pools_worker {
+	VMEM **pools;
+	char *addr;		/* n_ops regions of VMEM_MIN_POOL bytes */
+};
+
+/*
+ * vmem_pools_init -- check the options
+ */
+static int
+vmem_pools_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct vmem_bench *vb = calloc(1, sizeof (*vb));
+	if (vb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, "create") && strcmp(op, "delete")) {
+		fprintf(stderr, "op: expected create or delete, got \"%s\"\n",
+				op);
+		free(vb);
+		return -1;
+	}
+	vb->free_op = strcmp(op, "delete") == 0;
+
+	pmembench_set_priv(bench, vb);
+	return 0;
+}
+
+/*
+ * vmem_pools_exit -- free the options
+ */
+static int
+vmem_pools_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	free(pmembench_get_priv(bench));
+	return 0;
+}
+
+/*
+ * vmem_pools_init_worker -- reserve the regions of the thread's pools
+ *
+ * The regions are anonymous memory, only the pages a pool touches are ever
+ * allocated.  When the deletions are timed, the pools are created here.
+ */
+static int
+vmem_pools_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+
+	struct vmem_pools_worker *w = calloc(1, sizeof (*w));
+	if (w == NULL)
+		return -1;
+
+	if ((w->pools = calloc(args->n_ops, sizeof (VMEM *))) == NULL)
+		goto err;
+
+	w->addr = mmap(NULL, args->n_ops * VMEM_MIN_POOL,
+			PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (w->addr == MAP_FAILED) {
+		perror("mmap");
+		goto err;
+	}
+
+	for (size_t i = 0; vb->free_op && i < args->n_ops; ++i) {
+		w->pools[i] = vmem_create_in_region(w->addr +
+				i * VMEM_MIN_POOL, VMEM_MIN_POOL);
+		if (w->pools[i] == NULL) {
+			perror("vmem_create_in_region");
+			while (i--)
+				vmem_delete(w->pools[i]);
+			munmap(w->addr, args->n_ops * VMEM_MIN_POOL);
+			goto err;
+		}
+	}
+
+	worker->priv = w;
+	return 0;
+
+err:
+	free(w->pools);
+	free(w);
+	return -1;
+}
+
+/*
+ * vmem_pools_free_worker -- delete whatever the run left and unmap
+ */
+static void
+vmem_pools_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_pools_worker *w = worker->priv;
+
+	for (size_t i = 0; i < args->n_ops; ++i)
+		if (w->pools[i] != NULL)
+			vmem_delete(w->pools[i]);
+
+	munmap(w->addr, args->n_ops * VMEM_MIN_POOL);
+	free(w->pools);
+	free(w);
+}
+
+/*
+ * vmem_pools_op -- a single vmem_create_in_region() or vmem_delete()
+ *
+ * A created pool is used for one allocation of data-size bytes, so that
+ * the thread's per pool state is set up as well.
+ */
+static int
+vmem_pools_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct vmem_bench *vb = pmembench_get_priv(bench);
+	struct vmem_pools_worker *w = info->worker->priv;
+	size_t i = info->index;
+
+	if (vb->free_op) {
+		vmem_delete(w->pools[i]);
+		w->pools[i] = NULL;
+		return 0;
+	}
+
+	w->pools[i] = vmem_create_in_region(w->addr + i * VMEM_MIN_POOL,
+			VMEM_MIN_POOL);
+	if (w->pools[i] == NULL)
+		return -1;
+
+	void *ptr = vmem_malloc(w->pools[i], info->args->dsize);
+	if (ptr == NULL)
+		return -1;
+	vmem_free(w->pools[i], ptr);
+
+	return 0;
+}
+
+static const struct benchmark_opt vmem_pools_opts[] = {
+	{ "op", "create", "operation to time: create or delete" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info vmem_pools_info = {
+	.name = "vmem_pools",
+	.brief = "vmem_create_in_region() or vmem_delete() of ops pools",
+	.opts = vmem_pools_opts,
+	.init = vmem_pools_init,
+	.exit = vmem_pools_exit,
+	.init_worker = vmem_pools_init_worker,
+	.free_worker = vmem_pools_free_worker,
+	.operation = vmem_pools_op,
+};
+
+REGISTER_BENCHMARK(vmem_pools_info);
+
+/*
+ * vmem_reset_bench -- the way the objects of a request are released
+ */
+struct vmem_reset_bench {
+	enum {
+		RELEASE_FREE,		/* vmem_free() of every object */
+		RELEASE_RESET,		/* vmem_reset() of a regular pool */
+		RELEASE_RESET_ONLY,	/* vmem_reset() of a reset-only pool */
+	} release;
+	size_t objects;
+};
+
+/*
+ * vmem_reset_worker -- the private pool of a thread and its region
+ */
+struct vmem_reset_worker {
+	VMEM *vmp;
+	void **ptrs;
+	void *addr;
+	size_t size;
+};
+
+/*
+ * vmem_reset_init -- check the options
+ */
+static int
+vmem_reset_init(struct benchmark *bench, struct benchmark_args *args)
+{
+	struct vmem_reset_bench *rb = calloc(1, sizeof (*rb));
+	if (rb == NULL) {
+		perror("calloc");
+		return -1;
+	}
+
+	const char *op = benchmark_opt_str(args, "op");
+	if (strcmp(op, "free") == 0)
+		rb->release = RELEASE_FREE;
+	else if (strcmp(op, "reset") == 0)
+		rb->release = RELEASE_RESET;
+	else if (strcmp(op, "reset-only") == 0)
+		rb->release = RELEASE_RESET_ONLY;
+	else {
+		fprintf(stderr, "op: expected free, reset or reset-only, "
+				"got \"%s\"\n", op);
+		free(rb);
+		return -1;
+	}
+
+	rb->objects = benchmark_opt_size(args, "objects");
+	if (rb->objects == 0) {
+		fprintf(stderr, "objects: must be greater than 0\n");
+		free(rb);
+		return -1;
+	}
+
+	pmembench_set_priv(bench, rb);
+	return 0;
+}
+
+/*
+ * vmem_reset_exit -- free the options
+ */
+static int
+vmem_reset_exit(struct benchmark *bench, struct benchmark_args *args)
+{
+	free(pmembench_get_priv(bench));
+	return 0;
+}
+
+/*
+ * vmem_reset_init_worker -- create the thread's pool in anonymous memory
+ *
+ * Every thread has a pool of its own, as a reset drops the objects of all
+ * the threads using a pool.
+ */
+static int
+vmem_reset_init_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_reset_bench *rb = pmembench_get_priv(bench);
+
+	struct vmem_reset_worker *w = calloc(1, sizeof (*w));
+	if (w == NULL)
+		return -1;
+
+	if ((w->ptrs = calloc(rb->objects, sizeof (void *))) == NULL)
+		goto err;
+
+	w->size = VMEM_MIN_POOL + 2 * rb->objects * args->dsize;
+	w->addr = mmap(NULL, w->size, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+	if (w->addr == MAP_FAILED) {
+		perror("mmap");
+		goto err;
+	}
+
+	int flags = rb->release == RELEASE_RESET_ONLY ? VMEM_RESET_ONLY : 0;
+	w->vmp = vmem_create_in_region_flags(w->addr, w->size, flags);
+	if (w->vmp == NULL) {
+		perror("vmem_create_in_region_flags");
+		munmap(w->addr, w->size);
+		goto err;
+	}
+
+	worker->priv = w;
+	return 0;
+
+err:
+	free(w->ptrs);
+	free(w);
+	return -1;
+}
+
+/*
+ * vmem_reset_free_worker -- delete the thread's pool and unmap it
+ */
+static void
+vmem_reset_free_worker(struct benchmark *bench, struct benchmark_args *args,
+		struct worker_info *worker)
+{
+	struct vmem_reset_worker *w = worker->priv;
+
+	vmem_delete(w->vmp);
+	munmap(w->addr, w->size);
+	free(w->ptrs);
+	free(w);
+}
+
+/*
+ * vmem_reset_op -- allocate "objects" objects and release all of them
+ */
+static int
+vmem_reset_op(struct benchmark *bench, struct operation_info *info)
+{
+	struct vmem_reset_bench *rb = pmembench_get_priv(bench);
+	struct vmem_reset_worker *w = info->worker->priv;
+
+	for (size_t i = 0; i < rb->objects; ++i) {
+		w->ptrs[i] = vmem_malloc(w->vmp, info->args->dsize);
+		if (w->ptrs[i] == NULL)
+			return -1;
+	}
+
+	if (rb->release != RELEASE_FREE)
+		return vmem_reset(w->vmp);
+
+	for (size_t i = 0; i < rb->objects; ++i)
+		vmem_free(w->vmp, w->ptrs[i]);
+
+	return 0;
+}
+
+static const struct benchmark_opt vmem_reset_opts[] = {
+	{ "op", "reset", "release with: free, reset or reset-only" },
+	{ "objects", "1000", "number of objects allocated per operation" },
+	{ NULL, NULL, NULL }
+};
+
+static struct benchmark_info vmem_reset_info = {
+	.name = "vmem_reset",
+	.brief = "vmem_malloc()s released by vmem_free() or vmem_reset()",
+	.opts = vmem_reset_opts,
+	.init = vmem_reset_init,
+	.exit = vmem_reset_exit,
+	.init_worker = vmem_reset_init_worker,
+	.free_worker = vmem_reset_free_worker,
+	.operation = vmem_reset_op,
+};
+
+REGISTER_BENCHMARK(vmem_reset_info);
@@ -0,0 +1,73 @@
+#! /bin/bash
+#
+# Copyright (c) 2015, Intel Corporation
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in
+#       the documentation and/or other materials provided with the
+#       distribution.
+#
+#     * Neither the name of Intel Corporation nor the names of its
+#       contributors may be used to endorse or promote products derived
+#       from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#
+# RUN.sh -- measure fork(2) latency of libvmmalloc for growing pool sizes
+#
+# Usage: RUN.sh [POOL_DIR] [FORK_OPTION] [ITERATIONS] [NUM_TESTS] [SIZE_START]
+#
+POOL_DIR="/tmp"
+FORK_OPTION=2
+ITERATIONS=10
+NUM_TESTS=7
+SIZE_START=$((64 * 1024 * 1024))
+SIZE_MULTIPLIER=2
+USED_PERCENT=10
+
+LIBVMMALLOC=../../nondebug/libvmmalloc.so
+
+[ -n "$1" ] && POOL_DIR=$1
+[ -n "$2" ] && FORK_OPTION=$2
+[ -n "$3" ] && ITERATIONS=$3
+[ -n "$4" ] && NUM_TESTS=$4
+[ -n "$5" ] && SIZE_START=$5
+
+RUNS=`seq $NUM_TESTS`
+LOG_OUT=vmmalloc_fork.out
+
+rm -f $LOG_OUT
+
+POOL_SIZE=$SIZE_START
+
+for i in $RUNS ; do
+	USED_SIZE=$(($POOL_SIZE * $USED_PERCENT / 100))
+
+	echo "[#$i/$NUM_TESTS] VMMALLOC_POOL_SIZE=$POOL_SIZE ./vmmalloc_fork $USED_SIZE $ITERATIONS"
+	VMMALLOC_POOL_DIR=$POOL_DIR VMMALLOC_POOL_SIZE=$POOL_SIZE \
+		VMMALLOC_FORK=$FORK_OPTION LD_PRELOAD=$LIBVMMALLOC \
+		./vmmalloc_fork $USED_SIZE $ITERATIONS >> $LOG_OUT
+
+	POOL_SIZE=$(($POOL_SIZE * $SIZE_MULTIPLIER));
+done
+
+gnuplot gnuplot_vmmalloc_fork.p
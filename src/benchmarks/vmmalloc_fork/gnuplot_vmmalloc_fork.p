@@ -0,0 +1,18 @@
+set terminal png size 1000,500
+date=system("date +%F_%H-%M-%S")
+filename='benchmark_vmmalloc_fork'.date.'.png'
+set output filename
+set datafile separator ';'
+unset log
+unset label
+set logscale xy 2
+set grid
+set xtic auto
+set size ratio 0.5
+set ytic auto
+set format y "%3.2e"
+set title "Latency of fork() with libvmmalloc"
+set xlabel "Size of the memory pool [bytes]"
+set ylabel "Execution time [seconds]"
+set key inside left top
+plot "vmmalloc_fork.out" using 1:3 title "fork" with linespoints
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vmmalloc_fork.c -- benchmark of fork(2) latency with libvmmalloc
+ *
+ * The program is not linked with libvmmalloc, it is expected to be run with
+ * libvmmalloc preloaded (see RUN.sh).  It allocates and fills the requested
+ * amount of memory and then measures the time of fork(2), which includes
+ * the libvmmalloc pre-fork handler selected by VMMALLOC_FORK.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define	NANOSEC_IN_SEC 1000000000.0
+#define	ALLOC_SIZE (1024 * 1024)
+
+/*
+ * elapsed -- return time between two timestamps in seconds
+ */
+static double
+elapsed(struct timespec *start, struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) +
+		(stop->tv_nsec - start->tv_nsec) / NANOSEC_IN_SEC;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc < 3) {
+		printf("Usage %s <used_size> <iterations>\n", argv[0]);
+		return 0;
+	}
+
+	size_t used_size = strtoull(argv[1], NULL, 0);
+	int iterations = atoi(argv[2]);
+	char *env_str = getenv("VMMALLOC_POOL_SIZE");
+	size_t pool_size = env_str ? strtoull(env_str, NULL, 0) : 0;
+
+	size_t nallocs = used_size / ALLOC_SIZE;
+	char **ptrs = malloc(nallocs * sizeof (*ptrs));
+	if (ptrs == NULL) {
+		perror("malloc");
+		return -1;
+	}
+
+	for (size_t i = 0; i < nallocs; i++) {
+		if ((ptrs[i] = malloc(ALLOC_SIZE)) == NULL) {
+			perror("malloc");
+			return -1;
+		}
+		memset(ptrs[i], (int)i & 0xFF, ALLOC_SIZE);
+	}
+
+	struct timespec time_start, time_stop;
+	double fork_time = 0.0;
+
+	for (int i = 0; i < iterations; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &time_start);
+		pid_t pid = fork();
+		clock_gettime(CLOCK_MONOTONIC, &time_stop);
+
+		if (pid == -1) {
+			perror("fork");
+			return -1;
+		}
+
+		if (pid == 0)
+			_exit(0);
+
+		fork_time += elapsed(&time_start, &time_stop);
+
+		int status;
+		if (waitpid(pid, &status, 0) == -1) {
+			perror("waitpid");
+			return -1;
+		}
+	}
+
+	printf("%zu;%zu;%e\n", pool_size, used_size,
+		fork_time / (double)iterations);
+
+	for (size_t i = 0; i < nallocs; i++)
+		free(ptrs[i]);
+	free(ptrs);
+
+	return 0;
+}
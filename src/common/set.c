@@ -0,0 +1,682 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * set.c -- pool set utilities
+ *
+ * A pool set is a pool made of several part files, described by a plain
+ * text set file.  The parts are mapped next to each other, so the pool is
+ * a single contiguous range of the address space.  The first part is mapped
+ * as a whole and its header is the header of the pool.  Each subsequent
+ * part has its own header, which is mapped separately, and only the rest of
+ * the file is mapped into the pool range.
+ *
+ * The parts listed after a REPLICA line make a replica -- another copy of
+ * the pool, which is mapped into a range of its own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "util.h"
+#include "out.h"
+#include "set.h"
+
+#define	POOLSET_MAX_LINE (PATH_MAX + 64) /* maximum length of set file line */
+#define	POOLSET_REPLICA_SIG "REPLICA"
+
+/*
+ * util_parse_size -- parses a size with an optional K, M, G or T suffix
+ */
+int
+util_parse_size(const char *str, size_t *sizep)
+{
+	char *end;
+
+	errno = 0;
+	unsigned long long size = strtoull(str, &end, 10);
+	if (errno || end == str)
+		return -1;
+
+	int shift = 0;
+	switch (*end) {
+	case 'K':
+	case 'k':
+		shift = 10;
+		break;
+	case 'M':
+	case 'm':
+		shift = 20;
+		break;
+	case 'G':
+	case 'g':
+		shift = 30;
+		break;
+	case 'T':
+	case 't':
+		shift = 40;
+		break;
+	case '\0':
+		break;
+	default:
+		return -1;
+	}
+
+	if (shift && end[1] != '\0')
+		return -1;
+
+	if (size > (SIZE_MAX >> shift))
+		return -1;
+
+	*sizep = (size_t)size << shift;
+
+	return 0;
+}
+
+/*
+ * util_is_poolset -- (internal) checks if the file is a pool set file
+ */
+static int
+util_is_poolset(const char *path)
+{
+	int fd;
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+
+	char sig[POOLSET_HDR_SIG_LEN - 1];
+	int ret = read(fd, sig, sizeof (sig)) == sizeof (sig) &&
+		memcmp(sig, POOLSET_HDR_SIG, sizeof (sig)) == 0;
+
+	(void) close(fd);
+
+	return ret;
+}
+
+/*
+ * util_poolset_new -- (internal) allocates a pool set of nparts parts
+ */
+static struct pool_set *
+util_poolset_new(struct pool_set *set, unsigned nparts)
+{
+	struct pool_set *nset = Realloc(set, sizeof (*set) +
+		nparts * sizeof (struct pool_set_part));
+	if (nset == NULL) {
+		ERR("!Realloc");
+		return NULL;
+	}
+
+	if (set == NULL) {
+		nset->nparts = 0;
+		nset->poolsize = 0;
+		nset->replica = NULL;
+	}
+
+	for (unsigned i = nset->nparts; i < nparts; ++i) {
+		struct pool_set_part *part = &nset->part[i];
+		memset(part, 0, sizeof (*part));
+		part->fd = -1;
+	}
+
+	return nset;
+}
+
+/*
+ * util_poolset_add -- (internal) appends a part to the pool set
+ */
+static int
+util_poolset_add(struct pool_set **setp, const char *path, size_t filesize)
+{
+	unsigned nparts = *setp ? (*setp)->nparts : 0;
+
+	struct pool_set *set = util_poolset_new(*setp, nparts + 1);
+	if (set == NULL)
+		return -1;
+
+	*setp = set;
+
+	struct pool_set_part *part = &set->part[nparts];
+	if ((part->path = Strdup(path)) == NULL) {
+		ERR("!Strdup");
+		return -1;
+	}
+
+	part->filesize = filesize;
+	set->nparts = nparts + 1;
+
+	return 0;
+}
+
+/*
+ * util_poolset_parse -- (internal) parses the pool set file
+ *
+ * The file starts with the POOLSET_HDR_SIG line, followed by one
+ * "<size> <absolute path>" line for each part.  A POOLSET_REPLICA_SIG line
+ * starts the list of parts of the next replica.  Empty lines and lines
+ * starting with '#' are ignored.
+ */
+static int
+util_poolset_parse(const char *path, struct pool_set **setp)
+{
+	LOG(3, "path %s", path);
+
+	FILE *fs;
+	if ((fs = fopen(path, "r")) == NULL) {
+		ERR("!fopen %s", path);
+		return -1;
+	}
+
+	struct pool_set *set = NULL;
+	struct pool_set **repp = &set;	/* replica the parts are added to */
+	char line[POOLSET_MAX_LINE];
+	unsigned nline = 0;
+	int sig_found = 0;
+
+	while (fgets(line, sizeof (line), fs) != NULL) {
+		nline++;
+
+		char *s = line;
+		while (*s == ' ' || *s == '\t')
+			s++;
+
+		s[strcspn(s, "\r\n")] = '\0';
+		if (*s == '\0' || *s == '#')
+			continue;
+
+		if (!sig_found) {
+			if (strcmp(s, POOLSET_HDR_SIG) != 0)
+				goto err_format;
+			sig_found = 1;
+			continue;
+		}
+
+		if (strcmp(s, POOLSET_REPLICA_SIG) == 0) {
+			if (*repp == NULL)
+				goto err_format;
+			repp = &(*repp)->replica;
+			continue;
+		}
+
+		char *saveptr;
+		char *size_str = strtok_r(s, " \t", &saveptr);
+		char *part_path = strtok_r(NULL, " \t", &saveptr);
+		size_t size;
+
+		if (part_path == NULL || strtok_r(NULL, " \t", &saveptr) ||
+		    util_parse_size(size_str, &size) || size == 0)
+			goto err_format;
+
+		if (part_path[0] != '/') {
+			ERR("%s:%u: part path must be absolute", path, nline);
+			errno = EINVAL;
+			goto err;
+		}
+
+		if (util_poolset_add(repp, part_path, size))
+			goto err;
+	}
+
+	if (*repp == NULL) {
+		ERR("%s: no parts defined", path);
+		errno = EINVAL;
+		goto err;
+	}
+
+	(void) fclose(fs);
+
+	*setp = set;
+
+	return 0;
+
+err_format:
+	ERR("%s:%u: invalid pool set file format", path, nline);
+	errno = EINVAL;
+err:
+	{
+		int oerrno = errno;
+		(void) fclose(fs);
+		if (set)
+			util_poolset_close(set, 0);
+		errno = oerrno;
+	}
+	return -1;
+}
+
+/*
+ * util_poolset_single -- (internal) creates a pool set of a single file
+ */
+static int
+util_poolset_single(struct pool_set **setp, const char *path, int fd,
+	size_t filesize, int created)
+{
+	struct pool_set *set = NULL;
+	if (util_poolset_add(&set, path, filesize)) {
+		int oerrno = errno;
+		(void) close(fd);
+		if (created)
+			unlink(path);
+		if (set)
+			util_poolset_close(set, 0);
+		errno = oerrno;
+		return -1;
+	}
+
+	set->part[0].fd = fd;
+	set->part[0].created = created;
+	*setp = set;
+
+	return 0;
+}
+
+/*
+ * util_replica_layout -- (internal) calculates the placement of the parts
+ *	in the replica
+ *
+ * Every part except for the last one is truncated to a multiple of the page
+ * size, so that the next part can be mapped right behind it.
+ */
+static int
+util_replica_layout(struct pool_set *set, size_t minsize)
+{
+	size_t hdrsize = roundup(sizeof (struct pool_hdr), Pagesize);
+
+	set->poolsize = 0;
+	for (unsigned i = 0; i < set->nparts; ++i) {
+		struct pool_set_part *part = &set->part[i];
+		size_t off = i == 0 ? 0 : hdrsize;
+
+		if (part->filesize <= off + Pagesize) {
+			ERR("part %s too small", part->path);
+			errno = EINVAL;
+			return -1;
+		}
+
+		part->hdrsize = hdrsize;
+		part->size = part->filesize - off;
+		if (i != set->nparts - 1)
+			part->size &= ~(Pagesize - 1);
+
+		set->poolsize += part->size;
+	}
+
+	if (set->poolsize < minsize) {
+		ERR("size %zu smaller than %zu", set->poolsize, minsize);
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * util_poolset_layout -- (internal) calculates the placement of the parts
+ *	in the pool and all its replicas
+ *
+ * A replica holds a copy of the whole pool, so it may not be smaller than
+ * the pool.  The pool size is defined by the first replica.
+ */
+static int
+util_poolset_layout(struct pool_set *set, size_t minsize)
+{
+	if (util_replica_layout(set, minsize))
+		return -1;
+
+	for (struct pool_set *rep = set->replica; rep; rep = rep->replica) {
+		if (util_replica_layout(rep, set->poolsize))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * util_replica_create -- (internal) creates the part files of a replica
+ *
+ * Part files which already exist are used if their size matches the set
+ * file.
+ */
+static int
+util_replica_create(struct pool_set *set, size_t minpartsize, mode_t mode)
+{
+	for (unsigned i = 0; i < set->nparts; ++i) {
+		struct pool_set_part *part = &set->part[i];
+		struct stat stbuf;
+
+		if (stat(part->path, &stbuf) == 0) {
+			if (stbuf.st_size != part->filesize) {
+				ERR("size of %s does not match the set file",
+					part->path);
+				errno = EINVAL;
+				return -1;
+			}
+
+			if ((part->fd = open(part->path, O_RDWR)) < 0) {
+				ERR("!open %s", part->path);
+				return -1;
+			}
+		} else if (errno == ENOENT) {
+			part->fd = util_pool_create(part->path,
+				part->filesize, minpartsize, mode);
+			if (part->fd < 0)
+				return -1;
+			part->created = 1;
+		} else {
+			ERR("!stat %s", part->path);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * util_replica_open -- (internal) opens the part files of a replica
+ */
+static int
+util_replica_open(struct pool_set *set, size_t minpartsize)
+{
+	for (unsigned i = 0; i < set->nparts; ++i) {
+		struct pool_set_part *part = &set->part[i];
+		size_t size = 0;
+
+		part->fd = util_pool_open(part->path, &size, minpartsize);
+		if (part->fd < 0)
+			return -1;
+
+		if (size != part->filesize) {
+			ERR("size of %s does not match the set file",
+				part->path);
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * util_poolset_create -- creates the files of a new pool
+ *
+ * If poolsize is not zero, a single pool file of that size is created.
+ * If it is zero and path is a pool set file, the parts listed in the set
+ * file are created, or used as they are if they already exist with the
+ * declared size.  Otherwise path must be an existing pool file.
+ */
+int
+util_poolset_create(struct pool_set **setp, const char *path, size_t poolsize,
+	size_t minsize, size_t minpartsize, mode_t mode)
+{
+	LOG(3, "path %s poolsize %zu minsize %zu minpartsize %zu mode %d",
+			path, poolsize, minsize, minpartsize, mode);
+
+	int fd;
+	if (poolsize != 0) {
+		if ((fd = util_pool_create(path, poolsize, minsize, mode)) < 0)
+			return -1;
+
+		if (util_poolset_single(setp, path, fd, poolsize, 1))
+			return -1;
+	} else if (!util_is_poolset(path)) {
+		if ((fd = util_pool_open(path, &poolsize, minsize)) < 0)
+			return -1;
+
+		if (util_poolset_single(setp, path, fd, poolsize, 0))
+			return -1;
+	} else {
+		if (util_poolset_parse(path, setp))
+			return -1;
+
+		for (struct pool_set *rep = *setp; rep; rep = rep->replica)
+			if (util_replica_create(rep, minpartsize, mode))
+				goto err;
+	}
+
+	if (util_poolset_layout(*setp, minsize))
+		goto err;
+
+	return 0;
+
+err:
+	{
+		int oerrno = errno;
+		util_poolset_close(*setp, 1);
+		errno = oerrno;
+	}
+	return -1;
+}
+
+/*
+ * util_poolset_open -- opens the files of an existing pool
+ *
+ * The path may be either a pool file or a pool set file.
+ */
+int
+util_poolset_open(struct pool_set **setp, const char *path, size_t minsize,
+	size_t minpartsize)
+{
+	LOG(3, "path %s minsize %zu minpartsize %zu",
+			path, minsize, minpartsize);
+
+	int fd;
+	if (!util_is_poolset(path)) {
+		size_t poolsize = 0;
+		if ((fd = util_pool_open(path, &poolsize, minsize)) < 0)
+			return -1;
+
+		if (util_poolset_single(setp, path, fd, poolsize, 0))
+			return -1;
+	} else {
+		if (util_poolset_parse(path, setp))
+			return -1;
+
+		for (struct pool_set *rep = *setp; rep; rep = rep->replica)
+			if (util_replica_open(rep, minpartsize))
+				goto err;
+	}
+
+	if (util_poolset_layout(*setp, minsize))
+		goto err;
+
+	return 0;
+
+err:
+	{
+		int oerrno = errno;
+		util_poolset_close(*setp, 0);
+		errno = oerrno;
+	}
+	return -1;
+}
+
+/*
+ * util_replica_map -- (internal) maps all the parts of a replica
+ *
+ * The parts are mapped over a single reserved range, in the order of the
+ * set file.  The mapping policy is applied to the whole range.
+ */
+static int
+util_replica_map(struct pool_set *set, int cow, int mapflags)
+{
+	LOG(3, "set %p cow %d mapflags 0x%x", set, cow, mapflags);
+
+	int flags = cow ? MAP_PRIVATE|MAP_NORESERVE : MAP_SHARED;
+	int pflags = flags;
+	if (!cow && (mapflags & UTIL_MAP_POPULATE))
+		pflags |= MAP_POPULATE;
+
+	char *base = util_map_reserve(set->poolsize);
+	if (base == NULL)
+		return -1;
+
+	char *addr = base;
+	unsigned i;
+	for (i = 0; i < set->nparts; ++i) {
+		struct pool_set_part *part = &set->part[i];
+		off_t off = i == 0 ? 0 : part->hdrsize;
+
+		if (mmap(addr, part->size, PROT_READ|PROT_WRITE,
+				pflags|MAP_FIXED, part->fd, off) ==
+				MAP_FAILED) {
+			ERR("!mmap %s", part->path);
+			goto err;
+		}
+
+		if (i == 0) {
+			part->hdr = addr;
+		} else {
+			part->hdr = mmap(NULL, part->hdrsize,
+				PROT_READ|PROT_WRITE, flags, part->fd, 0);
+			if (part->hdr == MAP_FAILED) {
+				ERR("!mmap %s", part->path);
+				part->hdr = NULL;
+				goto err;
+			}
+		}
+
+		part->addr = addr;
+		addr += part->size;
+
+		LOG(4, "part %s mapped at %p", part->path, part->addr);
+	}
+
+	util_map_advise(base, set->poolsize, mapflags);
+
+	return 0;
+
+err:
+	{
+		int oerrno = errno;
+		for (unsigned j = 1; j < i; ++j)
+			(void) munmap(set->part[j].hdr, set->part[j].hdrsize);
+		for (unsigned j = 0; j < set->nparts; ++j) {
+			set->part[j].hdr = NULL;
+			set->part[j].addr = NULL;
+		}
+		(void) munmap(base, set->poolsize);
+		errno = oerrno;
+	}
+	return -1;
+}
+
+/*
+ * util_replica_unmap -- (internal) unmaps all the parts of a replica
+ */
+static void
+util_replica_unmap(struct pool_set *set)
+{
+	for (unsigned i = 1; i < set->nparts; ++i)
+		if (set->part[i].hdr != NULL)
+			(void) munmap(set->part[i].hdr, set->part[i].hdrsize);
+
+	if (set->nparts && set->part[0].addr != NULL)
+		util_unmap(set->part[0].addr, set->poolsize);
+
+	for (unsigned i = 0; i < set->nparts; ++i) {
+		set->part[i].hdr = NULL;
+		set->part[i].addr = NULL;
+	}
+}
+
+/*
+ * util_poolset_map -- maps the pool set and all its replicas
+ *
+ * mapflags is a mask of UTIL_MAP_* flags, applied to every replica.
+ */
+int
+util_poolset_map(struct pool_set *set, int cow, int mapflags)
+{
+	for (struct pool_set *rep = set; rep; rep = rep->replica) {
+		if (util_replica_map(rep, cow, mapflags) == 0)
+			continue;
+
+		int oerrno = errno;
+		for (struct pool_set *r = set; r != rep; r = r->replica)
+			util_replica_unmap(r);
+		errno = oerrno;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * util_poolset_fdclose -- closes the file descriptors of the parts
+ */
+void
+util_poolset_fdclose(struct pool_set *set)
+{
+	for (; set; set = set->replica) {
+		for (unsigned i = 0; i < set->nparts; ++i) {
+			if (set->part[i].fd != -1) {
+				(void) close(set->part[i].fd);
+				set->part[i].fd = -1;
+			}
+		}
+	}
+}
+
+/*
+ * util_poolset_close -- unmaps the pool set and its replicas and frees them
+ *
+ * If del is set, the part files created by util_poolset_create() are
+ * removed.
+ */
+void
+util_poolset_close(struct pool_set *set, int del)
+{
+	LOG(3, "set %p del %d", set, del);
+
+	if (set->replica)
+		util_poolset_close(set->replica, del);
+
+	util_replica_unmap(set);
+
+	for (unsigned i = 0; i < set->nparts; ++i) {
+		struct pool_set_part *part = &set->part[i];
+
+		if (part->fd != -1)
+			(void) close(part->fd);
+		if (del && part->created)
+			unlink(part->path);
+		Free(part->path);
+	}
+
+	Free(set);
+}
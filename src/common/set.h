@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * set.h -- internal definitions for pool sets
+ */
+
+struct pool_set_part {
+	/* populated by the set file parser */
+	char *path;
+	size_t filesize;	/* size of the part file */
+	int fd;
+	int created;		/* the file has been created by the library */
+
+	/* populated by util_poolset_map() */
+	void *hdr;		/* base address of the part header */
+	size_t hdrsize;		/* size of the part header mapping */
+	void *addr;		/* base address of the part in the pool */
+	size_t size;		/* size of the part in the pool */
+};
+
+/*
+ * A set holds the parts of one copy of the pool.  Each REPLICA section of
+ * the set file makes another set, linked from the previous one.
+ */
+struct pool_set {
+	unsigned nparts;
+	size_t poolsize;	/* size of the contiguous pool mapping */
+	struct pool_set *replica; /* next replica, NULL in the last one */
+	struct pool_set_part part[];
+};
+
+int util_parse_size(const char *str, size_t *sizep);
+
+int util_poolset_create(struct pool_set **setp, const char *path,
+	size_t poolsize, size_t minsize, size_t minpartsize, mode_t mode);
+int util_poolset_open(struct pool_set **setp, const char *path,
+	size_t minsize, size_t minpartsize);
+int util_poolset_map(struct pool_set *set, int cow, int mapflags);
+void util_poolset_fdclose(struct pool_set *set);
+void util_poolset_close(struct pool_set *set, int del);
@@ -34,6 +34,7 @@
  * util.c -- general utilities used in the library
  */
 
+#define	_GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,11 +45,13 @@
 #include <signal.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <endian.h>
 #include <errno.h>
 #include <stddef.h>
 #include <elf.h>
 #include <link.h>
+#include <pthread.h>
 
 #include "valgrind_internal.h"
 #include "util.h"
@@ -59,6 +62,21 @@
 #define	GIGABYTE ((uintptr_t)1 << 30)
 #define	TERABYTE ((uintptr_t)1 << 40)
 
+#define	PREFAULT_MAX_THREADS 16
+#define	PREFAULT_MIN_CHUNK ((size_t)1 << 26) /* 64 MiB per prefault thread */
+
+/*
+ * names of the mapping policy flags accepted in the environment
+ */
+static const struct {
+	const char *name;
+	int flag;
+} Map_policies[] = {
+	{ "populate", UTIL_MAP_POPULATE },
+	{ "hugepage", UTIL_MAP_HUGEPAGE },
+	{ "prefault", UTIL_MAP_PREFAULT },
+};
+
 /*
  * set of macros for determining the alignment descriptor
  */
@@ -215,22 +233,288 @@ util_map_hint(size_t len)
  */
 void *
 util_map(int fd, size_t len, int cow)
+{
+	return util_map_flags(fd, len, cow, 0);
+}
+
+/*
+ * util_map_flags -- memory map a file using a mapping policy
+ *
+ * Same as util_map(), but the mapping is also set up according to the
+ * UTIL_MAP_* flags, see util_map_advise().
+ */
+void *
+util_map_flags(int fd, size_t len, int cow, int flags)
 {
 	void *base;
 
-	LOG(3, "fd %d len %zu cow %d", fd, len, cow);
+	LOG(3, "fd %d len %zu cow %d flags 0x%x", fd, len, cow, flags);
 
 	void *addr = util_map_hint(len);
 
+	/* populating a private mapping would copy the whole file */
+	int mflags = cow ? MAP_PRIVATE|MAP_NORESERVE : MAP_SHARED;
+	if (!cow && (flags & UTIL_MAP_POPULATE))
+		mflags |= MAP_POPULATE;
+
 	if ((base = mmap(addr, len, PROT_READ|PROT_WRITE,
-			(cow) ? MAP_PRIVATE|MAP_NORESERVE : MAP_SHARED,
-					fd, 0)) == MAP_FAILED) {
+			mflags, fd, 0)) == MAP_FAILED) {
 		ERR("!mmap %zu bytes", len);
 		return NULL;
 	}
 
 	LOG(3, "mapped at %p", base);
 
+	util_map_advise(base, len, flags);
+
+	return base;
+}
+
+/*
+ * util_map_policy -- read the mapping policy from the environment
+ *
+ * The variable holds a comma-separated list of "populate", "hugepage" and
+ * "prefault".  Unknown names are ignored.
+ */
+int
+util_map_policy(const char *var)
+{
+	const char *e = getenv(var);
+	if (e == NULL)
+		return 0;
+
+	int flags = 0;
+	while (*e != '\0') {
+		size_t n = strcspn(e, ",");
+		unsigned i;
+		for (i = 0; i < sizeof (Map_policies) /
+				sizeof (Map_policies[0]); ++i) {
+			if (strlen(Map_policies[i].name) == n &&
+			    strncmp(Map_policies[i].name, e, n) == 0) {
+				flags |= Map_policies[i].flag;
+				break;
+			}
+		}
+		if (n && i == sizeof (Map_policies) / sizeof (Map_policies[0]))
+			LOG(2, "%s: unknown mapping policy \"%.*s\"",
+					var, (int)n, e);
+
+		e += n;
+		if (*e == ',')
+			e++;
+	}
+
+	LOG(3, "%s flags 0x%x", var, flags);
+
+	return flags;
+}
+
+struct prefault_range {
+	const char *addr;
+	size_t len;
+};
+
+/*
+ * util_prefault_range -- (internal) read the first byte of every page
+ *
+ * Read faults are used on purpose: a write fault would dirty every page
+ * of a file mapping and make the next msync() write the whole file back.
+ */
+static void *
+util_prefault_range(void *arg)
+{
+	struct prefault_range *r = arg;
+	volatile const char *p = r->addr;
+
+	for (size_t off = 0; off < r->len; off += Pagesize)
+		(void) p[off];
+
+	return NULL;
+}
+
+/*
+ * util_prefault -- (internal) fault in the whole range using several threads
+ *
+ * The range is split evenly between up to PREFAULT_MAX_THREADS threads,
+ * each one touching at least PREFAULT_MIN_CHUNK bytes.  The calling thread
+ * takes the first chunk, as well as the chunks of the threads that could
+ * not be created.
+ */
+static void
+util_prefault(void *addr, size_t len)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t nthreads = len / PREFAULT_MIN_CHUNK;
+	if (ncpus > 0 && nthreads > (size_t)ncpus)
+		nthreads = (size_t)ncpus;
+	if (nthreads > PREFAULT_MAX_THREADS)
+		nthreads = PREFAULT_MAX_THREADS;
+	if (nthreads == 0)
+		nthreads = 1;
+
+	size_t chunk = roundup(len / nthreads, Pagesize);
+
+	LOG(3, "addr %p len %zu threads %zu", addr, len, nthreads);
+
+	struct prefault_range ranges[PREFAULT_MAX_THREADS];
+	pthread_t threads[PREFAULT_MAX_THREADS];
+	int started[PREFAULT_MAX_THREADS];
+
+	for (size_t i = 0; i < nthreads; ++i) {
+		size_t off = i * chunk;
+		ranges[i].addr = (char *)addr + off;
+		ranges[i].len = off >= len ? 0 :
+			(len - off < chunk ? len - off : chunk);
+
+		started[i] = i != 0 && pthread_create(&threads[i], NULL,
+				util_prefault_range, &ranges[i]) == 0;
+	}
+
+	for (size_t i = 0; i < nthreads; ++i) {
+		if (started[i])
+			(void) pthread_join(threads[i], NULL);
+		else
+			util_prefault_range(&ranges[i]);
+	}
+}
+
+/*
+ * util_map_advise -- apply the mapping policy to a mapped range
+ *
+ * UTIL_MAP_HUGEPAGE asks for transparent huge pages; not getting them is not
+ * an error.  UTIL_MAP_PREFAULT faults in every page of the range up front, so
+ * the first accesses after the pool is opened do not pay for it.
+ * UTIL_MAP_POPULATE is handled by the caller of mmap(), as it is a mapping
+ * flag.
+ */
+void
+util_map_advise(void *addr, size_t len, int flags)
+{
+	LOG(3, "addr %p len %zu flags 0x%x", addr, len, flags);
+
+	if ((flags & UTIL_MAP_HUGEPAGE) &&
+			madvise(addr, len, MADV_HUGEPAGE) != 0)
+		LOG(2, "!madvise MADV_HUGEPAGE");
+
+	if (flags & UTIL_MAP_PREFAULT)
+		util_prefault(addr, len);
+
+#ifdef DEBUG
+	size_t huge2m;
+	size_t huge1g;
+	if (flags && util_map_pagesizes(addr, len, &huge2m, &huge1g) == 0)
+		LOG(2, "%p: %zu of %zu bytes in 2M pages, %zu in 1G pages",
+				addr, huge2m, len, huge1g);
+#endif
+}
+
+/*
+ * util_map_pagesizes -- report how much of a range is mapped with huge pages
+ *
+ * Sums up, from /proc/self/smaps, the bytes mapped with 2 MiB and 1 GiB
+ * pages in all the mappings that overlap the range.
+ */
+int
+util_map_pagesizes(const void *addr, size_t len, size_t *huge2m,
+		size_t *huge1g)
+{
+	LOG(3, "addr %p len %zu", addr, len);
+
+	FILE *fp;
+	if ((fp = fopen("/proc/self/smaps", "r")) == NULL) {
+		ERR("!/proc/self/smaps");
+		return -1;
+	}
+
+	uintptr_t start = (uintptr_t)addr;
+	uintptr_t end = start + len;
+
+	*huge2m = 0;
+	*huge1g = 0;
+
+	char line[PROCMAXLEN];	/* for fgets() */
+	int inrange = 0;	/* current mapping overlaps the range */
+	size_t pagesize = 0;	/* KernelPageSize of the current mapping */
+	size_t rss = 0;		/* resident bytes of the current mapping */
+	size_t pmd = 0;		/* bytes mapped with PMD-sized pages */
+	int eof = 0;
+
+	while (!eof) {
+		eof = fgets(line, PROCMAXLEN, fp) == NULL;
+
+		uintptr_t lo;
+		uintptr_t hi;
+		int header = !eof && sscanf(line,
+				"%" SCNxPTR "-%" SCNxPTR " ", &lo, &hi) == 2;
+
+		if (eof || header) {
+			/* account for the previous mapping */
+			if (inrange && pagesize == GIGABYTE)
+				*huge1g += rss;
+			else if (inrange && pagesize == ((size_t)2 << 20))
+				*huge2m += rss;
+			else if (inrange)
+				*huge2m += pmd;
+
+			if (eof)
+				break;
+
+			inrange = lo < end && hi > start;
+			pagesize = rss = pmd = 0;
+			continue;
+		}
+
+		if (!inrange)
+			continue;
+
+		char name[64];
+		size_t kb;
+		if (sscanf(line, "%63[^:]: %zu kB", name, &kb) != 2)
+			continue;
+
+		if (strcmp(name, "KernelPageSize") == 0)
+			pagesize = kb << 10;
+		else if (strcmp(name, "Rss") == 0)
+			rss = kb << 10;
+		else if (strcmp(name, "AnonHugePages") == 0 ||
+				strcmp(name, "ShmemPmdMapped") == 0 ||
+				strcmp(name, "FilePmdMapped") == 0)
+			pmd += kb << 10;
+	}
+
+	fclose(fp);
+
+	LOG(3, "2M %zu 1G %zu", *huge2m, *huge1g);
+
+	return 0;
+}
+
+/*
+ * util_map_reserve -- reserve a contiguous range of the address space
+ *
+ * The range is mapped inaccessible and without backing store, so that the
+ * parts of a pool set can be mapped over it with MAP_FIXED and end up
+ * adjacent to each other.  It is placed at the same hint address util_map()
+ * would use for a single file of the same length.
+ */
+void *
+util_map_reserve(size_t len)
+{
+	void *base;
+
+	LOG(3, "len %zu", len);
+
+	void *addr = util_map_hint(len);
+
+	if ((base = mmap(addr, len, PROT_NONE,
+			MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,
+			-1, 0)) == MAP_FAILED) {
+		ERR("!mmap %zu bytes", len);
+		return NULL;
+	}
+
+	LOG(3, "reserved at %p", base);
+
 	return base;
 }
 
@@ -256,10 +540,13 @@ util_unmap(void *addr, size_t len)
 /*
  * util_tmpfile -- reserve space in an unlinked file
  *
- * size must be multiple of page size.
+ * size must be multiple of page size.  If sparse is not NULL and *sparse is
+ * set, the file is left sparse when the file system can allocate its blocks
+ * on demand (see util_file_commit()), otherwise *sparse is cleared and the
+ * whole file is allocated.
  */
 int
-util_tmpfile(const char *dir, size_t size)
+util_tmpfile(const char *dir, size_t size, int *sparse)
 {
 	static char template[] = "/vmem.XXXXXX";
 
@@ -282,6 +569,24 @@ util_tmpfile(const char *dir, size_t size)
 
 	LOG(3, "unlinked file is \"%s\"", fullname);
 
+	if (sparse != NULL && *sparse) {
+		if (ftruncate(fd, size) != 0) {
+			ERR("!ftruncate");
+			goto err;
+		}
+
+		if (util_file_commit(fd, 0, Pagesize) == 0)
+			return fd;
+
+		if (errno != EOPNOTSUPP) {
+			ERR("!fallocate");
+			goto err;
+		}
+
+		LOG(3, "file system cannot allocate on demand");
+		*sparse = 0;
+	}
+
 	if ((errno = posix_fallocate(fd, 0, size)) != 0) {
 		ERR("!posix_fallocate");
 		goto err;
@@ -307,7 +612,7 @@ err:
 void *
 util_map_tmpfile(const char *dir, size_t size)
 {
-	int fd = util_tmpfile(dir, size);
+	int fd = util_tmpfile(dir, size, NULL);
 	void *base;
 	if ((base = util_map(fd, size, 0)) == NULL)
 		goto err;
@@ -324,6 +629,35 @@ err:
 	return NULL;
 }
 
+/*
+ * util_file_commit -- allocate the blocks backing a range of a sparse file
+ *
+ * Returns 0 on success and -1 with errno set otherwise, ENOSPC means the
+ * file system is full.
+ */
+int
+util_file_commit(int fd, off_t off, size_t len)
+{
+	LOG(5, "fd %d off %ju len %zu", fd, (uintmax_t)off, len);
+
+	return fallocate(fd, 0, off, (off_t)len);
+}
+
+/*
+ * util_file_decommit -- release the blocks backing a range of a file
+ *
+ * The range reads as zeros afterwards.  Returns 0 on success and -1 with
+ * errno set if the file system cannot punch holes.
+ */
+int
+util_file_decommit(int fd, off_t off, size_t len)
+{
+	LOG(5, "fd %d off %ju len %zu", fd, (uintmax_t)off, len);
+
+	return fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+			off, (off_t)len);
+}
+
 /*
  * util_checksum -- compute Fletcher64 checksum
  *
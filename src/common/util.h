@@ -42,6 +42,8 @@ typedef void (*Free_func)(void *ptr);
 typedef void *(*Realloc_func)(void *ptr, size_t size);
 typedef char *(*Strdup_func)(const char *s);
 
+extern unsigned long Pagesize;
+
 Malloc_func Malloc;
 Free_func Free;
 Realloc_func Realloc;
@@ -52,11 +54,26 @@ void util_set_alloc_funcs(
 		void (*free_func)(void *ptr),
 		void *(*realloc_func)(void *ptr, size_t size),
 		char *(*strdup_func)(const char *s));
+/*
+ * mapping policy flags, see util_map_advise()
+ */
+#define	UTIL_MAP_POPULATE	(1 << 0)	/* populate the page tables */
+#define	UTIL_MAP_HUGEPAGE	(1 << 1)	/* ask for huge pages */
+#define	UTIL_MAP_PREFAULT	(1 << 2)	/* touch every page */
+
 void *util_map(int fd, size_t len, int cow);
+void *util_map_flags(int fd, size_t len, int cow, int flags);
+int util_map_policy(const char *var);
+void util_map_advise(void *addr, size_t len, int flags);
+int util_map_pagesizes(const void *addr, size_t len, size_t *huge2m,
+		size_t *huge1g);
+void *util_map_reserve(size_t len);
 int util_unmap(void *addr, size_t len);
 
-int util_tmpfile(const char *dir, size_t size);
+int util_tmpfile(const char *dir, size_t size, int *sparse);
 void *util_map_tmpfile(const char *dir, size_t size);
+int util_file_commit(int fd, off_t off, size_t len);
+int util_file_decommit(int fd, off_t off, size_t len);
 
 /*
  * architecture identification flags
@@ -144,6 +161,19 @@ int util_check_arch_flags(const struct arch_flags *arch_flags);
 
 #endif	/* DEBUG */
 
+/*
+ * CPU_SPINWAIT -- tell the CPU that the thread is busy waiting
+ */
+#ifndef	CPU_SPINWAIT
+#if defined(__x86_64__) || defined(__i386__)
+#define	CPU_SPINWAIT __asm__ volatile("pause")
+#elif defined(__aarch64__)
+#define	CPU_SPINWAIT __asm__ volatile("yield")
+#else
+#define	CPU_SPINWAIT __asm__ volatile("" : : : "memory")
+#endif
+#endif
+
 /*
  * pool sets & replicas
  */
@@ -45,4 +45,7 @@
 /* number of values in a bucket which force hashtable rebuild */
 #define	MAX_HASHSET_THRESHOLD 10000
 
+/* number of buckets migrated per operation by an incremental rebuild */
+#define	REHASH_STEP_BUCKETS 64
+
 #endif
@@ -74,6 +74,12 @@ struct hashset {
 
 	/* buckets */
 	TOID(struct buckets) buckets;
+
+	/* buckets being filled by an incremental rebuild, NULL if none */
+	TOID(struct buckets) buckets_new;
+
+	/* old buckets below this index have already been migrated */
+	uint64_t rehash_cursor;
 };
 
 /*
@@ -131,34 +137,96 @@ hash(const TOID(struct hashset) *hashset, const TOID(struct buckets) *buckets,
 }
 
 /*
- * hs_rebuild -- rebuilds the hashset with a new number of buckets
+ * hs_bucket_of -- returns the table and the bucket holding the value
+ *
+ * While an incremental rebuild is in progress, old buckets below the cursor
+ * have been moved to the new table, the others are still in the old one.
  */
-void
-hs_rebuild(PMEMobjpool *pop, size_t new_len)
+static TOID(struct buckets)
+hs_bucket_of(TOID(struct hashset) hashset, uint64_t value, uint64_t *h)
 {
-	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets_old = D_RO(hashset)->buckets;
+	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
 
-	if (new_len == 0)
-		new_len = D_RO(buckets_old)->nbuckets;
+	*h = hash(&hashset, &buckets, value);
+	if (!TOID_IS_NULL(D_RO(hashset)->buckets_new) &&
+			*h < D_RO(hashset)->rehash_cursor) {
+		buckets = D_RO(hashset)->buckets_new;
+		*h = hash(&hashset, &buckets, value);
+	}
 
-	printf("rebuild ");
-	fflush(stdout);
-	time_t t1 = time(NULL);
-	size_t sz_old = sizeof (struct buckets) +
-			D_RO(buckets_old)->nbuckets *
-			sizeof (TOID(struct entry));
+	return buckets;
+}
+
+/*
+ * hs_rehash_start -- starts an incremental rebuild with new_len buckets
+ *
+ * Fails if a rebuild is already in progress, as its new table holds the
+ * buckets migrated so far.
+ */
+static int
+hs_rehash_start(PMEMobjpool *pop, size_t new_len)
+{
+	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
 	size_t sz_new = sizeof (struct buckets) +
 			new_len * sizeof (TOID(struct entry));
+	int ret = 0;
+
+	if (!TOID_IS_NULL(D_RO(hashset)->buckets_new)) {
+		fprintf(stderr, "%s: rebuild already in progress\n",
+			__func__);
+		return -1;
+	}
 
 	TX_BEGIN(pop) {
-		TX_ADD_FIELD(hashset, buckets);
-		TOID(struct buckets) buckets_new =
-				TX_ZALLOC(struct buckets, sz_new);
-		D_RW(buckets_new)->nbuckets = new_len;
-		pmemobj_tx_add_range(buckets_old.oid, 0, sz_old);
+		TX_ADD_FIELD(hashset, buckets_new);
+		TX_ADD_FIELD(hashset, rehash_cursor);
+
+		D_RW(hashset)->buckets_new = TX_ZALLOC(struct buckets, sz_new);
+		D_RW(D_RW(hashset)->buckets_new)->nbuckets = new_len;
+		D_RW(hashset)->rehash_cursor = 0;
+	} TX_ONABORT {
+		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
+			pmemobj_errormsg());
+		ret = -1;
+	} TX_END
+
+	return ret;
+}
 
-		for (size_t i = 0; i < D_RO(buckets_old)->nbuckets; ++i) {
+/*
+ * hs_rehash_step -- migrates up to nbuckets old buckets to the new table,
+ * returns:
+ * - 1 if the rebuild is finished,
+ * - 0 if there are buckets left to migrate,
+ * - -1 if the step failed
+ *
+ * Every step is a separate, small transaction, so the undo log is bounded
+ * by the size of the migrated buckets and the hashset remains usable while
+ * it is being rebuilt.  The cursor is persistent, so after a crash the
+ * migration simply continues with the next operation.
+ */
+static int
+hs_rehash_step(PMEMobjpool *pop, size_t nbuckets)
+{
+	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
+	TOID(struct buckets) buckets_old = D_RO(hashset)->buckets;
+	TOID(struct buckets) buckets_new = D_RO(hashset)->buckets_new;
+	int done = 0;
+
+	if (TOID_IS_NULL(buckets_new))
+		return 1;
+
+	TX_BEGIN(pop) {
+		uint64_t i = D_RO(hashset)->rehash_cursor;
+		uint64_t end = i + nbuckets;
+		if (end > D_RO(buckets_old)->nbuckets)
+			end = D_RO(buckets_old)->nbuckets;
+
+		for (; i < end; ++i) {
+			if (TOID_IS_NULL(D_RO(buckets_old)->bucket[i]))
+				continue;
+
+			TX_ADD_FIELD(buckets_old, bucket[i]);
 			while (!TOID_IS_NULL(D_RO(buckets_old)->bucket[i])) {
 				TOID(struct entry) en =
 					D_RO(buckets_old)->bucket[i];
@@ -168,23 +236,87 @@ hs_rebuild(PMEMobjpool *pop, size_t new_len)
 				D_RW(buckets_old)->bucket[i] = D_RO(en)->next;
 
 				TX_ADD_FIELD(en, next);
+				TX_ADD_FIELD(buckets_new, bucket[h]);
 				D_RW(en)->next = D_RO(buckets_new)->bucket[h];
 				D_RW(buckets_new)->bucket[h] = en;
 			}
 		}
 
-		D_RW(hashset)->buckets = buckets_new;
-		TX_FREE(buckets_old);
+		TX_ADD_FIELD(hashset, rehash_cursor);
+		D_RW(hashset)->rehash_cursor = end;
+
+		if (end == D_RO(buckets_old)->nbuckets) {
+			TX_ADD_FIELD(hashset, buckets);
+			TX_ADD_FIELD(hashset, buckets_new);
+			D_RW(hashset)->buckets = buckets_new;
+			D_RW(hashset)->buckets_new = TOID_NULL(struct buckets);
+			TX_FREE(buckets_old);
+			done = 1;
+		}
 	} TX_ONABORT {
 		fprintf(stderr, "%s: transaction aborted: %s\n", __func__,
 			pmemobj_errormsg());
 		/*
-		 * We don't need to do anything here, because everything is
-		 * consistent. The only thing affected is performance.
+		 * The step was rolled back, the migration is not finished and
+		 * the new table still holds the buckets moved so far.
 		 */
+		done = -1;
 	} TX_END
 
-	printf("%lus\n", time(NULL) - t1);
+	return done;
+}
+
+/*
+ * hs_rebuild -- rebuilds the hashset with a new number of buckets
+ *
+ * Finishes any incremental rebuild in progress first.
+ */
+void
+hs_rebuild(PMEMobjpool *pop, size_t new_len)
+{
+	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
+
+	printf("rebuild ");
+	fflush(stdout);
+	time_t t1 = time(NULL);
+
+	int ret;
+	while ((ret = hs_rehash_step(pop, REHASH_STEP_BUCKETS)) == 0)
+		;
+
+	if (ret > 0) {
+		if (new_len == 0)
+			new_len = D_RO(D_RO(hashset)->buckets)->nbuckets;
+
+		ret = hs_rehash_start(pop, new_len);
+		if (ret == 0)
+			while ((ret = hs_rehash_step(pop,
+					REHASH_STEP_BUCKETS)) == 0)
+				;
+	}
+
+	if (ret < 0)
+		printf("failed\n");
+	else
+		printf("%lus\n", time(NULL) - t1);
+}
+
+/*
+ * hs_rehash_maybe -- makes progress with the rebuild in progress or starts
+ * a new one with new_len buckets if requested
+ *
+ * A failed step leaves the rebuild in progress, it is retried by the next
+ * operation.
+ */
+static void
+hs_rehash_maybe(PMEMobjpool *pop, size_t new_len)
+{
+	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
+
+	if (!TOID_IS_NULL(D_RO(hashset)->buckets_new))
+		hs_rehash_step(pop, REHASH_STEP_BUCKETS);
+	else if (new_len != 0 && hs_rehash_start(pop, new_len) == 0)
+		hs_rehash_step(pop, REHASH_STEP_BUCKETS);
 }
 
 /*
@@ -198,10 +330,10 @@ int
 hs_insert(PMEMobjpool *pop, uint64_t value)
 {
 	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
 	TOID(struct entry) var;
 
-	uint64_t h = hash(&hashset, &buckets, value);
+	uint64_t h;
+	TOID(struct buckets) buckets = hs_bucket_of(hashset, value, &h);
 	int num = 0;
 
 	for (var = D_RO(buckets)->bucket[h];
@@ -212,7 +344,7 @@ hs_insert(PMEMobjpool *pop, uint64_t value)
 		num++;
 	}
 	TX_BEGIN(pop) {
-		TX_ADD_FIELD(D_RO(hashset)->buckets, bucket[h]);
+		TX_ADD_FIELD(buckets, bucket[h]);
 		TX_ADD_FIELD(hashset, count);
 
 		TOID(struct entry) e = TX_NEW(struct entry);
@@ -227,10 +359,13 @@ hs_insert(PMEMobjpool *pop, uint64_t value)
 		return -1;
 	} TX_END
 
+	size_t nbuckets = D_RO(D_RO(hashset)->buckets)->nbuckets;
 	if (num > MAX_HASHSET_THRESHOLD ||
 			(num > MIN_HASHSET_THRESHOLD &&
-			D_RO(hashset)->count > 2 * D_RO(buckets)->nbuckets))
-		hs_rebuild(pop, D_RO(buckets)->nbuckets * 2);
+			D_RO(hashset)->count > 2 * nbuckets))
+		hs_rehash_maybe(pop, nbuckets * 2);
+	else
+		hs_rehash_maybe(pop, 0);
 
 	return 1;
 }
@@ -246,10 +381,10 @@ int
 hs_remove(PMEMobjpool *pop, uint64_t value)
 {
 	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
 	TOID(struct entry) var, prev = TOID_NULL(struct entry);
 
-	uint64_t h = hash(&hashset, &buckets, value);
+	uint64_t h;
+	TOID(struct buckets) buckets = hs_bucket_of(hashset, value, &h);
 	for (var = D_RO(buckets)->bucket[h];
 			!TOID_IS_NULL(var);
 			prev = var, var = D_RO(var)->next) {
@@ -262,7 +397,7 @@ hs_remove(PMEMobjpool *pop, uint64_t value)
 
 	TX_BEGIN(pop) {
 		if (TOID_IS_NULL(prev))
-			TX_ADD_FIELD(D_RO(hashset)->buckets, bucket[h]);
+			TX_ADD_FIELD(buckets, bucket[h]);
 		else
 			TX_ADD_FIELD(prev, next);
 		TX_ADD_FIELD(hashset, count);
@@ -279,23 +414,23 @@ hs_remove(PMEMobjpool *pop, uint64_t value)
 		return -1;
 	} TX_END
 
-	if (D_RO(hashset)->count < D_RO(buckets)->nbuckets)
-		hs_rebuild(pop, D_RO(buckets)->nbuckets / 2);
+	size_t nbuckets = D_RO(D_RO(hashset)->buckets)->nbuckets;
+	if (D_RO(hashset)->count < nbuckets)
+		hs_rehash_maybe(pop, nbuckets / 2);
+	else
+		hs_rehash_maybe(pop, 0);
 
 	return 1;
 }
 
 /*
- * hs_print -- prints all values from the hashset
+ * hs_print_buckets -- prints all values from the buckets
  */
-void
-hs_print(PMEMobjpool *pop)
+static void
+hs_print_buckets(TOID(struct buckets) buckets)
 {
-	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
 	TOID(struct entry) var;
 
-	//printf("count: %lu\n", D_RO(hashset)->count);
 	for (size_t i = 0; i < D_RO(buckets)->nbuckets; ++i) {
 		if (TOID_IS_NULL(D_RO(buckets)->bucket[i]))
 			continue;
@@ -304,23 +439,29 @@ hs_print(PMEMobjpool *pop)
 				var = D_RO(var)->next)
 			printf("%lu ", D_RO(var)->value);
 	}
-	printf("\n");
 }
 
 /*
- * hs_debug -- prints complete hashset state
+ * hs_print -- prints all values from the hashset
  */
 void
-hs_debug(PMEMobjpool *pop)
+hs_print(PMEMobjpool *pop)
 {
 	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
-	TOID(struct entry) var;
 
-	printf("a: %u b: %u p: %lu\n", D_RO(hashset)->hash_fun_a,
-		D_RO(hashset)->hash_fun_b, D_RO(hashset)->hash_fun_p);
-	printf("count: %lu, buckets: %lu\n", D_RO(hashset)->count,
-		D_RO(buckets)->nbuckets);
+	hs_print_buckets(D_RO(hashset)->buckets);
+	if (!TOID_IS_NULL(D_RO(hashset)->buckets_new))
+		hs_print_buckets(D_RO(hashset)->buckets_new);
+	printf("\n");
+}
+
+/*
+ * hs_debug_buckets -- prints the contents of every non-empty bucket
+ */
+static void
+hs_debug_buckets(TOID(struct buckets) buckets)
+{
+	TOID(struct entry) var;
 
 	for (size_t i = 0; i < D_RO(buckets)->nbuckets; ++i) {
 		if (TOID_IS_NULL(D_RO(buckets)->bucket[i]))
@@ -337,6 +478,31 @@ hs_debug(PMEMobjpool *pop)
 	}
 }
 
+/*
+ * hs_debug -- prints complete hashset state
+ */
+void
+hs_debug(PMEMobjpool *pop)
+{
+	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
+	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
+	TOID(struct buckets) buckets_new = D_RO(hashset)->buckets_new;
+
+	printf("a: %u b: %u p: %lu\n", D_RO(hashset)->hash_fun_a,
+		D_RO(hashset)->hash_fun_b, D_RO(hashset)->hash_fun_p);
+	printf("count: %lu, buckets: %lu\n", D_RO(hashset)->count,
+		D_RO(buckets)->nbuckets);
+
+	hs_debug_buckets(buckets);
+
+	if (!TOID_IS_NULL(buckets_new)) {
+		printf("rebuild in progress, migrated: %lu, new buckets: %lu\n",
+			D_RO(hashset)->rehash_cursor,
+			D_RO(buckets_new)->nbuckets);
+		hs_debug_buckets(buckets_new);
+	}
+}
+
 /*
  * hs_check -- checks whether specified value is in the hashset
  */
@@ -344,10 +510,10 @@ int
 hs_check(PMEMobjpool *pop, uint64_t value)
 {
 	TOID(struct hashset) hashset = POBJ_ROOT(pop, struct hashset);
-	TOID(struct buckets) buckets = D_RO(hashset)->buckets;
 	TOID(struct entry) var;
 
-	uint64_t h = hash(&hashset, &buckets, value);
+	uint64_t h;
+	TOID(struct buckets) buckets = hs_bucket_of(hashset, value, &h);
 
 	for (var = D_RO(buckets)->bucket[h];
 			!TOID_IS_NULL(var);
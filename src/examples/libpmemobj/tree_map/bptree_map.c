@@ -0,0 +1,825 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * bptree_map.c -- B+tree with persistent leaves and a volatile inner index
+ *
+ * Only the leaves are persistent.  They hold all key-value pairs and form a
+ * doubly linked list in key order, linked by 8-byte pool offsets, so range
+ * scans never leave the leaf level.  The inner nodes are a DRAM index over
+ * the leaves: they are never logged nor flushed, and are rebuilt from the
+ * leaf list the first time a process uses the map and whenever the leaf
+ * list has changed behind the index's back (an aborted transaction or
+ * another process).  This is detected with a generation number stored in
+ * the map and bumped transactionally on every leaf split and unlink.
+ *
+ * The keys of a node are kept in a separate array which, together with the
+ * key count, fills exactly one cache line.  Nodes are searched with two
+ * AVX2 compares on CPUs that support it.
+ *
+ * Like the other tree_map implementations the map is not thread-safe.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include "tree_map.h"
+
+TOID_DECLARE(struct bptree_leaf, TREE_MAP_TYPE_OFFSET + 1);
+
+#define	BPTREE_KEYS 7 /* keys per node, the keys and the count fill 64B */
+#define	BPTREE_MAX_HEIGHT 32 /* inner levels, way more than ever needed */
+
+struct bptree_leaf {
+	uint64_t keys[BPTREE_KEYS];
+	uint64_t n; /* number of occupied slots */
+	PMEMoid values[BPTREE_KEYS];
+	uint64_t next; /* offset of the next leaf, 0 if last */
+	uint64_t prev; /* offset of the previous leaf, 0 if first */
+};
+
+struct tree_map {
+	uint64_t head; /* offset of the first leaf, 0 if the map is empty */
+	uint64_t gen; /* bumped whenever the leaf list changes */
+};
+
+union bptree_child {
+	struct bptree_inner *inner;
+	uint64_t leaf; /* offset of the leaf */
+};
+
+struct bptree_inner {
+	uint64_t keys[BPTREE_KEYS]; /* child i holds keys >= keys[i - 1] */
+	uint64_t n; /* number of keys, there is one child more */
+	union bptree_child children[BPTREE_KEYS + 1];
+} __attribute__((aligned(64)));
+
+/* volatile index of one map */
+struct bptree_index {
+	struct bptree_index *next;
+	PMEMoid map;
+	int valid;
+	uint64_t gen; /* generation of the map the index reflects */
+	int height; /* number of inner levels, 0 if root is a leaf */
+	union bptree_child root;
+};
+
+/* the way from the root to a leaf */
+struct bptree_path {
+	struct bptree_inner *nodes[BPTREE_MAX_HEIGHT];
+	unsigned pos[BPTREE_MAX_HEIGHT];
+};
+
+static struct bptree_index *Indexes;
+static int Has_avx2;
+
+/*
+ * bptree_init -- (internal) detect the SIMD support of the CPU
+ */
+__attribute__((constructor))
+static void
+bptree_init(void)
+{
+	__builtin_cpu_init();
+	Has_avx2 = __builtin_cpu_supports("avx2");
+}
+
+/*
+ * bptree_cmp_avx2 -- (internal) returns a bitmask of keys[i] > key (gt) or
+ *	keys[i] < key (!gt) for the first 8 slots of a node
+ *
+ * The keys are compared as unsigned by flipping their sign bits.
+ */
+__attribute__((target("avx2")))
+static unsigned
+bptree_cmp_avx2(const uint64_t *keys, uint64_t key, int gt)
+{
+	const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+	__m256i k = _mm256_xor_si256(_mm256_set1_epi64x((int64_t)key), sign);
+	__m256i lo = _mm256_xor_si256(
+		_mm256_loadu_si256((const __m256i *)keys), sign);
+	__m256i hi = _mm256_xor_si256(
+		_mm256_loadu_si256((const __m256i *)(keys + 4)), sign);
+
+	__m256i clo = gt ? _mm256_cmpgt_epi64(lo, k) :
+		_mm256_cmpgt_epi64(k, lo);
+	__m256i chi = gt ? _mm256_cmpgt_epi64(hi, k) :
+		_mm256_cmpgt_epi64(k, hi);
+
+	return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(clo)) |
+		((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(chi)) << 4);
+}
+
+/*
+ * bptree_count -- (internal) counts the keys greater (gt) or less (!gt)
+ *	than key among the first n keys of a node
+ */
+static inline unsigned
+bptree_count(const uint64_t *keys, uint64_t n, uint64_t key, int gt)
+{
+	if (Has_avx2) {
+		unsigned mask = bptree_cmp_avx2(keys, key, gt) &
+			((1u << n) - 1);
+		return (unsigned)__builtin_popcount(mask);
+	}
+
+	unsigned c = 0;
+	for (unsigned i = 0; i < n; ++i)
+		c += gt ? keys[i] > key : keys[i] < key;
+
+	return c;
+}
+
+/*
+ * bptree_leaf_ptr -- (internal) resolves a leaf offset
+ */
+static inline struct bptree_leaf *
+bptree_leaf_ptr(PMEMobjpool *pop, uint64_t off)
+{
+	return (struct bptree_leaf *)((uintptr_t)pop + off);
+}
+
+/*
+ * bptree_leaf_oid -- (internal) returns the object id of a leaf
+ */
+static inline PMEMoid
+bptree_leaf_oid(TOID(struct tree_map) map, uint64_t off)
+{
+	PMEMoid oid = {map.oid.pool_uuid_lo, off};
+	return oid;
+}
+
+/*
+ * bptree_index_free_node -- (internal) frees an inner subtree
+ */
+static void
+bptree_index_free_node(struct bptree_inner *node, int height)
+{
+	if (height > 1)
+		for (uint64_t i = 0; i <= node->n; ++i)
+			bptree_index_free_node(node->children[i].inner,
+				height - 1);
+
+	free(node);
+}
+
+/*
+ * bptree_index_clear -- (internal) drops all inner nodes of an index
+ */
+static void
+bptree_index_clear(struct bptree_index *idx)
+{
+	if (idx->valid && idx->height > 0)
+		bptree_index_free_node(idx->root.inner, idx->height);
+
+	idx->valid = 0;
+	idx->height = 0;
+	idx->root.leaf = 0;
+}
+
+/*
+ * bptree_index_build -- (internal) bulk loads the index from the leaf list
+ */
+static int
+bptree_index_build(PMEMobjpool *pop, TOID(struct tree_map) map,
+	struct bptree_index *idx)
+{
+	bptree_index_clear(idx);
+
+	size_t count = 0;
+	for (uint64_t off = D_RO(map)->head; off != 0;
+			off = bptree_leaf_ptr(pop, off)->next)
+		count++;
+
+	union bptree_child *children = malloc(
+		(count + 1) * sizeof (*children));
+	uint64_t *mins = malloc((count + 1) * sizeof (*mins));
+	if (children == NULL || mins == NULL) {
+		free(children);
+		free(mins);
+		return -1;
+	}
+
+	size_t i = 0;
+	for (uint64_t off = D_RO(map)->head; off != 0;
+			off = bptree_leaf_ptr(pop, off)->next) {
+		children[i].leaf = off;
+		mins[i++] = bptree_leaf_ptr(pop, off)->keys[0];
+	}
+
+	int height = 0;
+	while (count > 1) {
+		/* spread the children evenly over the fewest parents */
+		size_t nparents = (count + BPTREE_KEYS) / (BPTREE_KEYS + 1);
+		size_t base = count / nparents;
+		size_t extra = count % nparents;
+		size_t c = 0;
+
+		for (size_t p = 0; p < nparents; ++p) {
+			struct bptree_inner *node = calloc(1, sizeof (*node));
+			if (node == NULL) {
+				/*
+				 * children[0..p) are the parents built so far,
+				 * children[c..count) the ones not adopted yet
+				 */
+				for (size_t k = 0; k < p; ++k)
+					bptree_index_free_node(
+						children[k].inner, height + 1);
+				if (height > 0)
+					for (size_t k = c; k < count; ++k)
+						bptree_index_free_node(
+							children[k].inner,
+							height);
+				free(children);
+				free(mins);
+				return -1;
+			}
+
+			size_t nchildren = base + (p < extra);
+			uint64_t min = mins[c];
+			for (size_t j = 0; j < nchildren; ++j, ++c) {
+				node->children[j] = children[c];
+				if (j > 0)
+					node->keys[j - 1] = mins[c];
+			}
+			node->n = nchildren - 1;
+
+			children[p].inner = node;
+			mins[p] = min;
+		}
+
+		count = nparents;
+		height++;
+	}
+
+	idx->root = children[0];
+	idx->height = height;
+	idx->gen = D_RO(map)->gen;
+	idx->valid = 1;
+
+	free(children);
+	free(mins);
+
+	return 0;
+}
+
+/*
+ * bptree_index_get -- (internal) returns an up-to-date index of the map
+ */
+static struct bptree_index *
+bptree_index_get(PMEMobjpool *pop, TOID(struct tree_map) map)
+{
+	struct bptree_index *idx;
+	for (idx = Indexes; idx != NULL; idx = idx->next)
+		if (OID_EQUALS(idx->map, map.oid))
+			break;
+
+	if (idx == NULL) {
+		if ((idx = calloc(1, sizeof (*idx))) == NULL)
+			return NULL;
+
+		idx->map = map.oid;
+		idx->next = Indexes;
+		Indexes = idx;
+	}
+
+	if (!idx->valid || idx->gen != D_RO(map)->gen)
+		if (bptree_index_build(pop, map, idx) != 0)
+			return NULL;
+
+	return idx;
+}
+
+/*
+ * bptree_index_drop -- (internal) forgets the index of a deleted map
+ */
+static void
+bptree_index_drop(TOID(struct tree_map) map)
+{
+	for (struct bptree_index **idxp = &Indexes; *idxp != NULL;
+			idxp = &(*idxp)->next) {
+		if (OID_EQUALS((*idxp)->map, map.oid)) {
+			struct bptree_index *idx = *idxp;
+			*idxp = idx->next;
+			bptree_index_clear(idx);
+			free(idx);
+			return;
+		}
+	}
+}
+
+/*
+ * bptree_find_leaf -- (internal) finds the leaf that may contain the key
+ */
+static uint64_t
+bptree_find_leaf(struct bptree_index *idx, uint64_t key,
+	struct bptree_path *path)
+{
+	if (idx->height == 0)
+		return idx->root.leaf;
+
+	struct bptree_inner *node = idx->root.inner;
+	for (int level = 0; ; ++level) {
+		unsigned c = (unsigned)node->n -
+			bptree_count(node->keys, node->n, key, 1);
+		if (path != NULL) {
+			path->nodes[level] = node;
+			path->pos[level] = c;
+		}
+
+		if (level == idx->height - 1)
+			return node->children[c].leaf;
+
+		node = node->children[c].inner;
+	}
+}
+
+/*
+ * bptree_index_insert -- (internal) adds a new leaf to the index, right of
+ *	the one the path leads to
+ */
+static int
+bptree_index_insert(struct bptree_index *idx, struct bptree_path *path,
+	uint64_t sep, uint64_t leaf)
+{
+	union bptree_child child = {.leaf = leaf};
+
+	for (int level = idx->height - 1; level >= 0; --level) {
+		struct bptree_inner *node = path->nodes[level];
+		unsigned p = path->pos[level];
+
+		if (node->n < BPTREE_KEYS) {
+			memmove(&node->keys[p + 1], &node->keys[p],
+				sizeof (node->keys[0]) * (node->n - p));
+			memmove(&node->children[p + 2],
+				&node->children[p + 1],
+				sizeof (node->children[0]) * (node->n - p));
+			node->keys[p] = sep;
+			node->children[p + 1] = child;
+			node->n++;
+			return 0;
+		}
+
+		/* full node, split it around the middle key */
+		uint64_t keys[BPTREE_KEYS + 1];
+		union bptree_child children[BPTREE_KEYS + 2];
+
+		memcpy(keys, node->keys, sizeof (node->keys[0]) * p);
+		keys[p] = sep;
+		memcpy(&keys[p + 1], &node->keys[p],
+			sizeof (node->keys[0]) * (BPTREE_KEYS - p));
+
+		memcpy(children, node->children,
+			sizeof (node->children[0]) * (p + 1));
+		children[p + 1] = child;
+		memcpy(&children[p + 2], &node->children[p + 1],
+			sizeof (node->children[0]) * (BPTREE_KEYS - p));
+
+		struct bptree_inner *right = calloc(1, sizeof (*right));
+		if (right == NULL)
+			return -1;
+
+		unsigned m = (BPTREE_KEYS + 1) / 2;
+
+		memcpy(node->keys, keys, sizeof (keys[0]) * m);
+		memcpy(node->children, children,
+			sizeof (children[0]) * (m + 1));
+		node->n = m;
+
+		right->n = BPTREE_KEYS - m;
+		memcpy(right->keys, &keys[m + 1],
+			sizeof (keys[0]) * right->n);
+		memcpy(right->children, &children[m + 1],
+			sizeof (children[0]) * (right->n + 1));
+
+		sep = keys[m];
+		child.inner = right;
+	}
+
+	/* the root was split (or was a leaf), the index grows in height */
+	if (idx->height == BPTREE_MAX_HEIGHT)
+		return -1;
+
+	struct bptree_inner *root = calloc(1, sizeof (*root));
+	if (root == NULL)
+		return -1;
+
+	root->n = 1;
+	root->keys[0] = sep;
+	root->children[0] = idx->root;
+	root->children[1] = child;
+
+	idx->root.inner = root;
+	idx->height++;
+
+	return 0;
+}
+
+/*
+ * bptree_index_remove -- (internal) removes the leaf the path leads to
+ */
+static void
+bptree_index_remove(struct bptree_index *idx, struct bptree_path *path)
+{
+	int level;
+	for (level = idx->height - 1; level >= 0; --level) {
+		struct bptree_inner *node = path->nodes[level];
+		unsigned p = path->pos[level];
+
+		if (node->n > 0) {
+			/* drop the child and the key separating it */
+			unsigned k = p == 0 ? 0 : p - 1;
+			memmove(&node->keys[k], &node->keys[k + 1],
+				sizeof (node->keys[0]) * (node->n - k - 1));
+			memmove(&node->children[p], &node->children[p + 1],
+				sizeof (node->children[0]) * (node->n - p));
+			node->n--;
+			break;
+		}
+
+		/* the only child is gone, so is the node */
+		free(node);
+	}
+
+	if (level < 0) { /* there are no leaves left */
+		idx->height = 0;
+		idx->root.leaf = 0;
+		return;
+	}
+
+	/* collapse single-child roots */
+	while (idx->height > 0 && idx->root.inner->n == 0) {
+		struct bptree_inner *root = idx->root.inner;
+		idx->root = root->children[0];
+		idx->height--;
+		free(root);
+	}
+}
+
+/*
+ * bptree_bump_gen -- (internal) records a change of the leaf list
+ */
+static void
+bptree_bump_gen(TOID(struct tree_map) map, struct bptree_index *idx)
+{
+	TX_ADD_FIELD(map, gen);
+	D_RW(map)->gen++;
+	idx->gen = D_RO(map)->gen;
+}
+
+/*
+ * tree_map_new -- allocates a new B+tree instance
+ */
+int
+tree_map_new(PMEMobjpool *pop, TOID(struct tree_map) *map)
+{
+	int ret = 0;
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range_direct(map, sizeof (*map));
+		*map = TX_ZNEW(struct tree_map);
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * tree_map_delete -- cleanups and frees B+tree instance
+ */
+int
+tree_map_delete(PMEMobjpool *pop, TOID(struct tree_map) *map)
+{
+	int ret = 0;
+	TX_BEGIN(pop) {
+		tree_map_clear(pop, *map);
+		bptree_index_drop(*map);
+		pmemobj_tx_add_range_direct(map, sizeof (*map));
+		TX_FREE(*map);
+		*map = TOID_NULL(struct tree_map);
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * bptree_leaf_split -- (internal) moves the upper half of a full leaf to a
+ *	new leaf linked right after it, returns the offset of the new leaf
+ */
+static uint64_t
+bptree_leaf_split(PMEMobjpool *pop, TOID(struct tree_map) map,
+	uint64_t off)
+{
+	struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+	PMEMoid roid = pmemobj_tx_zalloc(sizeof (struct bptree_leaf),
+		TOID_TYPE_NUM(struct bptree_leaf));
+	struct bptree_leaf *right = bptree_leaf_ptr(pop, roid.off);
+
+	unsigned m = (BPTREE_KEYS + 1) / 2;
+
+	right->n = BPTREE_KEYS - m;
+	memcpy(right->keys, &leaf->keys[m],
+		sizeof (leaf->keys[0]) * right->n);
+	memcpy(right->values, &leaf->values[m],
+		sizeof (leaf->values[0]) * right->n);
+	right->prev = off;
+	right->next = leaf->next;
+
+	if (leaf->next != 0) {
+		struct bptree_leaf *next = bptree_leaf_ptr(pop, leaf->next);
+		pmemobj_tx_add_range_direct(&next->prev, sizeof (next->prev));
+		next->prev = roid.off;
+	}
+
+	pmemobj_tx_add_range_direct(leaf, sizeof (*leaf));
+	leaf->next = roid.off;
+	leaf->n = m;
+
+	return roid.off;
+}
+
+/*
+ * bptree_leaf_insert -- (internal) inserts an item into a non-full leaf
+ */
+static void
+bptree_leaf_insert(struct bptree_leaf *leaf, unsigned p, uint64_t key,
+	PMEMoid value)
+{
+	/* log the keys line and only the values that move */
+	pmemobj_tx_add_range_direct(leaf->keys,
+		sizeof (leaf->keys) + sizeof (leaf->n));
+	pmemobj_tx_add_range_direct(&leaf->values[p],
+		sizeof (leaf->values[0]) * (leaf->n - p + 1));
+
+	memmove(&leaf->keys[p + 1], &leaf->keys[p],
+		sizeof (leaf->keys[0]) * (leaf->n - p));
+	memmove(&leaf->values[p + 1], &leaf->values[p],
+		sizeof (leaf->values[0]) * (leaf->n - p));
+	leaf->keys[p] = key;
+	leaf->values[p] = value;
+	leaf->n++;
+}
+
+/*
+ * tree_map_insert -- inserts a new key-value pair into the map
+ *
+ * If the key is already present its value is replaced.
+ */
+int
+tree_map_insert(PMEMobjpool *pop,
+	TOID(struct tree_map) map, uint64_t key, PMEMoid value)
+{
+	int ret = 0;
+
+	TX_BEGIN(pop) {
+		struct bptree_index *idx = bptree_index_get(pop, map);
+		if (idx == NULL)
+			pmemobj_tx_abort(ENOMEM);
+
+		if (D_RO(map)->head == 0) {
+			PMEMoid oid = pmemobj_tx_zalloc(
+				sizeof (struct bptree_leaf),
+				TOID_TYPE_NUM(struct bptree_leaf));
+			struct bptree_leaf *leaf =
+				bptree_leaf_ptr(pop, oid.off);
+			leaf->keys[0] = key;
+			leaf->values[0] = value;
+			leaf->n = 1;
+
+			TX_ADD_FIELD(map, head);
+			D_RW(map)->head = oid.off;
+			bptree_bump_gen(map, idx);
+
+			idx->height = 0;
+			idx->root.leaf = oid.off;
+		} else {
+			struct bptree_path path;
+			uint64_t off = bptree_find_leaf(idx, key, &path);
+			struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+			unsigned p = bptree_count(leaf->keys, leaf->n, key, 0);
+
+			if (p < leaf->n && leaf->keys[p] == key) {
+				pmemobj_tx_add_range_direct(&leaf->values[p],
+					sizeof (leaf->values[p]));
+				leaf->values[p] = value;
+			} else if (leaf->n < BPTREE_KEYS) {
+				bptree_leaf_insert(leaf, p, key, value);
+			} else {
+				uint64_t roff = bptree_leaf_split(pop, map,
+					off);
+				struct bptree_leaf *right =
+					bptree_leaf_ptr(pop, roff);
+				bptree_bump_gen(map, idx);
+
+				if (p > leaf->n)
+					bptree_leaf_insert(right, p - leaf->n,
+						key, value);
+				else
+					bptree_leaf_insert(leaf, p, key, value);
+
+				if (bptree_index_insert(idx, &path,
+						right->keys[0], roff) != 0) {
+					bptree_index_clear(idx);
+					pmemobj_tx_abort(ENOMEM);
+				}
+			}
+		}
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * bptree_leaf_unlink -- (internal) removes an empty leaf from the list
+ */
+static void
+bptree_leaf_unlink(PMEMobjpool *pop, TOID(struct tree_map) map,
+	uint64_t off)
+{
+	struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+
+	if (leaf->prev != 0) {
+		struct bptree_leaf *prev = bptree_leaf_ptr(pop, leaf->prev);
+		pmemobj_tx_add_range_direct(&prev->next, sizeof (prev->next));
+		prev->next = leaf->next;
+	} else {
+		TX_ADD_FIELD(map, head);
+		D_RW(map)->head = leaf->next;
+	}
+
+	if (leaf->next != 0) {
+		struct bptree_leaf *next = bptree_leaf_ptr(pop, leaf->next);
+		pmemobj_tx_add_range_direct(&next->prev, sizeof (next->prev));
+		next->prev = leaf->prev;
+	}
+
+	pmemobj_tx_free(bptree_leaf_oid(map, off));
+}
+
+/*
+ * tree_map_remove -- removes key-value pair from the map
+ *
+ * Leaves are not merged; a leaf is freed once its last item is removed.
+ */
+PMEMoid
+tree_map_remove(PMEMobjpool *pop, TOID(struct tree_map) map, uint64_t key)
+{
+	PMEMoid ret = OID_NULL;
+
+	TX_BEGIN(pop) {
+		struct bptree_index *idx = bptree_index_get(pop, map);
+		if (idx == NULL)
+			pmemobj_tx_abort(ENOMEM);
+
+		struct bptree_path path;
+		uint64_t off = bptree_find_leaf(idx, key, &path);
+		if (off != 0) {
+			struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+			unsigned p = bptree_count(leaf->keys, leaf->n, key, 0);
+
+			if (p < leaf->n && leaf->keys[p] == key) {
+				ret = leaf->values[p];
+
+				if (leaf->n == 1) {
+					bptree_leaf_unlink(pop, map, off);
+					bptree_bump_gen(map, idx);
+					bptree_index_remove(idx, &path);
+				} else {
+					pmemobj_tx_add_range_direct(leaf->keys,
+						sizeof (leaf->keys) +
+						sizeof (leaf->n));
+					pmemobj_tx_add_range_direct(
+						&leaf->values[p],
+						sizeof (leaf->values[0]) *
+						(leaf->n - p));
+					leaf->n--;
+					memmove(&leaf->keys[p],
+						&leaf->keys[p + 1],
+						sizeof (leaf->keys[0]) *
+						(leaf->n - p));
+					memmove(&leaf->values[p],
+						&leaf->values[p + 1],
+						sizeof (leaf->values[0]) *
+						(leaf->n - p));
+				}
+			}
+		}
+	} TX_ONABORT {
+		ret = OID_NULL;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * tree_map_clear -- removes all elements from the map
+ */
+int
+tree_map_clear(PMEMobjpool *pop,
+	TOID(struct tree_map) map)
+{
+	int ret = 0;
+	TX_BEGIN(pop) {
+		uint64_t off = D_RO(map)->head;
+		while (off != 0) {
+			uint64_t next = bptree_leaf_ptr(pop, off)->next;
+			pmemobj_tx_free(bptree_leaf_oid(map, off));
+			off = next;
+		}
+
+		TX_ADD(map);
+		D_RW(map)->head = 0;
+		D_RW(map)->gen++;
+	} TX_ONABORT {
+		ret = 1;
+	} TX_END
+
+	return ret;
+}
+
+/*
+ * tree_map_get -- searches for a value of the key
+ */
+PMEMoid
+tree_map_get(TOID(struct tree_map) map, uint64_t key)
+{
+	PMEMobjpool *pop = pmemobj_pool(map.oid);
+	struct bptree_index *idx = bptree_index_get(pop, map);
+	if (idx == NULL)
+		return OID_NULL;
+
+	uint64_t off = bptree_find_leaf(idx, key, NULL);
+	if (off == 0)
+		return OID_NULL;
+
+	struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+	unsigned p = bptree_count(leaf->keys, leaf->n, key, 0);
+
+	return p < leaf->n && leaf->keys[p] == key ? leaf->values[p] : OID_NULL;
+}
+
+/*
+ * tree_map_foreach -- calls cb for all items in key order, walking the
+ *	leaf list
+ */
+int
+tree_map_foreach(TOID(struct tree_map) map,
+	int (*cb)(uint64_t key, PMEMoid value, void *arg), void *arg)
+{
+	PMEMobjpool *pop = pmemobj_pool(map.oid);
+
+	for (uint64_t off = D_RO(map)->head; off != 0; ) {
+		struct bptree_leaf *leaf = bptree_leaf_ptr(pop, off);
+		for (uint64_t i = 0; i < leaf->n; ++i)
+			if (cb(leaf->keys[i], leaf->values[i], arg) != 0)
+				return 1;
+		off = leaf->next;
+	}
+
+	return 0;
+}
+
+/*
+ * tree_map_is_empty -- checks whether the tree map is empty
+ */
+int
+tree_map_is_empty(TOID(struct tree_map) map)
+{
+	return D_RO(map)->head == 0;
+}
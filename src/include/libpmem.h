@@ -48,8 +48,23 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
+#include <stdint.h>
 
 void *pmem_map(int fd);
+
+/*
+ * Mapping policy flags for pmem_map_flags(), also accepted by name in the
+ * PMEM_MAP_POLICY environment variable...
+ */
+#define	PMEM_MAP_POPULATE	(1 << 0)	/* mmap() with MAP_POPULATE */
+#define	PMEM_MAP_HUGEPAGE	(1 << 1)	/* madvise(MADV_HUGEPAGE) */
+#define	PMEM_MAP_PREFAULT	(1 << 2)	/* fault in the whole file */
+#define	PMEM_MAP_ALL\
+	(PMEM_MAP_POPULATE | PMEM_MAP_HUGEPAGE | PMEM_MAP_PREFAULT)
+
+void *pmem_map_flags(int fd, int flags);
+int pmem_map_pagesizes(const void *addr, size_t len, size_t *huge2m,
+	size_t *huge1g);
 int pmem_is_pmem(void *addr, size_t len);
 void pmem_persist(void *addr, size_t len);
 int pmem_msync(void *addr, size_t len);
@@ -63,6 +78,29 @@ void *pmem_memmove_nodrain(void *pmemdest, const void *src, size_t len);
 void *pmem_memcpy_nodrain(void *pmemdest, const void *src, size_t len);
 void *pmem_memset_nodrain(void *pmemdest, int c, size_t len);
 
+/*
+ * Flush, fence and copy statistics, counted per thread when the
+ * PMEM_STATS environment variable is set to 1.  Each thread charges
+ * its operations to the context set by pmem_stats_set_context().
+ */
+#define	PMEM_STATS_NCONTEXTS	8	/* contexts 0 .. 7, 0 is the default */
+
+struct pmem_stats_counters {
+	uint64_t flushed_lines;		/* cache lines flushed */
+	uint64_t fences;		/* fences issued by pmem_drain() */
+	uint64_t movnt_bytes;		/* bytes stored with movnt */
+	uint64_t temporal_bytes;	/* bytes copied or set with stores */
+};
+
+struct pmem_stats {
+	struct pmem_stats_counters total;
+	struct pmem_stats_counters contexts[PMEM_STATS_NCONTEXTS];
+};
+
+int pmem_stats_enabled(void);
+unsigned pmem_stats_set_context(unsigned context);
+void pmem_stats_get(struct pmem_stats *stats);
+
 /*
  * PMEM_MAJOR_VERSION and PMEM_MINOR_VERSION provide the current version of the
  * libpmem API as provided by this header file.  Applications can verify that
@@ -72,6 +72,18 @@ const char *pmemblk_check_version(
 #define	PMEMBLK_MIN_BLK ((size_t)512)
 
 PMEMblkpool *pmemblk_open(const char *path, size_t bsize);
+
+/*
+ * Mapping policy flags for pmemblk_open_flags(), also accepted by name in the
+ * PMEMBLK_MAP_POLICY environment variable...
+ */
+#define	PMEMBLK_MAP_POPULATE	(1 << 0)	/* mmap() with MAP_POPULATE */
+#define	PMEMBLK_MAP_HUGEPAGE	(1 << 1)	/* madvise(MADV_HUGEPAGE) */
+#define	PMEMBLK_MAP_PREFAULT	(1 << 2)	/* fault in the whole pool */
+#define	PMEMBLK_MAP_ALL\
+	(PMEMBLK_MAP_POPULATE | PMEMBLK_MAP_HUGEPAGE | PMEMBLK_MAP_PREFAULT)
+
+PMEMblkpool *pmemblk_open_flags(const char *path, size_t bsize, int flags);
 PMEMblkpool *pmemblk_create(const char *path, size_t bsize,
 		size_t poolsize, mode_t mode);
 void pmemblk_close(PMEMblkpool *pbp);
@@ -74,6 +74,18 @@ const char *pmemlog_check_version(
 #define	PMEMLOG_MIN_POOL ((size_t)(1024 * 1024 * 2)) /* min pool size: 2MB */
 
 PMEMlogpool *pmemlog_open(const char *path);
+
+/*
+ * Mapping policy flags for pmemlog_open_flags(), also accepted by name in the
+ * PMEMLOG_MAP_POLICY environment variable...
+ */
+#define	PMEMLOG_MAP_POPULATE	(1 << 0)	/* mmap() with MAP_POPULATE */
+#define	PMEMLOG_MAP_HUGEPAGE	(1 << 1)	/* madvise(MADV_HUGEPAGE) */
+#define	PMEMLOG_MAP_PREFAULT	(1 << 2)	/* fault in the whole pool */
+#define	PMEMLOG_MAP_ALL\
+	(PMEMLOG_MAP_POPULATE | PMEMLOG_MAP_HUGEPAGE | PMEMLOG_MAP_PREFAULT)
+
+PMEMlogpool *pmemlog_open_flags(const char *path, int flags);
 PMEMlogpool *pmemlog_create(const char *path, size_t poolsize, mode_t mode);
 void pmemlog_close(PMEMlogpool *plp);
 int pmemlog_check(const char *path);
@@ -80,6 +80,7 @@ const char *pmemobj_check_version(
 		unsigned minor_required);
 
 #define	PMEMOBJ_MIN_POOL ((size_t)(1024 * 1024 * 256)) /* 8 MB */
+#define	PMEMOBJ_MIN_PART ((size_t)(1024 * 1024 * 2)) /* 2 MiB */
 #define	PMEMOBJ_MAX_LAYOUT ((size_t)1024)
 #define	PMEMOBJ_NUM_OID_TYPES ((unsigned)1024)
 
@@ -87,14 +88,90 @@ const char *pmemobj_check_version(
  * Pool management...
  */
 PMEMobjpool *pmemobj_open(const char *path, const char *layout);
+
+/*
+ * Mapping policy flags for pmemobj_open_flags(), also accepted by name in the
+ * PMEMOBJ_MAP_POLICY environment variable...
+ */
+#define	PMEMOBJ_MAP_POPULATE	(1 << 0)	/* mmap() with MAP_POPULATE */
+#define	PMEMOBJ_MAP_HUGEPAGE	(1 << 1)	/* madvise(MADV_HUGEPAGE) */
+#define	PMEMOBJ_MAP_PREFAULT	(1 << 2)	/* fault in the whole pool */
+#define	PMEMOBJ_MAP_ALL\
+	(PMEMOBJ_MAP_POPULATE | PMEMOBJ_MAP_HUGEPAGE | PMEMOBJ_MAP_PREFAULT)
+
+PMEMobjpool *pmemobj_open_flags(const char *path, const char *layout,
+	int flags);
 PMEMobjpool *pmemobj_create(const char *path, const char *layout,
 	size_t poolsize, mode_t mode);
-PMEMobjpool *pmemobj_create_part(const char *path, const char *layout,
+int pmemobj_create_part(const char *path, const char *layout,
 	size_t partsize, mode_t mode, int part_index, int nparts,
 	int replica_index, int nreplica);
 void pmemobj_close(PMEMobjpool *pop);
 int pmemobj_check(const char *path, const char *layout);
 
+/*
+ * Heap occupancy statistics...
+ */
+#define	PMEMOBJ_MAX_ALLOC_CLASSES 6
+
+struct pobj_alloc_class_stats {
+	size_t unit_size;	/* size of a single allocation unit */
+	uint64_t nruns;		/* number of runs, 0 for the chunk class */
+	uint64_t units;		/* total number of units */
+	uint64_t free_units;	/* number of free units */
+	uint64_t free_blocks;	/* number of free contiguous extents */
+};
+
+struct pobj_heap_stats {
+	size_t heap_size;
+	unsigned nzones;
+	unsigned nzones_processed;	/* zones known to the allocator */
+	unsigned nclasses;
+	struct pobj_alloc_class_stats classes[PMEMOBJ_MAX_ALLOC_CLASSES];
+};
+
+int pmemobj_heap_stats(PMEMobjpool *pop, struct pobj_heap_stats *stats);
+
+/*
+ * Runtime statistics, counted since the pool was opened...
+ */
+struct pobj_class_counters {
+	size_t unit_size;	/* size of a single allocation unit */
+	uint64_t allocs;	/* objects allocated from this class */
+	uint64_t frees;		/* objects returned to this class */
+};
+
+struct pobj_stats {
+	uint64_t lane_holds;		/* lane sections held */
+	uint64_t lane_contended;	/* ...which had to wait for the lane */
+	uint64_t tx_commits;		/* committed outermost transactions */
+	uint64_t tx_aborts;		/* aborted outermost transactions */
+	uint64_t tx_snapshots;		/* ranges added to the undo log */
+	uint64_t tx_snapshot_bytes;	/* bytes of those ranges */
+	uint64_t bucket_refills;	/* empty buckets refilled */
+	uint64_t zone_populations;	/* zones processed by the allocator */
+	uint64_t run_degradations;	/* empty runs turned back into chunks */
+	unsigned nclasses;
+	struct pobj_class_counters classes[PMEMOBJ_MAX_ALLOC_CLASSES];
+};
+
+int pmemobj_stats_get(PMEMobjpool *pop, struct pobj_stats *stats);
+
+/*
+ * Writes the events traced so far to a file, when tracing is enabled with
+ * the PMEMOBJ_TRACE environment variable.
+ */
+int pmemobj_trace_dump(const char *path);
+
+/*
+ * Contexts of the libpmem statistics the flushes and copies made by
+ * libpmemobj are charged to, see pmem_stats_get() in libpmem(3).
+ */
+#define	PMEMOBJ_STATS_REDO	1	/* redo logs */
+#define	PMEMOBJ_STATS_TX	2	/* undo logs and transaction state */
+#define	PMEMOBJ_STATS_LIST	3	/* list entries and list sections */
+#define	PMEMOBJ_STATS_HEAP	4	/* heap metadata */
+
 /*
  * Passing NULL to pmemobj_set_funcs() tells libpmemobj to continue to use the
  * default for that function.  The replacement functions must not make calls
@@ -336,6 +413,50 @@ pmemobj_direct(PMEMoid oid)
 #define	D_RW	DIRECT_RW
 #define	D_RO	DIRECT_RO
 
+const void *pmemobj_pool_local(PMEMoid oid);
+
+extern __thread struct _pobj_lcache {
+	const void *base;
+	uint64_t uuid_lo;
+	unsigned ttl;
+} _pobj_cached_local;
+
+/* lookups after which the NUMA node of the thread is checked again */
+#define	_POBJ_LOCAL_TTL 4096
+
+/*
+ * Returns the read-only pointer of an object in the copy of the pool local
+ * to the NUMA node of the calling thread.
+ *
+ * The copy may be a replica, which does not reflect the changes until they
+ * are persisted (and copied, if the replicas are allowed to lag behind).
+ */
+static inline const void *
+pmemobj_direct_local(PMEMoid oid)
+{
+	if (oid.off == 0 || oid.pool_uuid_lo == 0)
+		return NULL;
+
+	if (_pobj_cached_local.uuid_lo != oid.pool_uuid_lo ||
+	    --_pobj_cached_local.ttl == 0) {
+		if ((_pobj_cached_local.base = pmemobj_pool_local(oid))
+				== NULL) {
+			_pobj_cached_local.uuid_lo = 0;
+			return NULL;
+		}
+
+		_pobj_cached_local.uuid_lo = oid.pool_uuid_lo;
+		_pobj_cached_local.ttl = _POBJ_LOCAL_TTL;
+	}
+
+	return (const char *)_pobj_cached_local.base + oid.off;
+}
+
+#define	DIRECT_LOCAL(o)\
+((const typeof(*(o)._type) *)pmemobj_direct_local((o).oid))
+
+#define	D_LOCAL	DIRECT_LOCAL
+
 /*
  * Non-transactional atomic allocations
  *
@@ -353,6 +474,16 @@ int pmemobj_alloc(PMEMobjpool *pop, PMEMoid *oidp, size_t size,
 	unsigned int type_num, void (*constructor)(PMEMobjpool *pop, void *ptr,
 	void *arg), void *arg);
 
+/*
+ * Allocates n objects of the same size from the pool and calls a constructor
+ * function on each of them. The objects are published in batches, each batch
+ * with a single redo log pass, so either a whole batch becomes visible or none
+ * of it does. The oids array must not reside in the pool.
+ */
+int pmemobj_alloc_n(PMEMobjpool *pop, PMEMoid *oids, size_t n, size_t size,
+	unsigned int type_num, void (*constructor)(PMEMobjpool *pop, void *ptr,
+	void *arg), void *arg);
+
 /*
  * Allocates a new zeroed object from the pool.
  */
@@ -903,6 +1034,16 @@ int pmemobj_tx_add_range_direct(void *ptr, size_t size);
  */
 PMEMoid pmemobj_tx_alloc(size_t size, unsigned int type_num);
 
+/*
+ * Transactionally allocates n new objects of the same size.
+ *
+ * If successful and called during TX_STAGE_WORK, function stores the handles
+ * in oids and returns zero. Otherwise, state changes to TX_STAGE_ONABORT and
+ * an error number is returned.
+ */
+int pmemobj_tx_alloc_n(PMEMoid *oids, size_t n, size_t size,
+	unsigned int type_num);
+
 /*
  * Transactionally allocates new zeroed object.
  *
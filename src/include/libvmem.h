@@ -46,6 +46,7 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
+#include <stdint.h>
 
 typedef struct vmem VMEM;	/* opaque type internal to libvmem */
 
@@ -58,9 +59,50 @@ typedef struct vmem VMEM;	/* opaque type internal to libvmem */
 VMEM *vmem_create(const char *dir, size_t size);
 VMEM *vmem_create_in_region(void *addr, size_t size);
 void vmem_delete(VMEM *vmp);
+int vmem_reset(VMEM *vmp);
+
+/*
+ * flags supported by vmem_create_flags() and vmem_create_in_region_flags()
+ */
+#define	VMEM_RESET_ONLY	(1 << 0)	/* bump allocation, freed by reset */
+
+VMEM *vmem_create_flags(const char *dir, size_t size, int flags);
+VMEM *vmem_create_in_region_flags(void *addr, size_t size, int flags);
 int vmem_check(VMEM *vmp);
 void vmem_stats_print(VMEM *vmp, const char *opts);
 
+/*
+ * statistics of a pool, filled by vmem_stats_get()...
+ */
+#define	VMEM_STATS_NCLASSES 64	/* max number of small size classes */
+
+struct vmem_class_stats {
+	size_t size;			/* size of the objects */
+	size_t curobjs;			/* live objects */
+	uint64_t nmalloc;		/* objects allocated */
+	uint64_t ndalloc;		/* objects freed */
+	uint64_t nrequests;		/* allocation requests */
+	uint64_t nlock_contended;	/* waits for the class locks */
+};
+
+struct vmem_stats {
+	size_t allocated;		/* bytes of live objects */
+	size_t active;			/* bytes of pages with live objects */
+	size_t mapped;			/* bytes of chunks in use */
+	uint64_t nmalloc;		/* objects allocated */
+	uint64_t ndalloc;		/* objects freed */
+	uint64_t nlock_contended;	/* waits for arena and class locks */
+	unsigned nclasses;		/* entries of classes[] filled */
+	struct vmem_class_stats classes[VMEM_STATS_NCLASSES];
+};
+
+/*
+ * flags supported by vmem_stats_get()
+ */
+#define	VMEM_STATS_SAMPLE (1 << 0)	/* totals only, no classes[] */
+
+int vmem_stats_get(VMEM *vmp, struct vmem_stats *stats, int flags);
+
 /*
  * support for malloc and friends...
  */
@@ -506,6 +506,8 @@ void	arena_mapbits_small_set(arena_chunk_t *chunk, size_t pageind,
     size_t runind, size_t binind, size_t flags);
 void	arena_mapbits_unzeroed_set(arena_chunk_t *chunk, size_t pageind,
     size_t unzeroed);
+void	arena_lock(arena_t *arena);
+void	arena_bin_lock(arena_bin_t *bin);
 bool	arena_prof_accum_impl(arena_t *arena, uint64_t accumbytes);
 bool	arena_prof_accum_locked(arena_t *arena, uint64_t accumbytes);
 bool	arena_prof_accum(arena_t *arena, uint64_t accumbytes);
@@ -870,6 +872,32 @@ arena_mapbits_unzeroed_set(arena_chunk_t *chunk, size_t pageind,
 	    unzeroed);
 }
 
+/*
+ * Lock the arena, counting the times another thread holds the lock.  The
+ * counter is only updated with the lock held.
+ */
+JEMALLOC_ALWAYS_INLINE void
+arena_lock(arena_t *arena)
+{
+
+	if (config_stats && malloc_mutex_trylock(&arena->lock)) {
+		malloc_mutex_lock(&arena->lock);
+		arena->stats.nlock_contended++;
+	} else if (!config_stats)
+		malloc_mutex_lock(&arena->lock);
+}
+
+JEMALLOC_ALWAYS_INLINE void
+arena_bin_lock(arena_bin_t *bin)
+{
+
+	if (config_stats && malloc_mutex_trylock(&bin->lock)) {
+		malloc_mutex_lock(&bin->lock);
+		bin->stats.nlock_contended++;
+	} else if (!config_stats)
+		malloc_mutex_lock(&bin->lock);
+}
+
 JEMALLOC_INLINE bool
 arena_prof_accum_impl(arena_t *arena, uint64_t accumbytes)
 {
@@ -79,6 +79,7 @@ void	malloc_rwlock_postfork_child(malloc_rwlock_t *rwlock);
 
 #ifndef JEMALLOC_ENABLE_INLINE
 void	malloc_mutex_lock(malloc_mutex_t *mutex);
+bool	malloc_mutex_trylock(malloc_mutex_t *mutex);
 void	malloc_mutex_unlock(malloc_mutex_t *mutex);
 #if (!defined(_WIN32) && !defined(JEMALLOC_OSSPIN) && !defined(JEMALLOC_MUTEX_INIT_CB))
 bool	malloc_rwlock_init(malloc_rwlock_t *rwlock);
@@ -106,6 +107,22 @@ malloc_mutex_lock(malloc_mutex_t *mutex)
 	}
 }
 
+/* Returns true if the mutex is held by another thread. */
+JEMALLOC_INLINE bool
+malloc_mutex_trylock(malloc_mutex_t *mutex)
+{
+	if (isthreaded) {
+#ifdef _WIN32
+		return (!TryEnterCriticalSection(&mutex->lock));
+#elif (defined(JEMALLOC_OSSPIN))
+		return (!OSSpinLockTry(&mutex->lock));
+#else
+		return (pthread_mutex_trylock(&mutex->lock) != 0);
+#endif
+	}
+	return (false);
+}
+
 JEMALLOC_INLINE void
 malloc_mutex_unlock(malloc_mutex_t *mutex)
 {
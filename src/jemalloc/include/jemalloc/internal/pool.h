@@ -1,13 +1,43 @@
 /******************************************************************************/
 #ifdef JEMALLOC_H_TYPES
 
-#define POOLS_MAX  10
+/*
+ * Pools are registered in a two-level table: a fixed directory of segments,
+ * each holding POOLS_SEG_SIZE pool pointers.  Segments are allocated when
+ * the first pool id they cover is handed out and are never freed or moved,
+ * so a pool can be looked up by id without taking pools_lock.
+ */
+#define LG_POOLS_SEG_SIZE	10
+#define POOLS_SEG_SIZE		(1U << LG_POOLS_SEG_SIZE)
+#define POOLS_SEG_MASK		(POOLS_SEG_SIZE - 1)
+#define POOLS_NSEGS		1024
+#define POOLS_MAX		(POOLS_NSEGS * POOLS_SEG_SIZE)
+
+/* Used pool ids are tracked in bitmaps of longs, per segment. */
+#define LG_POOLS_GROUP_NBITS	(LG_SIZEOF_LONG + 3)
+#define POOLS_GROUP_NBITS	(1U << LG_POOLS_GROUP_NBITS)
+#define POOLS_GROUP_MASK	(POOLS_GROUP_NBITS - 1)
+
+/* Id of a pool torn down by a failed pool_reset(), it can only be deleted. */
+#define POOL_ID_LOST		(UINT_MAX - 1)
+
+/* Initial number of entries of the per thread pool arrays. */
+#define TSD_POOLS_MIN		8
 
 /*
  * We want to expose pool_t to the library user
  * as a result typedef for pool_s is located in "jemalloc.h"
  */
 typedef struct tsd_pool_s tsd_pool_t;
+typedef struct pools_seg_s pools_seg_t;
+typedef struct pool_bump_s pool_bump_t;
+
+/*
+ * Every object of a reset-only pool is preceded by its usable size, which
+ * keeps the objects aligned to the quantum.
+ */
+#define POOL_BUMP_HDR_SIZE	16
+#define POOL_BUMP_HDR_MASK	(POOL_BUMP_HDR_SIZE - 1)
 
 /*
  * Dummy arena is used to pass pool structure to choose_arena function
@@ -20,7 +50,7 @@ do {						\
 (name).pool = (p);				\
 } while (0)
 
-#define	TSD_POOL_INITIALIZER		JEMALLOC_ARG_CONCAT({.arenas = {0}})
+#define	TSD_POOL_INITIALIZER		JEMALLOC_ARG_CONCAT({.npools = 0})
 
 
 #endif /* JEMALLOC_H_TYPES */
@@ -105,11 +135,55 @@ struct pool_s {
 
 	/* List of memory ranges inside pool, useful for pool_check(). */
 	pool_memory_range_node_t *memory_range_list;
+
+	/*
+	 * Optional hooks backing the pool memory on demand, see
+	 * pool_create_sparse().  The chunks in the chunk trees are never
+	 * committed, a chunk is committed when it is taken from the trees and
+	 * decommitted when it is returned to them.
+	 */
+	bool		(*commit)(void *, size_t, void *);
+	bool		(*decommit)(void *, size_t, void *);
+	void		*backing_arg;
+	/* Base pages up to this address are committed. */
+	void		*base_commit_addr;
+
+	/*
+	 * Reset-only pools serve all allocations from a bump pointer, objects
+	 * are only reclaimed all at once by pool_reset().
+	 */
+	bool		reset_only;
+	/* Protects switching to a new bump block. */
+	malloc_mutex_t	bump_mtx;
+	/* Block allocations are carved from, NULL before the first one. */
+	pool_bump_t	*bump;
 };
 
+/*
+ * Header of a chunk carved up by the bump allocator.  The next pointer is
+ * advanced with an atomic add; once it passes end the block is exhausted
+ * and the allocating thread switches the pool to a new block.
+ */
+struct pool_bump_s {
+	uintptr_t	next;
+	uintptr_t	end;
+};
+
+struct pools_seg_s {
+	pool_t *pools[POOLS_SEG_SIZE];
+	/* Bitmap of the pool ids in use. */
+	unsigned long used[POOLS_SEG_SIZE / POOLS_GROUP_NBITS];
+};
+
+/*
+ * Per thread arenas of pools, indexed by pool id.  The arrays are allocated
+ * when the thread first uses a pool and grow with the largest pool id used.
+ */
 struct tsd_pool_s {
-	unsigned seqno[POOLS_MAX]; /* Sequence number of pool */
-	arena_t *arenas[POOLS_MAX];
+	unsigned npools; /* Number of entries of the arrays below */
+	bool base_pool; /* The arrays are allocated from the base pool */
+	unsigned *seqno; /* Sequence number of pool */
+	arena_t **arenas;
 };
 
 /*
@@ -126,9 +200,19 @@ struct tsd_pool_s {
 
 bool pool_new(pool_t *pool, unsigned pool_id);
 void pool_destroy(pool_t *pool);
+bool pool_id_alloc(unsigned *pool_id);
+void pool_set(unsigned pool_id, pool_t *pool);
+bool pool_tsd_grow(void ***ptrs, unsigned **seqno, unsigned *npools,
+    bool *base_pool, unsigned pool_id);
+void pool_tsd_free(void **ptrs, bool base_pool);
+void *pool_bump_alloc_hard(pool_t *pool, size_t size, size_t alignment);
+void *pool_bump_ralloc(pool_t *pool, void *ptr, size_t size);
 
 extern malloc_mutex_t	pools_lock;
 extern malloc_mutex_t	pool_base_lock;
+extern pools_seg_t	*pools_segs[POOLS_NSEGS];
+extern unsigned	npools;
+extern unsigned	pools_nids;
 
 bool pool_boot();
 void pool_prefork();
@@ -141,6 +225,12 @@ void pool_postfork_child();
 
 #ifndef JEMALLOC_ENABLE_INLINE
 bool pool_is_file_mapped(pool_t *pool);
+bool pool_commit(pool_t *pool, void *addr, size_t size);
+bool pool_decommit(pool_t *pool, void *addr, size_t size);
+pool_t *pool_get(unsigned pool_id);
+void *pool_bump_carve(pool_bump_t *bump, size_t size, size_t alignment);
+void *pool_bump_alloc(pool_t *pool, size_t size);
+size_t pool_bump_usize(const void *ptr);
 #endif
 
 #if (defined(JEMALLOC_ENABLE_INLINE) || defined (JEMALLOC_POOL_C_))
@@ -149,6 +239,99 @@ pool_is_file_mapped(pool_t *pool)
 {
 	return pool->pool_id != 0;
 }
+
+/* Back the range with memory, returns true on failure. */
+JEMALLOC_INLINE bool
+pool_commit(pool_t *pool, void *addr, size_t size)
+{
+	if (pool->commit == NULL)
+		return (false);
+
+	return (pool->commit(addr, size, pool->backing_arg));
+}
+
+/*
+ * Release the memory backing the range, returns true if the pool cannot do
+ * it.  A decommitted range reads as zeros.
+ */
+JEMALLOC_INLINE bool
+pool_decommit(pool_t *pool, void *addr, size_t size)
+{
+	if (pool->decommit == NULL)
+		return (true);
+
+	return (pool->decommit(addr, size, pool->backing_arg));
+}
+
+/*
+ * Look up a pool by id, returns NULL if no pool uses the id.  The segment
+ * and the pool are published with release semantics by pool_register().
+ */
+JEMALLOC_ALWAYS_INLINE pool_t *
+pool_get(unsigned pool_id)
+{
+	pools_seg_t *seg;
+
+	if (pool_id >= POOLS_MAX)
+		return (NULL);
+
+	seg = __atomic_load_n(&pools_segs[pool_id >> LG_POOLS_SEG_SIZE],
+	    __ATOMIC_ACQUIRE);
+	if (seg == NULL)
+		return (NULL);
+
+	return (__atomic_load_n(&seg->pools[pool_id & POOLS_SEG_MASK],
+	    __ATOMIC_ACQUIRE));
+}
+
+/*
+ * Carve an object of size bytes (a multiple of the header size) from a bump
+ * block, returns NULL if the block is exhausted.
+ */
+JEMALLOC_ALWAYS_INLINE void *
+pool_bump_carve(pool_bump_t *bump, size_t size, size_t alignment)
+{
+	size_t need = POOL_BUMP_HDR_SIZE + size;
+	uintptr_t end, ret;
+
+	if (alignment > POOL_BUMP_HDR_SIZE)
+		need += alignment - POOL_BUMP_HDR_SIZE;
+
+	end = __atomic_add_fetch(&bump->next, need, __ATOMIC_RELAXED);
+	if (end > bump->end)
+		return (NULL);
+
+	ret = end - need + POOL_BUMP_HDR_SIZE;
+	if (alignment > POOL_BUMP_HDR_SIZE)
+		ret = ALIGNMENT_CEILING(ret, alignment);
+	*((size_t *)ret - 1) = size;
+
+	return ((void *)ret);
+}
+
+/* Allocate from a reset-only pool. */
+JEMALLOC_ALWAYS_INLINE void *
+pool_bump_alloc(pool_t *pool, size_t size)
+{
+	pool_bump_t *bump = __atomic_load_n(&pool->bump, __ATOMIC_ACQUIRE);
+	void *ret;
+
+	if (bump != NULL && size <= SMALL_MAXCLASS) {
+		size = (size + POOL_BUMP_HDR_MASK) & ~POOL_BUMP_HDR_MASK;
+		if ((ret = pool_bump_carve(bump, size, 0)) != NULL)
+			return (ret);
+	}
+
+	return (pool_bump_alloc_hard(pool, size, 0));
+}
+
+/* Usable size of an object of a reset-only pool. */
+JEMALLOC_ALWAYS_INLINE size_t
+pool_bump_usize(const void *ptr)
+{
+
+	return (*((const size_t *)ptr - 1));
+}
 #endif
 
 #endif /* JEMALLOC_H_INLINES */
@@ -59,6 +59,9 @@ struct malloc_bin_stats_s {
 
 	/* Current number of runs in this bin. */
 	size_t		curruns;
+
+	/* Number of times the bin lock was found held by another thread. */
+	uint64_t	nlock_contended;
 };
 
 struct malloc_large_stats_s {
@@ -95,6 +98,9 @@ struct arena_stats_s {
 	uint64_t	nmadvise;
 	uint64_t	purged;
 
+	/* Number of times the arena lock was found held by another thread. */
+	uint64_t	nlock_contended;
+
 	/* Per-size-category statistics. */
 	size_t		allocated_large;
 	uint64_t	nmalloc_large;
@@ -138,6 +144,8 @@ extern bool	opt_stats_print;
 
 void	stats_print(pool_t *pool, void (*write)(void *, const char *), void *cbopaque,
     const char *opts);
+void	stats_pool_get(pool_t *pool, pool_stats_t *stats, pool_bin_stats_t *bins,
+    unsigned nbins);
 
 #endif /* JEMALLOC_H_EXTERNS */
 /******************************************************************************/
@@ -42,7 +42,7 @@ typedef struct tsd_tcache_s tsd_tcache_t;
 #define	TCACHE_GC_INCR							\
     ((TCACHE_GC_SWEEP / NBINS) + ((TCACHE_GC_SWEEP / NBINS == 0) ? 0 : 1))
 
-#define	TSD_TCACHE_INITIALIZER	JEMALLOC_ARG_CONCAT({.tcaches = {0}})
+#define	TSD_TCACHE_INITIALIZER	JEMALLOC_ARG_CONCAT({.npools = 0})
 
 #endif /* JEMALLOC_H_TYPES */
 /******************************************************************************/
@@ -85,9 +85,16 @@ struct tcache_s {
 	 */
 };
 
+/*
+ * Per thread caches of pools, indexed by pool id, see tsd_pool_s.  Once
+ * tcache_thread_cleanup() freed the arrays, no more caches are created.
+ */
 struct tsd_tcache_s {
-	unsigned seqno[POOLS_MAX]; /* Sequence number of pool */
-	tcache_t* tcaches[POOLS_MAX];
+	unsigned npools; /* Number of entries of the arrays below */
+	bool purgatory; /* tcache_thread_cleanup() was called */
+	bool base_pool; /* The arrays are allocated from the base pool */
+	unsigned *seqno; /* Sequence number of pool */
+	tcache_t **tcaches;
 };
 
 #endif /* JEMALLOC_H_STRUCTS */
@@ -119,6 +126,7 @@ void	tcache_bin_flush_large(tcache_bin_t *tbin, size_t binind, unsigned rem,
 void	tcache_arena_associate(tcache_t *tcache, arena_t *arena);
 void	tcache_arena_dissociate(tcache_t *tcache);
 tcache_t *tcache_get_hard(tcache_t *tcache, pool_t *pool, bool create);
+bool	tcache_tsd_extend(tsd_tcache_t *tsd, unsigned pool_id);
 tcache_t *tcache_create(arena_t *arena);
 void	tcache_destroy(tcache_t *tcache);
 void	tcache_thread_cleanup(void *arg);
@@ -161,6 +169,9 @@ tcache_flush(pool_t *pool)
 {
 	tsd_tcache_t *tsd = tcache_tsd_get();
 
+	if (pool->pool_id >= tsd->npools)
+		return;
+
 	tcache_t *tcache = tsd->tcaches[pool->pool_id];
 
 	if (tsd->seqno[pool->pool_id] == pool->seqno) {
@@ -195,7 +206,7 @@ tcache_enabled_set(bool enabled)
 	tcache_enabled_t tcache_enabled;
 	tsd_tcache_t *tsd;
 	tcache_t *tcache;
-	int i;
+	unsigned i;
 
 	cassert(config_tcache);
 
@@ -204,7 +215,7 @@ tcache_enabled_set(bool enabled)
 	tsd = tcache_tsd_get();
 
 	malloc_mutex_lock(&pools_lock);
-	for (i = 0; i < POOLS_MAX; i++) {
+	for (i = 0; i < tsd->npools; i++) {
 		tcache = tsd->tcaches[i];
 		if (tcache != NULL) {
 			if (enabled) {
@@ -213,7 +224,8 @@ tcache_enabled_set(bool enabled)
 				}
 			} else /* disabled */ {
 				if (tcache > TCACHE_STATE_MAX) {
-					if (pools[i] != NULL && tsd->seqno[i] == pools[i]->seqno)
+					pool_t *pool = pool_get(i);
+					if (pool != NULL && tsd->seqno[i] == pool->seqno)
 						tcache_destroy(tcache);
 
 					tcache = NULL;
@@ -240,6 +252,14 @@ tcache_get(pool_t *pool, bool create)
 
 	tsd = tcache_tsd_get();
 
+	/*
+	 * Growing the arrays on free() would allocate as its side effect.  The
+	 * id of a deleted pool is past POOLS_MAX, see choose_arena().
+	 */
+	if (pool->pool_id >= tsd->npools && pool->pool_id < POOLS_MAX &&
+	    (create == false || tcache_tsd_extend(tsd, pool->pool_id)))
+		return (NULL);
+
 	/*
 	 * All subsequent pools with the same id have to cleanup tcache before
 	 * calling tcache_get_hard.
@@ -569,7 +569,7 @@ arena_chunk_alloc_internal(arena_t *arena, size_t size, size_t alignment,
 	malloc_mutex_unlock(&arena->lock);
 	chunk = (arena_chunk_t *)chunk_alloc_arena(chunk_alloc, chunk_dalloc,
 	    arena, NULL, size, alignment, zero);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	if (config_stats && chunk != NULL)
 		arena->stats.mapped += chunksize;
 
@@ -584,7 +584,7 @@ arena_chunk_alloc_huge(arena_t *arena, void *new_addr, size_t size,
 	chunk_alloc_t *chunk_alloc;
 	chunk_dalloc_t *chunk_dalloc;
 
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	chunk_alloc = arena->chunk_alloc;
 	chunk_dalloc = arena->chunk_dalloc;
 	if (config_stats) {
@@ -604,7 +604,7 @@ arena_chunk_alloc_huge(arena_t *arena, void *new_addr, size_t size,
 			stats_cactive_add(arena->pool, size);
 		else {
 			/* Revert optimistic stats updates. */
-			malloc_mutex_lock(&arena->lock);
+			arena_lock(arena);
 			arena->stats.mapped -= size;
 			arena->stats.allocated_huge -= size;
 			arena->stats.nmalloc_huge--;
@@ -703,7 +703,7 @@ arena_chunk_dalloc_internal(arena_t *arena, arena_chunk_t *chunk)
 	chunk_dalloc = arena->chunk_dalloc;
 	malloc_mutex_unlock(&arena->lock);
 	chunk_dalloc((void *)chunk, chunksize, arena->ind, arena->pool);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	if (config_stats)
 		arena->stats.mapped -= chunksize;
 }
@@ -713,7 +713,7 @@ arena_chunk_dalloc_huge(arena_t *arena, void *chunk, size_t size)
 {
 	chunk_dalloc_t *chunk_dalloc;
 
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	chunk_dalloc = arena->chunk_dalloc;
 	if (config_stats) {
 		arena->stats.mapped -= size;
@@ -1016,7 +1016,7 @@ arena_chunk_purge_stashed(arena_t *arena, arena_chunk_t *chunk,
 		if (config_stats)
 			nmadvise++;
 	}
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	if (config_stats)
 		arena->stats.nmadvise += nmadvise;
 
@@ -1174,7 +1174,7 @@ arena_purge(arena_t *arena, bool all)
 void
 arena_purge_all(arena_t *arena)
 {
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	arena_purge(arena, true);
 	malloc_mutex_unlock(&arena->lock);
 }
@@ -1463,7 +1463,7 @@ arena_bin_nonfull_run_get(arena_t *arena, arena_bin_t *bin)
 	/* Allocate a new run. */
 	malloc_mutex_unlock(&bin->lock);
 	/******************************/
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	run = arena_run_alloc_small(arena, bin_info->run_size, binind);
 	if (run != NULL) {
 		bitmap_t *bitmap = (bitmap_t *)((uintptr_t)run +
@@ -1477,7 +1477,7 @@ arena_bin_nonfull_run_get(arena_t *arena, arena_bin_t *bin)
 	}
 	malloc_mutex_unlock(&arena->lock);
 	/********************************/
-	malloc_mutex_lock(&bin->lock);
+	arena_bin_lock(bin);
 	if (run != NULL) {
 		if (config_stats) {
 			bin->stats.nruns++;
@@ -1562,7 +1562,7 @@ arena_tcache_fill_small(arena_t *arena, tcache_bin_t *tbin, size_t binind,
 	if (config_prof && arena_prof_accum(arena, prof_accumbytes))
 		prof_idump();
 	bin = &arena->bins[binind];
-	malloc_mutex_lock(&bin->lock);
+	arena_bin_lock(bin);
 	for (i = 0, nfill = (tcache_bin_info[binind].ncached_max >>
 	    tbin->lg_fill_div); i < nfill; i++) {
 		if ((run = bin->runcur) != NULL && run->nfree > 0)
@@ -1703,7 +1703,7 @@ arena_malloc_small(arena_t *arena, size_t size, bool zero)
 	bin = &arena->bins[binind];
 	size = small_bin2size(binind);
 
-	malloc_mutex_lock(&bin->lock);
+	arena_bin_lock(bin);
 	if ((run = bin->runcur) != NULL && run->nfree > 0)
 		ret = arena_run_reg_alloc(run, &arena_bin_info[binind]);
 	else
@@ -1752,7 +1752,7 @@ arena_malloc_large(arena_t *arena, size_t size, bool zero)
 
 	/* Large allocation. */
 	size = PAGE_CEILING(size);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	ret = (void *)arena_run_alloc_large(arena, size, zero);
 	if (ret == NULL) {
 		malloc_mutex_unlock(&arena->lock);
@@ -1798,7 +1798,7 @@ arena_palloc(arena_t *arena, size_t size, size_t alignment, bool zero)
 	alignment = PAGE_CEILING(alignment);
 	alloc_size = size + alignment - PAGE;
 
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	run = arena_run_alloc_large(arena, alloc_size, false);
 	if (run == NULL) {
 		malloc_mutex_unlock(&arena->lock);
@@ -1910,7 +1910,7 @@ arena_dalloc_bin_run(arena_t *arena, arena_chunk_t *chunk, arena_run_t *run,
 	    (uintptr_t)bin_info->reg0_offset + (uintptr_t)(run->nextind *
 	    bin_info->reg_interval - bin_info->redzone_size) -
 	    (uintptr_t)chunk) >> LG_PAGE);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 
 	/*
 	 * If the run was originally clean, and some pages were never touched,
@@ -1932,7 +1932,7 @@ arena_dalloc_bin_run(arena_t *arena, arena_chunk_t *chunk, arena_run_t *run,
 	arena_run_dalloc(arena, run, true, false);
 	malloc_mutex_unlock(&arena->lock);
 	/****************************/
-	malloc_mutex_lock(&bin->lock);
+	arena_bin_lock(bin);
 	if (config_stats)
 		bin->stats.curruns--;
 }
@@ -2003,7 +2003,7 @@ arena_dalloc_bin(arena_t *arena, arena_chunk_t *chunk, void *ptr,
 	run = (arena_run_t *)((uintptr_t)chunk + (uintptr_t)((pageind -
 	    arena_mapbits_small_runind_get(chunk, pageind)) << LG_PAGE));
 	bin = run->bin;
-	malloc_mutex_lock(&bin->lock);
+	arena_bin_lock(bin);
 	arena_dalloc_bin_locked(arena, chunk, ptr, mapelm);
 	malloc_mutex_unlock(&bin->lock);
 }
@@ -2065,7 +2065,7 @@ void
 arena_dalloc_large(arena_t *arena, arena_chunk_t *chunk, void *ptr)
 {
 
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	arena_dalloc_large_locked(arena, chunk, ptr);
 	malloc_mutex_unlock(&arena->lock);
 }
@@ -2081,7 +2081,7 @@ arena_ralloc_large_shrink(arena_t *arena, arena_chunk_t *chunk, void *ptr,
 	 * Shrink the run, and make trailing pages available for other
 	 * allocations.
 	 */
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	arena_run_trim_tail(arena, chunk, (arena_run_t *)ptr, oldsize, size,
 	    true);
 	if (config_stats) {
@@ -2112,7 +2112,7 @@ arena_ralloc_large_grow(arena_t *arena, arena_chunk_t *chunk, void *ptr,
 
 	/* Try to extend the run. */
 	assert(size + extra > oldsize);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	if (pageind + npages < chunk_npages &&
 	    arena_mapbits_allocated_get(chunk, pageind+npages) == 0 &&
 	    (followsize = arena_mapbits_unallocated_size_get(chunk,
@@ -2324,7 +2324,7 @@ arena_dss_prec_get(arena_t *arena)
 {
 	dss_prec_t ret;
 
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	ret = arena->dss_prec;
 	malloc_mutex_unlock(&arena->lock);
 	return (ret);
@@ -2336,7 +2336,7 @@ arena_dss_prec_set(arena_t *arena, dss_prec_t dss_prec)
 
 	if (have_dss == false)
 		return (dss_prec != dss_prec_disabled);
-	malloc_mutex_lock(&arena->lock);
+	arena_lock(arena);
 	arena->dss_prec = dss_prec;
 	malloc_mutex_unlock(&arena->lock);
 	return (false);
@@ -15,6 +15,8 @@ base_pages_alloc(pool_t *pool, size_t minsize)
 		return (true);
 	pool->base_next_addr = base_pages;
 	pool->base_past_addr = (void *)((uintptr_t)base_pages + csize);
+	/* chunks are committed when taken from the chunk trees */
+	pool->base_commit_addr = pool->base_past_addr;
 
 	return (false);
 }
@@ -39,6 +41,20 @@ base_alloc(pool_t *pool, size_t size)
 	/* Allocate. */
 	ret = pool->base_next_addr;
 	pool->base_next_addr = (void *)((uintptr_t)pool->base_next_addr + csize);
+	if (pool->commit != NULL && (uintptr_t)pool->base_next_addr >
+	    (uintptr_t)pool->base_commit_addr) {
+		/* Commit the pool space used by the base allocator. */
+		uintptr_t end = CHUNK_CEILING((uintptr_t)pool->base_next_addr);
+		if (end > (uintptr_t)pool->base_past_addr)
+			end = (uintptr_t)pool->base_past_addr;
+		if (pool_commit(pool, pool->base_commit_addr,
+		    end - (uintptr_t)pool->base_commit_addr)) {
+			pool->base_next_addr = ret;
+			malloc_mutex_unlock(&pool->base_mtx);
+			return (NULL);
+		}
+		pool->base_commit_addr = (void *)end;
+	}
 	malloc_mutex_unlock(&pool->base_mtx);
 	JEMALLOC_VALGRIND_MAKE_MEM_UNDEFINED(ret, csize);
 
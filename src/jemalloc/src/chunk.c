@@ -104,6 +104,11 @@ chunk_recycle(pool_t *pool, extent_tree_t *chunks_szad, extent_tree_t *chunks_ad
 
 	if (node != NULL)
 		base_node_dalloc(pool, node);
+	if (pool_commit(pool, ret, size)) {
+		/* The backing store is exhausted, put the range back. */
+		chunk_record(pool, chunks_szad, chunks_ad, ret, size, zeroed);
+		return (NULL);
+	}
 	if (*zero) {
 		if (zeroed == false)
 			memset(ret, 0, size);
@@ -262,20 +267,27 @@ chunk_alloc_default(void *new_addr, size_t size, size_t alignment, bool *zero,
 	}
 }
 
-void
-chunk_record(pool_t *pool, extent_tree_t *chunks_szad, extent_tree_t *chunks_ad, void *chunk,
-    size_t size, bool zeroed)
+static void
+chunk_record_core(pool_t *pool, extent_tree_t *chunks_szad,
+    extent_tree_t *chunks_ad, void *chunk, size_t size, bool zeroed,
+    bool purge)
 {
 	bool unzeroed, file_mapped;
 	extent_node_t *xnode, *node, *prev, *xprev, key;
 
 	file_mapped = pool_is_file_mapped(pool);
-	unzeroed = pages_purge(chunk, size, file_mapped);
+	if (purge == false)
+		unzeroed = true;
+	else if (pool_decommit(pool, chunk, size) == false)
+		unzeroed = false;
+	else
+		unzeroed = pages_purge(chunk, size, file_mapped);
 	JEMALLOC_VALGRIND_MAKE_MEM_NOACCESS(chunk, size);
 
 	/*
-	 * If pages_purge() returned that the pages were zeroed
-	 * as a side effect of purging we can safely do this assignment.
+	 * If the pages were decommitted or pages_purge() returned that they
+	 * were zeroed as a side effect of purging we can safely do this
+	 * assignment.
 	 */
 	if (zeroed == false && unzeroed == false) {
 		zeroed = true;
@@ -359,6 +371,28 @@ label_return:
 		base_node_dalloc(pool, xprev);
 }
 
+void
+chunk_record(pool_t *pool, extent_tree_t *chunks_szad, extent_tree_t *chunks_ad, void *chunk,
+    size_t size, bool zeroed)
+{
+
+	chunk_record_core(pool, chunks_szad, chunks_ad, chunk, size, zeroed,
+	    true);
+}
+
+/*
+ * Record a dirty chunk without purging it, for pool_reset(), where the pages
+ * are about to be reused.
+ */
+void
+chunk_record_dirty(pool_t *pool, extent_tree_t *chunks_szad,
+    extent_tree_t *chunks_ad, void *chunk, size_t size)
+{
+
+	chunk_record_core(pool, chunks_szad, chunks_ad, chunk, size, false,
+	    false);
+}
+
 void
 chunk_unmap(pool_t *pool, void *chunk, size_t size)
 {
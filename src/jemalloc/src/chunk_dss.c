@@ -69,7 +69,7 @@ void *
 chunk_alloc_dss(size_t size, size_t alignment, bool *zero)
 {
 	void *ret;
-	pool_t *base_pool = pools[0];
+	pool_t *base_pool = pool_get(0);
 
 	cassert(have_dss);
 	assert(size > 0 && (size & chunksize_mask) == 0);
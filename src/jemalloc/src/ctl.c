@@ -711,9 +711,10 @@ ctl_refresh_pool(pool_t *pool)
 static void
 ctl_refresh(void)
 {
-	for (int i = 0; i < POOLS_MAX; ++i) {
-		if (pools[i] != NULL) {
-			ctl_refresh_pool(pools[i]);
+	for (unsigned i = 0; i < pools_nids; ++i) {
+		pool_t *pool = pool_get(i);
+		if (pool != NULL) {
+			ctl_refresh_pool(pool);
 		}
 	}
 }
@@ -769,9 +770,10 @@ ctl_init(void)
 {
 	bool ret;
 	malloc_mutex_lock(&ctl_mtx);
-	for (int i = 0; i < POOLS_MAX; ++i) {
-		if (pools[i] != NULL && pools[i]->ctl_initialized == false) {
-			if (ctl_init_pool(pools[i])) {
+	for (unsigned i = 0; i < pools_nids; ++i) {
+		pool_t *pool = pool_get(i);
+		if (pool != NULL && pool->ctl_initialized == false) {
+			if (ctl_init_pool(pool)) {
 				ret = true;
 				goto label_return;
 			}
@@ -1251,10 +1253,10 @@ thread_arena_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 	pool_t *pool;
 	arena_t dummy;
 
-	if (pool_ind >= POOLS_MAX)
+	if (pool_ind >= pools_nids)
 		return (ENOENT);
 
-	pool = pools[pool_ind];
+	pool = pool_get(pool_ind);
 	DUMMY_ARENA_INITIALIZE(dummy, pool);
 	tsd_tcache_t *tcache_tsd = tcache_tsd_get();
 
@@ -1287,7 +1289,8 @@ thread_arena_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 
 		/* Set new arena association. */
 		if (config_tcache) {
-			tcache_t *tcache = tcache_tsd->tcaches[pool->pool_id];
+			tcache_t *tcache = pool->pool_id < tcache_tsd->npools ?
+			    tcache_tsd->tcaches[pool->pool_id] : NULL;
 			if ((uintptr_t)(tcache) > (uintptr_t)TCACHE_STATE_MAX) {
 
 				if(tcache_tsd->seqno[pool->pool_id] == pool->seqno)
@@ -1298,9 +1301,12 @@ thread_arena_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 			}
 		}
 
+		/* choose_arena() made room for the pool in the arrays */
 		tsd = arenas_tsd_get();
-		tsd->seqno[0] = pool->seqno;
-		tsd->arenas[0] = arena;
+		if (pool->pool_id < tsd->npools) {
+			tsd->seqno[pool->pool_id] = pool->seqno;
+			tsd->arenas[pool->pool_id] = arena;
+		}
 	}
 
 	ret = 0;
@@ -1349,7 +1355,7 @@ thread_tcache_flush_ctl(const size_t *mib, size_t miblen, void *oldp,
 {
 	int ret;
 
-	pool_t *pool = pools[0];
+	pool_t *pool = pool_get(0);
 
 	if (config_tcache == false)
 		return (ENOENT);
@@ -1395,13 +1401,13 @@ arena_i_purge_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 {
 	int ret;
 
-	if (mib[1] >= POOLS_MAX)
+	if (mib[1] >= pools_nids)
 		return (ENOENT);
 
 	READONLY();
 	WRITEONLY();
 	malloc_mutex_lock(&ctl_mtx);
-	arena_purge(pools[mib[1]], mib[3]);
+	arena_purge(pool_get(mib[1]), mib[3]);
 	malloc_mutex_unlock(&ctl_mtx);
 
 	ret = 0;
@@ -1422,11 +1428,11 @@ arena_i_dss_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 	dss_prec_t dss_prec = dss_prec_limit;
 	pool_t *pool;
 
-	if (pool_ind >= POOLS_MAX)
+	if (pool_ind >= pools_nids)
 		return (ENOENT);
 
 	malloc_mutex_lock(&ctl_mtx);
-	pool = pools[pool_ind];
+	pool = pool_get(pool_ind);
 	WRITE(dss, const char *);
 	match = false;
 	for (i = 0; i < dss_prec_limit; i++) {
@@ -1475,11 +1481,11 @@ arena_i_chunk_alloc_ctl(const size_t *mib, size_t miblen, void *oldp,
 	arena_t *arena;
 	pool_t *pool;
 
-	if (pool_ind >= POOLS_MAX)
+	if (pool_ind >= pools_nids)
 		return (ENOENT);
 
 	malloc_mutex_lock(&ctl_mtx);
-	pool = pools[pool_ind];
+	pool = pool_get(pool_ind);
 	if (arena_ind < pool->narenas_total && (arena = pool->arenas[arena_ind]) != NULL) {
 		malloc_mutex_lock(&arena->lock);
 		READ(arena->chunk_alloc, chunk_alloc_t *);
@@ -1511,11 +1517,11 @@ arena_i_chunk_dalloc_ctl(const size_t *mib, size_t miblen, void *oldp,
 	arena_t *arena;
 	pool_t *pool;
 
-	if (pool_ind >= POOLS_MAX)
+	if (pool_ind >= pools_nids)
 		return (ENOENT);
 
 	malloc_mutex_lock(&ctl_mtx);
-	pool = pools[pool_ind];
+	pool = pool_get(pool_ind);
 	if (arena_ind < pool->narenas_total && (arena = pool->arenas[arena_ind]) != NULL) {
 		malloc_mutex_lock(&arena->lock);
 		READ(arena->chunk_dalloc, chunk_dalloc_t *);
@@ -1543,7 +1549,7 @@ arena_i_index(const size_t *mib, size_t miblen, size_t i)
 	const ctl_named_node_t * ret;
 
 	malloc_mutex_lock(&ctl_mtx);
-	if (i > pools[mib[1]]->ctl_stats.narenas) {
+	if (i > pool_get(mib[1])->ctl_stats.narenas) {
 		ret = NULL;
 		goto label_return;
 	}
@@ -1569,7 +1575,7 @@ arenas_narenas_ctl(const size_t *mib, size_t miblen, void *oldp,
 		ret = EINVAL;
 		goto label_return;
 	}
-	narenas = pools[mib[1]]->ctl_stats.narenas;
+	narenas = pool_get(mib[1])->ctl_stats.narenas;
 	READ(narenas, unsigned);
 
 	ret = 0;
@@ -1588,7 +1594,7 @@ arenas_initialized_ctl(const size_t *mib, size_t miblen, void *oldp,
 
 	malloc_mutex_lock(&ctl_mtx);
 	READONLY();
-	pool = pools[mib[1]];
+	pool = pool_get(mib[1]);
 	if (*oldlenp != pool->ctl_stats.narenas * sizeof(bool)) {
 		ret = EINVAL;
 		nread = (*oldlenp < pool->ctl_stats.narenas * sizeof(bool))
@@ -1643,10 +1649,10 @@ arenas_extend_ctl(const size_t *mib, size_t miblen, void *oldp, size_t *oldlenp,
 	unsigned pool_ind = mib[1];
 	pool_t *pool;
 
-	if (pool_ind >= POOLS_MAX)
+	if (pool_ind >= pools_nids)
 		return (ENOENT);
 
-	pool = pools[pool_ind];
+	pool = pool_get(pool_ind);
 
 	malloc_mutex_lock(&ctl_mtx);
 	READONLY();
@@ -1737,7 +1743,7 @@ pool_i_index(const size_t *mib, size_t miblen, size_t i)
        const ctl_named_node_t * ret;
 
        malloc_mutex_lock(&ctl_mtx);
-       if (i > POOLS_MAX) {
+       if (i >= pools_nids || pool_get(i) == NULL) {
                ret = NULL;
                goto label_return;
        }
@@ -1810,71 +1816,71 @@ CTL_RO_NL_CGEN(config_prof, prof_interval, prof_interval, uint64_t)
  * @TODO remember to split up stats to arena-related and th rest
  */
 
-CTL_RO_CGEN(config_stats, stats_cactive, &(pools[mib[1]]->stats_cactive), size_t *)
-CTL_RO_CGEN(config_stats, stats_allocated, pools[mib[1]]->ctl_stats_allocated, size_t)
-CTL_RO_CGEN(config_stats, stats_active, pools[mib[1]]->ctl_stats_active, size_t)
-CTL_RO_CGEN(config_stats, stats_mapped, pools[mib[1]]->ctl_stats_mapped, size_t)
-CTL_RO_CGEN(config_stats, stats_chunks_current, pools[mib[1]]->ctl_stats.chunks.current,
+CTL_RO_CGEN(config_stats, stats_cactive, &(pool_get(mib[1])->stats_cactive), size_t *)
+CTL_RO_CGEN(config_stats, stats_allocated, pool_get(mib[1])->ctl_stats_allocated, size_t)
+CTL_RO_CGEN(config_stats, stats_active, pool_get(mib[1])->ctl_stats_active, size_t)
+CTL_RO_CGEN(config_stats, stats_mapped, pool_get(mib[1])->ctl_stats_mapped, size_t)
+CTL_RO_CGEN(config_stats, stats_chunks_current, pool_get(mib[1])->ctl_stats.chunks.current,
     size_t)
-CTL_RO_CGEN(config_stats, stats_chunks_total, pools[mib[1]]->ctl_stats.chunks.total, uint64_t)
-CTL_RO_CGEN(config_stats, stats_chunks_high, pools[mib[1]]->ctl_stats.chunks.high, size_t)
+CTL_RO_CGEN(config_stats, stats_chunks_total, pool_get(mib[1])->ctl_stats.chunks.total, uint64_t)
+CTL_RO_CGEN(config_stats, stats_chunks_high, pool_get(mib[1])->ctl_stats.chunks.high, size_t)
 
-CTL_RO_GEN(stats_arenas_i_dss, pools[mib[1]]->ctl_stats.arenas[mib[4]].dss, const char *)
-CTL_RO_GEN(stats_arenas_i_nthreads, pools[mib[1]]->ctl_stats.arenas[mib[4]].nthreads, unsigned)
-CTL_RO_GEN(stats_arenas_i_pactive, pools[mib[1]]->ctl_stats.arenas[mib[4]].pactive, size_t)
-CTL_RO_GEN(stats_arenas_i_pdirty, pools[mib[1]]->ctl_stats.arenas[mib[4]].pdirty, size_t)
+CTL_RO_GEN(stats_arenas_i_dss, pool_get(mib[1])->ctl_stats.arenas[mib[4]].dss, const char *)
+CTL_RO_GEN(stats_arenas_i_nthreads, pool_get(mib[1])->ctl_stats.arenas[mib[4]].nthreads, unsigned)
+CTL_RO_GEN(stats_arenas_i_pactive, pool_get(mib[1])->ctl_stats.arenas[mib[4]].pactive, size_t)
+CTL_RO_GEN(stats_arenas_i_pdirty, pool_get(mib[1])->ctl_stats.arenas[mib[4]].pdirty, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_mapped,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.mapped, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.mapped, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_npurge,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.npurge, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.npurge, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_nmadvise,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nmadvise, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.nmadvise, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_purged,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.purged, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.purged, uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_allocated,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].allocated_small, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].allocated_small, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_nmalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].nmalloc_small, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].nmalloc_small, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_ndalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].ndalloc_small, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].ndalloc_small, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_nrequests,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].nrequests_small, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].nrequests_small, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_large_allocated,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.allocated_large, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.allocated_large, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_large_nmalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nmalloc_large, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.nmalloc_large, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_large_ndalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.ndalloc_large, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.ndalloc_large, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_large_nrequests,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nrequests_large, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.nrequests_large, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_huge_allocated,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.allocated_huge, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.allocated_huge, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_huge_nmalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nmalloc_huge, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.nmalloc_huge, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_huge_ndalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.ndalloc_huge, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.ndalloc_huge, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_huge_nrequests,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].astats.nrequests_huge, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].astats.nrequests_huge, uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_allocated,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].allocated, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].allocated, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nmalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].nmalloc, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].nmalloc, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_ndalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].ndalloc, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].ndalloc, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nrequests,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].nrequests, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].nrequests, uint64_t)
 CTL_RO_CGEN(config_stats && config_tcache, stats_arenas_i_bins_j_nfills,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].nfills, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].nfills, uint64_t)
 CTL_RO_CGEN(config_stats && config_tcache, stats_arenas_i_bins_j_nflushes,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].nflushes, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].nflushes, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nruns,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].nruns, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].nruns, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nreruns,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].reruns, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].reruns, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_curruns,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].bstats[mib[6]].curruns, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].bstats[mib[6]].curruns, size_t)
 
 static const ctl_named_node_t *
 stats_arenas_i_bins_j_index(const size_t *mib, size_t miblen, size_t j)
@@ -1886,13 +1892,13 @@ stats_arenas_i_bins_j_index(const size_t *mib, size_t miblen, size_t j)
 }
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_lruns_j_nmalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].lstats[mib[6]].nmalloc, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].lstats[mib[6]].nmalloc, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_lruns_j_ndalloc,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].lstats[mib[6]].ndalloc, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].lstats[mib[6]].ndalloc, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_lruns_j_nrequests,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].lstats[mib[6]].nrequests, uint64_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].lstats[mib[6]].nrequests, uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_lruns_j_curruns,
-    pools[mib[1]]->ctl_stats.arenas[mib[4]].lstats[mib[6]].curruns, size_t)
+    pool_get(mib[1])->ctl_stats.arenas[mib[4]].lstats[mib[6]].curruns, size_t)
 
 static const ctl_named_node_t *
 stats_arenas_i_lruns_j_index(const size_t *mib, size_t miblen, size_t j)
@@ -1909,8 +1915,8 @@ stats_arenas_i_index(const size_t *mib, size_t miblen, size_t i)
 	const ctl_named_node_t *ret;
 
 	malloc_mutex_lock(&ctl_mtx);
-	if (i > pools[mib[1]]->ctl_stats.narenas ||
-			pools[mib[1]]->ctl_stats.arenas[i].initialized == false) {
+	if (i > pool_get(mib[1])->ctl_stats.narenas ||
+			pool_get(mib[1])->ctl_stats.arenas[i].initialized == false) {
 		ret = NULL;
 		goto label_return;
 	}
@@ -1927,7 +1933,7 @@ thread_pool_i_index(const size_t *mib, size_t miblen, size_t i)
 	const ctl_named_node_t *ret;
 
 	malloc_mutex_lock(&ctl_mtx);
-	if (i > POOLS_MAX) {
+	if (i >= pools_nids || pool_get(i) == NULL) {
 		ret = NULL;
 		goto label_return;
 	}
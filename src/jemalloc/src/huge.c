@@ -274,10 +274,10 @@ size_t
 huge_salloc(const void *ptr)
 {
 	size_t ret = 0;
-	int i;
+	unsigned i;
 	extent_node_t *node, key;
-	for (i = 0; i < POOLS_MAX; ++i) {
-		pool_t *pool = pools[i];
+	for (i = 0; i < pools_nids; ++i) {
+		pool_t *pool = pool_get(i);
 		if (pool == NULL)
 			continue;
 		malloc_mutex_lock(&pool->huge_mtx);
@@ -317,11 +317,11 @@ prof_ctx_t *
 huge_prof_ctx_get(const void *ptr)
 {
 	prof_ctx_t *ret = NULL;
-	int i;
+	unsigned i;
 	extent_node_t *node, key;
 
-	for (i = 0; i < POOLS_MAX; ++i) {
-		pool_t *pool = pools[i];
+	for (i = 0; i < pools_nids; ++i) {
+		pool_t *pool = pool_get(i);
 		if (pool == NULL)
 			continue;
 		malloc_mutex_lock(&pool->huge_mtx);
@@ -344,10 +344,10 @@ void
 huge_prof_ctx_set(const void *ptr, prof_ctx_t *ctx)
 {
 	extent_node_t *node, key;
-	int i;
+	unsigned i;
 
-	for (i = 0; i < POOLS_MAX; ++i) {
-		pool_t *pool = pools[i];
+	for (i = 0; i < pools_nids; ++i) {
+		pool_t *pool = pool_get(i);
 		if (pool == NULL)
 			continue;
 		malloc_mutex_lock(&pool->huge_mtx);
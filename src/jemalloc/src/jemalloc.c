@@ -34,12 +34,9 @@ size_t	opt_narenas = 0;
 bool	in_valgrind;
 
 
-unsigned	npools;
 unsigned	ncpus;
 
-pool_t			*pools[POOLS_MAX];
 pool_t			init_pool;
-unsigned		pool_seqno = 0;
 bool			pools_shared_data_initialized;
 
 /*
@@ -167,6 +164,20 @@ choose_arena_hard(pool_t *pool)
 	arena_t *ret;
 	tsd_pool_t *tsd;
 
+	tsd = arenas_tsd_get();
+	if (pool->pool_id >= tsd->npools) {
+		bool first = tsd->npools == 0;
+
+		/* Do not cache the arena if there is no memory for it. */
+		if (pool_tsd_grow((void ***)&tsd->arenas, &tsd->seqno,
+		    &tsd->npools, &tsd->base_pool, pool->pool_id))
+			return (pool->arenas[0]);
+
+		/* Get arenas_cleanup() called when the thread exits. */
+		if (first)
+			arenas_tsd_set(tsd);
+	}
+
 	if (pool->narenas_auto > 1) {
 		unsigned i, choose, first_null;
 
@@ -217,7 +228,6 @@ choose_arena_hard(pool_t *pool)
 		malloc_rwlock_unlock(&pool->arenas_lock);
 	}
 
-	tsd = arenas_tsd_get();
 	tsd->seqno[pool->pool_id] = pool->seqno;
 	tsd->arenas[pool->pool_id] = ret;
 
@@ -241,8 +251,8 @@ stats_print_atexit(void)
 		 * continue to allocate.
 		 */
 		malloc_mutex_lock(&pools_lock);
-		for (i = 0; i < POOLS_MAX; i++) {
-			pool = pools[i];
+		for (i = 0; i < pools_nids; i++) {
+			pool = pool_get(i);
 			if (pool != NULL) {
 				for (j = 0, narenas = narenas_total_get(pool); j < narenas; j++) {
 					arena_t *arena = pool->arenas[j];
@@ -299,8 +309,8 @@ arenas_cleanup(void *arg)
 	pool_t *pool;
 	tsd_pool_t *tsd = arg;
 	malloc_mutex_lock(&pools_lock);
-	for (i = 0; i < POOLS_MAX; i++) {
-		pool = pools[i];
+	for (i = 0; i < tsd->npools; i++) {
+		pool = pool_get(i);
 		if (pool != NULL) {
 			if (pool->seqno == tsd->seqno[i] && tsd->arenas[i] != NULL) {
 				malloc_rwlock_wrlock(&pool->arenas_lock);
@@ -311,6 +321,12 @@ arenas_cleanup(void *arg)
 	}
 	malloc_mutex_unlock(&pools_lock);
 
+	if (tsd->npools > 0) {
+		pool_tsd_free((void **)tsd->arenas, tsd->base_pool);
+		tsd->arenas = NULL;
+		tsd->seqno = NULL;
+		tsd->npools = 0;
+	}
 }
 
 JEMALLOC_ALWAYS_INLINE_C void
@@ -354,9 +370,7 @@ malloc_init_base_pool(void)
 	}
 
 	base_pool = &init_pool;
-	npools++;
-	pools[0] = base_pool;
-	pools[0]->seqno = ++pool_seqno;
+	pool_set(0, base_pool);
 
 	if (pool_new(base_pool, 0)) {
 		malloc_mutex_unlock(&pool_base_lock);
@@ -789,9 +803,7 @@ malloc_init_hard(void)
 		}
 	}
 
-	npools = 0;
 	pools_shared_data_initialized = false;
-	memset(pools, 0, sizeof(pool_t *) * POOLS_MAX);
 
 	je_base_malloc = base_malloc_default;
 	je_base_free = base_free_default;
@@ -1238,7 +1250,7 @@ ifree(void *ptr)
 
 	assert(ptr != NULL);
 	assert(malloc_initialized || IS_INITIALIZER);
-	assert(pools[0] != NULL);
+	assert(pool_get(0) != NULL);
 
 	if (config_prof && opt_prof) {
 		usize = isalloc(ptr, config_prof);
@@ -1273,7 +1285,7 @@ je_realloc(void *ptr, size_t size)
 
 	if (ptr != NULL) {
 		assert(malloc_initialized || IS_INITIALIZER);
-		assert(pools[0] != NULL);
+		assert(pool_get(0) != NULL);
 		malloc_thread_init();
 
 		if ((config_prof && opt_prof) || config_stats ||
@@ -1394,7 +1406,7 @@ JEMALLOC_EXPORT void *(*__memalign_hook)(size_t alignment, size_t size) =
 static void*
 base_malloc_default(size_t size)
 {
-	pool_t *pool = pools[0];
+	pool_t *pool = pool_get(0);
 	return base_alloc(pool, size);
 }
 
@@ -1410,7 +1422,7 @@ pools_shared_data_create(void)
 	if (malloc_init())
 		return (true);
 
-	assert(je_base_malloc != base_malloc_default || pools[0] != NULL);
+	assert(je_base_malloc != base_malloc_default || pool_get(0) != NULL);
 
 	if (pools_shared_data_initialized)
 		return (false);
@@ -1424,6 +1436,35 @@ pools_shared_data_create(void)
 	return (false);
 }
 
+/*
+ * Free the per thread pool arrays of the calling thread, the arrays of other
+ * threads are freed when they exit.
+ */
+static void
+pools_tsd_free(void)
+{
+	tsd_pool_t *tsd = arenas_tsd_get();
+
+	if (tsd->npools > 0) {
+		pool_tsd_free((void **)tsd->arenas, tsd->base_pool);
+		tsd->arenas = NULL;
+		tsd->seqno = NULL;
+		tsd->npools = 0;
+	}
+
+	if (config_tcache) {
+		tsd_tcache_t *tcache_tsd = tcache_tsd_get();
+
+		if (tcache_tsd->npools > 0) {
+			pool_tsd_free((void **)tcache_tsd->tcaches,
+			    tcache_tsd->base_pool);
+			tcache_tsd->tcaches = NULL;
+			tcache_tsd->seqno = NULL;
+			tcache_tsd->npools = 0;
+		}
+	}
+}
+
 void pools_shared_data_destroy(void)
 {
 	/* Only destroy when no pools exist */
@@ -1432,53 +1473,20 @@ void pools_shared_data_destroy(void)
 
 		je_base_free(tcache_bin_info);
 		tcache_bin_info = NULL;
+
+		pools_tsd_free();
 	}
 }
 
-pool_t *
-je_pool_create(void *addr, size_t size, int zeroed)
+/*
+ * Lay out the metadata of a pool at its beginning and publish the pool under
+ * pool_id.  Must be called with pools_lock held.  The usable space of the
+ * first memory range is left to be registered with pool_init_chunks().
+ */
+static bool
+pool_init(pool_t *pool, unsigned pool_id, size_t size)
 {
-	if (malloc_init())
-		return (NULL);
-
-	if (addr == NULL || size < POOL_MINIMAL_SIZE)
-		return NULL;
-
-	pool_t *pool = (pool_t *)addr;
-	unsigned pool_id = POOLS_MAX;
-	size_t result;
-
-	if (je_base_malloc == base_malloc_default) {
-		/* Preinit base pool if not exist, before lock pool_lock */
-		if (malloc_init_base_pool())
-			return NULL;
-	}
-
-	malloc_mutex_lock(&pools_lock);
-
-	/* Find unused pool ID */
-	if (npools < POOLS_MAX) {
-		/*
-		 * Pool 0 is a special pool with reserved ID. Pool is created during
-		 * malloc_init_pool_base() and allocates memory from RAM.
-		 */
-		int i;
-		for (i = 1; i < POOLS_MAX; ++i) {
-			if (pools[i] == NULL) {
-				pool_id = i;
-				break;
-			}
-		}
-	}
-
-	if (pool_id == POOLS_MAX) {
-		malloc_mutex_unlock(&pools_lock);
-		malloc_printf("<jemalloc>: Too many pools\n");
-		return NULL;
-	}
-
-	if (!zeroed)
-		memset(addr, 0, sizeof (pool_t));
+	void *addr = pool;
 
 	/* preinit base allocator in unused space, align the address to the cache line */
 	pool->base_next_addr = (void *)CACHELINE_CEILING((uintptr_t)addr +
@@ -1486,24 +1494,16 @@ je_pool_create(void *addr, size_t size, int zeroed)
 	pool->base_past_addr = (void *)((uintptr_t)addr + size);
 
 	/* prepare pool and internal structures */
-	if (pool_new(pool, pool_id)) {
-		assert(pools[pool_id] == NULL);
-		malloc_mutex_unlock(&pools_lock);
-		pools_shared_data_destroy();
-		return NULL;
-	}
+	if (pool_new(pool, pool_id))
+		return (true);
 
 	/* preallocate the chunk tree nodes for the maximum possible number of chunks */
-	result = base_node_prealloc(pool, size/chunksize);
-	assert(result == 0);
-
-	assert(pools[pool_id] == NULL);
-	pool->seqno = pool_seqno++;
-	pools[pool_id] = pool;
-	npools++;
-	malloc_mutex_unlock(&pools_lock);
+	if (base_node_prealloc(pool, size/chunksize) != 0)
+		goto err;
 
 	pool->memory_range_list = base_alloc(pool, sizeof (*pool->memory_range_list));
+	if (pool->memory_range_list == NULL)
+		goto err;
 
 	/* pointer to the address of chunks, align the address to chunksize */
 	void *usable_addr = (void*)CHUNK_CEILING((uintptr_t)pool->base_next_addr);
@@ -1525,26 +1525,142 @@ je_pool_create(void *addr, size_t size, int zeroed)
 	pool->memory_range_list->usable_addr_end = (uintptr_t)usable_addr + usable_size;
 	malloc_mutex_unlock(&pool->memory_range_mtx);
 
-	/* register the usable pool space as a single big chunk */
-	chunk_record(pool,
-		&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
-		usable_addr, usable_size, zeroed);
-
 	pool->ctl_initialized = false;
 
+	assert(pool_get(pool_id) == NULL);
+	pool_set(pool_id, pool);
+
+	return (false);
+
+err:
+	pool_destroy(pool);
+	return (true);
+}
+
+/*
+ * Register the usable space of the first memory range of a pool as a single
+ * big chunk.  The space is purged, unless the pool is being reset and its
+ * pages are about to be reused.
+ */
+static void
+pool_init_chunks(pool_t *pool, bool zeroed, bool reset)
+{
+	pool_memory_range_node_t *range = pool->memory_range_list;
+	void *usable_addr = (void *)range->usable_addr;
+	size_t usable_size = range->usable_addr_end - range->usable_addr;
+
+	if (reset) {
+		chunk_record_dirty(pool,
+			&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
+			usable_addr, usable_size);
+	} else {
+		chunk_record(pool,
+			&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
+			usable_addr, usable_size, zeroed);
+	}
+}
+
+static pool_t *
+pool_create_common(void *addr, size_t size, int zeroed,
+	bool (*commit)(void *, size_t, void *),
+	bool (*decommit)(void *, size_t, void *), void *arg)
+{
+	if (malloc_init())
+		return (NULL);
+
+	if (addr == NULL || size < POOL_MINIMAL_SIZE)
+		return NULL;
+
+	pool_t *pool = (pool_t *)addr;
+	unsigned pool_id;
+	uintptr_t commit_end = 0;
+
+	if (commit != NULL) {
+		/* the pool header has to be backed before it is touched */
+		commit_end = CHUNK_CEILING((uintptr_t)addr + sizeof (pool_t));
+		if (commit_end > (uintptr_t)addr + size)
+			commit_end = (uintptr_t)addr + size;
+		if (commit(addr, commit_end - (uintptr_t)addr, arg))
+			return NULL;
+	}
+
+	if (je_base_malloc == base_malloc_default) {
+		/* Preinit base pool if not exist, before lock pool_lock */
+		if (malloc_init_base_pool())
+			return NULL;
+	}
+
+	malloc_mutex_lock(&pools_lock);
+
+	/*
+	 * Find unused pool ID.  Pool 0 is a special pool with reserved ID.
+	 * Pool is created during malloc_init_pool_base() and allocates memory
+	 * from RAM.
+	 */
+	if (pool_id_alloc(&pool_id)) {
+		malloc_mutex_unlock(&pools_lock);
+		malloc_printf("<jemalloc>: Too many pools\n");
+		return NULL;
+	}
+
+	if (!zeroed)
+		memset(addr, 0, sizeof (pool_t));
+
+	pool->commit = commit;
+	pool->decommit = decommit;
+	pool->backing_arg = arg;
+	pool->base_commit_addr = (void *)commit_end;
+	pool->reset_only = false;
+
+	if (pool_init(pool, pool_id, size)) {
+		assert(pool_get(pool_id) == NULL);
+		malloc_mutex_unlock(&pools_lock);
+		pools_shared_data_destroy();
+		return NULL;
+	}
+	malloc_mutex_unlock(&pools_lock);
+
+	pool_init_chunks(pool, zeroed != 0, false);
+
 	return pool;
 }
 
+pool_t *
+je_pool_create(void *addr, size_t size, int zeroed)
+{
+	return pool_create_common(addr, size, zeroed, NULL, NULL, NULL);
+}
+
+/*
+ * Create a pool in a reserved address range whose memory is backed on
+ * demand.  The commit hook is called before a range of the pool is used
+ * and the decommit hook when a chunk is released, both return true on
+ * failure.  The range is expected to read as zeros until it is committed.
+ */
+pool_t *
+je_pool_create_sparse(void *addr, size_t size,
+	bool (*commit)(void *, size_t, void *),
+	bool (*decommit)(void *, size_t, void *), void *arg)
+{
+	if (commit == NULL)
+		return NULL;
+
+	return pool_create_common(addr, size, 1, commit, decommit, arg);
+}
+
 void
 je_pool_delete(pool_t *pool)
 {
 	unsigned pool_id = pool->pool_id;
 
+	/* the pool was already torn down by a failed pool_reset() */
+	if (pool_id == POOL_ID_LOST)
+		return;
+
 	/* Remove pool from global array */
 	malloc_mutex_lock(&pools_lock);
 	pool_destroy(pool);
-	pools[pool_id] = NULL;
-	npools--;
+	pool_set(pool_id, NULL);
 
 	/*
 	 * TODO: Destroy mutex
@@ -1693,7 +1809,7 @@ je_pool_check(pool_t *pool)
 		return -1;
 	}
 
-	if (pools[pool->pool_id] != pool) {
+	if (pool_get(pool->pool_id) != pool) {
 		malloc_write("<jemalloc>: Error in pool_check(): "
 				"incorrect pool handle, probably pool was deleted\n");
 		return -1;
@@ -1718,8 +1834,8 @@ je_pool_check(pool_t *pool)
 
 	/* check memory collision with other pools */
 	malloc_mutex_lock(&pools_lock);
-	for (i = 1; i < POOLS_MAX; i++) {
-		pool_t *pool_cmp = pools[i];
+	for (i = 1; i < pools_nids; i++) {
+		pool_t *pool_cmp = pool_get(i);
 		if (pool_cmp != NULL && i != pool->pool_id) {
 			node = pool->memory_range_list;
 			while (node != NULL) {
@@ -1806,16 +1922,22 @@ je_pool_check(pool_t *pool)
 }
 
 /*
- * add more memory to a pool
+ * add a memory range to a pool, its chunks are purged unless the pool is
+ * being reset
  */
-size_t
-je_pool_extend(pool_t *pool, void *addr, size_t size, int zeroed)
+static size_t
+pool_extend_range(pool_t *pool, void *addr, size_t size, int zeroed,
+	bool reset)
 {
 	void *usable_addr = addr;
 	size_t nodes_number = size/chunksize;
 	if (size < POOL_MINIMAL_SIZE)
 		return 0;
 
+	/* the base allocator of sparse pools cannot move to the new range */
+	if (pool->commit != NULL)
+		return 0;
+
 	/* preallocate the chunk tree nodes for the max possible number of chunks */
 	nodes_number = base_node_prealloc(pool, nodes_number);
 	pool_memory_range_node_t *node = base_alloc(pool,
@@ -1862,15 +1984,121 @@ je_pool_extend(pool_t *pool, void *addr, size_t size, int zeroed)
 	node->next = pool->memory_range_list;
 	pool->memory_range_list = node;
 
-	chunk_record(pool,
-		&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
-		usable_addr, usable_size, zeroed);
+	if (reset) {
+		chunk_record_dirty(pool,
+			&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
+			usable_addr, usable_size);
+	} else {
+		chunk_record(pool,
+			&pool->chunks_szad_mmap, &pool->chunks_ad_mmap,
+			usable_addr, usable_size, zeroed);
+	}
 
 	malloc_mutex_unlock(&pool->memory_range_mtx);
 
 	return usable_size;
 }
 
+/*
+ * add more memory to a pool
+ */
+size_t
+je_pool_extend(pool_t *pool, void *addr, size_t size, int zeroed)
+{
+
+	return pool_extend_range(pool, addr, size, zeroed, false);
+}
+
+/*
+ * Drop all allocations of a pool at once.  The arenas, chunk trees and base
+ * allocator of the pool are rebuilt in place, the memory ranges added with
+ * pool_extend() stay part of the pool.  The pages are not purged, as they
+ * are likely to be used again right away.  The pool must not be used by
+ * other threads during the call.  Returns 0 on success or an error number,
+ * in which case the pool is lost and can only be deleted.
+ */
+int
+je_pool_reset(pool_t *pool)
+{
+	pool_memory_range_node_t *node;
+	unsigned pool_id = pool->pool_id;
+	unsigned i, nranges = 0;
+	size_t size;
+
+	malloc_mutex_lock(&pools_lock);
+	assert(pool_get(pool_id) == pool);
+
+	/* the first range, holding the pool itself, is at the list tail */
+	for (node = pool->memory_range_list; node->next != NULL;
+	    node = node->next)
+		nranges++;
+	size = node->addr_end - node->addr;
+
+	/*
+	 * The list nodes are allocated by the base allocator, copy the ranges
+	 * before the metadata of the pool is overwritten.
+	 */
+	struct {
+		void *addr;
+		size_t size;
+	} ranges[nranges + 1];
+	for (i = 0, node = pool->memory_range_list; i < nranges;
+	    i++, node = node->next) {
+		ranges[i].addr = (void *)node->addr;
+		ranges[i].size = node->addr_end - node->addr;
+	}
+
+	/*
+	 * Republishing the pool gives it a new sequence number, so the thread
+	 * caches and arena bindings of the threads are dropped.
+	 */
+	pool_set(pool_id, NULL);
+
+	bool (*commit)(void *, size_t, void *) = pool->commit;
+	bool (*decommit)(void *, size_t, void *) = pool->decommit;
+	void *backing_arg = pool->backing_arg;
+	bool reset_only = pool->reset_only;
+
+	memset(pool, 0, sizeof (pool_t));
+	pool->commit = commit;
+	pool->decommit = decommit;
+	pool->backing_arg = backing_arg;
+	/* committed pages are committed again, which is cheap */
+	pool->base_commit_addr = pool;
+	pool->reset_only = reset_only;
+
+	if (pool_init(pool, pool_id, size)) {
+		pool->pool_id = POOL_ID_LOST;
+		malloc_mutex_unlock(&pools_lock);
+		pools_shared_data_destroy();
+		return (ENOMEM);
+	}
+	malloc_mutex_unlock(&pools_lock);
+
+	pool_init_chunks(pool, false, true);
+
+	/* extensions are added back in the order they were added */
+	for (i = nranges; i > 0; i--)
+		pool_extend_range(pool, ranges[i - 1].addr, ranges[i - 1].size,
+			0, true);
+
+	return (0);
+}
+
+/*
+ * Switch a pool to reset-only mode, in which allocations are served from a
+ * bump pointer and free does nothing, see pool_bump_alloc().  The memory is
+ * reclaimed by pool_reset().  Must be called before the first allocation
+ * from the pool.
+ */
+void
+je_pool_set_reset_only(pool_t *pool)
+{
+
+	assert(pool->pool_id != 0);
+	pool->reset_only = true;
+}
+
 static void *
 pool_ialloc_prof_sample(pool_t *pool, size_t usize, prof_thr_cnt_t *cnt,
 	void *(*ialloc)(pool_t *, size_t))
@@ -1935,6 +2163,12 @@ je_pool_malloc(pool_t *pool, size_t size)
 	if (size == 0)
 		size = 1;
 
+	if (pool->reset_only) {
+		if ((ret = pool_bump_alloc(pool, size)) == NULL)
+			set_errno(ENOMEM);
+		return (ret);
+	}
+
 	ret = pool_imalloc_body(pool, size, &usize);
 	if (ret == NULL) {
 		if (config_xmalloc && opt_xmalloc) {
@@ -1975,6 +2209,14 @@ je_pool_calloc(pool_t *pool, size_t num, size_t size)
 		goto label_return;
 	}
 
+	if (pool->reset_only) {
+		if ((ret = pool_bump_alloc(pool, num_size)) == NULL)
+			set_errno(ENOMEM);
+		else
+			memset(ret, 0, num_size);
+		return (ret);
+	}
+
 	if (config_prof && opt_prof) {
 		usize = s2u(num_size);
 		ret = pool_ialloc_prof(pool, usize, pool_icalloc);
@@ -2081,12 +2323,19 @@ je_pool_ralloc(pool_t *pool, void *ptr, size_t size)
 		if (ptr != NULL) {
 			/* realloc(ptr, 0) is equivalent to free(ptr). */
 			UTRACE(ptr, 0, 0);
-			pool_ifree(pool, ptr);
+			if (pool->reset_only == false)
+				pool_ifree(pool, ptr);
 			return (NULL);
 		}
 		size = 1;
 	}
 
+	if (pool->reset_only) {
+		if ((ret = pool_bump_ralloc(pool, ptr, size)) == NULL)
+			set_errno(ENOMEM);
+		return (ret);
+	}
+
 	if (ptr != NULL) {
 		assert(malloc_initialized || IS_INITIALIZER);
 		malloc_init();
@@ -2204,6 +2453,14 @@ pool_imemalign(pool_t *pool, void **memptr, size_t alignment, size_t size,
 			goto label_return;
 		}
 
+		if (pool->reset_only) {
+			result = pool_bump_alloc_hard(pool, size, alignment);
+			if (result == NULL)
+				goto label_oom;
+			*memptr = result;
+			return (0);
+		}
+
 		usize = sa2u(size, alignment);
 		if (usize == 0) {
 			result = NULL;
@@ -2252,6 +2509,8 @@ je_pool_aligned_alloc(pool_t *pool, size_t alignment, size_t size)
 		ret = NULL;
 		set_errno(err);
 	}
+	if (pool->reset_only)
+		return (ret);
 	JEMALLOC_VALGRIND_MALLOC(err == 0, ret, isalloc(ret, config_prof),
 	    false);
 	return (ret);
@@ -2261,7 +2520,7 @@ void
 je_pool_free(pool_t *pool, void *ptr)
 {
 	UTRACE(ptr, 0, 0);
-	if (ptr != NULL)
+	if (ptr != NULL && pool->reset_only == false)
 		pool_ifree(pool, ptr);
 }
 
@@ -2274,13 +2533,21 @@ je_pool_malloc_stats_print(pool_t *pool,
 	stats_print(pool, write_cb, cbopaque, opts);
 }
 
+void
+je_pool_stats_get(pool_t *pool, pool_stats_t *stats, pool_bin_stats_t *bins,
+				unsigned nbins)
+{
+
+	stats_pool_get(pool, stats, bins, nbins);
+}
+
 void
 je_pool_set_alloc_funcs(void *(*malloc_func)(size_t),
 				void (*free_func)(void *))
 {
 	if (malloc_func != NULL && free_func != NULL) {
 		malloc_mutex_lock(&pool_base_lock);
-		if (pools[0] == NULL) {
+		if (pool_get(0) == NULL) {
 			je_base_malloc = malloc_func;
 			je_base_free = free_func;
 		}
@@ -2294,6 +2561,9 @@ je_pool_malloc_usable_size(pool_t *pool, void *ptr)
 	assert(malloc_initialized || IS_INITIALIZER);
 	malloc_thread_init();
 
+	if (pool->reset_only)
+		return (ptr != NULL) ? pool_bump_usize(ptr) : 0;
+
 	if (config_ivsalloc) {
 		/* Return 0 if ptr is not within a chunk managed by jemalloc. */
 		if (rtree_get(pool->chunks_rtree, (uintptr_t)CHUNK_ADDR2BASE(ptr)) == 0)
@@ -2370,7 +2640,7 @@ je_mallocx(size_t size, int flags)
 	bool zero = flags & MALLOCX_ZERO;
 	unsigned arena_ind = ((unsigned)(flags >> 8)) - 1;
 	unsigned pool_id = 0; // TODO add another flag
-	pool_t *pool = pools[pool_id];
+	pool_t *pool = pool_get(pool_id);
 	arena_t dummy_arena;
 	DUMMY_ARENA_INITIALIZE(dummy_arena, pool);
 	arena_t *arena;
@@ -2491,7 +2761,7 @@ je_rallocx(void *ptr, size_t size, int flags)
 	bool zero = flags & MALLOCX_ZERO;
 	unsigned arena_ind = ((unsigned)(flags >> 8)) - 1;
 	unsigned pool_id = 0; // TODO add another flag
-	pool_t *pool = pools[pool_id];
+	pool_t *pool = pool_get(pool_id);
 	arena_t dummy_arena;
 	DUMMY_ARENA_INITIALIZE(dummy_arena, pool);
 	bool try_tcache_alloc, try_tcache_dalloc;
@@ -2500,7 +2770,7 @@ je_rallocx(void *ptr, size_t size, int flags)
 	assert(ptr != NULL);
 	assert(size != 0);
 	assert(malloc_initialized || IS_INITIALIZER);
-	assert(pools[0] != NULL);
+	assert(pool_get(0) != NULL);
 	malloc_thread_init();
 
 	if (arena_ind != UINT_MAX) {
@@ -2633,7 +2903,7 @@ je_xallocx(void *ptr, size_t size, size_t extra, int flags)
 	bool zero = flags & MALLOCX_ZERO;
 	unsigned arena_ind = ((unsigned)(flags >> 8)) - 1;
 	unsigned pool_id = 0; // TODO add another flag
-	pool_t *pool = pools[pool_id];
+	pool_t *pool = pool_get(pool_id);
 	arena_t dummy_arena;
 	DUMMY_ARENA_INITIALIZE(dummy_arena, pool);
 	arena_t *arena;
@@ -2642,7 +2912,7 @@ je_xallocx(void *ptr, size_t size, size_t extra, int flags)
 	assert(size != 0);
 	assert(SIZE_T_MAX - size >= extra);
 	assert(malloc_initialized || IS_INITIALIZER);
-	assert(pools[0] != NULL);
+	assert(pool_get(0) != NULL);
 	malloc_thread_init();
 
 	if (arena_ind != UINT_MAX)
@@ -2694,7 +2964,7 @@ je_sallocx(const void *ptr, int flags)
 	size_t usize;
 
 	assert(malloc_initialized || IS_INITIALIZER);
-	assert(pools[0] != NULL);
+	assert(pool_get(0) != NULL);
 	malloc_thread_init();
 
 	if (config_ivsalloc)
@@ -2714,12 +2984,12 @@ je_dallocx(void *ptr, int flags)
 	UNUSED size_t rzsize JEMALLOC_CC_SILENCE_INIT(0);
 	unsigned arena_ind = ((unsigned)(flags >> 8)) - 1;
 	unsigned pool_id = 0; // TODO add another flag
-	pool_t *pool = pools[pool_id];
+	pool_t *pool = pool_get(pool_id);
 	bool try_tcache;
 
 	assert(ptr != NULL);
 	assert(malloc_initialized || IS_INITIALIZER);
-	assert(pools[0] != NULL);
+	assert(pool_get(0) != NULL);
 
 	if (arena_ind != UINT_MAX) {
 		arena_chunk_t *chunk = (arena_chunk_t *)CHUNK_ADDR2BASE(ptr);
@@ -2791,7 +3061,7 @@ void
 je_malloc_stats_print(void (*write_cb)(void *, const char *), void *cbopaque,
     const char *opts)
 {
-	pool_t *base_pool = pools[0];
+	pool_t *base_pool = pool_get(0);
 	stats_print(base_pool, write_cb, cbopaque, opts);
 }
 
@@ -2845,9 +3115,9 @@ jemalloc_constructor(void)
 #define FOREACH_POOL(func)		\
 do {								\
 	unsigned i;					\
-	for (i = 0; i < POOLS_MAX; i++) {	\
-		if (pools[i])			\
-			(func)(pools[i]);	\
+	for (i = 0; i < pools_nids; i++) {	\
+		if (pool_get(i))			\
+			(func)(pool_get(i));	\
 	}							\
 } while(0)
 
@@ -2872,14 +3142,15 @@ _malloc_prefork(void)
 	ctl_prefork();
 	prof_prefork();
 	pool_prefork();
-	for (i = 0; i < POOLS_MAX; i++) {
-		pool = pools[i];
+	for (i = 0; i < pools_nids; i++) {
+		pool = pool_get(i);
 		if (pool != NULL) {
 			malloc_rwlock_prefork(&pool->arenas_lock);
 			for (j = 0; j < pool->narenas_total; j++) {
 				if (pool->arenas[j] != NULL)
 					arena_prefork(pool->arenas[j]);
 			}
+			malloc_mutex_prefork(&pool->bump_mtx);
 		}
 	}
 
@@ -2916,9 +3187,10 @@ _malloc_postfork(void)
 	chunk_dss_postfork_parent();
 	FOREACH_POOL(chunk_postfork_parent);
 
-	for (i = 0; i < POOLS_MAX; i++) {
-		pool = pools[i];
+	for (i = 0; i < pools_nids; i++) {
+		pool = pool_get(i);
 		if (pool != NULL) {
+			malloc_mutex_postfork_parent(&pool->bump_mtx);
 			for (j = 0; j < pool->narenas_total; j++) {
 				if (pool->arenas[j] != NULL)
 					arena_postfork_parent(pool->arenas[j]);
@@ -2947,9 +3219,10 @@ jemalloc_postfork_child(void)
 	chunk_dss_postfork_child();
 	FOREACH_POOL(chunk_postfork_child);
 
-	for (i = 0; i < POOLS_MAX; i++) {
-		pool = pools[i];
+	for (i = 0; i < pools_nids; i++) {
+		pool = pool_get(i);
 		if (pool != NULL) {
+			malloc_mutex_postfork_child(&pool->bump_mtx);
 			for (j = 0; j < pool->narenas_total; j++) {
 				if (pool->arenas[j] != NULL)
 					arena_postfork_child(pool->arenas[j]);
@@ -2972,7 +3245,7 @@ jemalloc_postfork_child(void)
 static void *
 a0alloc(size_t size, bool zero)
 {
-	pool_t *base_pool = pools[0];
+	pool_t *base_pool = pool_get(0);
 
 	if (malloc_init_base_pool())
 		return (NULL);
@@ -3003,7 +3276,7 @@ a0calloc(size_t num, size_t size)
 void
 a0free(void *ptr)
 {
-	pool_t *base_pool = pools[0];
+	pool_t *base_pool = pool_get(0);
 	arena_chunk_t *chunk;
 
 	if (ptr == NULL)
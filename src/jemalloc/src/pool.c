@@ -4,6 +4,23 @@
 malloc_mutex_t	pool_base_lock;
 malloc_mutex_t	pools_lock;
 
+/*
+ * Registry of pools.  The first segment is static, so that the base pool
+ * can be registered before there is anything to allocate the others from.
+ * Pool id 0 is reserved for the base pool, even when it does not exist.
+ */
+static pools_seg_t	pools_seg0 = { .used = { 1UL } };
+pools_seg_t	*pools_segs[POOLS_NSEGS] = { &pools_seg0 };
+
+/* Number of existing pools. */
+unsigned	npools;
+/* One past the highest pool id ever used, bounds the pool iterations. */
+unsigned	pools_nids;
+/* Bitmap of the segments with all pool ids in use. */
+static unsigned long	pools_segs_full[POOLS_NSEGS / POOLS_GROUP_NBITS];
+/* Sequence number of the last registered pool. */
+static unsigned	pool_seqno;
+
 /* Initialize pool and create its base arena. */
 bool pool_new(pool_t *pool, unsigned pool_id)
 {
@@ -33,6 +50,11 @@ bool pool_new(pool_t *pool, unsigned pool_id)
 		return (true);
 	}
 
+	if (malloc_mutex_init(&pool->bump_mtx)) {
+		return (true);
+	}
+	pool->bump = NULL;
+
 	pool->stats_cactive = 0;
 	pool->ctl_stats_active = 0;
 	pool->ctl_stats_allocated = 0;
@@ -82,6 +104,172 @@ void pool_destroy(pool_t *pool)
 	malloc_rwlock_destroy(&pool->arenas_lock);
 }
 
+/*
+ * Return the index of the first unset bit of the bitmap, or the number of
+ * bits in it if all are set.
+ */
+static unsigned
+pools_bitmap_ffu(const unsigned long *bitmap, unsigned ngroups)
+{
+	unsigned i;
+
+	for (i = 0; i < ngroups; i++) {
+		if (bitmap[i] != ~0UL) {
+			return ((i << LG_POOLS_GROUP_NBITS) +
+			    jemalloc_ffsl(~bitmap[i]) - 1);
+		}
+	}
+
+	return (ngroups << LG_POOLS_GROUP_NBITS);
+}
+
+/*
+ * Find the lowest unused pool id, allocating the registry segment if
+ * necessary.  Reusing the lowest id keeps pools_nids, and so the pool
+ * iterations, as short as the number of pools allows.  Must be called with
+ * pools_lock held, the id is taken by the following pool_set().
+ */
+bool
+pool_id_alloc(unsigned *pool_id)
+{
+	unsigned i;
+	pools_seg_t *seg;
+
+	i = pools_bitmap_ffu(pools_segs_full,
+	    POOLS_NSEGS / POOLS_GROUP_NBITS);
+	if (i == POOLS_NSEGS)
+		return (true);
+
+	seg = pools_segs[i];
+	if (seg == NULL) {
+		seg = je_base_malloc(sizeof(pools_seg_t));
+		if (seg == NULL)
+			return (true);
+		memset(seg, 0, sizeof(pools_seg_t));
+		__atomic_store_n(&pools_segs[i], seg, __ATOMIC_RELEASE);
+	}
+
+	*pool_id = (i << LG_POOLS_SEG_SIZE) + pools_bitmap_ffu(seg->used,
+	    POOLS_SEG_SIZE / POOLS_GROUP_NBITS);
+	assert(*pool_id != 0);
+
+	return (false);
+}
+
+/*
+ * Publish the pool under the given id, or release the id if pool is NULL.
+ * Must be called with pools_lock held, except for the base pool.
+ */
+void
+pool_set(unsigned pool_id, pool_t *pool)
+{
+	unsigned i = pool_id >> LG_POOLS_SEG_SIZE;
+	unsigned slot = pool_id & POOLS_SEG_MASK;
+	unsigned long bit = 1UL << (slot & POOLS_GROUP_MASK);
+	pools_seg_t *seg = pools_segs[i];
+	unsigned long *group;
+
+	assert(seg != NULL);
+	group = &seg->used[slot >> LG_POOLS_GROUP_NBITS];
+
+	if (pool != NULL) {
+		*group |= bit;
+		if (pools_bitmap_ffu(seg->used, POOLS_SEG_SIZE /
+		    POOLS_GROUP_NBITS) == POOLS_SEG_SIZE) {
+			pools_segs_full[i >> LG_POOLS_GROUP_NBITS] |=
+			    1UL << (i & POOLS_GROUP_MASK);
+		}
+		pool->seqno = ++pool_seqno;
+		if (pool_id >= pools_nids)
+			pools_nids = pool_id + 1;
+		npools++;
+	} else {
+		*group &= ~bit;
+		pools_segs_full[i >> LG_POOLS_GROUP_NBITS] &=
+		    ~(1UL << (i & POOLS_GROUP_MASK));
+		npools--;
+	}
+
+	__atomic_store_n(&seg->pools[slot], pool, __ATOMIC_RELEASE);
+}
+
+/*
+ * Allocate memory for the per thread pool arrays.  Memory of the base pool
+ * is used when it exists, as the base allocator never frees.  The base pool
+ * may be created after the arrays are allocated, so *base_pool tells
+ * pool_tsd_free() which allocator the memory came from.
+ */
+static void *
+pool_tsd_malloc(size_t size, bool *base_pool)
+{
+	pool_t *pool = pool_get(0);
+
+	*base_pool = pool != NULL;
+	if (pool != NULL)
+		return (icalloct(size, false, pool->arenas[0]));
+
+	void *ret = je_base_malloc(size);
+	if (ret != NULL)
+		memset(ret, 0, size);
+
+	return (ret);
+}
+
+/*
+ * Grow the per thread arrays of pointers and sequence numbers, so that
+ * they have an entry for pool_id.  Both arrays live in a single allocation
+ * that starts with the pointers.  New entries are zeroed.
+ */
+bool
+pool_tsd_grow(void ***ptrs, unsigned **seqno, unsigned *npools,
+    bool *base_pool, unsigned pool_id)
+{
+	unsigned n = *npools * 2;
+	void **new_ptrs;
+	unsigned *new_seqno;
+	bool new_base_pool;
+
+	if (pool_id >= POOLS_MAX)
+		return (true);
+
+	if (n < TSD_POOLS_MIN)
+		n = TSD_POOLS_MIN;
+	if (n <= pool_id)
+		n = pool_id + 1;
+
+	new_ptrs = pool_tsd_malloc(n * (sizeof(void *) + sizeof(unsigned)),
+	    &new_base_pool);
+	if (new_ptrs == NULL)
+		return (true);
+	new_seqno = (unsigned *)&new_ptrs[n];
+
+	if (*npools > 0) {
+		memcpy(new_ptrs, *ptrs, *npools * sizeof(void *));
+		memcpy(new_seqno, *seqno, *npools * sizeof(unsigned));
+		pool_tsd_free(*ptrs, *base_pool);
+	}
+
+	*ptrs = new_ptrs;
+	*seqno = new_seqno;
+	*npools = n;
+	*base_pool = new_base_pool;
+
+	return (false);
+}
+
+/*
+ * Free the per thread arrays allocated by pool_tsd_grow(), with the allocator
+ * it recorded in base_pool.
+ */
+void
+pool_tsd_free(void **ptrs, bool base_pool)
+{
+	if (base_pool)
+		idalloct(ptrs, false);
+	else
+		je_base_free(ptrs);
+}
+
 bool pool_boot()
 {
 	if (malloc_mutex_init(&pools_lock)) {
@@ -112,3 +300,79 @@ void pool_postfork_child()
 	malloc_mutex_postfork_child(&pools_lock);
 	malloc_mutex_postfork_child(&pool_base_lock);
 }
+
+/*
+ * Slow path of pool_bump_alloc().  Objects that would waste much of a bump
+ * block get chunks of their own, the others are carved from a new block when
+ * the current one is exhausted.
+ */
+void *
+pool_bump_alloc_hard(pool_t *pool, size_t size, size_t alignment)
+{
+	pool_bump_t *bump;
+	size_t csize;
+	void *chunk, *ret;
+
+	size = (size + POOL_BUMP_HDR_MASK) & ~POOL_BUMP_HDR_MASK;
+	if (size == 0)
+		return (NULL);
+	if (alignment < POOL_BUMP_HDR_SIZE)
+		alignment = POOL_BUMP_HDR_SIZE;
+	if (alignment > chunksize)
+		return (NULL);
+
+	if (alignment + size > (chunksize >> 2)) {
+		/* the header fits below an object aligned within the chunk */
+		csize = CHUNK_CEILING(alignment + size);
+		if (csize < size)
+			return (NULL);
+		if ((chunk = chunk_alloc_base(pool, csize)) == NULL)
+			return (NULL);
+		ret = (void *)((uintptr_t)chunk + alignment);
+		*((size_t *)ret - 1) = size;
+		return (ret);
+	}
+
+	malloc_mutex_lock(&pool->bump_mtx);
+	bump = pool->bump;
+	if (bump == NULL ||
+	    (ret = pool_bump_carve(bump, size, alignment)) == NULL) {
+		if ((chunk = chunk_alloc_base(pool, chunksize)) == NULL) {
+			malloc_mutex_unlock(&pool->bump_mtx);
+			return (NULL);
+		}
+		bump = (pool_bump_t *)chunk;
+		bump->end = (uintptr_t)chunk + chunksize;
+		bump->next = CACHELINE_CEILING((uintptr_t)chunk +
+		    sizeof (pool_bump_t));
+		ret = pool_bump_carve(bump, size, alignment);
+		assert(ret != NULL);
+		__atomic_store_n(&pool->bump, bump, __ATOMIC_RELEASE);
+	}
+	malloc_mutex_unlock(&pool->bump_mtx);
+
+	return (ret);
+}
+
+/*
+ * Resize an object of a reset-only pool.  Objects never shrink, and growing
+ * one leaves the old copy in place until the pool is reset.
+ */
+void *
+pool_bump_ralloc(pool_t *pool, void *ptr, size_t size)
+{
+	size_t usize;
+	void *ret;
+
+	if (ptr == NULL)
+		return (pool_bump_alloc(pool, size));
+
+	usize = pool_bump_usize(ptr);
+	if (size <= usize)
+		return (ptr);
+
+	if ((ret = pool_bump_alloc(pool, size)) != NULL)
+		memcpy(ret, ptr, usize);
+
+	return (ret);
+}
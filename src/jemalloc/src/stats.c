@@ -560,3 +560,74 @@ stats_print(pool_t *pool, void (*write_cb)(void *, const char *), void *cbopaque
 	}
 	malloc_cprintf(write_cb, cbopaque, "--- End jemalloc statistics ---\n");
 }
+
+/*
+ * Read the counters of a pool the way ctl_refresh_pool() merges them, but
+ * without taking the arena and bin locks, so that allocation goes on while
+ * the pool is sampled.  Every counter is a single word updated by one thread
+ * at a time, so it can be read racily; the totals are not a consistent
+ * snapshot, they may be off by the operations in flight.  Only arenas_lock
+ * is held for reading, threads take it for writing only to add an arena.
+ */
+void
+stats_pool_get(pool_t *pool, pool_stats_t *stats, pool_bin_stats_t *bins,
+    unsigned nbins)
+{
+	size_t pactive = 0;
+	unsigned i, j;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->nbins = NBINS;
+	if (bins == NULL || nbins > NBINS)
+		nbins = (bins == NULL) ? 0 : NBINS;
+	if (nbins != 0)
+		memset(bins, 0, nbins * sizeof(*bins));
+
+	if (config_stats == false)
+		return;
+
+	malloc_rwlock_rdlock(&pool->arenas_lock);
+	for (i = 0; i < pool->narenas_total; i++) {
+		arena_t *arena = pool->arenas[i];
+
+		if (arena == NULL)
+			continue;
+
+		pactive += arena->nactive;
+		stats->allocated += arena->stats.allocated_large +
+		    arena->stats.allocated_huge;
+		stats->nmalloc += arena->stats.nmalloc_large +
+		    arena->stats.nmalloc_huge;
+		stats->ndalloc += arena->stats.ndalloc_large +
+		    arena->stats.ndalloc_huge;
+		stats->nlock_contended += arena->stats.nlock_contended;
+
+		for (j = 0; j < NBINS; j++) {
+			malloc_bin_stats_t *bstats = &arena->bins[j].stats;
+			size_t allocated = bstats->allocated;
+			uint64_t nmalloc = bstats->nmalloc;
+			uint64_t ndalloc = bstats->ndalloc;
+			uint64_t nlock_contended = bstats->nlock_contended;
+
+			stats->allocated += allocated;
+			stats->nmalloc += nmalloc;
+			stats->ndalloc += ndalloc;
+			stats->nlock_contended += nlock_contended;
+
+			if (j >= nbins)
+				continue;
+			bins[j].curobjs += allocated / arena_bin_info[j].reg_size;
+			bins[j].nmalloc += nmalloc;
+			bins[j].ndalloc += ndalloc;
+			bins[j].nrequests += bstats->nrequests;
+			bins[j].nlock_contended += nlock_contended;
+		}
+	}
+	malloc_rwlock_unlock(&pool->arenas_lock);
+
+	for (j = 0; j < nbins; j++)
+		bins[j].size = arena_bin_info[j].reg_size;
+
+	stats->active = pactive << LG_PAGE;
+	stats->mapped = pool->stats_chunks.curchunks << opt_lg_chunk;
+}
@@ -102,7 +102,7 @@ tcache_bin_flush_small(tcache_bin_t *tbin, size_t binind, unsigned rem,
 			tcache->prof_accumbytes = 0;
 		}
 
-		malloc_mutex_lock(&bin->lock);
+		arena_bin_lock(bin);
 		if (config_stats && arena == tcache->arena) {
 			assert(merged_stats == false);
 			merged_stats = true;
@@ -145,7 +145,7 @@ tcache_bin_flush_small(tcache_bin_t *tbin, size_t binind, unsigned rem,
 		 * arena, so the stats didn't get merged.  Manually do so now.
 		 */
 		arena_bin_t *bin = &tcache->arena->bins[binind];
-		malloc_mutex_lock(&bin->lock);
+		arena_bin_lock(bin);
 		bin->stats.nflushes++;
 		bin->stats.nrequests += tbin->tstats.nrequests;
 		tbin->tstats.nrequests = 0;
@@ -179,7 +179,7 @@ tcache_bin_flush_large(tcache_bin_t *tbin, size_t binind, unsigned rem,
 
 		if (config_prof)
 			idump = false;
-		malloc_mutex_lock(&arena->lock);
+		arena_lock(arena);
 		if ((config_prof || config_stats) && arena == tcache->arena) {
 			if (config_prof) {
 				idump = arena_prof_accum_locked(arena,
@@ -223,7 +223,7 @@ tcache_bin_flush_large(tcache_bin_t *tbin, size_t binind, unsigned rem,
 		 * arena, so the stats didn't get merged.  Manually do so now.
 		 */
 		arena_t *arena = tcache->arena;
-		malloc_mutex_lock(&arena->lock);
+		arena_lock(arena);
 		arena->stats.nrequests_large += tbin->tstats.nrequests;
 		arena->stats.lstats[binind - NBINS].nrequests +=
 		    tbin->tstats.nrequests;
@@ -244,7 +244,7 @@ tcache_arena_associate(tcache_t *tcache, arena_t *arena)
 
 	if (config_stats) {
 		/* Link into list of extant tcaches. */
-		malloc_mutex_lock(&arena->lock);
+		arena_lock(arena);
 		ql_elm_new(tcache, link);
 		ql_tail_insert(&arena->tcache_ql, tcache, link);
 		malloc_mutex_unlock(&arena->lock);
@@ -258,7 +258,7 @@ tcache_arena_dissociate(tcache_t *tcache)
 
 	if (config_stats) {
 		/* Unlink from list of extant tcaches. */
-		malloc_mutex_lock(&tcache->arena->lock);
+		arena_lock(tcache->arena);
 		ql_remove(&tcache->arena->tcache_ql, tcache, link);
 		tcache_stats_merge(tcache, tcache->arena);
 		malloc_mutex_unlock(&tcache->arena->lock);
@@ -308,6 +308,30 @@ tcache_get_hard(tcache_t *tcache, pool_t *pool, bool create)
 	return (NULL);
 }
 
+/*
+ * Grow the per thread arrays of tcaches to cover pool_id.  Fails after
+ * tcache_thread_cleanup(), so that no tcache is created by a destructor
+ * running after it.
+ */
+bool
+tcache_tsd_extend(tsd_tcache_t *tsd, unsigned pool_id)
+{
+	bool first = tsd->npools == 0;
+
+	if (tsd->purgatory)
+		return (true);
+
+	if (pool_tsd_grow((void ***)&tsd->tcaches, &tsd->seqno, &tsd->npools,
+	    &tsd->base_pool, pool_id))
+		return (true);
+
+	/* Get tcache_thread_cleanup() called when the thread exits. */
+	if (first)
+		tcache_tsd_set(tsd);
+
+	return (false);
+}
+
 tcache_t *
 tcache_create(arena_t *arena)
 {
@@ -372,7 +396,7 @@ tcache_destroy(tcache_t *tcache)
 		if (config_stats && tbin->tstats.nrequests != 0) {
 			arena_t *arena = tcache->arena;
 			arena_bin_t *bin = &arena->bins[i];
-			malloc_mutex_lock(&bin->lock);
+			arena_bin_lock(bin);
 			bin->stats.nrequests += tbin->tstats.nrequests;
 			malloc_mutex_unlock(&bin->lock);
 		}
@@ -384,7 +408,7 @@ tcache_destroy(tcache_t *tcache)
 
 		if (config_stats && tbin->tstats.nrequests != 0) {
 			arena_t *arena = tcache->arena;
-			malloc_mutex_lock(&arena->lock);
+			arena_lock(arena);
 			arena->stats.nrequests_large += tbin->tstats.nrequests;
 			arena->stats.lstats[i - NBINS].nrequests +=
 			    tbin->tstats.nrequests;
@@ -417,39 +441,32 @@ tcache_destroy(tcache_t *tcache)
 void
 tcache_thread_cleanup(void *arg)
 {
-	int i;
+	unsigned i;
 	tsd_tcache_t *tsd_array = arg;
 
 	malloc_mutex_lock(&pools_lock);
-	for (i = 0; i < POOLS_MAX; ++i) {
+	for (i = 0; i < tsd_array->npools; ++i) {
 		tcache_t *tcache = tsd_array->tcaches[i];
-		if (tcache != NULL) {
-			if (tcache == TCACHE_STATE_DISABLED) {
-				/* Do nothing. */
-			} else if (tcache == TCACHE_STATE_REINCARNATED) {
-				/*
-				 * Another destructor called an allocator function after this
-				 * destructor was called.  Reset tcache to
-				 * TCACHE_STATE_PURGATORY in order to receive another callback.
-				 */
-				tsd_array->tcaches[i] = TCACHE_STATE_PURGATORY;
-			} else if (tcache == TCACHE_STATE_PURGATORY) {
-				/*
-				 * The previous time this destructor was called, we set the key
-				 * to TCACHE_STATE_PURGATORY so that other destructors wouldn't
-				 * cause re-creation of the tcache.  This time, do nothing, so
-				 * that the destructor will not be called again.
-				 */
-			} else if (tcache != NULL) {
-				assert(tcache != TCACHE_STATE_PURGATORY);
-				if (pools[i] != NULL && tsd_array->seqno[i] == pools[i]->seqno)
-					tcache_destroy(tcache);
-
-				tsd_array->tcaches[i] = TCACHE_STATE_PURGATORY;
-			}
+		if ((uintptr_t)tcache > (uintptr_t)TCACHE_STATE_MAX) {
+			pool_t *pool = pool_get(i);
+			if (pool != NULL && tsd_array->seqno[i] == pool->seqno)
+				tcache_destroy(tcache);
 		}
 	}
 	malloc_mutex_unlock(&pools_lock);
+
+	/*
+	 * Instead of marking every tcache as TCACHE_STATE_PURGATORY, drop
+	 * the arrays and keep other destructors from creating them again.
+	 */
+	if (tsd_array->npools > 0) {
+		pool_tsd_free((void **)tsd_array->tcaches,
+		    tsd_array->base_pool);
+		tsd_array->tcaches = NULL;
+		tsd_array->seqno = NULL;
+		tsd_array->npools = 0;
+	}
+	tsd_array->purgatory = true;
 }
 
 /* Caller must own arena->lock. */
@@ -464,7 +481,7 @@ tcache_stats_merge(tcache_t *tcache, arena_t *arena)
 	for (i = 0; i < NBINS; i++) {
 		arena_bin_t *bin = &arena->bins[i];
 		tcache_bin_t *tbin = &tcache->tbins[i];
-		malloc_mutex_lock(&bin->lock);
+		arena_bin_lock(bin);
 		bin->stats.nrequests += tbin->tstats.nrequests;
 		malloc_mutex_unlock(&bin->lock);
 		tbin->tstats.nrequests = 0;
@@ -350,7 +350,7 @@ TEST_BEGIN(test_arena_i_dss)
 	assert_d_eq(mallctlbymib(mib, miblen, &dss_prec_new, &sz, &dss_prec_old,
 	    sizeof(dss_prec_old)), 0, "Unexpected mallctl() failure");
 
-	mib[3] = narenas_total_get(pools[0]);
+	mib[3] = narenas_total_get(pool_get(0));
 	dss_prec_new = "disabled";
 	assert_d_eq(mallctlbymib(mib, miblen, &dss_prec_old, &sz, &dss_prec_new,
 	    sizeof(dss_prec_new)), 0, "Unexpected mallctl() failure");
@@ -36,9 +36,9 @@ TEST_BEGIN(test_pool_create) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -66,9 +66,9 @@ TEST_BEGIN(test_pool_malloc) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -107,9 +107,9 @@ TEST_BEGIN(test_pool_free) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -131,9 +131,9 @@ TEST_BEGIN(test_pool_calloc) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -160,9 +160,9 @@ TEST_BEGIN(test_pool_realloc) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -191,9 +191,9 @@ TEST_BEGIN(test_pool_aligned_alloc) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -238,9 +238,9 @@ TEST_BEGIN(test_pool_reuse_pool) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -297,9 +297,9 @@ TEST_BEGIN(test_pool_check_memory) {
 
 		assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 		if (exp_base_pool) {
-			assert_ptr_not_null(pools[0], "not create base pool");
+			assert_ptr_not_null(pool_get(0), "not create base pool");
 		} else {
-			assert_ptr_null(pools[0], "create base pool");
+			assert_ptr_null(pool_get(0), "create base pool");
 		}
 	}
 
@@ -350,9 +350,9 @@ TEST_BEGIN(test_pool_use_all_memory) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -373,9 +373,9 @@ TEST_BEGIN(test_pool_extend_errors) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -396,9 +396,9 @@ TEST_BEGIN(test_pool_extend) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -423,9 +423,9 @@ TEST_BEGIN(test_pool_extend_after_out_of_memory) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 }
 TEST_END
@@ -461,9 +461,9 @@ TEST_BEGIN(test_pool_check_extend) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 
 	je_malloc_message = NULL;
@@ -493,9 +493,9 @@ TEST_BEGIN(test_pool_check_memory_out_of_range) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 
 	je_malloc_message = NULL;
@@ -523,9 +523,9 @@ TEST_BEGIN(test_pool_check_memory_overlap) {
 
 	assert_d_eq(custom_allocs, 0, "memory leak when using custom allocator");
 	if (exp_base_pool) {
-		assert_ptr_not_null(pools[0], "not create base pool");
+		assert_ptr_not_null(pool_get(0), "not create base pool");
 	} else {
-		assert_ptr_null(pools[0], "create base pool");
+		assert_ptr_null(pool_get(0), "create base pool");
 	}
 
 	je_malloc_message = NULL;
@@ -17,7 +17,7 @@ TEST_BEGIN(test_rtree_get_empty)
 	unsigned i;
 
 	for (i = 1; i <= (sizeof(uintptr_t) << 3); i++) {
-		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pools[0]);
+		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pool_get(0));
 		assert_u_eq(rtree_get(rtree, 0), 0,
 		    "rtree_get() should return NULL for empty tree");
 		rtree_delete(rtree);
@@ -30,7 +30,7 @@ TEST_BEGIN(test_rtree_extrema)
 	unsigned i;
 
 	for (i = 1; i <= (sizeof(uintptr_t) << 3); i++) {
-		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pools[0]);
+		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pool_get(0));
 
 		rtree_set(rtree, 0, 1);
 		assert_u_eq(rtree_get(rtree, 0), 1,
@@ -52,7 +52,7 @@ TEST_BEGIN(test_rtree_bits)
 	for (i = 1; i < (sizeof(uintptr_t) << 3); i++) {
 		uintptr_t keys[] = {0, 1,
 		    (((uintptr_t)1) << (sizeof(uintptr_t)*8-i)) - 1};
-		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pools[0]);
+		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pool_get(0));
 
 		for (j = 0; j < sizeof(keys)/sizeof(uintptr_t); j++) {
 			rtree_set(rtree, keys[j], 1);
@@ -85,7 +85,7 @@ TEST_BEGIN(test_rtree_random)
 
 	sfmt = init_gen_rand(SEED);
 	for (i = 1; i <= (sizeof(uintptr_t) << 3); i++) {
-		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pools[0]);
+		rtree_t *rtree = rtree_new(i, rtree_malloc, rtree_free, pool_get(0));
 		uintptr_t keys[NSET];
 		unsigned j;
 
@@ -190,6 +190,25 @@
  *		memset_nodrain_normal()
  *		memset_nodrain_movnt()
  *
+ * STATISTICS
+ *
+ * When PMEM_STATS is set to 1, pmem_init() moves the functions chosen above
+ * aside and points Func_flush, Func_drain, Func_memmove_nodrain and
+ * Func_memset_nodrain to stats_*() wrappers, which count into the calling
+ * thread's counters before calling them.  Without PMEM_STATS the wrappers
+ * are never called, so the statistics cost nothing.
+ *
+ * NVM EMULATION
+ *
+ * On machines without persistent memory the cost of the media can be
+ * modeled by setting PMEM_EMUL_FLUSH_NS, PMEM_EMUL_FENCE_NS and
+ * PMEM_EMUL_MOVNT_BW.  pmem_init() then wraps the functions above (the
+ * stats_*() ones included) in emul_*() functions, which busy-wait on the
+ * TSC for the configured time after every flushed line and every drain,
+ * and stretch non-temporal copies so they never exceed the configured
+ * bandwidth.  The TSC frequency is measured once at load time, or taken
+ * from PMEM_EMUL_TSC_MHZ so the delays are the same from run to run.
+ *
  * DEBUG LOGGING
  *
  * Many of the functions here get called hundreds of times from loops
@@ -203,7 +222,10 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <xmmintrin.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <x86intrin.h>
 
 #include "libpmem.h"
 
@@ -247,6 +269,7 @@
 
 static size_t Movnt_threshold = MOVNT_THRESHOLD;
 static int Has_hw_drain;
+static int Has_movnt;
 
 /*
  * pmem_has_hw_drain -- return whether or not HW drain (PCOMMIT) was found
@@ -651,14 +674,35 @@ pmem_map(int fd)
 {
 	LOG(3, "fd %d", fd);
 
+	return pmem_map_flags(fd, 0);
+}
+
+/*
+ * pmem_map_flags -- map the entire file for read/write access with a policy
+ *
+ * The PMEM_MAP_* flags are combined with the ones set in the environment.
+ */
+void *
+pmem_map_flags(int fd, int flags)
+{
+	LOG(3, "fd %d flags 0x%x", fd, flags);
+
+	if (flags & ~PMEM_MAP_ALL) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return NULL;
+	}
+
 	struct stat stbuf;
 	if (fstat(fd, &stbuf) < 0) {
 		ERR("!fstat");
 		return NULL;
 	}
 
+	flags |= util_map_policy(PMEM_MAP_POLICY_VAR);
+
 	void *addr;
-	if ((addr = util_map(fd, stbuf.st_size, 0)) == NULL)
+	if ((addr = util_map_flags(fd, stbuf.st_size, 0, flags)) == NULL)
 		return NULL;    /* util_map() set errno, called LOG */
 
 	LOG(3, "returning %p", addr);
@@ -668,6 +712,18 @@ pmem_map(int fd)
 	return addr;
 }
 
+/*
+ * pmem_map_pagesizes -- report how much of a mapping uses huge pages
+ */
+int
+pmem_map_pagesizes(const void *addr, size_t len, size_t *huge2m,
+		size_t *huge1g)
+{
+	LOG(3, "addr %p len %zu", addr, len);
+
+	return util_map_pagesizes(addr, len, huge2m, huge1g);
+}
+
 /*
  * memmove_nodrain_normal -- (internal) memmove to pmem without hw drain
  */
@@ -1088,6 +1144,422 @@ pmem_memset_persist(void *pmemdest, int c, size_t len)
 	return pmemdest;
 }
 
+/*
+ * Counters of a thread, one set per context.  Only the owning thread writes
+ * them; pmem_stats_get() reads them while they are being updated, which is
+ * fine for aligned 64-bit words.
+ */
+struct stats_thread {
+	struct pmem_stats_counters contexts[PMEM_STATS_NCONTEXTS];
+	struct stats_thread *next;
+	struct stats_thread **prevp;
+};
+
+static int Stats_enabled;
+static __thread unsigned Stats_context;
+static __thread struct stats_thread *Stats_thread;
+
+/* protects the list of threads and the counters of the exited ones */
+static pthread_mutex_t Stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_thread *Stats_threads;
+static struct pmem_stats_counters Stats_exited[PMEM_STATS_NCONTEXTS];
+static pthread_key_t Stats_key;
+
+/* used by the threads whose counters could not be allocated */
+static struct stats_thread Stats_nomem;
+
+/* fences issued by a single pmem_drain() */
+static unsigned Stats_drain_fences;
+
+static void (*Stats_flush)(void *, size_t);
+static void (*Stats_drain)(void);
+static void *(*Stats_memmove_nodrain)(void *, const void *, size_t);
+static void *(*Stats_memset_nodrain)(void *, int, size_t);
+
+/*
+ * stats_counters_add -- (internal) add a set of counters to another one
+ */
+static void
+stats_counters_add(struct pmem_stats_counters *dst,
+		const struct pmem_stats_counters *src)
+{
+	dst->flushed_lines += src->flushed_lines;
+	dst->fences += src->fences;
+	dst->movnt_bytes += src->movnt_bytes;
+	dst->temporal_bytes += src->temporal_bytes;
+}
+
+/*
+ * stats_thread_fini -- (internal) fold the counters of an exiting thread
+ */
+static void
+stats_thread_fini(void *arg)
+{
+	struct stats_thread *t = arg;
+
+	pthread_mutex_lock(&Stats_lock);
+	for (unsigned i = 0; i < PMEM_STATS_NCONTEXTS; ++i)
+		stats_counters_add(&Stats_exited[i], &t->contexts[i]);
+	*t->prevp = t->next;
+	if (t->next)
+		t->next->prevp = t->prevp;
+	pthread_mutex_unlock(&Stats_lock);
+
+	Stats_thread = NULL;
+	Free(t);
+}
+
+/*
+ * stats_thread_init -- (internal) register the counters of the thread
+ */
+static struct stats_thread *
+stats_thread_init(void)
+{
+	struct stats_thread *t = Malloc(sizeof (*t));
+	if (t == NULL) {
+		Stats_thread = &Stats_nomem;
+		return Stats_thread;
+	}
+	memset(t, 0, sizeof (*t));
+
+	pthread_mutex_lock(&Stats_lock);
+	t->next = Stats_threads;
+	t->prevp = &Stats_threads;
+	if (Stats_threads)
+		Stats_threads->prevp = &t->next;
+	Stats_threads = t;
+	pthread_mutex_unlock(&Stats_lock);
+
+	pthread_setspecific(Stats_key, t);
+	Stats_thread = t;
+	return t;
+}
+
+/*
+ * stats_counters -- (internal) counters of the thread's current context
+ */
+static inline struct pmem_stats_counters *
+stats_counters(void)
+{
+	struct stats_thread *t = Stats_thread;
+	if (t == NULL)
+		t = stats_thread_init();
+
+	return &t->contexts[Stats_context];
+}
+
+/*
+ * stats_flush -- (internal) count the cache lines flushed, then flush them
+ *
+ * The lines are counted the way the flush_*() loops walk them.
+ */
+static void
+stats_flush(void *addr, size_t len)
+{
+	uintptr_t start = (uintptr_t)addr & ~(FLUSH_ALIGN - 1);
+	uintptr_t end = (uintptr_t)addr + len;
+
+	stats_counters()->flushed_lines +=
+		(end - start + FLUSH_ALIGN - 1) >> ALIGN_SHIFT;
+	Stats_flush(addr, len);
+}
+
+/*
+ * stats_drain -- (internal) count the fences of a drain, then drain
+ */
+static void
+stats_drain(void)
+{
+	stats_counters()->fences += Stats_drain_fences;
+	Stats_drain();
+}
+
+/*
+ * stats_memmove_nodrain -- (internal) count the bytes copied, then copy
+ */
+static void *
+stats_memmove_nodrain(void *pmemdest, const void *src, size_t len)
+{
+	struct pmem_stats_counters *c = stats_counters();
+
+	if (Has_movnt && len >= Movnt_threshold)
+		c->movnt_bytes += len;
+	else
+		c->temporal_bytes += len;
+
+	return Stats_memmove_nodrain(pmemdest, src, len);
+}
+
+/*
+ * stats_memset_nodrain -- (internal) count the bytes set, then set them
+ */
+static void *
+stats_memset_nodrain(void *pmemdest, int c, size_t len)
+{
+	struct pmem_stats_counters *cnt = stats_counters();
+
+	if (Has_movnt && len >= Movnt_threshold)
+		cnt->movnt_bytes += len;
+	else
+		cnt->temporal_bytes += len;
+
+	return Stats_memset_nodrain(pmemdest, c, len);
+}
+
+/*
+ * stats_init -- (internal) route the flushes and copies through the counters
+ */
+static void
+stats_init(void)
+{
+	if ((errno = pthread_key_create(&Stats_key, stats_thread_fini))) {
+		ERR("!pthread_key_create");
+		return;
+	}
+
+	Stats_drain_fences = (Func_predrain_fence == predrain_fence_sfence) +
+		(Func_drain == drain_pcommit);
+
+	Stats_flush = Func_flush;
+	Stats_drain = Func_drain;
+	Stats_memmove_nodrain = Func_memmove_nodrain;
+	Stats_memset_nodrain = Func_memset_nodrain;
+
+	Func_flush = stats_flush;
+	Func_drain = stats_drain;
+	Func_memmove_nodrain = stats_memmove_nodrain;
+	Func_memset_nodrain = stats_memset_nodrain;
+
+	Stats_enabled = 1;
+}
+
+/*
+ * pmem_stats_enabled -- true if the statistics are collected
+ */
+int
+pmem_stats_enabled(void)
+{
+	return Stats_enabled;
+}
+
+/*
+ * pmem_stats_set_context -- charge the thread's next operations to a context
+ *
+ * Returns the previous context of the thread, so that nested callers can
+ * restore it.
+ */
+unsigned
+pmem_stats_set_context(unsigned context)
+{
+	if (!Stats_enabled)
+		return 0;
+
+	unsigned prev = Stats_context;
+
+	if (context >= PMEM_STATS_NCONTEXTS)
+		ERR("invalid context %u", context);
+	else
+		Stats_context = context;
+
+	return prev;
+}
+
+/*
+ * pmem_stats_get -- sum the counters of all the threads
+ */
+void
+pmem_stats_get(struct pmem_stats *stats)
+{
+	LOG(3, "stats %p", stats);
+
+	memset(stats, 0, sizeof (*stats));
+	if (!Stats_enabled)
+		return;
+
+	pthread_mutex_lock(&Stats_lock);
+	for (unsigned i = 0; i < PMEM_STATS_NCONTEXTS; ++i) {
+		stats_counters_add(&stats->contexts[i], &Stats_exited[i]);
+		stats_counters_add(&stats->contexts[i],
+				&Stats_nomem.contexts[i]);
+		for (struct stats_thread *t = Stats_threads; t; t = t->next)
+			stats_counters_add(&stats->contexts[i],
+					&t->contexts[i]);
+	}
+	pthread_mutex_unlock(&Stats_lock);
+
+	for (unsigned i = 0; i < PMEM_STATS_NCONTEXTS; ++i)
+		stats_counters_add(&stats->total, &stats->contexts[i]);
+}
+
+#define	EMUL_CALIBRATION_NS	10000000 /* time spent measuring the TSC */
+
+/* delays in TSC cycles, see NVM EMULATION above */
+static uint64_t Emul_flush_cycles;	/* per flushed cache line */
+static uint64_t Emul_fence_cycles;	/* per drain */
+static uint64_t Emul_movnt_bw;		/* MB/s, 0 means no cap */
+static uint64_t Emul_tsc_khz;
+
+static void (*Emul_flush)(void *, size_t);
+static void (*Emul_drain)(void);
+static void *(*Emul_memmove_nodrain)(void *, const void *, size_t);
+static void *(*Emul_memset_nodrain)(void *, int, size_t);
+
+/*
+ * emul_wait -- (internal) busy-wait until the TSC reaches the deadline
+ */
+static inline void
+emul_wait(uint64_t deadline)
+{
+	while (__rdtsc() < deadline)
+		_mm_pause();
+}
+
+/*
+ * emul_flush -- (internal) flush, then wait for every line written back
+ */
+static void
+emul_flush(void *addr, size_t len)
+{
+	uintptr_t start = (uintptr_t)addr & ~(FLUSH_ALIGN - 1);
+	uintptr_t end = (uintptr_t)addr + len;
+
+	Emul_flush(addr, len);
+
+	uint64_t lines = (end - start + FLUSH_ALIGN - 1) >> ALIGN_SHIFT;
+	if (len)
+		emul_wait(__rdtsc() + lines * Emul_flush_cycles);
+}
+
+/*
+ * emul_drain -- (internal) drain, then wait for the media
+ */
+static void
+emul_drain(void)
+{
+	Emul_drain();
+	emul_wait(__rdtsc() + Emul_fence_cycles);
+}
+
+/*
+ * emul_movnt_cycles -- (internal) the shortest time a copy of len bytes
+ *	may take with the emulated bandwidth, 0 if it is not capped
+ */
+static inline uint64_t
+emul_movnt_cycles(size_t len)
+{
+	if (!Emul_movnt_bw || !Has_movnt || len < Movnt_threshold)
+		return 0;
+
+	/* MB/s and kHz, so this is len / (bw * 10^6) seconds */
+	return (uint64_t)len * Emul_tsc_khz / (Emul_movnt_bw * 1000);
+}
+
+/*
+ * emul_memmove_nodrain -- (internal) copy no faster than the media allows
+ */
+static void *
+emul_memmove_nodrain(void *pmemdest, const void *src, size_t len)
+{
+	uint64_t deadline = __rdtsc() + emul_movnt_cycles(len);
+
+	Emul_memmove_nodrain(pmemdest, src, len);
+	emul_wait(deadline);
+
+	return pmemdest;
+}
+
+/*
+ * emul_memset_nodrain -- (internal) set no faster than the media allows
+ */
+static void *
+emul_memset_nodrain(void *pmemdest, int c, size_t len)
+{
+	uint64_t deadline = __rdtsc() + emul_movnt_cycles(len);
+
+	Emul_memset_nodrain(pmemdest, c, len);
+	emul_wait(deadline);
+
+	return pmemdest;
+}
+
+/*
+ * emul_tsc_khz -- (internal) measure the frequency of the TSC
+ */
+static uint64_t
+emul_tsc_khz(void)
+{
+	struct timespec t0, t1;
+	uint64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
+	uint64_t c0 = __rdtsc();
+	do {
+		clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
+		ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 +
+			(uint64_t)t1.tv_nsec - (uint64_t)t0.tv_nsec;
+	} while (ns < EMUL_CALIBRATION_NS);
+	uint64_t c1 = __rdtsc();
+
+	return (c1 - c0) * 1000000 / ns;
+}
+
+/*
+ * emul_getenv -- (internal) read a non-negative number from the environment
+ */
+static uint64_t
+emul_getenv(const char *name)
+{
+	char *ptr = getenv(name);
+	if (ptr == NULL)
+		return 0;
+
+	long long val = atoll(ptr);
+	if (val < 0) {
+		LOG(3, "Invalid %s", name);
+		return 0;
+	}
+
+	LOG(3, "%s set to %lld", name, val);
+	return (uint64_t)val;
+}
+
+/*
+ * emul_init -- (internal) route the flushes and copies through the delays
+ */
+static void
+emul_init(void)
+{
+	uint64_t flush_ns = emul_getenv("PMEM_EMUL_FLUSH_NS");
+	uint64_t fence_ns = emul_getenv("PMEM_EMUL_FENCE_NS");
+
+	Emul_movnt_bw = emul_getenv("PMEM_EMUL_MOVNT_BW");
+	if (!flush_ns && !fence_ns && !Emul_movnt_bw)
+		return;
+
+	Emul_tsc_khz = emul_getenv("PMEM_EMUL_TSC_MHZ") * 1000;
+	if (!Emul_tsc_khz)
+		Emul_tsc_khz = emul_tsc_khz();
+
+	LOG(3, "TSC at %llu kHz", (unsigned long long)Emul_tsc_khz);
+
+	Emul_flush_cycles = flush_ns * Emul_tsc_khz / 1000000;
+	Emul_fence_cycles = fence_ns * Emul_tsc_khz / 1000000;
+
+	Emul_flush = Func_flush;
+	Emul_drain = Func_drain;
+	Emul_memmove_nodrain = Func_memmove_nodrain;
+	Emul_memset_nodrain = Func_memset_nodrain;
+
+	if (flush_ns)
+		Func_flush = emul_flush;
+	if (fence_ns)
+		Func_drain = emul_drain;
+	if (Emul_movnt_bw) {
+		Func_memmove_nodrain = emul_memmove_nodrain;
+		Func_memset_nodrain = emul_memset_nodrain;
+	}
+}
+
 /*
  * pmem_init -- load-time initialization for pmem.c
  *
@@ -1184,6 +1656,7 @@ pmem_init(void)
 							memmove_nodrain_movnt;
 						Func_memset_nodrain =
 							memset_nodrain_movnt;
+						Has_movnt = 1;
 					}
 				}
 
@@ -1231,4 +1704,20 @@ pmem_init(void)
 		else if (val == 1)
 			Func_is_pmem = is_pmem_always;
 	}
+
+	/*
+	 * Count the flushes, fences and copies if asked to, see the
+	 * STATISTICS section above.
+	 */
+	ptr = getenv("PMEM_STATS");
+	if (ptr && strcmp(ptr, "1") == 0) {
+		LOG(3, "PMEM_STATS enabled");
+		stats_init();
+	}
+
+	/*
+	 * Add the latency and bandwidth of the emulated media, see the
+	 * NVM EMULATION section above.
+	 */
+	emul_init();
 }
@@ -37,5 +37,6 @@
 #define	PMEM_LOG_PREFIX "libpmem"
 #define	PMEM_LOG_LEVEL_VAR "PMEM_LOG_LEVEL"
 #define	PMEM_LOG_FILE_VAR "PMEM_LOG_FILE"
+#define	PMEM_MAP_POLICY_VAR "PMEM_MAP_POLICY"
 
 extern unsigned long Pagesize;
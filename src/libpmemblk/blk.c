@@ -285,17 +285,18 @@ static struct ns_callback ns_cb = {
  */
 static PMEMblkpool *
 pmemblk_map_common(int fd, size_t poolsize, size_t bsize, int rdonly,
-		int initialize, int zeroed)
+		int initialize, int zeroed, int mapflags)
 {
-	LOG(3, "fd %d poolsize %zu bsize %zu rdonly %d initialize %d zeroed %d",
-			fd, poolsize, bsize, rdonly, initialize, zeroed);
+	LOG(3, "fd %d poolsize %zu bsize %zu rdonly %d initialize %d zeroed %d "
+			"mapflags 0x%x", fd, poolsize, bsize, rdonly,
+			initialize, zeroed, mapflags);
 
 	/* things free by "goto err" if not NULL */
 	struct btt *bttp = NULL;
 	pthread_mutex_t *locks = NULL;
 
 	void *addr;
-	if ((addr = util_map(fd, poolsize, rdonly)) == NULL) {
+	if ((addr = util_map_flags(fd, poolsize, rdonly, mapflags)) == NULL) {
 		(void) close(fd);
 		return NULL;	/* util_map() set errno, called LOG */
 	}
@@ -536,7 +537,8 @@ pmemblk_create(const char *path, size_t bsize, size_t poolsize,
 		return NULL;	/* errno set by util_pool_create/open() */
 
 	PMEMblkpool *pbp;
-	pbp = pmemblk_map_common(fd, poolsize, bsize, 0, 1, created);
+	pbp = pmemblk_map_common(fd, poolsize, bsize, 0, 1, created,
+			util_map_policy(PMEMBLK_MAP_POLICY_VAR));
 	if (pbp == NULL && created)
 		unlink(path);	/* delete file if pool creation failed */
 
@@ -551,13 +553,33 @@ pmemblk_open(const char *path, size_t bsize)
 {
 	LOG(3, "path %s bsize %zu", path, bsize);
 
+	return pmemblk_open_flags(path, bsize, 0);
+}
+
+/*
+ * pmemblk_open_flags -- open a block memory pool with a mapping policy
+ *
+ * The PMEMBLK_MAP_* flags are combined with the ones set in the environment.
+ */
+PMEMblkpool *
+pmemblk_open_flags(const char *path, size_t bsize, int flags)
+{
+	LOG(3, "path %s bsize %zu flags 0x%x", path, bsize, flags);
+
+	if (flags & ~PMEMBLK_MAP_ALL) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return NULL;
+	}
+
 	size_t poolsize = 0;
 	int fd;
 
 	if ((fd = util_pool_open(path, &poolsize, PMEMBLK_MIN_POOL)) == -1)
 		return NULL;	/* errno set by util_pool_open() */
 
-	return pmemblk_map_common(fd, poolsize, bsize, 0, 0, 0);
+	return pmemblk_map_common(fd, poolsize, bsize, 0, 0, 0,
+			flags | util_map_policy(PMEMBLK_MAP_POLICY_VAR));
 }
 
 /*
@@ -719,7 +741,7 @@ pmemblk_check(const char *path)
 		return -1;	/* errno set by util_pool_open() */
 
 	/* map the pool read-only */
-	PMEMblkpool *pbp = pmemblk_map_common(fd, poolsize, 0, 1, 0, 0);
+	PMEMblkpool *pbp = pmemblk_map_common(fd, poolsize, 0, 1, 0, 0, 0);
 
 	if (pbp == NULL)
 		return -1;	/* errno set by pmemblk_map_common() */
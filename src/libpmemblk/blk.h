@@ -37,6 +37,7 @@
 #define	PMEMBLK_LOG_PREFIX "libpmemblk"
 #define	PMEMBLK_LOG_LEVEL_VAR "PMEMBLK_LOG_LEVEL"
 #define	PMEMBLK_LOG_FILE_VAR "PMEMBLK_LOG_FILE"
+#define	PMEMBLK_MAP_POLICY_VAR "PMEMBLK_MAP_POLICY"
 
 /* attributes of the blk memory pool format for the pool header */
 #define	BLK_HDR_SIG "PMEMBLK"	/* must be 8 bytes including '\0' */
@@ -64,13 +64,14 @@
  * a new pool header is created.  Otherwise, a valid header must exist.
  */
 static PMEMlogpool *
-pmemlog_map_common(int fd, size_t poolsize, int rdonly, int empty)
+pmemlog_map_common(int fd, size_t poolsize, int rdonly, int empty,
+		int mapflags)
 {
-	LOG(3, "fd %d poolsize %zu rdonly %d empty %d",
-			fd, poolsize, rdonly, empty);
+	LOG(3, "fd %d poolsize %zu rdonly %d empty %d mapflags 0x%x",
+			fd, poolsize, rdonly, empty, mapflags);
 
 	void *addr;
-	if ((addr = util_map(fd, poolsize, rdonly)) == NULL) {
+	if ((addr = util_map_flags(fd, poolsize, rdonly, mapflags)) == NULL) {
 		(void) close(fd);
 		return NULL;	/* util_map() set errno, called LOG */
 	}
@@ -282,7 +283,8 @@ pmemlog_create(const char *path, size_t poolsize, mode_t mode)
 	if (fd == -1)
 		return NULL;	/* errno set by util_pool_create/open() */
 
-	PMEMlogpool *plp = pmemlog_map_common(fd, poolsize, 0, 1);
+	PMEMlogpool *plp = pmemlog_map_common(fd, poolsize, 0, 1,
+			util_map_policy(PMEMLOG_MAP_POLICY_VAR));
 	if (plp == NULL && created)
 		unlink(path);	/* delete file if pool creation failed */
 
@@ -297,13 +299,33 @@ pmemlog_open(const char *path)
 {
 	LOG(3, "path %s", path);
 
+	return pmemlog_open_flags(path, 0);
+}
+
+/*
+ * pmemlog_open_flags -- open an existing log memory pool with a mapping policy
+ *
+ * The PMEMLOG_MAP_* flags are combined with the ones set in the environment.
+ */
+PMEMlogpool *
+pmemlog_open_flags(const char *path, int flags)
+{
+	LOG(3, "path %s flags 0x%x", path, flags);
+
+	if (flags & ~PMEMLOG_MAP_ALL) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return NULL;
+	}
+
 	size_t poolsize = 0;
 	int fd;
 
 	if ((fd = util_pool_open(path, &poolsize, PMEMLOG_MIN_POOL)) == -1)
 		return NULL;	/* errno set by util_pool_open() */
 
-	return pmemlog_map_common(fd, poolsize, 0, 0);
+	return pmemlog_map_common(fd, poolsize, 0, 0,
+			flags | util_map_policy(PMEMLOG_MAP_POLICY_VAR));
 }
 
 /*
@@ -666,7 +688,7 @@ pmemlog_check(const char *path)
 		return -1;	/* errno set by util_pool_open() */
 
 	/* map the pool read-only */
-	PMEMlogpool *plp = pmemlog_map_common(fd, poolsize, 1, 0);
+	PMEMlogpool *plp = pmemlog_map_common(fd, poolsize, 1, 0, 0);
 
 	if (plp == NULL)
 		return -1;	/* errno set by pmemlog_map_common() */
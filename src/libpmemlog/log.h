@@ -37,6 +37,7 @@
 #define	PMEMLOG_LOG_PREFIX "libpmemlog"
 #define	PMEMLOG_LOG_LEVEL_VAR "PMEMLOG_LOG_LEVEL"
 #define	PMEMLOG_LOG_FILE_VAR "PMEMLOG_LOG_FILE"
+#define	PMEMLOG_MAP_POLICY_VAR "PMEMLOG_MAP_POLICY"
 
 /* attributes of the log memory pool format for the pool header */
 #define	LOG_HDR_SIG "PMEMLOG"	/* must be 8 bytes including '\0' */
@@ -79,6 +79,11 @@ struct bucket {
 	uint64_t bitmap_lastval;
 	int bitmap_nval;
 	int bitmap_nallocs;
+
+	/* statistics, may be read without holding the lock */
+	uint64_t nruns;
+	uint64_t nfree_units;
+	uint64_t nfree_blocks;
 };
 
 /*
@@ -104,6 +109,9 @@ bucket_new(size_t unit_size, int unit_max)
 
 	b->unit_size = unit_size;
 	b->unit_max = unit_max;
+	b->nruns = 0;
+	b->nfree_units = 0;
+	b->nfree_blocks = 0;
 
 	if (bucket_is_small(b)) {
 		b->bitmap_nallocs = RUNSIZE / unit_size;
@@ -218,7 +226,13 @@ bucket_insert_block(struct bucket *b, struct memory_block m)
 	uint64_t key = CHUNK_KEY_PACK(m.zone_id, m.chunk_id, m.block_off,
 				m.size_idx);
 
-	return ctree_insert(b->tree, key);
+	int ret = ctree_insert(b->tree, key);
+	if (ret == 0) {
+		__sync_fetch_and_add(&b->nfree_units, m.size_idx);
+		__sync_fetch_and_add(&b->nfree_blocks, 1);
+	}
+
+	return ret;
 }
 
 /*
@@ -239,6 +253,9 @@ bucket_get_rm_block_bestfit(struct bucket *b, struct memory_block *m)
 	m->block_off = CHUNK_KEY_GET_BLOCK_OFF(key);
 	m->size_idx = CHUNK_KEY_GET_SIZE_IDX(key);
 
+	__sync_fetch_and_sub(&b->nfree_units, m->size_idx);
+	__sync_fetch_and_sub(&b->nfree_blocks, 1);
+
 	return 0;
 }
 
@@ -254,6 +271,9 @@ bucket_get_rm_block_exact(struct bucket *b, struct memory_block m)
 	if ((key = ctree_remove(b->tree, key, 1)) == 0)
 		return ENOMEM;
 
+	__sync_fetch_and_sub(&b->nfree_units, m.size_idx);
+	__sync_fetch_and_sub(&b->nfree_blocks, 1);
+
 	return 0;
 }
 
@@ -266,6 +286,42 @@ bucket_is_empty(struct bucket *b)
 	return ctree_is_empty(b->tree);
 }
 
+/*
+ * bucket_add_runs -- updates the number of runs assigned to the bucket
+ */
+void
+bucket_add_runs(struct bucket *b, int n)
+{
+	__sync_fetch_and_add(&b->nruns, n);
+}
+
+/*
+ * bucket_nruns -- returns the number of runs assigned to the bucket
+ */
+uint64_t
+bucket_nruns(struct bucket *b)
+{
+	return b->nruns;
+}
+
+/*
+ * bucket_nfree_units -- returns the number of free units in the bucket
+ */
+uint64_t
+bucket_nfree_units(struct bucket *b)
+{
+	return b->nfree_units;
+}
+
+/*
+ * bucket_nfree_blocks -- returns the number of free blocks in the bucket
+ */
+uint64_t
+bucket_nfree_blocks(struct bucket *b)
+{
+	return b->nfree_blocks;
+}
+
 /*
  * bucket_lock -- acquire bucket lock
  */
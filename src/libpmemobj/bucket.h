@@ -51,4 +51,8 @@ int bucket_is_empty(struct bucket *b);
 int bucket_bitmap_nval(struct bucket *b);
 uint64_t bucket_bitmap_lastval(struct bucket *b);
 int bucket_bitmap_nallocs(struct bucket *b);
+void bucket_add_runs(struct bucket *b, int n);
+uint64_t bucket_nruns(struct bucket *b);
+uint64_t bucket_nfree_units(struct bucket *b);
+uint64_t bucket_nfree_blocks(struct bucket *b);
 void bucket_unlock(struct bucket *b);
@@ -45,6 +45,7 @@
 #include "libpmem.h"
 #include "libpmemobj.h"
 #include "util.h"
+#include "set.h"
 #include "heap.h"
 #include "redo.h"
 #include "heap_layout.h"
@@ -53,6 +54,8 @@
 #include "out.h"
 #include "list.h"
 #include "obj.h"
+#include "trace.h"
+#include "stats.h"
 #include "valgrind_internal.h"
 
 #define	MAX_BUCKET_REFILL 2
@@ -72,6 +75,7 @@ struct pmalloc_heap {
 	pthread_mutex_t run_locks[MAX_RUN_LOCKS];
 	int max_zone;
 	int zones_exhausted;
+	uint32_t *zone_order; /* order in which the zones are processed */
 	int last_run_max_size;
 };
 
@@ -148,7 +152,10 @@ heap_chunk_init(PMEMobjpool *pop, struct chunk_header *hdr,
 		.size_idx = size_idx
 	};
 	*hdr = nhdr; /* write the entire header (8 bytes) at once */
-	pop->persist(hdr, sizeof (*hdr));
+
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+	pop->persist(pop, hdr, sizeof (*hdr));
+	pmem_stats_set_context(ctx);
 
 	heap_chunk_write_footer(hdr, size_idx);
 }
@@ -170,7 +177,10 @@ heap_zone_init(PMEMobjpool *pop, uint32_t zone_id)
 		.magic = ZONE_HEADER_MAGIC,
 	};
 	z->header = nhdr;  /* write the entire header (8 bytes) at once */
-	pop->persist(&z->header, sizeof (z->header));
+
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+	pop->persist(pop, &z->header, sizeof (z->header));
+	pmem_stats_set_context(ctx);
 }
 
 /*
@@ -180,10 +190,12 @@ static void
 heap_init_run(PMEMobjpool *pop, struct bucket *b, struct chunk_header *hdr,
 	struct chunk_run *run)
 {
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+
 	/* add/remove chunk_run and chunk_header to valgrind transaction */
 	VALGRIND_ADD_TO_TX(run, sizeof (*run));
 	run->block_size = bucket_unit_size(b);
-	pop->persist(&run->block_size, sizeof (run->block_size));
+	pop->persist(pop, &run->block_size, sizeof (run->block_size));
 
 	ASSERT(hdr->type == CHUNK_TYPE_FREE);
 
@@ -195,13 +207,15 @@ heap_init_run(PMEMobjpool *pop, struct bucket *b, struct chunk_header *hdr,
 	run->bitmap[bucket_bitmap_nval(b) - 1] = bucket_bitmap_lastval(b);
 	VALGRIND_REMOVE_FROM_TX(run, sizeof (*run));
 
-	pop->persist(run->bitmap, sizeof (run->bitmap));
+	pop->persist(pop, run->bitmap, sizeof (run->bitmap));
 
 	VALGRIND_ADD_TO_TX(hdr, sizeof (*hdr));
 	hdr->type = CHUNK_TYPE_RUN;
 	VALGRIND_REMOVE_FROM_TX(hdr, sizeof (*hdr));
 
-	pop->persist(hdr, sizeof (*hdr));
+	pop->persist(pop, hdr, sizeof (*hdr));
+
+	pmem_stats_set_context(ctx);
 }
 
 /*
@@ -247,6 +261,8 @@ heap_populate_run_bucket(PMEMobjpool *pop, struct bucket *b,
 	ASSERT(hdr->size_idx == 1);
 	ASSERT(bucket_unit_size(b) == run->block_size);
 
+	bucket_add_runs(b, 1);
+
 	uint16_t run_bits = RUNSIZE / run->block_size;
 	ASSERT(run_bits < (MAX_BITMAP_VALUES * BITS_PER_VALUE));
 	uint16_t block_off = 0;
@@ -287,6 +303,30 @@ heap_populate_run_bucket(PMEMobjpool *pop, struct bucket *b,
 	}
 }
 
+/*
+ * heap_merge_free_chunks -- (internal) merges consecutive free chunks
+ *
+ * Neighbouring free chunks that were never coalesced (e.g. because of an
+ * interrupted free) would otherwise end up as separate blocks in the default
+ * bucket, fragmenting the zone for large allocations.
+ */
+static void
+heap_merge_free_chunks(PMEMobjpool *pop, struct zone *z,
+	struct chunk_header *hdr, uint32_t chunk_id)
+{
+	uint32_t size_idx = hdr->size_idx;
+	while (chunk_id + size_idx < z->header.size_idx) {
+		struct chunk_header *next = hdr + size_idx;
+		if (next->type != CHUNK_TYPE_FREE)
+			break;
+
+		size_idx += next->size_idx;
+	}
+
+	if (size_idx != hdr->size_idx)
+		heap_chunk_init(pop, hdr, CHUNK_TYPE_FREE, size_idx);
+}
+
 /*
  * heap_populate_buckets -- (internal) creates volatile state of memory blocks
  */
@@ -298,9 +338,12 @@ heap_populate_buckets(PMEMobjpool *pop)
 	if (h->zones_exhausted == h->max_zone)
 		return;
 
-	uint32_t zone_id = h->zones_exhausted++;
+	uint32_t zone_id = h->zone_order[h->zones_exhausted++];
 	struct zone *z = &h->layout->zones[zone_id];
 
+	TRACE(TRACE_HEAP_POPULATE, TRACE_BEGIN, zone_id);
+	OBJ_STATS_ADD(pop, OBJ_STAT_ZONE_POPULATIONS, 1);
+
 	/* ignore zone and chunk headers */
 	VALGRIND_ADD_TO_GLOBAL_TX_IGNORE(z, sizeof (z->header) +
 		sizeof (z->chunk_headers));
@@ -320,12 +363,15 @@ heap_populate_buckets(PMEMobjpool *pop)
 			heap_populate_run_bucket(pop,
 				h->bucket_map[run->block_size], i, zone_id);
 		} else if (hdr->type == CHUNK_TYPE_FREE) {
+			heap_merge_free_chunks(pop, z, hdr, i);
 			struct memory_block m = {i, zone_id, hdr->size_idx, 0};
 			bucket_insert_block(def_bucket, m);
 		}
 
 		i += hdr->size_idx;
 	}
+
+	TRACE(TRACE_HEAP_POPULATE, TRACE_END, zone_id);
 }
 
 /*
@@ -337,21 +383,27 @@ heap_ensure_bucket_filled(PMEMobjpool *pop, struct bucket *b, int force)
 	if (!force && !bucket_is_empty(b))
 		return;
 
+	TRACE(TRACE_BUCKET_REFILL, TRACE_BEGIN, bucket_unit_size(b));
+	OBJ_STATS_ADD(pop, OBJ_STAT_BUCKET_REFILLS, 1);
+
 	if (!bucket_is_small(b)) {
 		/* not much to do here apart from using the next zone */
 		heap_populate_buckets(pop);
-		return;
+		goto out;
 	}
 
 	struct bucket *def_bucket = heap_get_default_bucket(pop);
 
 	struct memory_block m = {0, 0, 1, 0};
 	if (heap_get_bestfit_block(pop, def_bucket, &m) != 0)
-		return; /* OOM */
+		goto out; /* OOM */
 
 	ASSERT(m.block_off == 0);
 
 	heap_populate_run_bucket(pop, b, m.chunk_id, m.zone_id);
+
+out:
+	TRACE(TRACE_BUCKET_REFILL, TRACE_END, bucket_unit_size(b));
 }
 
 /*
@@ -372,13 +424,27 @@ heap_get_default_bucket(PMEMobjpool *pop)
 struct bucket *
 heap_get_best_bucket(PMEMobjpool *pop, size_t size)
 {
-	struct bucket *b = size < pop->heap->last_run_max_size ?
+	struct bucket *b = size <= pop->heap->last_run_max_size ?
 		pop->heap->bucket_map[size] :
 		pop->heap->buckets[DEFAULT_BUCKET];
 
 	return b;
 }
 
+/*
+ * heap_get_bucket_class -- returns the allocation class index of the bucket
+ */
+int
+heap_get_bucket_class(PMEMobjpool *pop, struct bucket *b)
+{
+	for (int i = 0; i < MAX_BUCKETS; ++i)
+		if (pop->heap->buckets[i] == b)
+			return i;
+
+	ASSERT(0);
+	return DEFAULT_BUCKET;
+}
+
 /*
  * heap_buckets_init -- (internal) initializes bucket instances
  */
@@ -413,7 +479,14 @@ heap_buckets_init(PMEMobjpool *pop)
 	h->last_run_max_size = bucket_proto[i - 1].unit_size *
 				(bucket_proto[i - 1].unit_max - 1);
 
-	h->bucket_map = Malloc(sizeof (*h->bucket_map) * h->last_run_max_size);
+	/*
+	 * The map includes last_run_max_size itself, the usable size of a block
+	 * with the maximum number of units of the last run bucket must resolve
+	 * to that bucket and not to the chunk one, otherwise the block would be
+	 * freed as a whole chunk.
+	 */
+	h->bucket_map = Malloc(sizeof (*h->bucket_map) *
+				(h->last_run_max_size + 1));
 	if (h->bucket_map == NULL)
 		goto error_bucket_map_malloc;
 
@@ -425,7 +498,7 @@ heap_buckets_init(PMEMobjpool *pop)
 	}
 
 	/* XXX better way to fill the bucket map */
-	for (i = 0; i < h->last_run_max_size; ++i) {
+	for (i = 0; i <= h->last_run_max_size; ++i) {
 		for (int j = 0; j < MAX_BUCKETS - 1; ++j) {
 			/*
 			 * Skip the last unit, so that the distribution
@@ -536,6 +609,149 @@ heap_get_bestfit_block(PMEMobjpool *pop, struct bucket *b,
 	return 0;
 }
 
+/*
+ * heap_same_block_header -- (internal) checks whether two run blocks are
+ *	described by the same bitmap value
+ */
+static int
+heap_same_block_header(struct memory_block a, struct memory_block b)
+{
+	return a.zone_id == b.zone_id && a.chunk_id == b.chunk_id &&
+		a.block_off / BITS_PER_VALUE == b.block_off / BITS_PER_VALUE;
+}
+
+/*
+ * heap_get_bestfit_blocks --
+ *	extracts up to *nblocks memory blocks of equal size index
+ *
+ * All the blocks are taken under a single bucket lock. The blocks are
+ * limited to those described by at most max_hdrs block headers, so that all
+ * of them can be published with a single redo log. Blocks of the chunk
+ * bucket are never batched. On return *nblocks contains the number of
+ * extracted blocks, which is at least one.
+ */
+int
+heap_get_bestfit_blocks(PMEMobjpool *pop, struct bucket *b,
+	struct memory_block *m, size_t *nblocks, size_t max_hdrs)
+{
+	ASSERTne(*nblocks, 0);
+	ASSERTne(max_hdrs, 0);
+
+	if (bucket_lock(b) != 0)
+		return EAGAIN;
+
+	int i;
+	uint32_t units = m[0].size_idx;
+	for (i = 0; i < MAX_BUCKET_REFILL; ++i) {
+		if (bucket_get_rm_block_bestfit(b, &m[0]) != 0)
+			heap_ensure_bucket_filled(pop, b, 1);
+		else
+			break;
+	}
+
+	if (i == MAX_BUCKET_REFILL) {
+		bucket_unlock(b);
+		return ENOMEM;
+	}
+
+	if (units != m[0].size_idx)
+		heap_recycle_block(pop, b, &m[0], units);
+
+	size_t n = 1;
+	size_t nhdrs = 1;
+	while (bucket_is_small(b) && n < *nblocks) {
+		struct memory_block next = {0, 0, units, 0};
+		if (bucket_get_rm_block_bestfit(b, &next) != 0)
+			break;
+
+		size_t j;
+		for (j = 0; j < n; ++j)
+			if (heap_same_block_header(m[j], next))
+				break;
+
+		if (j == n && nhdrs == max_hdrs) {
+			bucket_insert_block(b, next);
+			break;
+		}
+
+		if (j == n)
+			nhdrs++;
+
+		if (units != next.size_idx)
+			heap_recycle_block(pop, b, &next, units);
+
+		m[n++] = next;
+	}
+
+	bucket_unlock(b);
+
+	*nblocks = n;
+
+	return 0;
+}
+
+/*
+ * heap_lock_runs -- acquire the run locks of all the memory blocks
+ *
+ * The locks are taken in the order of their position in the lock array, so
+ * two threads locking overlapping sets of runs cannot deadlock.
+ */
+int
+heap_lock_runs(PMEMobjpool *pop, struct memory_block *m, size_t n)
+{
+	uint8_t locked[MAX_RUN_LOCKS] = {0};
+	int err = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		struct chunk_header *hdr = &pop->heap->layout->
+			zones[m[i].zone_id].chunk_headers[m[i].chunk_id];
+		if (hdr->type == CHUNK_TYPE_RUN)
+			locked[m[i].chunk_id % MAX_RUN_LOCKS] = 1;
+	}
+
+	int l;
+	for (l = 0; l < MAX_RUN_LOCKS; ++l) {
+		if (!locked[l])
+			continue;
+
+		if ((err = pthread_mutex_lock(&pop->heap->run_locks[l])) != 0)
+			break;
+	}
+
+	if (err) {
+		while (--l >= 0)
+			if (locked[l])
+				pthread_mutex_unlock(&pop->heap->run_locks[l]);
+	}
+
+	return err;
+}
+
+/*
+ * heap_unlock_runs -- release the run locks of all the memory blocks
+ */
+int
+heap_unlock_runs(PMEMobjpool *pop, struct memory_block *m, size_t n)
+{
+	uint8_t locked[MAX_RUN_LOCKS] = {0};
+	int err = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		struct chunk_header *hdr = &pop->heap->layout->
+			zones[m[i].zone_id].chunk_headers[m[i].chunk_id];
+		if (hdr->type == CHUNK_TYPE_RUN)
+			locked[m[i].chunk_id % MAX_RUN_LOCKS] = 1;
+	}
+
+	for (int l = 0; l < MAX_RUN_LOCKS; ++l) {
+		if (locked[l] &&
+			pthread_mutex_unlock(&pop->heap->run_locks[l]) != 0)
+			err = EINVAL;
+	}
+
+	return err;
+}
+
 /*
  * heap_get_exact_block --
  *	extracts exactly this memory block and cuts it accordingly
@@ -547,8 +763,79 @@ heap_get_exact_block(PMEMobjpool *pop, struct bucket *b,
 	if (bucket_lock(b) != 0)
 		return EAGAIN;
 
-	if (bucket_get_rm_block_exact(b, *m) != 0)
+	if (bucket_get_rm_block_exact(b, *m) != 0) {
+		bucket_unlock(b);
 		return ENOMEM;
+	}
+
+	if (units != m->size_idx)
+		heap_recycle_block(pop, b, m, units);
+
+	bucket_unlock(b);
+
+	return 0;
+}
+
+/*
+ * heap_get_next_chunks --
+ *	extracts the free chunks that directly follow the chunk block and cuts
+ *	them to the given number of units
+ *
+ * The free space behind a chunk can be described by more than one free chunk
+ * header, in which case all of them are merged into a single free chunk. This
+ * doesn't require a redo log because the merged chunks are already free.
+ */
+int
+heap_get_next_chunks(PMEMobjpool *pop, struct bucket *b,
+	struct memory_block cnt, struct memory_block *m, uint32_t units)
+{
+	struct zone *z = &pop->heap->layout->zones[cnt.zone_id];
+	struct chunk_header *hdr = &z->chunk_headers[cnt.chunk_id];
+	ASSERT(hdr->type != CHUNK_TYPE_RUN);
+
+	if (bucket_lock(b) != 0)
+		return EAGAIN;
+
+	struct memory_block next = {cnt.chunk_id + hdr->size_idx,
+		cnt.zone_id, 0, 0};
+	m->chunk_id = next.chunk_id;
+	m->zone_id = cnt.zone_id;
+	m->size_idx = 0;
+	m->block_off = 0;
+
+	int nchunks = 0;
+	while (m->size_idx < units && next.chunk_id < z->header.size_idx) {
+		struct chunk_header *nhdr = &z->chunk_headers[next.chunk_id];
+		if (nhdr->type != CHUNK_TYPE_FREE)
+			break;
+
+		next.size_idx = nhdr->size_idx;
+		if (bucket_get_rm_block_exact(b, next) != 0)
+			break;
+
+		m->size_idx += next.size_idx;
+		next.chunk_id += next.size_idx;
+		nchunks++;
+	}
+
+	if (m->size_idx < units) {
+		/* the headers weren't modified, put the chunks back */
+		next.chunk_id = m->chunk_id;
+		while (nchunks-- != 0) {
+			next.size_idx =
+				z->chunk_headers[next.chunk_id].size_idx;
+			if (bucket_insert_block(b, next) != 0)
+				ERR("Failed to update heap volatile state");
+			next.chunk_id += next.size_idx;
+		}
+
+		bucket_unlock(b);
+		return ENOMEM;
+	}
+
+	if (nchunks > 1)
+		heap_chunk_init(pop, &z->chunk_headers[m->chunk_id],
+			CHUNK_TYPE_FREE, m->size_idx);
 
 	if (units != m->size_idx)
 		heap_recycle_block(pop, b, m, units);
@@ -860,6 +1147,10 @@ heap_degrade_run_if_empty(PMEMobjpool *pop, struct bucket *b,
 	m.size_idx = 1;
 	heap_chunk_init(pop, hdr, CHUNK_TYPE_FREE, m.size_idx);
 
+	/* the run is gone only once its chunk header says so */
+	bucket_add_runs(b, -1);
+	OBJ_STATS_ADD(pop, OBJ_STAT_RUN_DEGRADATIONS, 1);
+
 	uint64_t *mhdr;
 	uint64_t op_result;
 	struct memory_block fm =
@@ -867,7 +1158,10 @@ heap_degrade_run_if_empty(PMEMobjpool *pop, struct bucket *b,
 	VALGRIND_ADD_TO_TX(mhdr, sizeof (*mhdr));
 	*mhdr = op_result;
 	VALGRIND_REMOVE_FROM_TX(mhdr, sizeof (*mhdr));
-	pop->persist(mhdr, sizeof (*mhdr));
+
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+	pop->persist(pop, mhdr, sizeof (*mhdr));
+	pmem_stats_set_context(ctx);
 
 	if ((err = bucket_insert_block(defb, fm)) != 0) {
 		ERR("Failed to update heap volatile state");
@@ -884,6 +1178,110 @@ out:
 	return err;
 }
 
+/*
+ * heap_get_stats -- fills the heap occupancy statistics
+ *
+ * The counters are read without taking the bucket locks, so the result is
+ * only a snapshot. Zones not yet processed by the allocator are not counted.
+ * Chunks turned into runs belong to the run buckets, the default bucket only
+ * counts the free and used chunks.
+ */
+void
+heap_get_stats(PMEMobjpool *pop, struct pobj_heap_stats *stats)
+{
+	struct pmalloc_heap *h = pop->heap;
+
+	ASSERT(MAX_BUCKETS <= PMEMOBJ_MAX_ALLOC_CLASSES);
+	memset(stats, 0, sizeof (*stats));
+	stats->heap_size = pop->heap_size;
+	stats->nzones = h->max_zone;
+	stats->nzones_processed = h->zones_exhausted;
+	stats->nclasses = MAX_BUCKETS;
+
+	uint64_t nchunks = 0;
+	for (int i = 0; i < h->zones_exhausted; ++i) {
+		struct zone *z = &h->layout->zones[h->zone_order[i]];
+		for (uint32_t c = 0; c < z->header.size_idx; ) {
+			struct chunk_header *hdr = &z->chunk_headers[c];
+			uint32_t size_idx = hdr->size_idx;
+			/* a header being rewritten concurrently */
+			if (size_idx == 0)
+				size_idx = 1;
+
+			if (hdr->type == CHUNK_TYPE_FREE ||
+					hdr->type == CHUNK_TYPE_USED)
+				nchunks += size_idx;
+
+			c += size_idx;
+		}
+	}
+
+	for (int i = 0; i < MAX_BUCKETS; ++i) {
+		struct bucket *b = h->buckets[i];
+		struct pobj_alloc_class_stats *c = &stats->classes[i];
+
+		c->unit_size = bucket_unit_size(b);
+		c->free_units = bucket_nfree_units(b);
+		c->free_blocks = bucket_nfree_blocks(b);
+		if (bucket_is_small(b)) {
+			c->nruns = bucket_nruns(b);
+			c->units = c->nruns * bucket_bitmap_nallocs(b);
+		} else {
+			c->units = nchunks;
+		}
+	}
+}
+
+/*
+ * heap_zone_part -- (internal) returns the pool set part the zone starts in
+ */
+static unsigned
+heap_zone_part(PMEMobjpool *pop, struct heap_layout *layout, uint32_t zone_id)
+{
+	struct pool_set *set = pop->set;
+	if (set == NULL)
+		return 0;
+
+	uintptr_t zone = (uintptr_t)&layout->zones[zone_id];
+	unsigned p;
+	for (p = set->nparts - 1; p > 0; --p)
+		if (zone >= (uintptr_t)set->part[p].addr)
+			break;
+
+	return p;
+}
+
+/*
+ * heap_zones_interleave -- (internal) orders the zones round-robin across
+ *	the parts of the pool set
+ *
+ * Zones are processed one at a time, when the previous ones run out of
+ * memory, so with the natural order a pool set would fill its parts one
+ * after another.  Taking the zones from each part in turn spreads the
+ * allocations over all the devices of the set.
+ */
+static void
+heap_zones_interleave(PMEMobjpool *pop, struct pmalloc_heap *h)
+{
+	unsigned nparts = pop->set ? pop->set->nparts : 1;
+
+	int n = 0;
+	for (int round = 0; n < h->max_zone; ++round) {
+		for (unsigned p = 0; p < nparts; ++p) {
+			int k = 0;
+			for (int z = 0; z < h->max_zone; ++z) {
+				if (heap_zone_part(pop, h->layout, z) != p)
+					continue;
+
+				if (k++ == round) {
+					h->zone_order[n++] = z;
+					break;
+				}
+			}
+		}
+	}
+}
+
 /*
  * heap_boot -- opens the heap region of the pmemobj pool
  *
@@ -902,6 +1300,15 @@ heap_boot(PMEMobjpool *pop)
 	h->max_zone = heap_max_zone(pop->heap_size);
 	h->zones_exhausted = 0;
 	h->layout = heap_get_layout(pop);
+
+	h->zone_order = Malloc(h->max_zone * sizeof (*h->zone_order));
+	if (h->zone_order == NULL) {
+		err = ENOMEM;
+		goto error_zone_order_malloc;
+	}
+
+	heap_zones_interleave(pop, h);
+
 	for (int i = 0; i < MAX_RUN_LOCKS; ++i)
 		if ((err = pthread_mutex_init(&h->run_locks[i], NULL)) != 0)
 			goto error_run_lock_init;
@@ -916,6 +1323,8 @@ heap_boot(PMEMobjpool *pop)
 error_buckets_init:
 	/* there's really no point in destroying the locks */
 error_run_lock_init:
+	Free(h->zone_order);
+error_zone_order_malloc:
 	Free(h);
 	pop->heap = NULL;
 error_heap_malloc:
@@ -990,6 +1399,7 @@ heap_cleanup(PMEMobjpool *pop)
 		pthread_mutex_destroy(&pop->heap->run_locks[i]);
 
 	Free(pop->heap->bucket_map);
+	Free(pop->heap->zone_order);
 
 	Free(pop->heap);
 
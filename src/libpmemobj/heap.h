@@ -54,6 +54,7 @@ struct memory_block {
 
 struct bucket *heap_get_best_bucket(PMEMobjpool *pop, size_t size);
 struct bucket *heap_get_default_bucket(PMEMobjpool *pop);
+int heap_get_bucket_class(PMEMobjpool *pop, struct bucket *b);
 void *heap_get_block_data(PMEMobjpool *pop, struct memory_block m);
 void *heap_get_block_header(PMEMobjpool *pop, struct memory_block m,
 	enum heap_op op, uint64_t *op_result);
@@ -69,8 +70,14 @@ int heap_unlock_if_run(PMEMobjpool *pop, struct memory_block m);
 
 int heap_get_bestfit_block(PMEMobjpool *pop, struct bucket *b,
 	struct memory_block *m);
+int heap_get_bestfit_blocks(PMEMobjpool *pop, struct bucket *b,
+	struct memory_block *m, size_t *nblocks, size_t max_hdrs);
+int heap_lock_runs(PMEMobjpool *pop, struct memory_block *m, size_t n);
+int heap_unlock_runs(PMEMobjpool *pop, struct memory_block *m, size_t n);
 int heap_get_exact_block(PMEMobjpool *pop, struct bucket *b,
 	struct memory_block *m, uint32_t new_size_idx);
+int heap_get_next_chunks(PMEMobjpool *pop, struct bucket *b,
+	struct memory_block cnt, struct memory_block *m, uint32_t units);
 int heap_degrade_run_if_empty(PMEMobjpool *pop, struct bucket *b,
 	struct memory_block m);
 
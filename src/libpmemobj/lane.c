@@ -45,6 +45,7 @@
 #include <stdint.h>
 #include <pthread.h>
 
+#include "libpmem.h"
 #include "libpmemobj.h"
 #include "lane.h"
 #include "util.h"
@@ -52,11 +53,32 @@
 #include "redo.h"
 #include "list.h"
 #include "obj.h"
+#include "trace.h"
+#include "stats.h"
 #include "valgrind_internal.h"
 
 static __thread int lane_idx = -1;
 static int next_lane_idx = 0;
 
+/*
+ * While a thread holds a lane section, its flushes are charged to the
+ * libpmem statistics context of the section.  The sections are held in a
+ * nested way (an allocation inside a transaction), the contexts they replaced
+ * are stacked here and restored by lane_release().
+ */
+#define	LANE_STATS_MAX_DEPTH 8
+
+static const unsigned lane_stats_ctx[MAX_LANE_SECTION] = {
+	[LANE_SECTION_ALLOCATOR] = PMEMOBJ_STATS_HEAP,
+	[LANE_SECTION_LIST] = PMEMOBJ_STATS_LIST,
+	[LANE_SECTION_TRANSACTION] = PMEMOBJ_STATS_TX,
+};
+
+static __thread struct {
+	unsigned depth;
+	unsigned prev[LANE_STATS_MAX_DEPTH];
+} lane_stats;
+
 struct section_operations *section_ops[MAX_LANE_SECTION];
 
 /*
@@ -293,11 +315,27 @@ lane_hold(PMEMobjpool *pop, struct lane_section **section,
 
 	struct lane *lane = &pop->lanes[lane_idx % pop->nlanes];
 
-	if ((err = pthread_mutex_lock(lane->lock)) != 0)
+	TRACE(TRACE_LANE_WAIT, TRACE_BEGIN, lane - pop->lanes);
+	if ((err = pthread_mutex_trylock(lane->lock)) == EBUSY) {
+		OBJ_STATS_ADD(pop, OBJ_STAT_LANE_CONTENDED, 1);
+		err = pthread_mutex_lock(lane->lock);
+	}
+	if (err != 0) {
 		ERR("!pthread_mutex_lock");
+		TRACE(TRACE_LANE_WAIT, TRACE_END, lane - pop->lanes);
+		return err;
+	}
+	TRACE(TRACE_LANE_WAIT, TRACE_END, lane - pop->lanes);
+	OBJ_STATS_ADD(pop, OBJ_STAT_LANE_HOLDS, 1);
+	TRACE(TRACE_LANE_HOLD, TRACE_BEGIN, lane - pop->lanes);
 
 	*section = &lane->sections[type];
 
+	unsigned prev = pmem_stats_set_context(lane_stats_ctx[type]);
+	if (lane_stats.depth < LANE_STATS_MAX_DEPTH)
+		lane_stats.prev[lane_stats.depth] = prev;
+	lane_stats.depth++;
+
 	return err;
 }
 
@@ -314,6 +352,12 @@ lane_release(PMEMobjpool *pop)
 
 	struct lane *lane = &pop->lanes[lane_idx % pop->nlanes];
 
+	ASSERTne(lane_stats.depth, 0);
+	lane_stats.depth--;
+	if (lane_stats.depth < LANE_STATS_MAX_DEPTH)
+		pmem_stats_set_context(lane_stats.prev[lane_stats.depth]);
+
+	TRACE(TRACE_LANE_HOLD, TRACE_END, lane - pop->lanes);
 	if ((err = pthread_mutex_unlock(lane->lock)) != 0)
 		ERR("!pthread_mutex_unlock");
 
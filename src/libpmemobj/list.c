@@ -47,6 +47,7 @@
 #include "util.h"
 #include "obj.h"
 #include "out.h"
+#include "trace.h"
 #include "valgrind_internal.h"
 
 #define	PREV_OFF (offsetof(struct list_entry, pe_prev) + offsetof(PMEMoid, off))
@@ -55,6 +56,12 @@
 #define	OOB_ENTRY_OFF_REV \
 ((ssize_t)offsetof(struct oob_header, oob) - OBJ_OOB_SIZE)
 
+/* maximum number of objects allocated by a single list_insert_new_n pass */
+#define	LIST_NEW_N_MAX 256
+
+/* number of redo log entries needed to link a chain into an oob list */
+#define	LIST_OOB_CHAIN_REDO 2
+
 /*
  * list_args_common -- common arguments for operations on list
  *
@@ -367,7 +374,7 @@ list_fill_entry_persist(PMEMobjpool *pop, struct list_entry *entry_ptr,
 	entry_ptr->pe_prev.off = prev_offset;
 	VALGRIND_REMOVE_FROM_TX(entry_ptr, sizeof (*entry_ptr));
 
-	pop->persist(entry_ptr, sizeof (*entry_ptr));
+	pop->persist(pop, entry_ptr, sizeof (*entry_ptr));
 }
 
 /*
@@ -400,7 +407,7 @@ list_fill_entry_redo_log(PMEMobjpool *pop,
 		VALGRIND_REMOVE_FROM_TX(
 				&(args->entry_ptr->pe_prev.pool_uuid_lo),
 				sizeof (args->entry_ptr->pe_prev.pool_uuid_lo));
-		pop->persist(args->entry_ptr, sizeof (*args->entry_ptr));
+		pop->persist(pop, args->entry_ptr, sizeof (*args->entry_ptr));
 	} else {
 		ASSERTeq(args->entry_ptr->pe_next.pool_uuid_lo, pop->uuid_lo);
 		ASSERTeq(args->entry_ptr->pe_prev.pool_uuid_lo, pop->uuid_lo);
@@ -560,25 +567,28 @@ list_insert_user(PMEMobjpool *pop,
 }
 
 /*
- * list_insert_oob -- (internal) inserting element to oob list
+ * list_insert_oob_chain -- (internal) inserting chain of elements to oob list
  *
- * This function inserts the element at the last position always.
+ * The chain starts at first_offset and ends at last_offset, this function
+ * only links its ends with the list, the caller fills the entries of the
+ * chain. The chain is inserted at the last position always.
  */
 static size_t
-list_insert_oob(PMEMobjpool *pop, struct redo_log *redo, size_t redo_index,
-	struct list_head *oob_head, uint64_t obj_offset,
+list_insert_oob_chain(PMEMobjpool *pop, struct redo_log *redo,
+	size_t redo_index, struct list_head *oob_head,
+	uint64_t first_offset, uint64_t last_offset,
 	uint64_t *next_offset, uint64_t *prev_offset)
 {
 	if (oob_head->pe_first.off == 0) {
-		/* inserting the first element */
+		/* inserting the first elements */
 
-		/* set loop on current element */
-		*next_offset = obj_offset;
-		*prev_offset = obj_offset;
+		/* set loop on current chain */
+		*next_offset = first_offset;
+		*prev_offset = last_offset;
 
 		/* update head */
 		redo_index = list_update_head(pop, redo, redo_index,
-				oob_head, obj_offset);
+				oob_head, first_offset);
 
 		return redo_index;
 	} else {
@@ -588,7 +598,7 @@ list_insert_oob(PMEMobjpool *pop, struct redo_log *redo, size_t redo_index,
 					oob_head->pe_first.off -
 					OBJ_OOB_SIZE + OOB_ENTRY_OFF);
 
-		/* current->next = first and current->prev = first->prev */
+		/* last->next = first and first_chain->prev = first->prev */
 		*next_offset = oob_head->pe_first.off;
 		*prev_offset = first_ptr->pe_prev.off;
 
@@ -598,14 +608,28 @@ list_insert_oob(PMEMobjpool *pop, struct redo_log *redo, size_t redo_index,
 				OBJ_OOB_SIZE + OOB_ENTRY_OFF + NEXT_OFF;
 
 		redo_log_store(pop, redo, redo_index + 0,
-				first_prev_off, obj_offset);
+				first_prev_off, last_offset);
 		redo_log_store(pop, redo, redo_index + 1,
-				first_prev_next_off, obj_offset);
+				first_prev_next_off, first_offset);
 
 		return redo_index + 2;
 	}
 }
 
+/*
+ * list_insert_oob -- (internal) inserting element to oob list
+ *
+ * This function inserts the element at the last position always.
+ */
+static size_t
+list_insert_oob(PMEMobjpool *pop, struct redo_log *redo, size_t redo_index,
+	struct list_head *oob_head, uint64_t obj_offset,
+	uint64_t *next_offset, uint64_t *prev_offset)
+{
+	return list_insert_oob_chain(pop, redo, redo_index, oob_head,
+			obj_offset, obj_offset, next_offset, prev_offset);
+}
+
 /*
  * list_realloc_replace -- (internal) realloc and replace element
  */
@@ -643,7 +667,7 @@ list_realloc_replace(PMEMobjpool *pop,
 	 * Persist the copied and modified data. The caller
 	 * is responsible to persist modified data in extended area.
 	 */
-	pop->persist(OBJ_OFF_TO_PTR(pop, new_obj_offset), old_size);
+	pop->persist(pop, OBJ_OFF_TO_PTR(pop, new_obj_offset), old_size);
 
 	if (head) {
 		struct list_entry *entry_ptr =
@@ -714,28 +738,11 @@ list_insert_new(PMEMobjpool *pop, struct list_head *oob_head,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_INSERT_NEW, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
 
-	/*
-	 * In case of oob list and user list grab the oob list lock
-	 * first.
-	 *
-	 * XXX performance improvement: initialize oob locks at pool opening
-	 */
-	if ((ret = pmemobj_mutex_lock(pop, &oob_head->lock))) {
-		LOG(2, "pmemobj_mutex_lock failed");
-		goto err_oob_lock;
-	}
-
-	if (head) {
-		if ((ret = pmemobj_mutex_lock(pop, &head->lock))) {
-			LOG(2, "pmemobj_mutex_lock failed");
-			goto err_lock;
-		}
-	}
-
 	/* increase allocation size by oob header size */
 	size += OBJ_OOB_SIZE;
 	struct lane_list_section *section =
@@ -744,6 +751,13 @@ list_insert_new(PMEMobjpool *pop, struct list_head *oob_head,
 	size_t redo_index = 0;
 	uint64_t sec_off_off = OBJ_PTR_TO_OFF(pop, &section->obj_offset);
 
+	/*
+	 * The object is allocated before grabbing the list locks. Until it
+	 * is linked and the obj_offset is cleared by the redo log below, the
+	 * object belongs to the lane and it is freed by the lane recovery,
+	 * so the heap operation does not have to serialize with other
+	 * operations on the same list.
+	 */
 	if (constructor) {
 		if ((errno = pmalloc_construct(pop,
 				&section->obj_offset, size,
@@ -761,6 +775,24 @@ list_insert_new(PMEMobjpool *pop, struct list_head *oob_head,
 		}
 	}
 
+	/*
+	 * In case of oob list and user list grab the oob list lock
+	 * first.
+	 *
+	 * XXX performance improvement: initialize oob locks at pool opening
+	 */
+	if ((ret = pmemobj_mutex_lock(pop, &oob_head->lock))) {
+		LOG(2, "pmemobj_mutex_lock failed");
+		goto err_oob_lock;
+	}
+
+	if (head) {
+		if ((ret = pmemobj_mutex_lock(pop, &head->lock))) {
+			LOG(2, "pmemobj_mutex_lock failed");
+			goto err_lock;
+		}
+	}
+
 	uint64_t obj_offset = section->obj_offset;
 	uint64_t obj_doffset = obj_offset + OBJ_OOB_SIZE;
 
@@ -849,7 +881,6 @@ err_redolog:
 	redo_log_process(pop, redo, REDO_NUM_ENTRIES);
 
 	ret = 0;
-err_pmalloc:
 	if (head) {
 		out_ret = pmemobj_mutex_unlock(pop, &head->lock);
 		ASSERTeq(out_ret, 0);
@@ -862,6 +893,13 @@ err_lock:
 	if (out_ret)
 		LOG(2, "pmemobj_mutex_unlock failed");
 err_oob_lock:
+	if (ret && section->obj_offset) {
+		/* the object has not been linked */
+		if ((errno = pfree(pop, &section->obj_offset)))
+			ERR("!pfree");
+	}
+err_pmalloc:
+	TRACE(TRACE_LIST_INSERT_NEW, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -870,6 +908,165 @@ err_oob_lock:
 	return ret;
 }
 
+/*
+ * list_insert_new_n_pass -- (internal) allocate a chain of up to *n elements
+ *	and insert it to oob list
+ *
+ * The blocks are reserved from the heap, constructed and linked into a
+ * chain without logging, because nothing refers to them yet. The chain is
+ * then made allocated and linked with the list by a single redo log. On
+ * return *n contains the number of inserted elements.
+ */
+static int
+list_insert_new_n_pass(PMEMobjpool *pop, struct list_head *oob_head,
+	size_t size, size_t *n, void (*constructor)(PMEMobjpool *pop, void *ptr,
+	void *arg), void *arg, PMEMoid *oids)
+{
+	int ret;
+	int out_ret;
+
+	struct lane_section *lane_section;
+
+	if ((ret = lane_hold(pop, &lane_section, LANE_SECTION_LIST))) {
+		LOG(2, "lane_hold failed");
+		return ret;
+	}
+	TRACE(TRACE_LIST_INSERT_NEW, TRACE_BEGIN, 0);
+
+	ASSERTne(lane_section, NULL);
+	ASSERTne(lane_section->layout, NULL);
+
+	struct lane_list_section *section =
+		(struct lane_list_section *)lane_section->layout;
+	struct redo_log *redo = section->redo;
+	size_t redo_index = 0;
+
+	uint64_t offs[LIST_NEW_N_MAX];
+	if (*n > LIST_NEW_N_MAX)
+		*n = LIST_NEW_N_MAX;
+
+	if ((errno = pmalloc_reserve(pop, offs, n, size + OBJ_OOB_SIZE,
+			REDO_NUM_ENTRIES - LIST_OOB_CHAIN_REDO))) {
+		ERR("!pmalloc_reserve");
+		ret = -1;
+		goto err_reserve;
+	}
+
+	if (constructor) {
+		for (size_t i = 0; i < *n; ++i)
+			constructor(pop, OBJ_OFF_TO_PTR(pop,
+				offs[i] + OBJ_OOB_SIZE), arg);
+	}
+
+	if ((ret = pmemobj_mutex_lock(pop, &oob_head->lock))) {
+		LOG(2, "pmemobj_mutex_lock failed");
+		goto err_oob_lock;
+	}
+
+	uint64_t first_doffset = offs[0] + OBJ_OOB_SIZE;
+	uint64_t last_doffset = offs[*n - 1] + OBJ_OOB_SIZE;
+	uint64_t oob_next_off;
+	uint64_t oob_prev_off;
+
+	/* insert chain to oob list */
+	redo_index = list_insert_oob_chain(pop, redo, redo_index, oob_head,
+			first_doffset, last_doffset,
+			&oob_next_off, &oob_prev_off);
+
+	/* don't need to use redo log for filling new elements */
+	for (size_t i = 0; i < *n; ++i) {
+		struct list_entry *entry_ptr =
+			(struct list_entry *)OBJ_OFF_TO_PTR(pop,
+				offs[i] + OOB_ENTRY_OFF);
+
+		VALGRIND_ADD_TO_TX(entry_ptr, sizeof (*entry_ptr));
+		entry_ptr->pe_next.pool_uuid_lo = pop->uuid_lo;
+		entry_ptr->pe_next.off = i == *n - 1 ? oob_next_off :
+			offs[i + 1] + OBJ_OOB_SIZE;
+		entry_ptr->pe_prev.pool_uuid_lo = pop->uuid_lo;
+		entry_ptr->pe_prev.off = i == 0 ? oob_prev_off :
+			offs[i - 1] + OBJ_OOB_SIZE;
+		VALGRIND_REMOVE_FROM_TX(entry_ptr, sizeof (*entry_ptr));
+
+		pop->flush(pop, entry_ptr, sizeof (*entry_ptr));
+	}
+
+	pop->drain(pop);
+
+	if ((errno = pmalloc_publish(pop, redo, &redo_index, offs, *n))) {
+		ERR("!pmalloc_publish");
+		ret = -1;
+		goto err_publish;
+	}
+
+	ASSERT(redo_index <= REDO_NUM_ENTRIES);
+	redo_log_set_last(pop, redo, redo_index - 1);
+	redo_log_process(pop, redo, REDO_NUM_ENTRIES);
+
+	pmalloc_publish_end(pop, offs, *n);
+
+	for (size_t i = 0; i < *n; ++i) {
+		oids[i].off = offs[i] + OBJ_OOB_SIZE;
+		oids[i].pool_uuid_lo = pop->uuid_lo;
+	}
+
+err_publish:
+	out_ret = pmemobj_mutex_unlock(pop, &oob_head->lock);
+	ASSERTeq(out_ret, 0);
+	if (out_ret)
+		LOG(2, "pmemobj_mutex_unlock failed");
+err_oob_lock:
+	if (ret)
+		pmalloc_cancel(pop, offs, *n);
+err_reserve:
+	TRACE(TRACE_LIST_INSERT_NEW, TRACE_END, 0);
+	out_ret = lane_release(pop);
+	ASSERTeq(out_ret, 0);
+	if (out_ret)
+		LOG(2, "lane_release failed");
+
+	return ret;
+}
+
+/*
+ * list_insert_new_n -- allocate n elements and insert them to oob list
+ *
+ * pop         - pmemobj pool handle
+ * oob_head    - oob list head
+ * size        - size of each allocation, will be increased by OBJ_OOB_SIZE
+ * n           - number of elements
+ * constructor - objects' constructor
+ * arg         - argument for objects' constructor
+ * oids        - array of n target object IDs, must not be persistent
+ *
+ * The elements are allocated in passes, each of which takes the lane, the
+ * bucket and the list lock once and is published by a single redo log.
+ * If a pass fails, the elements inserted by previous ones stay on the list
+ * and the remaining object IDs are left untouched.
+ */
+int
+list_insert_new_n(PMEMobjpool *pop, struct list_head *oob_head,
+	size_t size, size_t n, void (*constructor)(PMEMobjpool *pop, void *ptr,
+	void *arg), void *arg, PMEMoid *oids)
+{
+	LOG(3, NULL);
+	ASSERTne(oob_head, NULL);
+	ASSERTne(oids, NULL);
+
+	while (n != 0) {
+		size_t nalloc = n;
+		int ret = list_insert_new_n_pass(pop, oob_head, size, &nalloc,
+				constructor, arg, oids);
+		if (ret)
+			return ret;
+
+		oids += nalloc;
+		n -= nalloc;
+	}
+
+	return 0;
+}
+
 /*
  * list_insert -- insert object to a single list
  *
@@ -898,6 +1095,7 @@ list_insert(PMEMobjpool *pop,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_INSERT, TRACE_BEGIN, 0);
 
 	if ((ret = pmemobj_mutex_lock(pop, &head->lock))) {
 		LOG(2, "pmemobj_mutex_lock failed");
@@ -956,6 +1154,7 @@ list_insert(PMEMobjpool *pop,
 	if (out_ret)
 		LOG(2, "pmemobj_mutex_unlock failed");
 err:
+	TRACE(TRACE_LIST_INSERT, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -997,6 +1196,7 @@ list_remove_free_eap(PMEMobjpool *pop, struct list_head *oob_head,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_REMOVE_FREE, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1123,6 +1323,7 @@ err_lock:
 	if (out_ret)
 		LOG(2, "pmemobj_mutex_unlock failed");
 err_oob_lock:
+	TRACE(TRACE_LIST_REMOVE_FREE, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1163,6 +1364,7 @@ list_remove_free(PMEMobjpool *pop, struct list_head *oob_head,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_REMOVE_FREE, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1246,9 +1448,27 @@ eap_goto_free:
 
 	redo_log_process(pop, redo, REDO_NUM_ENTRIES);
 
+	if (head) {
+		out_ret = pmemobj_mutex_unlock(pop, &head->lock);
+		ASSERTeq(out_ret, 0);
+		if (out_ret)
+			LOG(2, "pmemobj_mutex_unlock failed");
+	}
+err_lock:
+	out_ret = pmemobj_mutex_unlock(pop, &oob_head->lock);
+	ASSERTeq(out_ret, 0);
+	if (out_ret)
+		LOG(2, "pmemobj_mutex_unlock failed");
+
+	if (ret)
+		goto err_oob_lock;
+
 	/*
 	 * Don't need to fill next and prev offsets of removing element
 	 * because the element is freed.
+	 *
+	 * The object is already unlinked and until it is freed it belongs
+	 * to the lane, so the list locks are not held for the heap operation.
 	 */
 #if defined(_DISABLE_LOGGING) || defined(_EAP_FLUSH_ONLY)
 	if(tx_is_relaxedlog()) {
@@ -1262,22 +1482,10 @@ eap_goto_free:
 #endif
 		ERR("!pfree");
 		ret = -1;
-	} else {
-		ret = 0;
 	}
 
-	if (head) {
-		out_ret = pmemobj_mutex_unlock(pop, &head->lock);
-		ASSERTeq(out_ret, 0);
-		if (out_ret)
-			LOG(2, "pmemobj_mutex_unlock failed");
-	}
-err_lock:
-	out_ret = pmemobj_mutex_unlock(pop, &oob_head->lock);
-	ASSERTeq(out_ret, 0);
-	if (out_ret)
-		LOG(2, "pmemobj_mutex_unlock failed");
 err_oob_lock:
+	TRACE(TRACE_LIST_REMOVE_FREE, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1311,6 +1519,7 @@ list_remove(PMEMobjpool *pop,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_REMOVE, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1359,6 +1568,7 @@ list_remove(PMEMobjpool *pop,
 	if (out_ret)
 		LOG(2, "pmemobj_mutex_unlock failed");
 err:
+	TRACE(TRACE_LIST_REMOVE, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1393,6 +1603,7 @@ list_move_oob(PMEMobjpool *pop,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_MOVE_OOB, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1456,6 +1667,7 @@ list_move_oob(PMEMobjpool *pop,
 	if (out_ret)
 		LOG(2, "list_mutexes_unlock failed");
 err:
+	TRACE(TRACE_LIST_MOVE_OOB, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1495,6 +1707,7 @@ list_move(PMEMobjpool *pop,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_MOVE, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1575,6 +1788,7 @@ list_move(PMEMobjpool *pop,
 	if (out_ret)
 		LOG(2, "list_mutexes_unlock failed");
 err:
+	TRACE(TRACE_LIST_MOVE, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1618,6 +1832,7 @@ list_realloc(PMEMobjpool *pop, struct list_head *oob_head,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_REALLOC, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1663,10 +1878,10 @@ list_realloc(PMEMobjpool *pop, struct list_head *oob_head,
 	 * 6. Process the redo log.
 	 */
 	section->obj_size = old_size;
-	pop->persist(&section->obj_size, sizeof (section->obj_size));
+	pop->persist(pop, &section->obj_size, sizeof (section->obj_size));
 
 	section->obj_offset = obj_offset;
-	pop->persist(&section->obj_offset, sizeof (section->obj_offset));
+	pop->persist(pop, &section->obj_offset, sizeof (section->obj_offset));
 
 	/*
 	 * The user must be aware that any changes in
@@ -1697,11 +1912,12 @@ list_realloc(PMEMobjpool *pop, struct list_head *oob_head,
 		 * If realloc in-place failed clear the obj_offset and obj_size.
 		 */
 		section->obj_offset = 0;
-		pop->persist(&section->obj_offset,
+		pop->persist(pop, &section->obj_offset,
 				sizeof (section->obj_offset));
 
 		section->obj_size = 0;
-		pop->persist(&section->obj_size, sizeof (section->obj_size));
+		pop->persist(pop, &section->obj_size,
+			sizeof (section->obj_size));
 
 		/*
 		 * Realloc in place is not possible so we need to perform
@@ -1801,6 +2017,7 @@ err_lock:
 	if (out_ret)
 		LOG(2, "pmemobj_mutex_unlock failed");
 err_oob_lock:
+	TRACE(TRACE_LIST_REALLOC, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -1846,6 +2063,7 @@ list_realloc_move(PMEMobjpool *pop, struct list_head *oob_head_old,
 		LOG(2, "lane_hold failed");
 		return ret;
 	}
+	TRACE(TRACE_LIST_REALLOC_MOVE, TRACE_BEGIN, 0);
 
 	ASSERTne(lane_section, NULL);
 	ASSERTne(lane_section->layout, NULL);
@@ -1895,10 +2113,10 @@ list_realloc_move(PMEMobjpool *pop, struct list_head *oob_head_old,
 	 * 6. Process the redo log.
 	 */
 	section->obj_size = old_size;
-	pop->persist(&section->obj_size, sizeof (section->obj_size));
+	pop->persist(pop, &section->obj_size, sizeof (section->obj_size));
 
 	section->obj_offset = obj_offset;
-	pop->persist(&section->obj_offset, sizeof (section->obj_offset));
+	pop->persist(pop, &section->obj_offset, sizeof (section->obj_offset));
 
 	/*
 	 * The user must be aware that any changes in
@@ -1932,11 +2150,12 @@ list_realloc_move(PMEMobjpool *pop, struct list_head *oob_head_old,
 		 * If realloc in-place failed clear the obj_offset and obj_size.
 		 */
 		section->obj_offset = 0;
-		pop->persist(&section->obj_offset,
+		pop->persist(pop, &section->obj_offset,
 				sizeof (section->obj_offset));
 
 		section->obj_size = 0;
-		pop->persist(&section->obj_size, sizeof (section->obj_size));
+		pop->persist(pop, &section->obj_size,
+			sizeof (section->obj_size));
 
 		/*
 		 * Realloc in place is not possible so we need to perform
@@ -2053,6 +2272,7 @@ err_lock:
 	if (out_ret)
 		LOG(2, "list_mutexes_unlock failed");
 err_oob_lock:
+	TRACE(TRACE_LIST_REALLOC_MOVE, TRACE_END, 0);
 	out_ret = lane_release(pop);
 	ASSERTeq(out_ret, 0);
 	if (out_ret)
@@ -2099,7 +2319,7 @@ lane_list_recovery(PMEMobjpool *pop, struct lane_section_layout *section_layout)
 			 * so just clear the offset and size.
 			 */
 			section->obj_offset = 0;
-			pop->persist(&section->obj_offset,
+			pop->persist(pop, &section->obj_offset,
 					sizeof (section->obj_offset));
 		}
 		/*
@@ -2107,7 +2327,8 @@ lane_list_recovery(PMEMobjpool *pop, struct lane_section_layout *section_layout)
 		 * size field.
 		 */
 		section->obj_size = 0;
-		pop->persist(&section->obj_size, sizeof (section->obj_size));
+		pop->persist(pop, &section->obj_size,
+			sizeof (section->obj_size));
 
 	} else if (section->obj_offset) {
 		/* alloc or free recovery */
@@ -65,6 +65,10 @@ int list_insert_new(PMEMobjpool *pop, struct list_head *oob_head,
 	size_t size, void (*constructor)(PMEMobjpool *pop, void *ptr,
 	void *arg), void *arg, PMEMoid *oidp);
 
+int list_insert_new_n(PMEMobjpool *pop, struct list_head *oob_head,
+	size_t size, size_t n, void (*constructor)(PMEMobjpool *pop, void *ptr,
+	void *arg), void *arg, PMEMoid *oids);
+
 int list_realloc(PMEMobjpool *pop, struct list_head *oob_head,
 	size_t pe_offset, struct list_head *head,
 	size_t size, void (*constructor)(PMEMobjpool *pop, void *ptr,
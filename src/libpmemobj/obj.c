@@ -51,16 +51,22 @@
 
 #include "util.h"
 #include "out.h"
+#include "set.h"
 #include "lane.h"
 #include "redo.h"
 #include "list.h"
 #include "pmalloc.h"
 #include "cuckoo.h"
 #include "obj.h"
+#include "sync.h"
+#include "replica.h"
+#include "trace.h"
+#include "stats.h"
 #include "valgrind_internal.h"
 
 static struct cuckoo *pools;
 __thread struct _pobj_pcache _pobj_cached_pool;
+__thread struct _pobj_lcache _pobj_cached_local;
 
 /*
  * obj_init -- initialization of obj
@@ -74,6 +80,8 @@ obj_init(void)
 	pools = cuckoo_new();
 	if (pools == NULL)
 		FATAL("!cuckoo_new");
+
+	trace_init();
 }
 
 /*
@@ -85,6 +93,7 @@ void
 obj_fini(void)
 {
 	LOG(3, NULL);
+	trace_fini();
 	cuckoo_delete(pools);
 }
 
@@ -123,6 +132,74 @@ nopmem_memset_persist(void *dest, int c, size_t len)
 	return dest;
 }
 
+/*
+ * obj_set_local_fns -- sets the primitives acting on the mapping of the pool
+ *	or replica
+ */
+void
+obj_set_local_fns(PMEMobjpool *pop)
+{
+	if (pop->is_pmem) {
+		pop->persist_local = pmem_persist;
+		pop->flush_local = pmem_flush;
+		pop->drain_local = pmem_drain;
+		pop->memcpy_persist_local = pmem_memcpy_persist;
+		pop->memset_persist_local = pmem_memset_persist;
+	} else {
+		pop->persist_local = (persist_local_fn)pmem_msync;
+		pop->flush_local = (flush_local_fn)pmem_msync;
+		pop->drain_local = drain_empty;
+		pop->memcpy_persist_local = nopmem_memcpy_persist;
+		pop->memset_persist_local = nopmem_memset_persist;
+	}
+}
+
+/*
+ * obj_norep_persist -- (internal) persist without replication
+ */
+static void
+obj_norep_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->persist_local(addr, len);
+}
+
+/*
+ * obj_norep_flush -- (internal) flush without replication
+ */
+static void
+obj_norep_flush(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->flush_local(addr, len);
+}
+
+/*
+ * obj_norep_drain -- (internal) drain without replication
+ */
+static void
+obj_norep_drain(PMEMobjpool *pop)
+{
+	pop->drain_local();
+}
+
+/*
+ * obj_norep_memcpy_persist -- (internal) memcpy without replication
+ */
+static void *
+obj_norep_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
+	size_t len)
+{
+	return pop->memcpy_persist_local(dest, src, len);
+}
+
+/*
+ * obj_norep_memset_persist -- (internal) memset without replication
+ */
+static void *
+obj_norep_memset_persist(PMEMobjpool *pop, void *dest, int c, size_t len)
+{
+	return pop->memset_persist_local(dest, c, len);
+}
+
 /*
  * pmemobj_get_uuid_lo -- (internal) evaluates XOR sum of least significant
  * 8 bytes with most significant 8 bytes.
@@ -149,6 +226,16 @@ pmemobj_boot(PMEMobjpool *pop)
 {
 	LOG(3, "pop %p", pop);
 
+	if ((errno = obj_stats_boot(pop)) != 0) {
+		ERR("!obj_stats_boot");
+		return errno;
+	}
+
+	if ((errno = sync_boot(pop)) != 0) {
+		ERR("!sync_boot");
+		return errno;
+	}
+
 	if ((errno = lane_boot(pop)) != 0) {
 		ERR("!lane_boot");
 		return errno;
@@ -159,6 +246,10 @@ pmemobj_boot(PMEMobjpool *pop)
 		return errno;
 	}
 
+	struct pobj_heap_stats hs;
+	heap_get_stats(pop, &hs);
+	obj_stats_set_classes(pop, &hs);
+
 	if ((errno = lane_recover(pop)) != 0) {
 		ERR("!lane_recover");
 		return errno;
@@ -167,32 +258,220 @@ pmemobj_boot(PMEMobjpool *pop)
 	return 0;
 }
 
+/*
+ * pmemobj_next_replica -- (internal) returns the next replica in the ring
+ */
+static struct pool_set *
+pmemobj_next_replica(struct pool_set *set, struct pool_set *rep)
+{
+	return rep->replica ? rep->replica : set;
+}
+
+/*
+ * pmemobj_parts_check -- (internal) verifies the headers of the pool parts
+ *
+ * Every part must belong to the pool set of the first one and the parts
+ * must be linked in the order given by the set file.  The parts of each
+ * replica are linked to the first parts of the neighbouring replicas.  A
+ * single file pool is a set of one part, linked to itself.
+ */
+static int
+pmemobj_parts_check(struct pool_set *set)
+{
+	struct pool_hdr *hdr0 = set->part[0].hdr;
+
+	/* a ring of two parts reads the same in both directions */
+	if ((set->nparts > 1 || set->replica) && memcmp(hdr0->uuid,
+			hdr0->poolset_uuid, POOL_HDR_UUID_LEN)) {
+		ERR("%s is not the first part of the pool set",
+			set->part[0].path);
+		errno = EINVAL;
+		return -1;
+	}
+
+	struct pool_set *prev_rep = set;
+	while (prev_rep->replica)
+		prev_rep = prev_rep->replica;
+
+	for (struct pool_set *rep = set; rep; rep = rep->replica) {
+		struct pool_set *next_rep = pmemobj_next_replica(set, rep);
+		struct pool_hdr *prev_rep_hdr = prev_rep->part[0].hdr;
+		struct pool_hdr *next_rep_hdr = next_rep->part[0].hdr;
+
+		for (unsigned i = 0; i < rep->nparts; ++i) {
+			struct pool_hdr *hdrp = rep->part[i].hdr;
+			struct pool_hdr *prev = rep->part[
+				(i + rep->nparts - 1) % rep->nparts].hdr;
+			struct pool_hdr *next =
+				rep->part[(i + 1) % rep->nparts].hdr;
+
+			if (rep != set || i != 0) {
+				struct pool_hdr hdr;
+				memcpy(&hdr, hdrp, sizeof (hdr));
+
+				if (!util_convert_hdr(&hdr) ||
+				    strncmp(hdr.signature, OBJ_HDR_SIG,
+						POOL_HDR_SIG_LEN) ||
+				    hdr.major != OBJ_FORMAT_MAJOR) {
+					ERR("invalid header of part %s",
+						rep->part[i].path);
+					errno = EINVAL;
+					return -1;
+				}
+			}
+
+			if (memcmp(hdrp->poolset_uuid, hdr0->poolset_uuid,
+					POOL_HDR_UUID_LEN) ||
+			    memcmp(hdrp->prev_part_uuid, prev->uuid,
+					POOL_HDR_UUID_LEN) ||
+			    memcmp(hdrp->next_part_uuid, next->uuid,
+					POOL_HDR_UUID_LEN) ||
+			    memcmp(hdrp->prev_repl_uuid, prev_rep_hdr->uuid,
+					POOL_HDR_UUID_LEN) ||
+			    memcmp(hdrp->next_repl_uuid, next_rep_hdr->uuid,
+					POOL_HDR_UUID_LEN)) {
+				ERR("wrong UUID of part %s",
+					rep->part[i].path);
+				errno = EINVAL;
+				return -1;
+			}
+		}
+
+		prev_rep = rep;
+	}
+
+	return 0;
+}
+
+/*
+ * pmemobj_parts_create -- (internal) creates the headers of the pool parts
+ */
+static int
+pmemobj_parts_create(struct pool_set *set)
+{
+	for (struct pool_set *rep = set; rep; rep = rep->replica) {
+		for (unsigned i = 0; i < rep->nparts; ++i) {
+			struct pool_hdr *hdrp = rep->part[i].hdr;
+
+			/* check if the part header is all zeros */
+			if (!util_is_zeroed(hdrp, sizeof (*hdrp))) {
+				ERR("Non-empty file detected");
+				errno = EINVAL;
+				return -1;
+			}
+
+			/* the neighbours must know the UUID before linking */
+			uuid_generate(hdrp->uuid);
+		}
+	}
+
+	/*
+	 * The pool set is identified by the UUID of its first part, which
+	 * tells the first part apart from the others.  Single file pools
+	 * keep a random one, as they always did.
+	 */
+	unsigned char poolset_uuid[POOL_HDR_UUID_LEN];
+	if (set->nparts > 1 || set->replica)
+		memcpy(poolset_uuid, ((struct pool_hdr *)set->part[0].hdr)->uuid,
+			POOL_HDR_UUID_LEN);
+	else
+		uuid_generate(poolset_uuid);
+
+	struct pool_set *prev_rep = set;
+	while (prev_rep->replica)
+		prev_rep = prev_rep->replica;
+
+	for (struct pool_set *rep = set; rep; rep = rep->replica) {
+		struct pool_set *next_rep = pmemobj_next_replica(set, rep);
+		struct pool_hdr *prev_rep_hdr = prev_rep->part[0].hdr;
+		struct pool_hdr *next_rep_hdr = next_rep->part[0].hdr;
+
+		for (unsigned i = 0; i < rep->nparts; ++i) {
+			struct pool_hdr *hdrp = rep->part[i].hdr;
+			struct pool_hdr *prev = rep->part[
+				(i + rep->nparts - 1) % rep->nparts].hdr;
+			struct pool_hdr *next =
+				rep->part[(i + 1) % rep->nparts].hdr;
+
+			strncpy(hdrp->signature, OBJ_HDR_SIG,
+				POOL_HDR_SIG_LEN);
+			hdrp->major = htole32(OBJ_FORMAT_MAJOR);
+			hdrp->compat_features = htole32(OBJ_FORMAT_COMPAT);
+			hdrp->incompat_features =
+				htole32(OBJ_FORMAT_INCOMPAT);
+			hdrp->ro_compat_features =
+				htole32(OBJ_FORMAT_RO_COMPAT);
+			memcpy(hdrp->poolset_uuid, poolset_uuid,
+				POOL_HDR_UUID_LEN);
+			memcpy(hdrp->prev_part_uuid, prev->uuid,
+				POOL_HDR_UUID_LEN);
+			memcpy(hdrp->next_part_uuid, next->uuid,
+				POOL_HDR_UUID_LEN);
+			memcpy(hdrp->prev_repl_uuid, prev_rep_hdr->uuid,
+				POOL_HDR_UUID_LEN);
+			memcpy(hdrp->next_repl_uuid, next_rep_hdr->uuid,
+				POOL_HDR_UUID_LEN);
+			hdrp->crtime = htole64((uint64_t)time(NULL));
+
+			if (util_get_arch_flags(&hdrp->arch_flags)) {
+				ERR("Reading architecture flags failed\n");
+				errno = EINVAL;
+				return -1;
+			}
+
+			hdrp->arch_flags.alignment_desc =
+				htole64(hdrp->arch_flags.alignment_desc);
+			hdrp->arch_flags.e_machine =
+				htole16(hdrp->arch_flags.e_machine);
+
+			util_checksum(hdrp, sizeof (*hdrp), &hdrp->checksum,
+				1);
+
+			/* store part's header */
+			pmem_msync(hdrp, sizeof (*hdrp));
+		}
+
+		prev_rep = rep;
+	}
+
+	return 0;
+}
+
 /*
  * pmemobj_map_common -- (internal) map a transactional memory pool
  *
  * This routine does all the work, but takes a rdonly flag so internal
  * calls can map a read-only pool if required.
  *
- * If empty flag is set, the file is assumed to be a new memory pool, and
- * new pool header is created.  Otherwise, a valid header must exist.
+ * If empty flag is set, the files are assumed to be a new memory pool, and
+ * new pool headers are created.  Otherwise, valid headers must exist.
+ *
+ * The pool takes over the set, which is released on failure.
  */
 static PMEMobjpool *
-pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
-		int empty, int boot)
+pmemobj_map_common(struct pool_set *set, const char *layout, int rdonly,
+		int empty, int boot, int mapflags)
 {
-	LOG(3, "fd %d layout %s poolsize %zu rdonly %d empty %d",
-			fd, layout, poolsize, rdonly, empty);
-
-	void *addr;
-	if ((addr = util_map(fd, poolsize, rdonly)) == NULL) {
-		(void) close(fd);
-		return NULL;	/* util_map() set errno, called LOG */
+	LOG(3, "set %p layout %s rdonly %d empty %d mapflags 0x%x",
+			set, layout, rdonly, empty, mapflags);
+
+	if (util_poolset_map(set, rdonly, mapflags) != 0) {
+		int oerrno = errno;
+		util_poolset_close(set, empty);
+		errno = oerrno;
+		return NULL;	/* util_poolset_map() set errno, called LOG */
 	}
 
+	void *addr = set->part[0].addr;
+	size_t poolsize = set->poolsize;
+
 	VALGRIND_REGISTER_PMEM_MAPPING(addr, poolsize);
-	VALGRIND_REGISTER_PMEM_FILE(fd, addr, poolsize, 0);
+	for (unsigned i = 0; i < set->nparts; ++i)
+		VALGRIND_REGISTER_PMEM_FILE(set->part[i].fd,
+			set->part[i].addr, set->part[i].size,
+			i == 0 ? 0 : set->part[i].hdrsize);
 
-	(void) close(fd);
+	util_poolset_fdclose(set);
 
 	/* check if the mapped region is located in persistent memory */
 	int is_pmem = pmem_is_pmem(addr, poolsize);
@@ -229,15 +508,8 @@ pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
 			goto err;
 		}
 
-		/* XXX - pools sets / replicas */
-		if (memcmp(hdr.uuid, hdr.prev_part_uuid, POOL_HDR_UUID_LEN) ||
-		    memcmp(hdr.uuid, hdr.next_part_uuid, POOL_HDR_UUID_LEN) ||
-		    memcmp(hdr.uuid, hdr.prev_repl_uuid, POOL_HDR_UUID_LEN) ||
-		    memcmp(hdr.uuid, hdr.next_repl_uuid, POOL_HDR_UUID_LEN)) {
-			ERR("wrong UUID");
-			errno = EINVAL;
+		if (pmemobj_parts_check(set))
 			goto err;
-		}
 
 		if (util_check_arch_flags(&hdr.arch_flags)) {
 			ERR("wrong architecture flags");
@@ -274,15 +546,6 @@ pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
 
 		ASSERTeq(rdonly, 0);
 
-		struct pool_hdr *hdrp = &pop->hdr;
-
-		/* check if the pool header is all zeros */
-		if (!util_is_zeroed(hdrp, sizeof (*hdrp))) {
-			ERR("Non-empty file detected");
-			errno = EINVAL;
-			goto err;
-		}
-
 		/* check length of layout */
 		if (layout && (strlen(layout) >= PMEMOBJ_MAX_LAYOUT)) {
 				ERR("Layout too long");
@@ -290,36 +553,9 @@ pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
 				goto err;
 		}
 
-		/* create pool's header */
-		strncpy(hdrp->signature, OBJ_HDR_SIG, POOL_HDR_SIG_LEN);
-		hdrp->major = htole32(OBJ_FORMAT_MAJOR);
-		hdrp->compat_features = htole32(OBJ_FORMAT_COMPAT);
-		hdrp->incompat_features = htole32(OBJ_FORMAT_INCOMPAT);
-		hdrp->ro_compat_features = htole32(OBJ_FORMAT_RO_COMPAT);
-		uuid_generate(hdrp->uuid);
-		/* XXX - pools sets / replicas */
-		uuid_generate(hdrp->poolset_uuid);
-		memcpy(hdrp->prev_part_uuid, hdrp->uuid, POOL_HDR_UUID_LEN);
-		memcpy(hdrp->next_part_uuid, hdrp->uuid, POOL_HDR_UUID_LEN);
-		memcpy(hdrp->prev_repl_uuid, hdrp->uuid, POOL_HDR_UUID_LEN);
-		memcpy(hdrp->next_repl_uuid, hdrp->uuid, POOL_HDR_UUID_LEN);
-		hdrp->crtime = htole64((uint64_t)time(NULL));
-
-		if (util_get_arch_flags(&hdrp->arch_flags)) {
-			ERR("Reading architecture flags failed\n");
-			errno = EINVAL;
+		/* create and store headers of all the pool's parts */
+		if (pmemobj_parts_create(set))
 			goto err;
-		}
-
-		hdrp->arch_flags.alignment_desc =
-			htole64(hdrp->arch_flags.alignment_desc);
-		hdrp->arch_flags.e_machine =
-			htole16(hdrp->arch_flags.e_machine);
-
-		util_checksum(hdrp, sizeof (*hdrp), &hdrp->checksum, 1);
-
-		/* store pool's header */
-		pmem_msync(hdrp, sizeof (*hdrp));
 
 		/* initialize run_id, it will be incremented later */
 		pop->run_id = 0;
@@ -385,35 +621,48 @@ pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
 	 */
 	pop->addr = addr;
 	pop->size = poolsize;
+	pop->set = set;
 	pop->rdonly = rdonly;
 	pop->lanes = NULL;
+	pop->locks = NULL;
+	pop->stats = NULL;
 	pop->is_pmem = is_pmem;
 
 	pop->uuid_lo = pmemobj_get_uuid_lo(pop);
 	pop->store = (struct object_store *)
 			((uintptr_t)pop + pop->obj_store_offset);
 
-	if (pop->is_pmem) {
-		pop->persist = pmem_persist;
-		pop->flush = pmem_flush;
-		pop->drain = pmem_drain;
-		pop->memcpy_persist = pmem_memcpy_persist;
-		pop->memset_persist = pmem_memset_persist;
-	} else {
-		pop->persist = (persist_fn)pmem_msync;
-		pop->flush = (flush_fn)pmem_msync;
-		pop->drain = drain_empty;
-		pop->memcpy_persist = nopmem_memcpy_persist;
-		pop->memset_persist = nopmem_memset_persist;
+	obj_set_local_fns(pop);
+	pop->persist = obj_norep_persist;
+	pop->flush = obj_norep_flush;
+	pop->drain = obj_norep_drain;
+	pop->memcpy_persist = obj_norep_memcpy_persist;
+	pop->memset_persist = obj_norep_memset_persist;
+
+	pop->replica = NULL;
+	pop->rq = NULL;
+	pop->numa_node = -1;
+
+	/* a read-only pool leaves the replicas alone */
+	if (!rdonly) {
+		if ((errno = replica_boot(pop)) != 0)
+			goto err_replica;
 	}
 
 	if (boot) {
+		/* the run-time state of a pool can be set up only once */
+		if (cuckoo_get(pools, pop->uuid_lo) != NULL) {
+			ERR("pool already open");
+			errno = EEXIST;
+			goto err_replica;
+		}
+
 		if ((errno = pmemobj_boot(pop)) != 0)
-			goto err;
+			goto err_replica;
 
 		if ((errno = cuckoo_insert(pools, pop->uuid_lo, pop)) != 0) {
 			ERR("!cuckoo_insert");
-			goto err;
+			goto err_replica;
 		}
 
 	}
@@ -432,11 +681,18 @@ pmemobj_map_common(int fd, const char *layout, size_t poolsize, int rdonly,
 	LOG(3, "pop %p", pop);
 	return pop;
 
+err_replica:
+	{
+		int oerrno = errno;
+		obj_stats_cleanup(pop);
+		replica_cleanup(pop, 0);
+		errno = oerrno;
+	}
 err:
 	LOG(4, "error clean up");
 	int oerrno = errno;
 	VALGRIND_REMOVE_PMEM_MAPPING(addr, poolsize);
-	util_unmap(addr, poolsize);
+	util_poolset_close(set, empty);
 	errno = oerrno;
 	return NULL;
 }
@@ -451,6 +707,9 @@ int eapundo_fd;
 
 /*
  * pmemobj_create -- create a transactional memory pool
+ *
+ * If path is a pool set file, poolsize must be zero and the pool is made of
+ * the parts listed in the set file.
  */
 PMEMobjpool *
 pmemobj_create(const char *path, const char *layout, size_t poolsize,
@@ -459,35 +718,22 @@ pmemobj_create(const char *path, const char *layout, size_t poolsize,
 	LOG(3, "path %s layout %s poolsize %zu mode %d",
 			path, layout, poolsize, mode);
 
-	int created = 0;
-	int fd;
-	if (poolsize != 0) {
-		/* create a new memory pool file */
-		fd = util_pool_create(path, poolsize, PMEMOBJ_MIN_POOL, mode);
-#ifdef _ENABLE_EAP
-		//eapundo_fd = util_pool_create(EAP_UNDO_PATH,EAP_UNDO_POOLSZ, PMEMOBJ_MIN_POOL, mode);
-#endif
-		created = 1;
-	} else {
-		/* open an existing file */
-		fd = util_pool_open(path, &poolsize, PMEMOBJ_MIN_POOL);
-#ifdef _ENABLE_EAP
-		//eapundo_fd = util_pool_open(EAP_UNDO_PATH, &undo_poolsize, PMEMOBJ_MIN_POOL);
-#endif
-	}
-	if (fd == -1)
-		return NULL;	/* errno set by util_pool_create/open() */
+	struct pool_set *set;
+
+	/* create new memory pool files or open an existing one */
+	if (util_poolset_create(&set, path, poolsize, PMEMOBJ_MIN_POOL,
+			PMEMOBJ_MIN_PART, mode) != 0)
+		return NULL;	/* errno set by util_poolset_create() */
 
 #ifdef _ENABLE_EAP
+	//eapundo_fd = util_pool_create(EAP_UNDO_PATH,EAP_UNDO_POOLSZ, PMEMOBJ_MIN_POOL, mode);
 	//if (eapundo_fd == -1)
 	//	return NULL;	/* errno set by util_pool_create/open() */
 #endif
 
-	PMEMobjpool *pop = pmemobj_map_common(fd, layout, poolsize, 0, 1, 1);
-	if (pop == NULL && created)
-		unlink(path);	/* delete file if pool creation failed */
-
-	return pop;
+	/* files created by util_poolset_create() are deleted on failure */
+	return pmemobj_map_common(set, layout, 0, 1, 1,
+			util_map_policy(PMEMOBJ_MAP_POLICY_VAR));
 }
 
 /*
@@ -498,25 +744,77 @@ pmemobj_open(const char *path, const char *layout)
 {
 	LOG(3, "path %s layout %s", path, layout);
 
-	size_t poolsize = 0;
-	int fd;
+	return pmemobj_open_flags(path, layout, 0);
+}
 
-	if ((fd = util_pool_open(path, &poolsize, PMEMOBJ_MIN_POOL)) == -1)
-		return NULL;	/* errno set by util_pool_open() */
+/*
+ * pmemobj_open_flags -- open a transactional memory pool with a mapping policy
+ *
+ * The PMEMOBJ_MAP_* flags are combined with the ones set in the environment.
+ */
+PMEMobjpool *
+pmemobj_open_flags(const char *path, const char *layout, int flags)
+{
+	LOG(3, "path %s layout %s flags 0x%x", path, layout, flags);
 
-	return pmemobj_map_common(fd, layout, poolsize, 0, 0, 1);
+	if (flags & ~PMEMOBJ_MAP_ALL) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct pool_set *set;
+
+	if (util_poolset_open(&set, path, PMEMOBJ_MIN_POOL,
+			PMEMOBJ_MIN_PART) != 0)
+		return NULL;	/* errno set by util_poolset_open() */
+
+	return pmemobj_map_common(set, layout, 0, 0, 1,
+			flags | util_map_policy(PMEMOBJ_MAP_POLICY_VAR));
 }
 
 /*
- * pmemobj_create_part -- XXX
+ * pmemobj_create_part -- create a part file of a pool set
+ *
+ * A part is not a pool on its own, the set is formatted by pmemobj_create()
+ * called on the set file listing the part.  Only a set of a single part,
+ * without replicas, is formatted right away.
  */
-PMEMobjpool *
+int
 pmemobj_create_part(const char *path, const char *layout, size_t partsize,
 	mode_t mode, int part_index, int nparts, int replica_index,
 	int nreplica)
 {
-	/* XXX */
-	return NULL;
+	LOG(3, "path %s layout %s partsize %zu mode %d part %d/%d "
+		"replica %d/%d", path, layout, partsize, mode,
+		part_index, nparts, replica_index, nreplica);
+
+	if (nparts < 1 || part_index < 0 || part_index >= nparts ||
+	    nreplica < 1 || replica_index < 0 ||
+	    replica_index >= nreplica) {
+		ERR("invalid part %d/%d or replica %d/%d",
+			part_index, nparts, replica_index, nreplica);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (nparts == 1 && nreplica == 1) {
+		PMEMobjpool *pop = pmemobj_create(path, layout, partsize,
+				mode);
+		if (pop == NULL)
+			return -1;	/* errno set by pmemobj_create() */
+
+		pmemobj_close(pop);
+		return 0;
+	}
+
+	int fd = util_pool_create(path, partsize, PMEMOBJ_MIN_PART, mode);
+	if (fd == -1)
+		return -1;	/* errno set by util_pool_create() */
+
+	(void) close(fd);
+
+	return 0;
 }
 
 /*
@@ -534,8 +832,14 @@ pmemobj_cleanup(PMEMobjpool *pop)
 	if ((errno = lane_cleanup(pop)) != 0)
 		ERR("!lane_cleanup");
 
+	sync_cleanup(pop);
+
+	replica_cleanup(pop, 1);
+
+	obj_stats_cleanup(pop);
+
 	VALGRIND_REMOVE_PMEM_MAPPING(pop->addr, pop->size);
-	util_unmap(pop->addr, pop->size);
+	util_poolset_close(pop->set, 0);
 }
 
 /*
@@ -555,6 +859,11 @@ pmemobj_close(PMEMobjpool *pop)
 		_pobj_cached_pool.uuid_lo = 0;
 	}
 
+	if (_pobj_cached_local.uuid_lo == pop->uuid_lo) {
+		_pobj_cached_local.base = NULL;
+		_pobj_cached_local.uuid_lo = 0;
+	}
+
 	pmemobj_cleanup(pop);
 #if defined(_DISABLE_LOGGING) || defined(_EAP_FLUSH_ONLY) || defined(_EAP_ALLOC_OPTIMIZE)
 	print_stats();
@@ -569,14 +878,14 @@ pmemobj_check(const char *path, const char *layout)
 {
 	LOG(3, "path %s layout %s", path, layout);
 
-	size_t poolsize = 0;
-	int fd;
+	struct pool_set *set;
 
-	if ((fd = util_pool_open(path, &poolsize, PMEMOBJ_MIN_POOL)) == -1)
-		return -1;	/* errno set by util_pool_open() */
+	if (util_poolset_open(&set, path, PMEMOBJ_MIN_POOL,
+			PMEMOBJ_MIN_PART) != 0)
+		return -1;	/* errno set by util_poolset_open() */
 
 	/* map the pool read-only */
-	PMEMobjpool *pop = pmemobj_map_common(fd, layout, poolsize, 1, 0, 0);
+	PMEMobjpool *pop = pmemobj_map_common(set, layout, 1, 0, 0, 0);
 
 	if (pop == NULL)
 		return -1;	/* errno set by pmemobj_map_common() */
@@ -606,8 +915,8 @@ pmemobj_check(const char *path, const char *layout)
 	if (consistent) {
 		pmemobj_close(pop);
 	} else {
-		VALGRIND_REMOVE_PMEM_MAPPING(pop, poolsize);
-		util_unmap(pop, poolsize);
+		VALGRIND_REMOVE_PMEM_MAPPING(pop, pop->size);
+		util_poolset_close(pop->set, 0);
 	}
 
 	/* XXX validate metadata */
@@ -628,6 +937,20 @@ pmemobj_pool(PMEMoid oid)
 	return cuckoo_get(pools, oid.pool_uuid_lo);
 }
 
+/*
+ * pmemobj_pool_local -- returns the base address of the copy of the pool
+ *	local to the NUMA node of the calling thread
+ */
+const void *
+pmemobj_pool_local(PMEMoid oid)
+{
+	PMEMobjpool *pop = cuckoo_get(pools, oid.pool_uuid_lo);
+	if (pop == NULL)
+		return NULL;
+
+	return replica_local(pop);
+}
+
 
 /* arguments for constructor_alloc_bytype */
 struct carg_bytype {
@@ -652,7 +975,7 @@ constructor_alloc_bytype(PMEMobjpool *pop, void *ptr, void *arg)
 
 	pobj->internal_type = TYPE_ALLOCATED;
 	pobj->user_type = carg->user_type;
-	pop->persist(pobj, OBJ_OOB_SIZE);
+	pop->persist(pop, pobj, OBJ_OOB_SIZE);
 
 	if (carg->constructor)
 		carg->constructor(pop, ptr, carg->arg);
@@ -734,7 +1057,7 @@ constructor_zalloc(PMEMobjpool *pop, void *ptr, void *arg)
 
 	struct carg_alloc *carg = arg;
 
-	pop->memset_persist(ptr, 0, carg->size);
+	pop->memset_persist(pop, ptr, 0, carg->size);
 }
 
 /*
@@ -778,6 +1101,63 @@ obj_free(PMEMobjpool *pop, PMEMoid *oidp)
 		LOG(2, "list_remove_free failed");
 }
 
+/*
+ * pmemobj_alloc_n -- allocates n new objects of the same size
+ */
+int
+pmemobj_alloc_n(PMEMobjpool *pop, PMEMoid *oids, size_t n, size_t size,
+	unsigned int type_num, void (*constructor)(PMEMobjpool *pop, void *ptr,
+	void *arg), void *arg)
+{
+	LOG(3, "pop %p oids %p n %zu size %zu type_num %u constructor %p "
+		"arg %p", pop, oids, n, size, type_num, constructor, arg);
+
+	/* log notice message if used inside a transaction */
+	_POBJ_DEBUG_NOTICE_IN_TX();
+
+	if (size == 0 || n == 0) {
+		ERR("allocation with size or number of objects 0");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (type_num >= PMEMOBJ_NUM_OID_TYPES) {
+		errno = EINVAL;
+		ERR("!pmemobj_alloc_n");
+		LOG(2, "type_num has to be in range [0, %i]",
+			PMEMOBJ_NUM_OID_TYPES - 1);
+		return -1;
+	}
+
+	if (OBJ_PTR_IS_VALID(pop, oids)) {
+		ERR("array of object IDs must not reside in the pool");
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (size_t i = 0; i < n; ++i)
+		oids[i] = OID_NULL;
+
+	struct list_head *lhead = &pop->store->bytype[type_num].head;
+	struct carg_bytype carg;
+
+	carg.user_type = type_num;
+	carg.constructor = constructor;
+	carg.arg = arg;
+
+	if (list_insert_new_n(pop, lhead, size, n, constructor_alloc_bytype,
+			&carg, oids) == 0)
+		return 0;
+
+	/* roll back the objects allocated before the failure */
+	int oerrno = errno;
+	for (size_t i = 0; i < n && !OID_IS_NULL(oids[i]); ++i)
+		obj_free(pop, &oids[i]);
+	errno = oerrno;
+
+	return -1;
+}
+
 /*
  * obj_realloc_common -- (internal) common routine for resizing
  *                          existing objects
@@ -866,11 +1246,11 @@ constructor_realloc(PMEMobjpool *pop, void *ptr, void *arg)
 		size_t cpy_size = carg->new_size > carg->old_size ?
 			carg->old_size : carg->new_size;
 
-		pop->memcpy_persist(ptr, carg->ptr, cpy_size);
+		pop->memcpy_persist(pop, ptr, carg->ptr, cpy_size);
 
 		pobj->internal_type = TYPE_ALLOCATED;
 		pobj->user_type = carg->user_type;
-		pop->persist(pobj, sizeof (*pobj));
+		pop->persist(pop, pobj, sizeof (*pobj));
 	}
 }
 
@@ -892,18 +1272,18 @@ constructor_zrealloc(PMEMobjpool *pop, void *ptr, void *arg)
 		size_t cpy_size = carg->new_size > carg->old_size ?
 			carg->old_size : carg->new_size;
 
-		pop->memcpy_persist(ptr, carg->ptr, cpy_size);
+		pop->memcpy_persist(pop, ptr, carg->ptr, cpy_size);
 
 		pobj->internal_type = TYPE_ALLOCATED;
 		pobj->user_type = carg->user_type;
-		pop->persist(pobj, sizeof (*pobj));
+		pop->persist(pop, pobj, sizeof (*pobj));
 	}
 
 	if (carg->new_size > carg->old_size) {
 		size_t grow_len = carg->new_size - carg->old_size;
 		void *new_data_ptr = (void *)((uintptr_t)ptr + carg->old_size);
 
-		pop->memset_persist(new_data_ptr, 0, grow_len);
+		pop->memset_persist(pop, new_data_ptr, 0, grow_len);
 	}
 }
 
@@ -981,7 +1361,7 @@ constructor_strdup(PMEMobjpool *pop, void *ptr, void *arg)
 	struct carg_strdup *carg = arg;
 
 	/* copy string */
-	pop->memcpy_persist(ptr, carg->s, carg->size);
+	pop->memcpy_persist(pop, ptr, carg->s, carg->size);
 }
 
 /*
@@ -1066,7 +1446,10 @@ void *
 pmemobj_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
 	size_t len)
 {
-	return pop->memcpy_persist(dest, src, len);
+	void *ret = pop->memcpy_persist(pop, dest, src, len);
+	tx_range_durable(pop, dest, len);
+
+	return ret;
 }
 
 /*
@@ -1075,7 +1458,10 @@ pmemobj_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
 void *
 pmemobj_memset_persist(PMEMobjpool *pop, void *dest, int c, size_t len)
 {
-	return pop->memset_persist(dest, c, len);
+	void *ret = pop->memset_persist(pop, dest, c, len);
+	tx_range_durable(pop, dest, len);
+
+	return ret;
 }
 
 /*
@@ -1086,7 +1472,8 @@ pmemobj_persist(PMEMobjpool *pop, void *addr, size_t len)
 {
 //#if defined(_DISABLE_LOGGING) || defined(_EAP_FLUSH_ONLY)
 //#else
-	pop->persist(addr, len);
+	pop->persist(pop, addr, len);
+	tx_range_durable(pop, addr, len);
 //#endif
 }
 
@@ -1096,7 +1483,7 @@ pmemobj_persist(PMEMobjpool *pop, void *addr, size_t len)
 void
 pmemobj_flush(PMEMobjpool *pop, void *addr, size_t len)
 {
-	pop->flush(addr, len);
+	pop->flush(pop, addr, len);
 }
 
 /*
@@ -1105,7 +1492,7 @@ pmemobj_flush(PMEMobjpool *pop, void *addr, size_t len)
 void
 pmemobj_drain(PMEMobjpool *pop)
 {
-	pop->drain();
+	pop->drain(pop);
 }
 
 /*
@@ -1147,7 +1534,7 @@ constructor_alloc_root(PMEMobjpool *pop, void *ptr, void *arg)
 	/* temporarily add atomic root allocation to pmemcheck transaction */
 	VALGRIND_ADD_TO_TX(ro, OBJ_OOB_SIZE + carg->size);
 
-	pop->memset_persist(ptr, 0, carg->size);
+	pop->memset_persist(pop, ptr, 0, carg->size);
 
 	ro->internal_type = TYPE_ALLOCATED;
 	ro->user_type = POBJ_ROOT_TYPE_NUM;
@@ -1155,7 +1542,7 @@ constructor_alloc_root(PMEMobjpool *pop, void *ptr, void *arg)
 
 	VALGRIND_REMOVE_FROM_TX(ro, OBJ_OOB_SIZE + carg->size);
 
-	pop->persist(ro, OBJ_OOB_SIZE);
+	pop->persist(pop, ro, OBJ_OOB_SIZE);
 }
 
 /*
@@ -1215,6 +1602,50 @@ pmemobj_root_size(PMEMobjpool *pop)
 		return 0;
 }
 
+/*
+ * pmemobj_heap_stats -- returns heap occupancy statistics
+ */
+int
+pmemobj_heap_stats(PMEMobjpool *pop, struct pobj_heap_stats *stats)
+{
+	LOG(3, "pop %p stats %p", pop, stats);
+
+	if (stats == NULL) {
+		ERR("invalid stats pointer");
+		errno = EINVAL;
+		return -1;
+	}
+
+	heap_get_stats(pop, stats);
+
+	return 0;
+}
+
+/*
+ * pmemobj_stats_get -- returns runtime statistics of the pool
+ */
+int
+pmemobj_stats_get(PMEMobjpool *pop, struct pobj_stats *stats)
+{
+	LOG(3, "pop %p stats %p", pop, stats);
+
+	if (stats == NULL) {
+		ERR("invalid stats pointer");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (pop->stats == NULL) {
+		ERR("no statistics for the pool");
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	obj_stats_merge(pop->stats, stats);
+
+	return 0;
+}
+
 /*
  * pmemobj_root -- returns root object
  */
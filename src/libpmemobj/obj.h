@@ -39,6 +39,7 @@
 #define	PMEMOBJ_LOG_PREFIX "libpmemobj"
 #define	PMEMOBJ_LOG_LEVEL_VAR "PMEMOBJ_LOG_LEVEL"
 #define	PMEMOBJ_LOG_FILE_VAR "PMEMOBJ_LOG_FILE"
+#define	PMEMOBJ_MAP_POLICY_VAR "PMEMOBJ_MAP_POLICY"
 
 /* attributes of the obj memory pool format for the pool header */
 #define	OBJ_HDR_SIG "OBJPOOL"	/* must be 8 bytes including '\0' */
@@ -99,11 +100,18 @@
 #define	OBJ_STORE_ITEM_PADDING\
 	(_POBJ_CL_ALIGNMENT - (sizeof (struct list_head) % _POBJ_CL_ALIGNMENT))
 
-typedef void (*persist_fn)(void *, size_t);
-typedef void (*flush_fn)(void *, size_t);
-typedef void (*drain_fn)(void);
-typedef void *(*memcpy_fn)(void *dest, const void *src, size_t len);
-typedef void *(*memset_fn)(void *dest, int c, size_t len);
+typedef void (*persist_local_fn)(void *, size_t);
+typedef void (*flush_local_fn)(void *, size_t);
+typedef void (*drain_local_fn)(void);
+typedef void *(*memcpy_local_fn)(void *dest, const void *src, size_t len);
+typedef void *(*memset_local_fn)(void *dest, int c, size_t len);
+
+typedef void (*persist_fn)(PMEMobjpool *pop, void *, size_t);
+typedef void (*flush_fn)(PMEMobjpool *pop, void *, size_t);
+typedef void (*drain_fn)(PMEMobjpool *pop);
+typedef void *(*memcpy_fn)(PMEMobjpool *pop, void *dest, const void *src,
+	size_t len);
+typedef void *(*memset_fn)(PMEMobjpool *pop, void *dest, int c, size_t len);
 
 struct pmemobjpool {
 	struct pool_hdr hdr;	/* memory pool header */
@@ -125,6 +133,7 @@ struct pmemobjpool {
 	/* some run-time state, allocated out of memory pool... */
 	void *addr;		/* mapped region */
 	size_t size;		/* size of mapped region */
+	struct pool_set *set;	/* part files the pool is mapped from */
 	int is_pmem;		/* true if pool is PMEM */
 	int rdonly;		/* true if pool is opened read-only */
 	struct pmalloc_heap *heap; /* allocator heap */
@@ -132,12 +141,27 @@ struct pmemobjpool {
 	struct object_store *store; /* object store */
 	uint64_t uuid_lo;
 
+	/* primitives acting on this mapping only */
+	persist_local_fn persist_local;	/* persist function */
+	flush_local_fn flush_local;	/* flush function */
+	drain_local_fn drain_local;	/* drain function */
+	memcpy_local_fn memcpy_persist_local; /* persistent memcpy function */
+	memset_local_fn memset_persist_local; /* persistent memset function */
+
+	/* primitives of the pool, which also update the replicas */
 	persist_fn persist;	/* persist function */
 	flush_fn flush;		/* flush function */
 	drain_fn drain;		/* drain function */
 	memcpy_fn memcpy_persist; /* persistent memcpy function */
 	memset_fn memset_persist; /* persistent memset function */
 
+	PMEMobjpool *replica;	/* next replica, NULL in the last one */
+	struct replica_queue *rq; /* asynchronous replication, may be NULL */
+	int numa_node;		/* node of the mapping, -1 if unknown */
+
+	struct sync_table *locks; /* volatile lock side-table, may be NULL */
+	struct obj_stats *stats; /* runtime statistics, may be NULL */
+
 	PMEMmutex rootlock;	/* root object lock */
 };
 
@@ -225,3 +249,5 @@ oob_list_last(PMEMobjpool *pop, struct list_head *head)
 
 void obj_init(void);
 void obj_fini(void);
+void obj_set_local_fns(PMEMobjpool *pop);
+void tx_range_durable(PMEMobjpool *pop, const void *addr, size_t len);
@@ -40,6 +40,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "libpmem.h"
 #include "libpmemobj.h"
 #include "util.h"
 #include "pmalloc.h"
@@ -47,11 +48,13 @@
 #include "redo.h"
 #include "list.h"
 #include "obj.h"
+#include "sync.h"
 #include "out.h"
 #include "heap.h"
 #include "bucket.h"
 #include "heap_layout.h"
 #include "out.h"
+#include "stats.h"
 #include "valgrind_internal.h"
 
 enum alloc_op_redo {
@@ -73,7 +76,10 @@ alloc_write_header(PMEMobjpool *pop, struct allocation_header *alloc,
 	alloc->size = size;
 	alloc->zone_id = zone_id;
 	VALGRIND_REMOVE_FROM_TX(alloc, sizeof (*alloc));
-	pop->persist(alloc, sizeof (*alloc));
+
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+	pop->persist(pop, alloc, sizeof (*alloc));
+	pmem_stats_set_context(ctx);
 }
 
 /*
@@ -214,6 +220,8 @@ pmalloc_construct(PMEMobjpool *pop, uint64_t *off, size_t size,
 		ASSERT(0);
 	}
 
+	OBJ_STATS_ADD(pop, OBJ_STAT_ALLOCS + heap_get_bucket_class(pop, b), 1);
+
 	return 0;
 
 err_lane_hold:
@@ -230,6 +238,188 @@ err_lane_hold:
 	return err;
 }
 
+/*
+ * get_mblocks_from_offs -- (internal) returns memory blocks of allocations
+ */
+static struct memory_block *
+get_mblocks_from_offs(PMEMobjpool *pop, uint64_t *offs, size_t n)
+{
+	struct memory_block *m = Malloc(n * sizeof (*m));
+	if (m == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < n; ++i) {
+		struct allocation_header *alloc =
+			alloc_get_header(pop, offs[i]);
+		struct bucket *b = heap_get_best_bucket(pop, alloc->size);
+		m[i] = get_mblock_from_alloc(pop, b, alloc);
+	}
+
+	return m;
+}
+
+/*
+ * pmalloc_reserve -- reserves up to *n memory blocks of the same size
+ *
+ * The blocks are taken out of the volatile state of the heap and their
+ * allocation headers are written, but they stay free in the persistent
+ * state until pmalloc_publish() is called, so an interrupted reservation
+ * leaves nothing behind. The offsets of the blocks are stored in offs and
+ * *n is set to the number of reserved blocks. Publishing them changes at
+ * most max_hdrs heap headers.
+ *
+ * If successful function returns zero. Otherwise an error number is returned.
+ */
+int
+pmalloc_reserve(PMEMobjpool *pop, uint64_t *offs, size_t *n, size_t size,
+	size_t max_hdrs)
+{
+	size_t sizeh = size + sizeof (struct allocation_header);
+
+	struct bucket *b = heap_get_best_bucket(pop, sizeh);
+
+	int err = 0;
+	uint32_t units = bucket_calc_units(b, sizeh);
+	uint64_t real_size = bucket_unit_size(b) * units;
+
+	struct memory_block *m = Malloc(*n * sizeof (*m));
+	if (m == NULL)
+		return ENOMEM;
+
+	m[0].chunk_id = 0;
+	m[0].zone_id = 0;
+	m[0].size_idx = units;
+	m[0].block_off = 0;
+
+	if ((err = heap_get_bestfit_blocks(pop, b, m, n, max_hdrs)) != 0)
+		goto out;
+
+	/* the headers are written for the list code, charge them to the heap */
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_HEAP);
+
+	for (size_t i = 0; i < *n; ++i) {
+		struct allocation_header *alloc =
+			heap_get_block_data(pop, m[i]);
+
+		ASSERT((uint64_t)alloc % _POBJ_CL_ALIGNMENT == 0);
+
+		VALGRIND_ADD_TO_TX(alloc, sizeof (*alloc));
+		alloc->chunk_id = m[i].chunk_id;
+		alloc->size = real_size;
+		alloc->zone_id = m[i].zone_id;
+		VALGRIND_REMOVE_FROM_TX(alloc, sizeof (*alloc));
+		pop->flush(pop, alloc, sizeof (*alloc));
+
+		offs[i] = pop_offset(pop, alloc) +
+			sizeof (struct allocation_header);
+	}
+
+	pop->drain(pop);
+
+	pmem_stats_set_context(ctx);
+
+out:
+	Free(m);
+
+	return err;
+}
+
+/*
+ * pmalloc_publish -- stores the heap operations allocating the reserved
+ *	memory blocks in the redo log
+ *
+ * Updates of the same heap header are merged into a single entry, the
+ * entries are stored starting at *redo_index, which is then set to the next
+ * free index. The runs of the blocks stay locked until pmalloc_publish_end()
+ * is called, which must happen after the redo log has been processed.
+ *
+ * If successful function returns zero. Otherwise an error number is returned.
+ */
+int
+pmalloc_publish(PMEMobjpool *pop, struct redo_log *redo, size_t *redo_index,
+	uint64_t *offs, size_t n)
+{
+	struct memory_block *m = get_mblocks_from_offs(pop, offs, n);
+	if (m == NULL)
+		return ENOMEM;
+
+	int err = 0;
+	if ((err = heap_lock_runs(pop, m, n)) != 0)
+		goto out;
+
+	size_t first = *redo_index;
+	for (size_t i = 0; i < n; ++i) {
+		uint64_t op_result;
+		void *hdr = heap_get_block_header(pop, m[i], HEAP_OP_ALLOC,
+				&op_result);
+		uint64_t hdr_off = pop_offset(pop, hdr);
+
+		size_t j;
+		for (j = first; j < *redo_index; ++j)
+			if (redo[j].offset == hdr_off)
+				break;
+
+		if (j != *redo_index)
+			redo[j].value |= op_result;
+		else
+			redo_log_store(pop, redo, (*redo_index)++,
+				hdr_off, op_result);
+	}
+
+out:
+	Free(m);
+
+	return err;
+}
+
+/*
+ * pmalloc_publish_end -- releases the runs locked by pmalloc_publish()
+ */
+void
+pmalloc_publish_end(PMEMobjpool *pop, uint64_t *offs, size_t n)
+{
+	struct memory_block *m = get_mblocks_from_offs(pop, offs, n);
+	if (m == NULL) {
+		ERR("Failed to release run locks");
+		ASSERT(0);
+		return;
+	}
+
+	if (heap_unlock_runs(pop, m, n) != 0) {
+		ERR("Failed to release run locks");
+		ASSERT(0);
+	}
+
+	Free(m);
+
+	/* the redo log has been processed, the blocks are allocated now */
+	if (n != 0) {
+		struct bucket *b = heap_get_best_bucket(pop,
+			alloc_get_header(pop, offs[0])->size);
+		OBJ_STATS_ADD(pop, OBJ_STAT_ALLOCS +
+			heap_get_bucket_class(pop, b), n);
+	}
+}
+
+/*
+ * pmalloc_cancel -- returns the reserved memory blocks to the heap
+ */
+void
+pmalloc_cancel(PMEMobjpool *pop, uint64_t *offs, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		struct allocation_header *alloc =
+			alloc_get_header(pop, offs[i]);
+		struct bucket *b = heap_get_best_bucket(pop, alloc->size);
+
+		if (bucket_insert_block(b,
+			get_mblock_from_alloc(pop, b, alloc)) != 0) {
+			ERR("Failed to recover heap volatile state");
+			ASSERT(0);
+		}
+	}
+}
+
 /*
  * prealloc -- resizes in-place a previously allocated memory block
  *
@@ -276,18 +466,26 @@ prealloc_construct(PMEMobjpool *pop, uint64_t *off, size_t size,
 		return err;
 
 	struct memory_block next = {0};
-	if ((err = heap_get_adjacent_free_block(pop, &next, cnt, 0)) != 0)
-		goto error;
+	if (!bucket_is_small(b)) {
+		/* the growth may span several consecutive free chunks */
+		if ((err = heap_get_next_chunks(pop, b, cnt, &next,
+			add_size_idx)) != 0)
+			goto error;
+	} else {
+		if ((err = heap_get_adjacent_free_block(pop, &next,
+			cnt, 0)) != 0)
+			goto error;
+
+		if (next.size_idx < add_size_idx) {
+			err = ENOMEM;
+			goto error;
+		}
 
-	if (next.size_idx < add_size_idx) {
-		err = ENOMEM;
-		goto error;
+		if ((err = heap_get_exact_block(pop, b, &next,
+			add_size_idx)) != 0)
+			goto error;
 	}
 
-	if ((err = heap_get_exact_block(pop, b, &next,
-		add_size_idx)) != 0)
-		goto error;
-
 	struct memory_block *blocks[2] = {&cnt, &next};
 	uint64_t op_result;
 	void *hdr;
@@ -358,6 +556,9 @@ pfree_eap(PMEMobjpool *pop, uint64_t *off)
 {
 	struct allocation_header *alloc = alloc_get_header(pop, *off);
 
+	/* the volatile locks of the freed memory must not outlive it */
+	sync_table_drop(pop, *off, pmalloc_usable_size(pop, *off));
+
 	struct bucket *b = heap_get_best_bucket(pop, alloc->size);
 
 	int err = 0;
@@ -432,6 +633,9 @@ pfree(PMEMobjpool *pop, uint64_t *off)
 
 	struct allocation_header *alloc = alloc_get_header(pop, *off);
 
+	/* the volatile locks of the freed memory must not outlive it */
+	sync_table_drop(pop, *off, pmalloc_usable_size(pop, *off));
+
 	struct bucket *b = heap_get_best_bucket(pop, alloc->size);
 
 	int err = 0;
@@ -504,6 +708,8 @@ pfree(PMEMobjpool *pop, uint64_t *off)
 		ASSERT(0);
 	}
 
+	OBJ_STATS_ADD(pop, OBJ_STAT_FREES + heap_get_bucket_class(pop, b), 1);
+
 	return 0;
 
 error_lane_hold:
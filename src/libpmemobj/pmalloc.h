@@ -34,16 +34,26 @@
  * pmalloc.h -- internal definitions for persistent malloc
  */
 
+struct redo_log;
+
 int heap_boot(PMEMobjpool *pop);
 int heap_init(PMEMobjpool *pop);
 int heap_cleanup(PMEMobjpool *pop);
 int heap_check(PMEMobjpool *pop);
+void heap_get_stats(PMEMobjpool *pop, struct pobj_heap_stats *stats);
 
 int pmalloc(PMEMobjpool *pop, uint64_t *off, size_t size);
 int pmalloc_construct(PMEMobjpool *pop, uint64_t *off, size_t size,
 	void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg), void *arg,
 	uint64_t data_off);
 
+int pmalloc_reserve(PMEMobjpool *pop, uint64_t *offs, size_t *n, size_t size,
+	size_t max_hdrs);
+int pmalloc_publish(PMEMobjpool *pop, struct redo_log *redo, size_t *redo_index,
+	uint64_t *offs, size_t n);
+void pmalloc_publish_end(PMEMobjpool *pop, uint64_t *offs, size_t n);
+void pmalloc_cancel(PMEMobjpool *pop, uint64_t *offs, size_t n);
+
 int prealloc(PMEMobjpool *pop, uint64_t *off, size_t size);
 int prealloc_construct(PMEMobjpool *pop, uint64_t *off, size_t size,
 	void (*constructor)(PMEMobjpool *pop, void *ptr, void *arg), void *arg,
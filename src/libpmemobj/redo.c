@@ -45,6 +45,7 @@
 #include "list.h"
 #include "obj.h"
 #include "out.h"
+#include "trace.h"
 #include "valgrind_internal.h"
 
 #define	_POBJ_REDO_MIN_OFFSET	8192
@@ -107,15 +108,19 @@ redo_log_store_last(PMEMobjpool *pop, struct redo_log *redo, size_t index,
 
 	ASSERTeq(offset & REDO_FINISH_FLAG, 0);
 
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_REDO);
+
 	/* store value of last entry */
 	redo[index].value = value;
 
 	/* persist all redo log entries */
-	pop->persist(redo, (index + 1) * sizeof (struct redo_log));
+	pop->persist(pop, redo, (index + 1) * sizeof (struct redo_log));
 
 	/* store and persist offset of last entry */
 	redo[index].offset = offset | REDO_FINISH_FLAG;
-	pop->persist(&redo[index].offset, sizeof (redo[index].offset));
+	pop->persist(pop, &redo[index].offset, sizeof (redo[index].offset));
+
+	pmem_stats_set_context(ctx);
 }
 
 /*
@@ -126,12 +131,16 @@ redo_log_set_last(PMEMobjpool *pop, struct redo_log *redo, size_t index)
 {
 	LOG(15, "redo %p index %zu", redo, index);
 
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_REDO);
+
 	/* persist all redo log entries */
-	pop->persist(redo, (index + 1) * sizeof (struct redo_log));
+	pop->persist(pop, redo, (index + 1) * sizeof (struct redo_log));
 
 	/* set finish flag of last entry and persist */
 	redo[index].offset |= REDO_FINISH_FLAG;
-	pop->persist(&redo[index].offset, sizeof (redo[index].offset));
+	pop->persist(pop, &redo[index].offset, sizeof (redo[index].offset));
+
+	pmem_stats_set_context(ctx);
 }
 
 /*
@@ -145,6 +154,10 @@ redo_log_process(PMEMobjpool *pop, struct redo_log *redo,
 
 	ASSERTeq(redo_log_check(pop, redo, nentries), 0);
 
+	unsigned ctx = pmem_stats_set_context(PMEMOBJ_STATS_REDO);
+	TRACE(TRACE_REDO_PROCESS, TRACE_BEGIN, nentries);
+	struct redo_log *first = redo;
+
 	uint64_t *val;
 	while ((redo->offset & REDO_FINISH_FLAG) == 0) {
 
@@ -154,7 +167,7 @@ redo_log_process(PMEMobjpool *pop, struct redo_log *redo,
 			VALGRIND_ADD_TO_TX(val, sizeof (*val));
 			*val = redo->value;
 			VALGRIND_REMOVE_FROM_TX(val, sizeof (*val));
-			pop->flush(val, sizeof (uint64_t));
+			pop->flush(pop, val, sizeof (uint64_t));
 		}
 		redo++;
 	}
@@ -167,12 +180,15 @@ redo_log_process(PMEMobjpool *pop, struct redo_log *redo,
 		VALGRIND_ADD_TO_TX(val, sizeof (*val));
 		*val = redo->value;
 		VALGRIND_REMOVE_FROM_TX(val, sizeof (*val));
-		pop->flush(val, sizeof (uint64_t));
-		pop->drain();
+		pop->flush(pop, val, sizeof (uint64_t));
+		pop->drain(pop);
 	}
 	redo->offset = 0;
 
-	pop->persist(&redo->offset, sizeof (redo->offset));
+	pop->persist(pop, &redo->offset, sizeof (redo->offset));
+
+	TRACE(TRACE_REDO_PROCESS, TRACE_END, redo - first + 1);
+	pmem_stats_set_context(ctx);
 }
 
 /*
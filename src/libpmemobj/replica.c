@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * replica.c -- replicas of the pool
+ *
+ * A replica is a copy of the pool kept in a separate set of part files,
+ * typically on a device attached to another NUMA node.  All the changes
+ * made to the pool go through its persist, flush and memcpy/memset
+ * primitives, which apply them to the replicas as well -- either right
+ * away or, if the replicas are allowed to lag behind, from a worker thread.
+ * Readers may then resolve objects against the copy local to their node.
+ *
+ * A replica is known to be up to date only if its copy of the pool
+ * descriptor matches the one of the pool.  The copy is invalidated for as
+ * long as the pool is open, so a replica left behind by a crash is brought
+ * up to date the next time the pool is opened.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/param.h>
+#include <sys/syscall.h>
+
+#include "libpmem.h"
+#include "libpmemobj.h"
+#include "util.h"
+#include "lane.h"
+#include "redo.h"
+#include "list.h"
+#include "obj.h"
+#include "set.h"
+#include "replica.h"
+#include "out.h"
+#include "valgrind_internal.h"
+
+#ifndef MPOL_F_NODE
+#define	MPOL_F_NODE (1 << 0)	/* see get_mempolicy(2) */
+#define	MPOL_F_ADDR (1 << 1)
+#endif
+
+/* persistent part of the pool descriptor */
+#define	REPLICA_DSC(pop) ((char *)(pop) + sizeof (struct pool_hdr))
+
+/*
+ * replica_copy -- (internal) copies a range of the pool to all the replicas
+ */
+static void
+replica_copy(PMEMobjpool *pop, uint64_t off, size_t len)
+{
+	for (PMEMobjpool *rep = pop->replica; rep; rep = rep->replica)
+		rep->memcpy_persist_local((char *)rep + off,
+			(char *)pop + off, len);
+}
+
+/*
+ * obj_rep_persist -- (internal) persist to the pool and its replicas
+ */
+static void
+obj_rep_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->persist_local(addr, len);
+	replica_copy(pop, OBJ_PTR_TO_OFF(pop, addr), len);
+}
+
+/*
+ * obj_rep_flush -- (internal) flush to the pool and its replicas
+ */
+static void
+obj_rep_flush(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->flush_local(addr, len);
+
+	uint64_t off = OBJ_PTR_TO_OFF(pop, addr);
+	for (PMEMobjpool *rep = pop->replica; rep; rep = rep->replica) {
+		memcpy((char *)rep + off, addr, len);
+		rep->flush_local((char *)rep + off, len);
+	}
+}
+
+/*
+ * obj_rep_drain -- (internal) drain the pool and its replicas
+ */
+static void
+obj_rep_drain(PMEMobjpool *pop)
+{
+	pop->drain_local();
+
+	for (PMEMobjpool *rep = pop->replica; rep; rep = rep->replica)
+		rep->drain_local();
+}
+
+/*
+ * obj_rep_memcpy_persist -- (internal) memcpy to the pool and its replicas
+ */
+static void *
+obj_rep_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
+	size_t len)
+{
+	pop->memcpy_persist_local(dest, src, len);
+	replica_copy(pop, OBJ_PTR_TO_OFF(pop, dest), len);
+
+	return dest;
+}
+
+/*
+ * obj_rep_memset_persist -- (internal) memset the pool and its replicas
+ */
+static void *
+obj_rep_memset_persist(PMEMobjpool *pop, void *dest, int c, size_t len)
+{
+	pop->memset_persist_local(dest, c, len);
+
+	uint64_t off = OBJ_PTR_TO_OFF(pop, dest);
+	for (PMEMobjpool *rep = pop->replica; rep; rep = rep->replica)
+		rep->memset_persist_local((char *)rep + off, c, len);
+
+	return dest;
+}
+
+/*
+ * replica_enqueue -- (internal) queues a range to be copied to the replicas
+ *
+ * Waits for the worker if the queue is full or the range would put the
+ * replicas more than max_lag bytes behind the pool.  A range larger than
+ * max_lag waits for the queue to drain.
+ */
+static void
+replica_enqueue(PMEMobjpool *pop, void *addr, size_t len)
+{
+	struct replica_queue *rq = pop->rq;
+
+	pthread_mutex_lock(&rq->lock);
+
+	while (rq->tail - rq->head == REPLICA_QUEUE_LEN ||
+	    (rq->lag != 0 && rq->lag + len > rq->max_lag))
+		pthread_cond_wait(&rq->copied, &rq->lock);
+
+	struct replica_range *r = &rq->ranges[rq->tail % REPLICA_QUEUE_LEN];
+	r->offset = OBJ_PTR_TO_OFF(pop, addr);
+	r->size = len;
+	rq->tail++;
+	rq->lag += len;
+
+	pthread_cond_signal(&rq->queued);
+	pthread_mutex_unlock(&rq->lock);
+}
+
+/*
+ * obj_rep_async_persist -- (internal) persist to the pool, queue the range
+ *	for the replicas
+ */
+static void
+obj_rep_async_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->persist_local(addr, len);
+	replica_enqueue(pop, addr, len);
+}
+
+/*
+ * obj_rep_async_flush -- (internal) flush to the pool, queue the range
+ *	for the replicas
+ */
+static void
+obj_rep_async_flush(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->flush_local(addr, len);
+	replica_enqueue(pop, addr, len);
+}
+
+/*
+ * obj_rep_async_drain -- (internal) drain the pool
+ *
+ * The replicas are drained by the worker.
+ */
+static void
+obj_rep_async_drain(PMEMobjpool *pop)
+{
+	pop->drain_local();
+}
+
+/*
+ * obj_rep_async_memcpy_persist -- (internal) memcpy to the pool, queue the
+ *	range for the replicas
+ */
+static void *
+obj_rep_async_memcpy_persist(PMEMobjpool *pop, void *dest, const void *src,
+	size_t len)
+{
+	pop->memcpy_persist_local(dest, src, len);
+	replica_enqueue(pop, dest, len);
+
+	return dest;
+}
+
+/*
+ * obj_rep_async_memset_persist -- (internal) memset the pool, queue the
+ *	range for the replicas
+ */
+static void *
+obj_rep_async_memset_persist(PMEMobjpool *pop, void *dest, int c, size_t len)
+{
+	pop->memset_persist_local(dest, c, len);
+	replica_enqueue(pop, dest, len);
+
+	return dest;
+}
+
+/*
+ * replica_worker -- (internal) copies the queued ranges to the replicas
+ *
+ * The ranges are copied from the pool as it is at the time of the copy.
+ * A slot is not reused before the head moves past it, so the ranges can be
+ * read without holding the lock.
+ */
+static void *
+replica_worker(void *arg)
+{
+	PMEMobjpool *pop = arg;
+	struct replica_queue *rq = pop->rq;
+
+	pthread_mutex_lock(&rq->lock);
+
+	for (;;) {
+		while (rq->head == rq->tail && !rq->stop)
+			pthread_cond_wait(&rq->queued, &rq->lock);
+
+		if (rq->head == rq->tail)
+			break;
+
+		uint64_t head = rq->head;
+		uint64_t tail = rq->tail;
+		pthread_mutex_unlock(&rq->lock);
+
+		size_t copied = 0;
+		for (uint64_t i = head; i != tail; ++i) {
+			struct replica_range *r =
+				&rq->ranges[i % REPLICA_QUEUE_LEN];
+			replica_copy(pop, r->offset, r->size);
+			copied += r->size;
+		}
+
+		pthread_mutex_lock(&rq->lock);
+		rq->head = tail;
+		rq->lag -= copied;
+		pthread_cond_broadcast(&rq->copied);
+	}
+
+	pthread_mutex_unlock(&rq->lock);
+
+	return NULL;
+}
+
+/*
+ * replica_queue_new -- (internal) starts the asynchronous replication
+ */
+static int
+replica_queue_new(PMEMobjpool *pop, size_t max_lag)
+{
+	struct replica_queue *rq = Malloc(sizeof (*rq));
+	if (rq == NULL) {
+		ERR("!Malloc");
+		return ENOMEM;
+	}
+
+	memset(rq, 0, sizeof (*rq));
+	rq->max_lag = max_lag;
+
+	int err;
+	if ((err = pthread_mutex_init(&rq->lock, NULL)) != 0) {
+		ERR("!pthread_mutex_init");
+		goto error_lock_init;
+	}
+
+	if ((err = pthread_cond_init(&rq->queued, NULL)) != 0) {
+		ERR("!pthread_cond_init");
+		goto error_queued_init;
+	}
+
+	if ((err = pthread_cond_init(&rq->copied, NULL)) != 0) {
+		ERR("!pthread_cond_init");
+		goto error_copied_init;
+	}
+
+	pop->rq = rq;
+
+	if ((err = pthread_create(&rq->worker, NULL, replica_worker, pop))) {
+		ERR("!pthread_create");
+		goto error_worker_create;
+	}
+
+	return 0;
+
+error_worker_create:
+	pop->rq = NULL;
+	pthread_cond_destroy(&rq->copied);
+error_copied_init:
+	pthread_cond_destroy(&rq->queued);
+error_queued_init:
+	pthread_mutex_destroy(&rq->lock);
+error_lock_init:
+	Free(rq);
+	return err;
+}
+
+/*
+ * replica_queue_delete -- (internal) copies the queued ranges and stops the
+ *	asynchronous replication
+ */
+static void
+replica_queue_delete(PMEMobjpool *pop)
+{
+	struct replica_queue *rq = pop->rq;
+
+	pthread_mutex_lock(&rq->lock);
+	rq->stop = 1;
+	pthread_cond_signal(&rq->queued);
+	pthread_mutex_unlock(&rq->lock);
+
+	if ((errno = pthread_join(rq->worker, NULL)) != 0)
+		ERR("!pthread_join");
+
+	pthread_cond_destroy(&rq->copied);
+	pthread_cond_destroy(&rq->queued);
+	pthread_mutex_destroy(&rq->lock);
+	Free(rq);
+
+	pop->rq = NULL;
+}
+
+/*
+ * replica_sync_range -- (internal) copies the pages of the range which
+ *	differ between the pool and the replica
+ */
+static void
+replica_sync_range(PMEMobjpool *pop, PMEMobjpool *rep, size_t start,
+	size_t end)
+{
+	char *src = (char *)pop;
+	char *dst = (char *)rep;
+	size_t run_off = start;
+	size_t run_len = 0;
+
+	for (size_t off = start; off < end; ) {
+		size_t len = MIN(Pagesize - off % Pagesize, end - off);
+
+		if (memcmp(dst + off, src + off, len) != 0) {
+			if (run_len == 0)
+				run_off = off;
+			run_len += len;
+		} else if (run_len != 0) {
+			rep->memcpy_persist_local(dst + run_off,
+				src + run_off, run_len);
+			run_len = 0;
+		}
+
+		off += len;
+	}
+
+	if (run_len != 0)
+		rep->memcpy_persist_local(dst + run_off, src + run_off,
+			run_len);
+}
+
+/*
+ * replica_sync -- (internal) brings the replica up to date with the pool
+ *
+ * Only the pages which differ are written, so bringing a replica which
+ * is nearly up to date, or a new replica of a nearly empty pool, is cheap.
+ * The headers of the part files and the run-time part of the pool
+ * descriptor are not copied.
+ */
+static void
+replica_sync(PMEMobjpool *pop, PMEMobjpool *rep)
+{
+	LOG(3, "pop %p rep %p", pop, rep);
+
+	replica_sync_range(pop, rep, sizeof (struct pool_hdr),
+		offsetof(struct pmemobjpool, addr));
+	replica_sync_range(pop, rep, sizeof (struct pmemobjpool), pop->size);
+}
+
+/*
+ * replica_node -- (internal) returns the NUMA node of the mapping
+ *
+ * The nodes listed in PMEMOBJ_REPLICA_NODES, in the order of the set file,
+ * take precedence over the ones reported by the kernel.
+ */
+static int
+replica_node(PMEMobjpool *rep, const char **nodes)
+{
+	if (*nodes != NULL && **nodes != '\0') {
+		char *end;
+		long node = strtol(*nodes, &end, 10);
+		if (end == *nodes)
+			node = -1;
+
+		*nodes = *end == ',' ? end + 1 : end + strlen(end);
+		return (int)node;
+	}
+
+	/* the page must be present to be placed on a node */
+	volatile char *addr = (char *)rep + rep->lanes_offset;
+	(void) *addr;
+
+	int node = -1;
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr,
+			MPOL_F_NODE|MPOL_F_ADDR) != 0) {
+		LOG(4, "!get_mempolicy");
+		return -1;
+	}
+
+	return node;
+}
+
+/*
+ * replica_boot -- attaches the replicas to the pool
+ *
+ * The replicas which are out of date are brought up to date first.  If
+ * PMEMOBJ_REPLICA_LAG is set to a non-zero size, the replicas are updated
+ * by a worker thread and may lag up to that many bytes behind the pool.
+ */
+int
+replica_boot(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	const char *nodes = getenv(OBJ_REPLICA_NODES_VAR);
+	pop->numa_node = replica_node(pop, &nodes);
+
+	if (pop->set->replica == NULL)
+		return 0;
+
+	PMEMobjpool **prevp = &pop->replica;
+	for (struct pool_set *set = pop->set->replica; set;
+			set = set->replica) {
+		PMEMobjpool *rep = set->part[0].addr;
+
+		VALGRIND_REMOVE_PMEM_MAPPING(&rep->addr,
+			sizeof (struct pmemobjpool) -
+			sizeof (struct pool_hdr) -
+			OBJ_DSC_P_SIZE);
+
+		rep->addr = rep;
+		rep->size = set->poolsize;
+		rep->set = set;
+		rep->is_pmem = pmem_is_pmem(rep, set->poolsize);
+		rep->rdonly = 0;
+		rep->replica = NULL;
+		rep->rq = NULL;
+		obj_set_local_fns(rep);
+
+		if (memcmp(REPLICA_DSC(rep), REPLICA_DSC(pop),
+				OBJ_DSC_P_SIZE) != 0) {
+			LOG(3, "replica %s out of date", set->part[0].path);
+			replica_sync(pop, rep);
+		}
+
+		/* out of date until the pool is closed */
+		rep->checksum = 0;
+		rep->persist_local(&rep->checksum, sizeof (rep->checksum));
+
+		rep->numa_node = replica_node(rep, &nodes);
+
+		*prevp = rep;
+		prevp = &rep->replica;
+	}
+
+	size_t max_lag = 0;
+	char *e = getenv(OBJ_REPLICA_LAG_VAR);
+	if (e != NULL && util_parse_size(e, &max_lag) != 0) {
+		ERR("invalid %s value %s", OBJ_REPLICA_LAG_VAR, e);
+		return EINVAL;
+	}
+
+	if (max_lag != 0) {
+		int err;
+		if ((err = replica_queue_new(pop, max_lag)) != 0)
+			return err;
+
+		pop->persist = obj_rep_async_persist;
+		pop->flush = obj_rep_async_flush;
+		pop->drain = obj_rep_async_drain;
+		pop->memcpy_persist = obj_rep_async_memcpy_persist;
+		pop->memset_persist = obj_rep_async_memset_persist;
+	} else {
+		pop->persist = obj_rep_persist;
+		pop->flush = obj_rep_flush;
+		pop->drain = obj_rep_drain;
+		pop->memcpy_persist = obj_rep_memcpy_persist;
+		pop->memset_persist = obj_rep_memset_persist;
+	}
+
+	return 0;
+}
+
+/*
+ * replica_cleanup -- detaches the replicas from the pool
+ *
+ * If the pool is consistent, the replicas are marked as up to date.
+ */
+void
+replica_cleanup(PMEMobjpool *pop, int consistent)
+{
+	LOG(3, "pop %p consistent %d", pop, consistent);
+
+	if (pop->rq != NULL)
+		replica_queue_delete(pop);
+
+	if (!consistent)
+		return;
+
+	for (PMEMobjpool *rep = pop->replica; rep; rep = rep->replica)
+		rep->memcpy_persist_local(REPLICA_DSC(rep), REPLICA_DSC(pop),
+			OBJ_DSC_P_SIZE);
+}
+
+/*
+ * replica_local -- returns the copy of the pool on the NUMA node the
+ *	calling thread runs on, or the pool if there is none
+ */
+PMEMobjpool *
+replica_local(PMEMobjpool *pop)
+{
+	if (pop->replica == NULL)
+		return pop;
+
+	unsigned cpu;
+	unsigned node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+		return pop;
+
+	for (PMEMobjpool *rep = pop; rep; rep = rep->replica)
+		if (rep->numa_node == (int)node)
+			return rep;
+
+	return pop;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014, Intel Corporation
+ * Copyright (c) 2015, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -31,52 +31,40 @@
  */
 
 /*
- * workers.h -- definitions for the thread workers
+ * replica.h -- internal definitions for pool replicas
  */
 
-#include <stdint.h>
-#include <libpmemblk.h>
+/* bytes the replicas may lag behind the pool, unset or 0 - synchronous */
+#define	OBJ_REPLICA_LAG_VAR "PMEMOBJ_REPLICA_LAG"
 
-/*
- * Data structure for thread workers
- */
-struct worker_info {
-	unsigned long block_size;
-	unsigned long num_blocks;
-	unsigned int thread_index;
-	unsigned int seed;
-	unsigned int num_ops;
-	PMEMblkpool *handle;
-	int file_desc;
-	unsigned int file_lanes;
-};
+/* NUMA nodes of the pool and its replicas, overrides the detected ones */
+#define	OBJ_REPLICA_NODES_VAR "PMEMOBJ_REPLICA_NODES"
 
-/*
- * worker -- read worker function for pmem
- */
-void *r_worker(void *arg);
-/*
- * worker -- write worker function for pmem
- */
-void *w_worker(void *arg);
+#define	REPLICA_QUEUE_LEN 4096	/* ranges waiting to be copied */
 
-/*
- * prep_worker -- worker for the prep mode. Writes the whole
- * calculated range of lba's. This is similar to the rf_worker.
- */
-void *prep_worker(void *arg);
+struct replica_range {
+	uint64_t offset;
+	uint64_t size;
+};
 
 /*
- * warmup_worker -- worker for the warm-up. Reads the whole
- * calculated range of lba's. This is similar to the rf_worker.
+ * Ranges persisted in the pool, waiting to be copied to the replicas by
+ * the worker thread.  The head and tail only grow, the slot of a range is
+ * the index modulo REPLICA_QUEUE_LEN.
  */
-void *warmup_worker(void *arg);
+struct replica_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t queued;	/* signalled when a range is queued */
+	pthread_cond_t copied;	/* signalled when ranges are copied */
+	pthread_t worker;
+	int stop;
+	size_t lag;		/* bytes queued, but not copied yet */
+	size_t max_lag;
+	uint64_t head;		/* next range to be copied */
+	uint64_t tail;		/* next free slot */
+	struct replica_range ranges[REPLICA_QUEUE_LEN];
+};
 
-/*
- * worker -- read worker function for file io
- */
-void *rf_worker(void *arg);
-/*
- * worker -- write worker function for file io
- */
-void *wf_worker(void *arg);
+int replica_boot(PMEMobjpool *pop);
+void replica_cleanup(PMEMobjpool *pop, int consistent);
+PMEMobjpool *replica_local(PMEMobjpool *pop);
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * stats.c -- runtime statistics of libpmemobj
+ *
+ * The counters of a pool are sharded per thread and summed up on read.  When
+ * PMEMOBJ_STATS_SHM is set they live in a POSIX shared memory object named
+ * after the pool and the process, so that pmempool info can show them for
+ * an open pool.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libpmem.h"
+#include "libpmemobj.h"
+#include "util.h"
+#include "out.h"
+#include "lane.h"
+#include "redo.h"
+#include "list.h"
+#include "obj.h"
+#include "stats.h"
+#include "valgrind_internal.h"
+
+static unsigned Stats_next_shard;
+static __thread unsigned Stats_shard;	/* shard index + 1, 0 if unset */
+
+/*
+ * obj_stats_shm_create -- (internal) maps the shared memory object of the pool
+ *
+ * The object is named after the pool and the pid, and is created
+ * exclusively.  A pool cannot be open twice in one process, so an object with
+ * the same name can only be left behind by an earlier process with the same
+ * pid which did not close the pool.  It is removed and the creation retried
+ * once.
+ */
+static void *
+obj_stats_shm_create(PMEMobjpool *pop, size_t size)
+{
+	char name[OBJ_STATS_SHM_NAME_MAX];
+	snprintf(name, sizeof (name), OBJ_STATS_SHM_NAME,
+		(uintmax_t)pop->uuid_lo, (uintmax_t)getpid());
+
+	int fd;
+	int retry = 1;
+	while ((fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL,
+			S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH)) < 0) {
+		if (errno != EEXIST || !retry) {
+			LOG(1, "!shm_open %s", name);
+			return NULL;
+		}
+
+		LOG(2, "removing stale %s", name);
+		shm_unlink(name);
+		retry = 0;
+	}
+
+	void *addr = NULL;
+	if (ftruncate(fd, size) != 0) {
+		LOG(1, "!ftruncate %s", name);
+		goto err;
+	}
+
+	addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED) {
+		LOG(1, "!mmap %s", name);
+		addr = NULL;
+		goto err;
+	}
+
+	close(fd);
+	return addr;
+
+err:
+	close(fd);
+	shm_unlink(name);
+	return NULL;
+}
+
+/*
+ * obj_stats_boot -- sets up the statistics of the pool
+ *
+ * If the shared memory object cannot be created the statistics are kept in
+ * private memory, they are not worth failing the open for.
+ */
+int
+obj_stats_boot(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	size_t size = sizeof (struct obj_stats) +
+		OBJ_STATS_NSHARDS * sizeof (struct obj_stats_shard);
+	size = (size + Pagesize - 1) & ~(Pagesize - 1);
+
+	int shm = 0;
+	void *addr = NULL;
+
+	char *e = getenv(PMEMOBJ_STATS_SHM_VAR);
+	if (e != NULL && atoi(e) != 0 &&
+			(addr = obj_stats_shm_create(pop, size)) != NULL)
+		shm = 1;
+
+	if (addr == NULL) {
+		addr = mmap(NULL, size, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (addr == MAP_FAILED) {
+			ERR("!mmap of the statistics");
+			return errno;
+		}
+	}
+
+	/* both kinds of mappings start out zeroed */
+	struct obj_stats *s = addr;
+	s->major = OBJ_STATS_FORMAT_MAJOR;
+	s->nshards = OBJ_STATS_NSHARDS;
+	s->pid = (uint64_t)getpid();
+	s->uuid_lo = pop->uuid_lo;
+	s->size = size;
+	s->shm = shm;
+
+	/* the signature goes last, readers in other processes check it */
+	__sync_synchronize();
+	memcpy(s->signature, OBJ_STATS_SIG, sizeof (s->signature));
+
+	pop->stats = s;
+
+	return 0;
+}
+
+/*
+ * obj_stats_set_classes -- records the unit sizes of the allocation classes
+ *
+ * Called once the heap is booted.
+ */
+void
+obj_stats_set_classes(PMEMobjpool *pop, const struct pobj_heap_stats *hs)
+{
+	struct obj_stats *s = pop->stats;
+	if (s == NULL)
+		return;
+
+	for (unsigned i = 0; i < hs->nclasses; ++i)
+		s->unit_size[i] = hs->classes[i].unit_size;
+
+	s->nclasses = hs->nclasses;
+}
+
+/*
+ * obj_stats_cleanup -- releases the statistics of the pool
+ */
+void
+obj_stats_cleanup(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	struct obj_stats *s = pop->stats;
+	if (s == NULL)
+		return;
+
+	pop->stats = NULL;
+
+	if (s->shm) {
+		char name[OBJ_STATS_SHM_NAME_MAX];
+		snprintf(name, sizeof (name), OBJ_STATS_SHM_NAME,
+			(uintmax_t)s->uuid_lo, (uintmax_t)s->pid);
+		if (shm_unlink(name) != 0)
+			LOG(1, "!shm_unlink %s", name);
+	}
+
+	if (munmap(s, s->size) != 0)
+		ERR("!munmap");
+}
+
+/*
+ * obj_stats_add -- bumps a counter in the shard of the calling thread
+ *
+ * The shard is only shared with other threads when there are more threads
+ * than shards, the atomic add keeps the counters exact in that case and costs
+ * next to nothing on an uncontended cache line.
+ */
+void
+obj_stats_add(struct obj_stats *s, enum obj_stat stat, uint64_t n)
+{
+	if (Stats_shard == 0)
+		Stats_shard = (__sync_fetch_and_add(&Stats_next_shard, 1) &
+			(OBJ_STATS_NSHARDS - 1)) + 1;
+
+	__sync_fetch_and_add(&s->shards[Stats_shard - 1].counters[stat], n);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * stats.h -- internal definitions for the runtime statistics of libpmemobj
+ */
+
+#define	PMEMOBJ_STATS_SHM_VAR "PMEMOBJ_STATS_SHM"
+
+/*
+ * name of the shared memory object, the arguments are the pool's uuid_lo and
+ * the pid of the process which has the pool open
+ */
+#define	OBJ_STATS_SHM_NAME "/pmemobj.%016jx.%ju"
+#define	OBJ_STATS_SHM_NAME_MAX 64
+
+/* directory in which the shared memory objects can be listed */
+#define	OBJ_STATS_SHM_DIR "/dev/shm"
+
+#define	OBJ_STATS_SIG "PMEMSTS"	/* must be 8 bytes including '\0' */
+#define	OBJ_STATS_FORMAT_MAJOR 1
+
+#define	OBJ_STATS_NSHARDS 64	/* power of two */
+
+enum obj_stat {
+	OBJ_STAT_LANE_HOLDS,
+	OBJ_STAT_LANE_CONTENDED,
+	OBJ_STAT_TX_COMMITS,
+	OBJ_STAT_TX_ABORTS,
+	OBJ_STAT_TX_SNAPSHOTS,
+	OBJ_STAT_TX_SNAPSHOT_BYTES,
+	OBJ_STAT_BUCKET_REFILLS,
+	OBJ_STAT_ZONE_POPULATIONS,
+	OBJ_STAT_RUN_DEGRADATIONS,
+	OBJ_STAT_ALLOCS,	/* one counter per allocation class */
+	OBJ_STAT_FREES = OBJ_STAT_ALLOCS + PMEMOBJ_MAX_ALLOC_CLASSES,
+
+	MAX_OBJ_STAT = OBJ_STAT_FREES + PMEMOBJ_MAX_ALLOC_CLASSES
+};
+
+/*
+ * Each thread updates the counters of its own shard, the shards are only
+ * shared when there are more threads than shards.  A shard takes whole
+ * cache lines, so the threads do not bounce them between each other.
+ */
+struct obj_stats_shard {
+	uint64_t counters[MAX_OBJ_STAT];
+} __attribute__((aligned(_POBJ_CL_ALIGNMENT)));
+
+/*
+ * The statistics of an open pool, in private memory or, when
+ * PMEMOBJ_STATS_SHM is set, in a shared memory object other processes can
+ * map read-only.  The layout is in the byte order of the machine.
+ */
+struct obj_stats {
+	char signature[8];	/* OBJ_STATS_SIG */
+	uint32_t major;		/* OBJ_STATS_FORMAT_MAJOR */
+	uint32_t nshards;
+	uint64_t pid;		/* process which has the pool open */
+	uint64_t uuid_lo;
+	uint64_t size;		/* of the whole mapping */
+	uint32_t nclasses;
+	uint32_t shm;		/* true if in a shared memory object */
+	uint64_t unit_size[PMEMOBJ_MAX_ALLOC_CLASSES];
+	struct obj_stats_shard shards[];
+};
+
+int obj_stats_boot(PMEMobjpool *pop);
+void obj_stats_set_classes(PMEMobjpool *pop,
+	const struct pobj_heap_stats *hs);
+void obj_stats_cleanup(PMEMobjpool *pop);
+void obj_stats_add(struct obj_stats *s, enum obj_stat stat, uint64_t n);
+
+/*
+ * OBJ_STATS_ADD -- bump a counter of the pool, if the pool has statistics
+ */
+#define	OBJ_STATS_ADD(pop, stat, n) do {\
+	if ((pop)->stats != NULL)\
+		obj_stats_add((pop)->stats, (stat), (n));\
+} while (0)
+
+/*
+ * obj_stats_merge -- sums up the shards
+ *
+ * The counters are read without any synchronization, each of them is exact
+ * but they are not a consistent snapshot.  Used by pmempool too.
+ */
+static inline void
+obj_stats_merge(const struct obj_stats *s, struct pobj_stats *stats)
+{
+	uint64_t c[MAX_OBJ_STAT] = {0};
+
+	for (uint32_t i = 0; i < s->nshards; ++i)
+		for (int j = 0; j < MAX_OBJ_STAT; ++j)
+			c[j] += s->shards[i].counters[j];
+
+	memset(stats, 0, sizeof (*stats));
+	stats->lane_holds = c[OBJ_STAT_LANE_HOLDS];
+	stats->lane_contended = c[OBJ_STAT_LANE_CONTENDED];
+	stats->tx_commits = c[OBJ_STAT_TX_COMMITS];
+	stats->tx_aborts = c[OBJ_STAT_TX_ABORTS];
+	stats->tx_snapshots = c[OBJ_STAT_TX_SNAPSHOTS];
+	stats->tx_snapshot_bytes = c[OBJ_STAT_TX_SNAPSHOT_BYTES];
+	stats->bucket_refills = c[OBJ_STAT_BUCKET_REFILLS];
+	stats->zone_populations = c[OBJ_STAT_ZONE_POPULATIONS];
+	stats->run_degradations = c[OBJ_STAT_RUN_DEGRADATIONS];
+
+	stats->nclasses = s->nclasses;
+	for (uint32_t i = 0; i < s->nclasses; ++i) {
+		stats->classes[i].unit_size = s->unit_size[i];
+		stats->classes[i].allocs = c[OBJ_STAT_ALLOCS + i];
+		stats->classes[i].frees = c[OBJ_STAT_FREES + i];
+	}
+}
@@ -36,6 +36,11 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include "libpmem.h"
@@ -45,30 +50,697 @@
 #include "redo.h"
 #include "list.h"
 #include "obj.h"
+#include "sync.h"
 #include "out.h"
 #include "valgrind_internal.h"
 
+#define	VOLATILE_LOCKS(pop)\
+((pop)->locks != NULL && (pop)->locks->volatile_locks)
+
+#define	BIASED_RWLOCKS(pop)\
+((pop)->locks != NULL && (pop)->locks->biased_rwlocks)
+
 #define	GET_MUTEX(pop, mutexp)\
-get_lock((pop)->run_id,\
+(VOLATILE_LOCKS(pop) ?\
+	sync_table_get((pop), (mutexp), SYNC_MUTEX,\
+	(void *)pthread_mutex_init, NULL, sizeof (pthread_mutex_t)) :\
+	get_lock((pop)->run_id,\
 	&(mutexp)->pmemmutex.runid,\
 	&(mutexp)->pmemmutex.mutex,\
 	(void *)pthread_mutex_init,\
-	sizeof ((mutexp)->pmemmutex.mutex))
+	sizeof ((mutexp)->pmemmutex.mutex)))
 
 #define	GET_RWLOCK(pop, rwlockp)\
-get_lock((pop)->run_id,\
+(VOLATILE_LOCKS(pop) ?\
+	sync_table_get((pop), (rwlockp), SYNC_RWLOCK,\
+	(void *)pthread_rwlock_init, NULL, sizeof (pthread_rwlock_t)) :\
+	get_lock((pop)->run_id,\
 	&(rwlockp)->pmemrwlock.runid,\
 	&(rwlockp)->pmemrwlock.rwlock,\
 	(void *)pthread_rwlock_init,\
-	sizeof ((rwlockp)->pmemrwlock.rwlock))
+	sizeof ((rwlockp)->pmemrwlock.rwlock)))
 
 
 #define	GET_COND(pop, condp)\
-get_lock((pop)->run_id,\
+(VOLATILE_LOCKS(pop) ?\
+	sync_table_get((pop), (condp), SYNC_COND,\
+	(void *)pthread_cond_init, NULL, sizeof (pthread_cond_t)) :\
+	get_lock((pop)->run_id,\
 	&(condp)->pmemcond.runid,\
 	&(condp)->pmemcond.cond,\
 	(void *)pthread_cond_init,\
-	sizeof ((condp)->pmemcond.cond))
+	sizeof ((condp)->pmemcond.cond)))
+
+#define	GET_BRLOCK(pop, rwlockp)\
+((struct brlock *)sync_table_get((pop), (rwlockp), SYNC_BRLOCK,\
+	(void *)brlock_init, &(pop)->locks->nslots,\
+	BRLOCK_SIZE((pop)->locks->nslots)))
+
+/* marks a hash slot whose entry has been dropped */
+#define	SYNC_TOMBSTONE ((struct sync_entry *)1)
+
+/* offset of an entry that does not describe any lock */
+#define	SYNC_OFF_INVALID UINT64_MAX
+
+#define	SYNC_SORTED_MIN 64 /* initial capacity of the ordered entries */
+
+/*
+ * sync_entry -- volatile counterpart of a pmem resident lock
+ *
+ * The lock itself starts on a cache line of its own, so two hot locks never
+ * share one.
+ */
+struct sync_entry {
+	struct sync_entry *next; /* next unused entry of the same kind */
+	volatile uint64_t off;	/* offset of the pmem lock from the pool */
+	enum sync_kind kind;
+	void *base;		/* unaligned allocation to be freed */
+	char lock[] __attribute__((aligned(_POBJ_CL_ALIGNMENT)));
+};
+
+/*
+ * sync_slots -- open-addressing hash of the side-table entries
+ *
+ * At least a quarter of the slots is always NULL, which terminates probing.
+ */
+struct sync_slots {
+	struct sync_slots *retired; /* next hash replaced by a resize */
+	size_t mask;		/* number of slots - 1 */
+	size_t nused;		/* slots with an entry or a tombstone */
+	struct sync_entry *volatile slot[];
+};
+
+/*
+ * sync_hash -- (internal) map a lock offset to a hash slot
+ */
+static inline size_t
+sync_hash(struct sync_slots *s, uint64_t off)
+{
+	return (size_t)(((off >> 3) * 0x9E3779B97F4A7C15ULL) >> 32) & s->mask;
+}
+
+/*
+ * sync_slots_new -- (internal) allocate an empty hash of nslots slots
+ */
+static struct sync_slots *
+sync_slots_new(size_t nslots)
+{
+	size_t size = sizeof (struct sync_slots) +
+		nslots * sizeof (struct sync_entry *);
+	struct sync_slots *s = Malloc(size);
+	if (s == NULL) {
+		ERR("!Malloc");
+		return NULL;
+	}
+
+	memset(s, 0, size);
+	s->mask = nslots - 1;
+
+	return s;
+}
+
+/*
+ * sync_slots_find -- (internal) lock-free lookup of the entry of a lock
+ */
+static struct sync_entry *
+sync_slots_find(struct sync_slots *s, uint64_t off, enum sync_kind kind)
+{
+	for (size_t i = sync_hash(s, off); ; i = (i + 1) & s->mask) {
+		struct sync_entry *e = s->slot[i];
+		if (e == NULL)
+			return NULL;
+
+		if (e != SYNC_TOMBSTONE && e->off == off && e->kind == kind)
+			return e;
+	}
+}
+
+/*
+ * sync_slots_put -- (internal) publish an entry in the hash
+ */
+static void
+sync_slots_put(struct sync_slots *s, struct sync_entry *e)
+{
+	size_t i = sync_hash(s, e->off);
+	while (s->slot[i] != NULL && s->slot[i] != SYNC_TOMBSTONE)
+		i = (i + 1) & s->mask;
+
+	if (s->slot[i] == NULL)
+		s->nused++;
+
+	/* the entry must be complete before readers can see it */
+	__sync_synchronize();
+	s->slot[i] = e;
+}
+
+/*
+ * sync_slots_remove -- (internal) replace an entry in the hash by a tombstone
+ */
+static void
+sync_slots_remove(struct sync_slots *s, struct sync_entry *e)
+{
+	size_t i = sync_hash(s, e->off);
+	while (s->slot[i] != e)
+		i = (i + 1) & s->mask;
+
+	s->slot[i] = SYNC_TOMBSTONE;
+}
+
+/*
+ * sync_table_reserve -- (internal) make room for one more entry
+ *
+ * A hash that would become more than three quarters used is rebuilt without
+ * its tombstones, at twice the size if the live entries alone need it.  The
+ * old hash is kept until sync_cleanup, as lock-free readers may still probe
+ * it; they just miss the entries added later and retry under the lock.
+ */
+static int
+sync_table_reserve(struct sync_table *t)
+{
+	if (t->nsorted == t->sorted_max) {
+		size_t max = t->sorted_max ? t->sorted_max * 2 :
+			SYNC_SORTED_MIN;
+		struct sync_entry **sorted = Realloc(t->sorted,
+				max * sizeof (*sorted));
+		if (sorted == NULL) {
+			ERR("!Realloc");
+			return ENOMEM;
+		}
+		t->sorted = sorted;
+		t->sorted_max = max;
+	}
+
+	struct sync_slots *old = t->slots;
+	size_t nslots = old->mask + 1;
+	if ((old->nused + 1) * 4 <= nslots * 3)
+		return 0;
+
+	if ((t->nsorted + 1) * 2 > nslots)
+		nslots *= 2;
+
+	struct sync_slots *s = sync_slots_new(nslots);
+	if (s == NULL)
+		return ENOMEM;
+
+	for (size_t i = 0; i < t->nsorted; ++i)
+		sync_slots_put(s, t->sorted[i]);
+
+	__sync_synchronize();
+	t->slots = s;
+	old->retired = t->retired;
+	t->retired = old;
+
+	return 0;
+}
+
+/*
+ * sync_sorted_find -- (internal) index of the first entry at or above off
+ */
+static size_t
+sync_sorted_find(struct sync_table *t, uint64_t off)
+{
+	size_t lo = 0;
+	size_t hi = t->nsorted;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (t->sorted[mid]->off < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/*
+ * sync_table_insert -- (internal) create the volatile lock for off
+ *
+ * Dropped entries of the same kind are reused, so the memory held by the
+ * side-table is bounded by the largest number of locks alive at once.
+ */
+static struct sync_entry *
+sync_table_insert(struct sync_table *t, uint64_t off, enum sync_kind kind,
+	int (*init_lock)(void *lock, void *arg), void *arg, size_t size)
+{
+	if ((errno = pthread_mutex_lock(&t->lock)) != 0) {
+		ERR("!pthread_mutex_lock");
+		return NULL;
+	}
+
+	/* another thread might have been faster */
+	struct sync_entry *e = sync_slots_find(t->slots, off, kind);
+	if (e != NULL || sync_table_reserve(t) != 0)
+		goto out;
+
+	if ((e = t->unused[kind]) != NULL) {
+		t->unused[kind] = e->next;
+	} else {
+		void *base = Malloc(sizeof (*e) + size +
+				_POBJ_CL_ALIGNMENT - 1);
+		if (base == NULL) {
+			ERR("!Malloc");
+			goto out;
+		}
+
+		e = (struct sync_entry *)(((uintptr_t)base +
+			_POBJ_CL_ALIGNMENT - 1) &
+			~((uintptr_t)_POBJ_CL_ALIGNMENT - 1));
+		e->base = base;
+		e->off = SYNC_OFF_INVALID;
+		e->kind = kind;
+	}
+
+	if (init_lock(e->lock, arg)) {
+		ERR("error initializing lock");
+		e->next = t->unused[kind];
+		t->unused[kind] = e;
+		e = NULL;
+		goto out;
+	}
+
+	/* a stale reader of a reused entry must never see a half-built lock */
+	__sync_synchronize();
+	e->off = off;
+
+	size_t i = sync_sorted_find(t, off);
+	memmove(&t->sorted[i + 1], &t->sorted[i],
+		(t->nsorted - i) * sizeof (*t->sorted));
+	t->sorted[i] = e;
+	t->nsorted++;
+
+	if (off < t->off_min)
+		t->off_min = off;
+	if (off > t->off_max)
+		t->off_max = off;
+
+	sync_slots_put(t->slots, e);
+
+out:
+	if ((errno = pthread_mutex_unlock(&t->lock)) != 0)
+		ERR("!pthread_mutex_unlock");
+
+	return e;
+}
+
+/*
+ * sync_table_get -- (internal) find or create the volatile lock for lockp
+ *
+ * Entries are keyed by both the offset and the kind of the lock, so that
+ * the size of the returned lock always matches its kind.
+ *
+ * Lookups never take a lock and never write to the pool.  A missing entry
+ * is created under the side-table lock.
+ */
+static void *
+sync_table_get(PMEMobjpool *pop, void *lockp, enum sync_kind kind,
+	int (*init_lock)(void *lock, void *arg), void *arg, size_t size)
+{
+	struct sync_table *t = pop->locks;
+	uint64_t off = (uintptr_t)lockp - (uintptr_t)pop;
+
+	struct sync_entry *e = sync_slots_find(t->slots, off, kind);
+	if (e == NULL)
+		e = sync_table_insert(t, off, kind, init_lock, arg, size);
+
+	return e != NULL ? e->lock : NULL;
+}
+
+/*
+ * sync_table_drop -- forget the volatile locks in [off, off + size)
+ *
+ * Called when the memory of the pmem locks is zeroed or freed, so that the
+ * next user of that memory starts with fresh locks.  The dropped entries are
+ * only invalidated and kept for reuse, never freed, as lock-free readers of
+ * other locks may still be looking at them.
+ *
+ * Most freed objects hold no locks with a volatile counterpart, so a range
+ * outside of the bounds of the live entries returns without taking the
+ * side-table lock.  The bounds may be stale only because of locks outside
+ * of the range - a lock inside it must not be used concurrently with the
+ * free of its memory.
+ */
+void
+sync_table_drop(PMEMobjpool *pop, uint64_t off, size_t size)
+{
+	struct sync_table *t = pop->locks;
+	if (t == NULL)
+		return;
+
+	if (off > t->off_max || off + size <= t->off_min)
+		return;
+
+	if ((errno = pthread_mutex_lock(&t->lock)) != 0) {
+		ERR("!pthread_mutex_lock");
+		return;
+	}
+
+	size_t first = sync_sorted_find(t, off);
+	size_t last = first;
+	for (; last < t->nsorted && t->sorted[last]->off - off < size;
+			++last) {
+		struct sync_entry *e = t->sorted[last];
+
+		sync_slots_remove(t->slots, e);
+		e->off = SYNC_OFF_INVALID;
+		e->next = t->unused[e->kind];
+		t->unused[e->kind] = e;
+	}
+
+	memmove(&t->sorted[first], &t->sorted[last],
+		(t->nsorted - last) * sizeof (*t->sorted));
+	t->nsorted -= last - first;
+
+	if (t->nsorted == 0) {
+		t->off_min = UINT64_MAX;
+		t->off_max = 0;
+	} else {
+		t->off_min = t->sorted[0]->off;
+		t->off_max = t->sorted[t->nsorted - 1]->off;
+	}
+
+	if ((errno = pthread_mutex_unlock(&t->lock)) != 0)
+		ERR("!pthread_mutex_unlock");
+}
+
+/*
+ * Reader-biased rwlock.
+ *
+ * Readers announce themselves in one of nslots per-CPU indicators, each on
+ * its own cache line, so concurrent readers on different CPUs never write
+ * the same line.  A writer registers in nwriters first, which keeps new
+ * readers out, takes the writer mutex and then waits for all indicators to
+ * drain.  Writers queued on the mutex keep nwriters raised, so the lock is
+ * handed from writer to writer before readers are let in again.
+ *
+ * A reader that takes the lock again must not wait for a writer, which in
+ * turn waits for that reader.  Each thread therefore remembers the locks it
+ * holds for reading and re-enters them without checking for writers.
+ */
+#define	BRLOCK_SPINS 1024	/* pause iterations between yields */
+#define	BRLOCK_MAX_HELD 16	/* read locks held by one thread at once */
+
+struct brlock_slot {
+	volatile long readers;
+} __attribute__((aligned(_POBJ_CL_ALIGNMENT)));
+
+struct brlock {
+	volatile long nwriters;	/* writers holding or waiting for the lock */
+	volatile int wlocked;	/* true while a writer holds the lock */
+	pthread_t owner;	/* valid only if wlocked */
+	unsigned nslots;
+	pthread_mutex_t wlock;	/* serializes writers */
+	struct brlock_slot slots[];
+};
+
+#define	BRLOCK_SIZE(nslots)\
+(sizeof (struct brlock) + (nslots) * sizeof (struct brlock_slot))
+
+struct brlock_held {
+	struct brlock *lock;
+	unsigned depth;		/* read locks taken and not yet released */
+};
+
+static __thread int brlock_idx = -1;
+static int next_brlock_idx = 0;
+static __thread struct brlock_held brlock_held[BRLOCK_MAX_HELD];
+
+/*
+ * brlock_init -- (internal) initialize a reader-biased rwlock
+ */
+static int
+brlock_init(struct brlock *l, unsigned *nslots)
+{
+	memset(l, 0, BRLOCK_SIZE(*nslots));
+	l->nslots = *nslots;
+
+	return pthread_mutex_init(&l->wlock, NULL);
+}
+
+/*
+ * brlock_slot -- (internal) return the reader indicator of this thread
+ */
+static inline struct brlock_slot *
+brlock_slot(struct brlock *l)
+{
+	if (brlock_idx == -1)
+		brlock_idx = __sync_fetch_and_add(&next_brlock_idx, 1);
+
+	return &l->slots[(unsigned)brlock_idx % l->nslots];
+}
+
+/*
+ * brlock_held_find -- (internal) find l among the read locks of this thread
+ */
+static inline struct brlock_held *
+brlock_held_find(struct brlock *l)
+{
+	for (int i = 0; i < BRLOCK_MAX_HELD; ++i)
+		if (brlock_held[i].lock == l)
+			return &brlock_held[i];
+
+	return NULL;
+}
+
+/*
+ * brlock_backoff -- (internal) wait a little before retrying
+ *
+ * Returns true if abs_timeout (if any) has already passed.
+ */
+static int
+brlock_backoff(unsigned *spins, const struct timespec *abs_timeout)
+{
+	if (++(*spins) % BRLOCK_SPINS) {
+		CPU_SPINWAIT;
+		return 0;
+	}
+
+	sched_yield();
+
+	if (abs_timeout == NULL)
+		return 0;
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	return now.tv_sec > abs_timeout->tv_sec ||
+		(now.tv_sec == abs_timeout->tv_sec &&
+		now.tv_nsec >= abs_timeout->tv_nsec);
+}
+
+/*
+ * brlock_rdlock -- (internal) acquire a reader-biased rwlock for reading
+ *
+ * Like its POSIX counterpart, fails with EAGAIN if the thread already holds
+ * the maximum number of read locks.
+ */
+static int
+brlock_rdlock(struct brlock *l, int try,
+	const struct timespec *abs_timeout)
+{
+	struct brlock_held *h = brlock_held_find(l);
+	if (h != NULL) {
+		h->depth++;
+		return 0;
+	}
+
+	if (l->wlocked && pthread_equal(l->owner, pthread_self()))
+		return EDEADLK;
+
+	if ((h = brlock_held_find(NULL)) == NULL)
+		return EAGAIN;
+
+	struct brlock_slot *s = brlock_slot(l);
+	unsigned spins = 0;
+
+	for (;;) {
+		while (l->nwriters != 0) {
+			if (try)
+				return EBUSY;
+			if (brlock_backoff(&spins, abs_timeout))
+				return ETIMEDOUT;
+		}
+
+		__sync_fetch_and_add(&s->readers, 1);
+		if (l->nwriters == 0) {
+			h->lock = l;
+			h->depth = 1;
+			return 0;
+		}
+
+		/* a writer showed up, let it go first */
+		__sync_fetch_and_sub(&s->readers, 1);
+	}
+}
+
+/*
+ * brlock_wrlock -- (internal) acquire a reader-biased rwlock for writing
+ */
+static int
+brlock_wrlock(struct brlock *l, int try,
+	const struct timespec *abs_timeout)
+{
+	int ret;
+
+	/* waiting for our own read lock to drain would never end */
+	if (brlock_held_find(l) != NULL)
+		return EDEADLK;
+
+	__sync_fetch_and_add(&l->nwriters, 1);
+
+	if (try)
+		ret = pthread_mutex_trylock(&l->wlock);
+	else if (abs_timeout)
+		ret = pthread_mutex_timedlock(&l->wlock, abs_timeout);
+	else
+		ret = pthread_mutex_lock(&l->wlock);
+
+	if (ret) {
+		__sync_fetch_and_sub(&l->nwriters, 1);
+		return ret;
+	}
+
+	unsigned spins = 0;
+	for (unsigned i = 0; i < l->nslots; ++i) {
+		while (l->slots[i].readers != 0) {
+			if (try)
+				ret = EBUSY;
+			else if (brlock_backoff(&spins, abs_timeout))
+				ret = ETIMEDOUT;
+
+			if (ret) {
+				pthread_mutex_unlock(&l->wlock);
+				__sync_fetch_and_sub(&l->nwriters, 1);
+				return ret;
+			}
+		}
+	}
+
+	l->owner = pthread_self();
+	l->wlocked = 1;
+
+	return 0;
+}
+
+/*
+ * brlock_unlock -- (internal) release a reader-biased rwlock
+ */
+static int
+brlock_unlock(struct brlock *l)
+{
+	if (l->wlocked && pthread_equal(l->owner, pthread_self())) {
+		l->wlocked = 0;
+		/* hand over to a queued writer before readers may enter */
+		int ret = pthread_mutex_unlock(&l->wlock);
+		__sync_fetch_and_sub(&l->nwriters, 1);
+		return ret;
+	}
+
+	struct brlock_held *h = brlock_held_find(l);
+	if (h == NULL)
+		return EPERM;
+
+	if (--h->depth == 0) {
+		h->lock = NULL;
+		__sync_fetch_and_sub(&brlock_slot(l)->readers, 1);
+	}
+
+	return 0;
+}
+
+/*
+ * sync_boot -- set up the volatile lock side-table if requested
+ *
+ * Setting PMEMOBJ_VOLATILE_LOCKS=1 makes all PMEMmutex, PMEMrwlock and
+ * PMEMcond operations on this pool resolve to DRAM-resident locks, so
+ * taking a lock never stores to (or dirties cache lines of) the pool.
+ * Setting PMEMOBJ_BIASED_RWLOCKS=1 makes PMEMrwlock operations resolve to
+ * DRAM-resident reader-biased locks instead.
+ */
+int
+sync_boot(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	pop->locks = NULL;
+
+	char *e = getenv(OBJ_VOLATILE_LOCKS_VAR);
+	int volatile_locks = e != NULL && atoi(e) == 1;
+
+	e = getenv(OBJ_BIASED_RWLOCKS_VAR);
+	int biased_rwlocks = e != NULL && atoi(e) == 1;
+
+	if (!volatile_locks && !biased_rwlocks)
+		return 0;
+
+	pop->locks = Malloc(sizeof (struct sync_table));
+	if (pop->locks == NULL) {
+		ERR("!Malloc");
+		return ENOMEM;
+	}
+
+	memset(pop->locks, 0, sizeof (struct sync_table));
+
+	pop->locks->lock = (pthread_mutex_t)PTHREAD_MUTEX_INITIALIZER;
+	pop->locks->off_min = UINT64_MAX;
+	pop->locks->off_max = 0;
+	pop->locks->slots = sync_slots_new(SYNC_TABLE_MIN_SLOTS);
+	if (pop->locks->slots == NULL) {
+		Free(pop->locks);
+		pop->locks = NULL;
+		return ENOMEM;
+	}
+
+	pop->locks->volatile_locks = volatile_locks;
+	pop->locks->biased_rwlocks = biased_rwlocks;
+
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus < 1)
+		ncpus = 1;
+	else if (ncpus > BRLOCK_MAX_SLOTS)
+		ncpus = BRLOCK_MAX_SLOTS;
+	pop->locks->nslots = (unsigned)ncpus;
+
+	return 0;
+}
+
+/*
+ * sync_cleanup -- free the volatile lock side-table
+ */
+void
+sync_cleanup(PMEMobjpool *pop)
+{
+	LOG(3, "pop %p", pop);
+
+	if (pop->locks == NULL)
+		return;
+
+	struct sync_table *t = pop->locks;
+
+	for (size_t i = 0; i < t->nsorted; ++i)
+		Free(t->sorted[i]->base);
+	Free(t->sorted);
+
+	for (int k = 0; k < MAX_SYNC_KIND; ++k) {
+		while (t->unused[k] != NULL) {
+			struct sync_entry *e = t->unused[k];
+			t->unused[k] = e->next;
+			Free(e->base);
+		}
+	}
+
+	Free(t->slots);
+	while (t->retired != NULL) {
+		struct sync_slots *s = t->retired;
+		t->retired = s->retired;
+		Free(s);
+	}
+
+	if ((errno = pthread_mutex_destroy(&t->lock)) != 0)
+		ERR("!pthread_mutex_destroy");
+
+	Free(pop->locks);
+	pop->locks = NULL;
+}
 
 /*
  * get_lock -- (internal) atomically initialize and return a lock
@@ -101,6 +773,9 @@ get_lock(uint64_t pop_runid, volatile uint64_t *runid, void *lock,
 					return NULL;
 				}
 			}
+		} else {
+			/* another thread is initializing the lock */
+			CPU_SPINWAIT;
 		}
 	}
 	return lock;
@@ -117,8 +792,10 @@ pmemobj_mutex_zero(PMEMobjpool *pop, PMEMmutex *mutexp)
 	LOG(3, "pop %p mutex %p", pop, mutexp);
 
 	mutexp->pmemmutex.runid = 0;
-	pop->persist(&mutexp->pmemmutex.runid,
+	pop->persist(pop, &mutexp->pmemmutex.runid,
 				sizeof (&mutexp->pmemmutex.runid));
+	sync_table_drop(pop, (uintptr_t)mutexp - (uintptr_t)pop,
+		sizeof (*mutexp));
 }
 
 /*
@@ -184,8 +861,10 @@ pmemobj_rwlock_zero(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
 	rwlockp->pmemrwlock.runid = 0;
-	pop->persist(&rwlockp->pmemrwlock.runid,
+	pop->persist(pop, &rwlockp->pmemrwlock.runid,
 				sizeof (&rwlockp->pmemrwlock.runid));
+	sync_table_drop(pop, (uintptr_t)rwlockp - (uintptr_t)pop,
+		sizeof (*rwlockp));
 }
 
 /*
@@ -199,6 +878,14 @@ pmemobj_rwlock_rdlock(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 {
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_rdlock(l, 0, NULL);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -217,6 +904,14 @@ pmemobj_rwlock_wrlock(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 {
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_wrlock(l, 0, NULL);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -237,6 +932,14 @@ pmemobj_rwlock_timedrdlock(PMEMobjpool *pop, PMEMrwlock *__restrict rwlockp,
 	LOG(3, "pop %p rwlock %p timeout sec %ld nsec %ld", pop, rwlockp,
 		abs_timeout->tv_sec, abs_timeout->tv_nsec);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_rdlock(l, 0, abs_timeout);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -257,6 +960,14 @@ pmemobj_rwlock_timedwrlock(PMEMobjpool *pop, PMEMrwlock *__restrict rwlockp,
 	LOG(3, "pop %p rwlock %p timeout sec %ld nsec %ld", pop, rwlockp,
 		abs_timeout->tv_sec, abs_timeout->tv_nsec);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_wrlock(l, 0, abs_timeout);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -275,6 +986,14 @@ pmemobj_rwlock_tryrdlock(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 {
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_rdlock(l, 1, NULL);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -293,6 +1012,14 @@ pmemobj_rwlock_trywrlock(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 {
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_wrlock(l, 1, NULL);
+	}
+
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
 		return EINVAL;
@@ -308,6 +1035,14 @@ pmemobj_rwlock_unlock(PMEMobjpool *pop, PMEMrwlock *rwlockp)
 {
 	LOG(3, "pop %p rwlock %p", pop, rwlockp);
 
+	if (BIASED_RWLOCKS(pop)) {
+		struct brlock *l = GET_BRLOCK(pop, rwlockp);
+		if (l == NULL)
+			return EINVAL;
+
+		return brlock_unlock(l);
+	}
+
 	/* XXX potential performance improvement - move GET to debug version */
 	pthread_rwlock_t *rwlock = GET_RWLOCK(pop, rwlockp);
 	if (rwlock == NULL)
@@ -327,7 +1062,10 @@ pmemobj_cond_zero(PMEMobjpool *pop, PMEMcond *condp)
 	LOG(3, "pop %p cond %p", pop, condp);
 
 	condp->pmemcond.runid = 0;
-	pop->persist(&condp->pmemcond.runid, sizeof (&condp->pmemcond.runid));
+	pop->persist(pop, &condp->pmemcond.runid,
+		sizeof (&condp->pmemcond.runid));
+	sync_table_drop(pop, (uintptr_t)condp - (uintptr_t)pop,
+		sizeof (*condp));
 }
 
 /*
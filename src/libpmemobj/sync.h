@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * sync.h -- internal definitions for pmem resident locks
+ */
+
+/* opt-in: resolve PMEM locks through a volatile side-table */
+#define	OBJ_VOLATILE_LOCKS_VAR "PMEMOBJ_VOLATILE_LOCKS"
+
+/* opt-in: back PMEMrwlocks with reader-biased locks in the side-table */
+#define	OBJ_BIASED_RWLOCKS_VAR "PMEMOBJ_BIASED_RWLOCKS"
+
+#define	BRLOCK_MAX_SLOTS 256	/* upper bound of reader indicators per lock */
+
+#define	SYNC_TABLE_MIN_SLOTS 1024 /* initial hash size, must be a power of 2 */
+
+/*
+ * Kinds of volatile locks. The same pmem offset may be used by locks of
+ * different kinds over time (e.g. after the memory is freed and reused), each
+ * kind has an entry of its own and of its own size.
+ */
+enum sync_kind {
+	SYNC_MUTEX,
+	SYNC_RWLOCK,
+	SYNC_COND,
+	SYNC_BRLOCK,
+
+	MAX_SYNC_KIND
+};
+
+struct sync_entry;
+struct sync_slots;
+
+struct sync_table {
+	int volatile_locks;	/* all locks resolve to the side-table */
+	int biased_rwlocks;	/* rwlocks resolve to reader-biased locks */
+	unsigned nslots;	/* reader indicators per reader-biased lock */
+	pthread_mutex_t lock;	/* serializes inserts, drops and resizes */
+	struct sync_slots *volatile slots; /* hash of the live entries */
+	struct sync_slots *retired;	/* hashes replaced by a resize */
+	struct sync_entry **sorted;	/* live entries ordered by offset */
+	size_t nsorted;
+	size_t sorted_max;
+	volatile uint64_t off_min;	/* lowest offset of a live entry */
+	volatile uint64_t off_max;	/* highest offset of a live entry */
+	struct sync_entry *unused[MAX_SYNC_KIND]; /* dropped entries */
+};
+
+int sync_boot(PMEMobjpool *pop);
+void sync_cleanup(PMEMobjpool *pop);
+void sync_table_drop(PMEMobjpool *pop, uint64_t off, size_t size);
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * trace.c -- event tracing of libpmemobj
+ *
+ * When PMEMOBJ_TRACE names a file, every thread records the events of the
+ * hot paths into its own ring of TRACE_RING_SIZE records, overwriting the
+ * oldest ones.  Only the owning thread writes to a ring, so recording takes
+ * no locks; the lock below is taken once per thread, to get a ring.
+ *
+ * The rings are written out by trace_dump() at exit, on the signal given in
+ * PMEMOBJ_TRACE_SIGNAL and by pmemobj_trace_dump().  trace_dump() makes
+ * only async-signal-safe calls and reads the rings while they are being
+ * written, so the records of the running threads are a best effort.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "libpmemobj.h"
+#include "util.h"
+#include "out.h"
+#include "trace.h"
+
+struct trace_ring {
+	uint64_t head;			/* number of records ever written */
+	struct trace_ring *next;	/* all the rings */
+	struct trace_ring *next_free;	/* rings of the exited threads */
+	struct trace_record records[TRACE_RING_SIZE];
+};
+
+int Trace_enabled;
+
+static char *Trace_path;
+
+/* protects the list of free rings and appending to the list of all */
+static pthread_mutex_t Trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *volatile Trace_rings;
+static struct trace_ring *Trace_free;
+static pthread_key_t Trace_key;
+
+static __thread struct trace_ring *Trace_ring;
+static __thread uint32_t Trace_tid;
+
+/*
+ * trace_thread_fini -- (internal) give the ring of an exiting thread away
+ *
+ * The records stay in the ring until the next thread using it wraps.
+ */
+static void
+trace_thread_fini(void *arg)
+{
+	struct trace_ring *r = arg;
+
+	pthread_mutex_lock(&Trace_lock);
+	r->next_free = Trace_free;
+	Trace_free = r;
+	pthread_mutex_unlock(&Trace_lock);
+
+	Trace_ring = NULL;
+}
+
+/*
+ * trace_thread_init -- (internal) get a ring for the calling thread
+ */
+static struct trace_ring *
+trace_thread_init(void)
+{
+	struct trace_ring *r;
+
+	pthread_mutex_lock(&Trace_lock);
+	if ((r = Trace_free) != NULL) {
+		Trace_free = r->next_free;
+	} else if ((r = Malloc(sizeof (*r))) != NULL) {
+		r->head = 0;
+		r->next = Trace_rings;
+
+		/* trace_dump() walks the list without the lock */
+		__sync_synchronize();
+		Trace_rings = r;
+	}
+	pthread_mutex_unlock(&Trace_lock);
+
+	if (r == NULL)
+		return NULL;	/* the events of this thread are lost */
+
+	if ((errno = pthread_setspecific(Trace_key, r)) != 0)
+		ERR("!pthread_setspecific");
+
+	Trace_tid = (uint32_t)syscall(SYS_gettid);
+	Trace_ring = r;
+
+	return r;
+}
+
+/*
+ * trace_event -- record an event in the ring of the calling thread
+ */
+void
+trace_event(enum trace_event_type type, enum trace_phase phase, uint64_t arg)
+{
+	struct trace_ring *r = Trace_ring;
+	if (r == NULL && (r = trace_thread_init()) == NULL)
+		return;
+
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	struct trace_record *rec =
+		&r->records[r->head & (TRACE_RING_SIZE - 1)];
+	rec->time = (uint64_t)t.tv_sec * 1000000000 + (uint64_t)t.tv_nsec;
+	rec->arg = arg;
+	rec->tid = Trace_tid;
+	rec->type = type;
+	rec->phase = phase;
+
+	/* publish the record after it is written, stores are not reordered */
+	__asm__ __volatile__("" ::: "memory");
+	r->head++;
+}
+
+/*
+ * trace_write -- (internal) write all of the buffer
+ */
+static int
+trace_write(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+
+	while (len) {
+		ssize_t ret = write(fd, p, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += ret;
+		len -= (size_t)ret;
+	}
+
+	return 0;
+}
+
+/*
+ * trace_dump -- write the records of all the rings to a file
+ *
+ * Safe to call from a signal handler.
+ */
+int
+trace_dump(const char *path)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+
+	struct trace_file_header hdr;
+	memset(&hdr, 0, sizeof (hdr));
+	memcpy(hdr.signature, TRACE_HDR_SIG, sizeof (hdr.signature));
+	hdr.major = TRACE_FORMAT_MAJOR;
+	hdr.record_size = sizeof (struct trace_record);
+	hdr.pid = (uint32_t)getpid();
+
+	/* the number of records is known at the end */
+	if (trace_write(fd, &hdr, sizeof (hdr)))
+		goto err;
+
+	for (struct trace_ring *r = Trace_rings; r; r = r->next) {
+		uint64_t head = r->head;
+		uint64_t n = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+		uint64_t first = (head - n) & (TRACE_RING_SIZE - 1);
+
+		/* the oldest records are at the end of the array */
+		uint64_t n1 = n < TRACE_RING_SIZE - first ?
+			n : TRACE_RING_SIZE - first;
+		if (trace_write(fd, &r->records[first],
+				n1 * sizeof (struct trace_record)))
+			goto err;
+		if (trace_write(fd, &r->records[0],
+				(n - n1) * sizeof (struct trace_record)))
+			goto err;
+
+		hdr.nrecords += n;
+	}
+
+	if (pwrite(fd, &hdr, sizeof (hdr), 0) != sizeof (hdr))
+		goto err;
+
+	return close(fd);
+
+err:
+	(void) close(fd);
+	return -1;
+}
+
+/*
+ * trace_signal -- (internal) dump the records on a signal
+ */
+static void
+trace_signal(int sig)
+{
+	int olderrno = errno;
+
+	(void) trace_dump(Trace_path);
+
+	errno = olderrno;
+}
+
+/*
+ * trace_init -- enable the tracing if asked to
+ *
+ * Called by constructor.
+ */
+void
+trace_init(void)
+{
+	char *path = getenv(PMEMOBJ_TRACE_VAR);
+	if (path == NULL || *path == '\0')
+		return;
+
+	if ((Trace_path = Strdup(path)) == NULL) {
+		ERR("!Strdup");
+		return;
+	}
+
+	if ((errno = pthread_key_create(&Trace_key, trace_thread_fini))) {
+		ERR("!pthread_key_create");
+		Free(Trace_path);
+		return;
+	}
+
+	char *sig = getenv(PMEMOBJ_TRACE_SIGNAL_VAR);
+	if (sig) {
+		struct sigaction sa;
+
+		memset(&sa, 0, sizeof (sa));
+		sa.sa_handler = trace_signal;
+		sa.sa_flags = SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+
+		if (sigaction(atoi(sig), &sa, NULL))
+			ERR("!sigaction %s", sig);
+	}
+
+	LOG(3, "tracing to %s", Trace_path);
+	Trace_enabled = 1;
+}
+
+/*
+ * trace_fini -- write the records out
+ *
+ * Called by destructor.  Other threads may still be recording, so the rings
+ * are left to the exit of the process.
+ */
+void
+trace_fini(void)
+{
+	if (!Trace_enabled)
+		return;
+
+	Trace_enabled = 0;
+
+	if (trace_dump(Trace_path))
+		ERR("!%s", Trace_path);
+}
+
+/*
+ * pmemobj_trace_dump -- write the events recorded so far to a file
+ */
+int
+pmemobj_trace_dump(const char *path)
+{
+	LOG(3, "path %s", path);
+
+	if (!Trace_enabled) {
+		ERR("tracing is not enabled");
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (trace_dump(path)) {
+		ERR("!%s", path);
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * trace.h -- internal definitions for the event tracing of libpmemobj
+ */
+
+#define	PMEMOBJ_TRACE_VAR "PMEMOBJ_TRACE"
+#define	PMEMOBJ_TRACE_SIGNAL_VAR "PMEMOBJ_TRACE_SIGNAL"
+
+#define	TRACE_HDR_SIG "PMEMTRC"	/* must be 8 bytes including '\0' */
+#define	TRACE_FORMAT_MAJOR 1
+
+#define	TRACE_RING_SIZE	(1 << 15)	/* records per thread, power of two */
+
+enum trace_event_type {
+	TRACE_LANE_WAIT,	/* waiting for a lane, arg is the lane index */
+	TRACE_LANE_HOLD,	/* holding a lane, arg is the lane index */
+	TRACE_BUCKET_REFILL,	/* refilling a bucket, arg is its unit size */
+	TRACE_HEAP_POPULATE,	/* populating the buckets, arg is the zone */
+	TRACE_REDO_PROCESS,	/* processing a redo log, arg is the entries */
+	TRACE_TX,		/* outermost transaction, arg is the bytes */
+	TRACE_TX_COMMIT,	/* commit of the outermost transaction */
+	TRACE_TX_ABORT,		/* abort of the outermost transaction */
+	TRACE_TX_SNAPSHOT,	/* range added to the undo log, arg is size */
+	TRACE_LIST_INSERT_NEW,
+	TRACE_LIST_INSERT,
+	TRACE_LIST_REMOVE_FREE,
+	TRACE_LIST_REMOVE,
+	TRACE_LIST_MOVE_OOB,
+	TRACE_LIST_MOVE,
+	TRACE_LIST_REALLOC,
+	TRACE_LIST_REALLOC_MOVE,
+
+	MAX_TRACE_EVENT
+};
+
+enum trace_phase {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_INSTANT,
+
+	MAX_TRACE_PHASE
+};
+
+/*
+ * The dump file is a trace_file_header followed by nrecords trace_records,
+ * in the byte order of the machine that wrote it.  The records of each
+ * thread are in time order, threads follow each other.
+ */
+struct trace_file_header {
+	char signature[8];	/* TRACE_HDR_SIG */
+	uint32_t major;		/* TRACE_FORMAT_MAJOR */
+	uint32_t record_size;	/* sizeof (struct trace_record) */
+	uint32_t pid;
+	uint32_t unused;
+	uint64_t nrecords;
+};
+
+struct trace_record {
+	uint64_t time;		/* CLOCK_MONOTONIC, in nanoseconds */
+	uint64_t arg;
+	uint32_t tid;
+	uint16_t type;		/* enum trace_event_type */
+	uint16_t phase;		/* enum trace_phase */
+};
+
+extern int Trace_enabled;
+
+void trace_init(void);
+void trace_fini(void);
+void trace_event(enum trace_event_type type, enum trace_phase phase,
+	uint64_t arg);
+int trace_dump(const char *path);
+
+/*
+ * TRACE -- record an event if tracing is enabled, a single well predicted
+ * branch otherwise
+ */
+#define	TRACE(type, phase, arg) do {\
+	if (__builtin_expect(Trace_enabled, 0))\
+		trace_event((type), (phase), (arg));\
+} while (0)
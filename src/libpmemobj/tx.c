@@ -53,6 +53,8 @@
 #include "obj.h"
 #include "out.h"
 #include "pmalloc.h"
+#include "trace.h"
+#include "stats.h"
 #include "valgrind_internal.h"
 
 struct tx_data {
@@ -64,6 +66,7 @@ struct tx_data {
 static __thread struct {
 	enum pobj_tx_stage stage;
 	struct lane_section *section;
+	uint64_t snapshot_bytes;	/* of the outermost transaction */
 #if defined(_DISABLE_LOGGING) || defined(_EAP_FLUSH_ONLY)
 	enum pobj_tx_logtype logtype;
 #endif
@@ -78,10 +81,20 @@ struct tx_lock_data {
 	SLIST_ENTRY(tx_lock_data) tx_lock;
 };
 
+struct tx_durable_range {
+	uint64_t offset;
+	uint64_t size;
+};
+
 struct lane_tx_runtime {
 	PMEMobjpool *pop;
 	SLIST_HEAD(txd, tx_data) tx_entries;
 	SLIST_HEAD(txl, tx_lock_data) tx_locks;
+
+	/* pool ranges already made durable within the transaction */
+	struct tx_durable_range *durable;
+	size_t ndurable;
+	size_t durable_max;
 };
 
 struct tx_alloc_args {
@@ -370,6 +383,45 @@ void print_stats(){
 
 
 
+/*
+ * tx_durable_ranges_drop -- (internal) forgets the durable ranges which
+ *	overlap with the given range of the pool
+ *
+ * This is called when a block is freed or allocated within the transaction,
+ * the ranges made durable before don't describe its new contents.
+ */
+static void
+tx_durable_ranges_drop(struct lane_tx_runtime *lane, uint64_t offset,
+	uint64_t size)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < lane->ndurable; ++i) {
+		struct tx_durable_range *r = &lane->durable[i];
+		if (r->offset < offset + size && offset < r->offset + r->size)
+			continue;
+
+		lane->durable[n++] = *r;
+	}
+
+	lane->ndurable = n;
+}
+
+/*
+ * tx_durable_ranges_drop_obj -- (internal) forgets the durable ranges which
+ *	overlap with the whole memory block of an object
+ */
+static void
+tx_durable_ranges_drop_obj(PMEMobjpool *pop, void *ptr)
+{
+	struct lane_tx_runtime *lane = tx.section->runtime;
+	if (lane->ndurable == 0)
+		return;
+
+	uint64_t off = OBJ_PTR_TO_OFF(pop, ptr) - OBJ_OOB_SIZE;
+
+	tx_durable_ranges_drop(lane, off, pmalloc_usable_size(pop, off));
+}
+
 /*
  * constructor_tx_alloc -- (internal) constructor for normal alloc
  */
@@ -399,6 +451,8 @@ constructor_tx_alloc(PMEMobjpool *pop, void *ptr, void *arg)
 
 	/* do not report changes to the new object */
 	VALGRIND_ADD_TO_TX(ptr, args->size);
+
+	tx_durable_ranges_drop_obj(pop, ptr);
 }
 
 /*
@@ -431,6 +485,12 @@ constructor_tx_zalloc(PMEMobjpool *pop, void *ptr, void *arg)
 	/* do not report changes to the new object */
 	VALGRIND_ADD_TO_TX(ptr, args->size);
 
+	tx_durable_ranges_drop_obj(pop, ptr);
+
+	/*
+	 * The object is flushed in the pre-commit phase, together with
+	 * whatever the application stores into it.
+	 */
 	memset(ptr, 0, args->size);
 }
 
@@ -459,9 +519,9 @@ constructor_tx_add_range(PMEMobjpool *pop, void *ptr, void *arg)
 	void *src = OBJ_OFF_TO_PTR(args->pop, args->offset);
 
 	/* flush offset and size */
-	pop->flush(range, sizeof (struct tx_range));
+	pop->flush(pop, range, sizeof (struct tx_range));
 	/* memcpy data and persist */
-	pop->memcpy_persist(range->data, src, args->size);
+	pop->memcpy_persist(pop, range->data, src, args->size);
 
 	VALGRIND_REMOVE_FROM_TX(OOB_HEADER_FROM_PTR(ptr),
 			sizeof (struct tx_range) + args->size
@@ -500,6 +560,8 @@ constructor_tx_copy(PMEMobjpool *pop, void *ptr, void *arg)
 	/* do not report changes made to the copy */
 	VALGRIND_ADD_TO_TX(ptr, args->size);
 
+	tx_durable_ranges_drop_obj(pop, ptr);
+
 	memcpy(ptr, args->ptr, args->copy_size);
 }
 
@@ -533,6 +595,8 @@ constructor_tx_copy_zero(PMEMobjpool *pop, void *ptr, void *arg)
 	/* do not report changes made to the copy */
 	VALGRIND_ADD_TO_TX(ptr, args->size);
 
+	tx_durable_ranges_drop_obj(pop, ptr);
+
 	memcpy(ptr, args->ptr, args->copy_size);
 	if (args->size > args->copy_size) {
 		void *zero_ptr = (void *)((uintptr_t)ptr + args->copy_size);
@@ -548,7 +612,7 @@ static inline void
 tx_set_state(PMEMobjpool *pop, struct lane_tx_layout *layout, uint64_t state)
 {
 	layout->state = state;
-	pop->persist(&layout->state, sizeof (layout->state));
+	pop->persist(pop, &layout->state, sizeof (layout->state));
 }
 
 /*
@@ -748,7 +812,7 @@ tx_restore_range(PMEMobjpool *pop, struct tx_range *range)
 		struct tx_range_data *txr = SLIST_FIRST(&tx_ranges);
 		SLIST_REMOVE_HEAD(&tx_ranges, tx_range);
 		/* restore partial range data from snapshot */
-		pop->memcpy_persist(txr->begin,
+		pop->memcpy_persist(pop, txr->begin,
 				&range->data[txr->begin - dst_ptr],
 				txr->end - txr->begin);
 		Free(txr);
@@ -772,7 +836,8 @@ tx_abort_set(PMEMobjpool *pop, struct lane_tx_layout *layout, int recovery)
 
 		if (recovery) {
 			/* lane recovery */
-			pop->memcpy_persist(OBJ_OFF_TO_PTR(pop, range->offset),
+			pop->memcpy_persist(pop,
+					OBJ_OFF_TO_PTR(pop, range->offset),
 					range->data, range->size);
 		} else {
 			/* aborted transaction */
@@ -792,6 +857,130 @@ tx_abort_set(PMEMobjpool *pop, struct lane_tx_layout *layout, int recovery)
 	return 0;
 }
 
+/*
+ * tx_durable_range_cmp -- (internal) compares durable ranges by offset
+ */
+static int
+tx_durable_range_cmp(const void *lhs, const void *rhs)
+{
+	const struct tx_durable_range *l = lhs;
+	const struct tx_durable_range *r = rhs;
+
+	if (l->offset < r->offset)
+		return -1;
+
+	return l->offset > r->offset;
+}
+
+/*
+ * tx_durable_ranges_sort -- (internal) sorts and merges durable ranges
+ *
+ * After this the ranges are disjoint and ordered by both offset and end.
+ */
+static void
+tx_durable_ranges_sort(struct lane_tx_runtime *lane)
+{
+	if (lane->ndurable == 0)
+		return;
+
+	qsort(lane->durable, lane->ndurable, sizeof (*lane->durable),
+		tx_durable_range_cmp);
+
+	size_t n = 0;
+	for (size_t i = 1; i < lane->ndurable; ++i) {
+		struct tx_durable_range *last = &lane->durable[n];
+		struct tx_durable_range *r = &lane->durable[i];
+		uint64_t last_end = last->offset + last->size;
+
+		if (r->offset <= last_end) {
+			if (r->offset + r->size > last_end)
+				last->size = r->offset + r->size - last->offset;
+		} else {
+			lane->durable[++n] = *r;
+		}
+	}
+
+	lane->ndurable = n + 1;
+}
+
+/*
+ * tx_flush_nondurable -- (internal) flushes the parts of the range which
+ *	were not made durable within the transaction
+ *
+ * The durable ranges have to be sorted with tx_durable_ranges_sort.
+ */
+static void
+tx_flush_nondurable(PMEMobjpool *pop, struct lane_tx_runtime *lane,
+	uint64_t offset, uint64_t size)
+{
+	uint64_t end = offset + size;
+
+	/* find the first durable range that ends after the offset */
+	size_t lo = 0;
+	size_t hi = lane->ndurable;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		struct tx_durable_range *r = &lane->durable[mid];
+		if (r->offset + r->size <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (size_t i = lo; i < lane->ndurable && offset < end; ++i) {
+		struct tx_durable_range *r = &lane->durable[i];
+		if (r->offset >= end)
+			break;
+
+		if (r->offset > offset)
+			pop->flush(pop, (char *)pop + offset,
+				r->offset - offset);
+
+		offset = r->offset + r->size;
+	}
+
+	if (offset < end)
+		pop->flush(pop, (char *)pop + offset, end - offset);
+}
+
+/*
+ * tx_range_durable -- registers a range of the pool which was made durable
+ *	by the application within the current transaction
+ *
+ * Objects allocated in the transaction are persisted during the pre-commit
+ * phase, the registered ranges are skipped there. Failing to register a
+ * range is not an error, the range is just flushed again.
+ */
+void
+tx_range_durable(PMEMobjpool *pop, const void *addr, size_t len)
+{
+	if (tx.stage != TX_STAGE_WORK || len == 0)
+		return;
+
+	struct lane_tx_runtime *lane = tx.section->runtime;
+	if (lane->pop != pop)
+		return;
+
+	if ((uintptr_t)addr < (uintptr_t)pop ||
+		(uintptr_t)addr + len > (uintptr_t)pop + pop->size)
+		return;
+
+	if (lane->ndurable == lane->durable_max) {
+		size_t max = lane->durable_max ? lane->durable_max * 2 : 16;
+		struct tx_durable_range *durable = Realloc(lane->durable,
+			max * sizeof (*durable));
+		if (durable == NULL)
+			return;
+
+		lane->durable = durable;
+		lane->durable_max = max;
+	}
+
+	struct tx_durable_range *r = &lane->durable[lane->ndurable++];
+	r->offset = (uintptr_t)addr - (uintptr_t)pop;
+	r->size = len;
+}
+
 /*
  * tx_pre_commit_alloc -- (internal) do pre-commit operations for
  * allocated objects
@@ -803,6 +992,10 @@ tx_pre_commit_alloc(PMEMobjpool *pop, struct lane_tx_layout *layout)
 
 	PMEMoid iter;
 
+	struct lane_tx_runtime *lane =
+			(struct lane_tx_runtime *)tx.section->runtime;
+	tx_durable_ranges_sort(lane);
+
 #if defined(_DISABLE_LOGGING) || defined(_EAP_FLUSH_ONLY)
 
 	struct list_head tmphead;
@@ -845,9 +1038,15 @@ tx_pre_commit_alloc(PMEMobjpool *pop, struct lane_tx_layout *layout)
 		size_t size = pmalloc_usable_size(pop,
 				iter.off - OBJ_OOB_SIZE);
 
-		/* flush and persist the whole allocated area and oob header */
-		pop->persist(oobh, size);
+		/*
+		 * flush the oob header and the parts of the allocated area
+		 * which were not already made durable
+		 */
+		pop->flush(pop, oobh, OBJ_OOB_SIZE);
+		tx_flush_nondurable(pop, lane, iter.off, size - OBJ_OOB_SIZE);
 	}
+
+	pop->drain(pop);
 }
 
 /*
@@ -871,7 +1070,7 @@ tx_pre_commit_set(PMEMobjpool *pop, struct lane_tx_layout *layout)
 		void *ptr = OBJ_OFF_TO_PTR(pop, range->offset);
 
 		/* flush and persist modified area */
-		pop->persist(ptr, range->size);
+		pop->persist(pop, ptr, range->size);
 		//fprintf(stdout,"tx_pre_commit_set %lu\n", range->size);
 	}
 }
@@ -1326,6 +1525,10 @@ pmemobj_tx_begin(PMEMobjpool *pop, jmp_buf env, ...)
 		SLIST_INIT(&lane->tx_locks);
 
 		lane->pop = pop;
+		lane->ndurable = 0;
+
+		tx.snapshot_bytes = 0;
+		TRACE(TRACE_TX, TRACE_BEGIN, 0);
 	} else {
 		err = EINVAL;
 		goto err_abort;
@@ -1416,7 +1619,10 @@ pmemobj_tx_abort(int errnum)
 				(struct lane_tx_layout *)tx.section->layout;
 
 		/* process the undo log */
+		TRACE(TRACE_TX_ABORT, TRACE_BEGIN, 0);
 		tx_abort(lane->pop, layout, 0 /* abort */);
+		TRACE(TRACE_TX_ABORT, TRACE_END, tx.snapshot_bytes);
+		OBJ_STATS_ADD(lane->pop, OBJ_STAT_TX_ABORTS, 1);
 	}
 
 	txd->errnum = errnum;
@@ -1456,6 +1662,8 @@ pmemobj_tx_commit()
 		struct lane_tx_layout *layout =
 				(struct lane_tx_layout *)tx.section->layout;
 
+		TRACE(TRACE_TX_COMMIT, TRACE_BEGIN, 0);
+
 		/* pre-commit phase */
 		tx_pre_commit(lane->pop, layout);
 
@@ -1473,6 +1681,9 @@ pmemobj_tx_commit()
 			/* XXX need to handle this case somehow */
 			LOG(2, "tx_post_commit failed");
 		}
+
+		TRACE(TRACE_TX_COMMIT, TRACE_END, tx.snapshot_bytes);
+		OBJ_STATS_ADD(lane->pop, OBJ_STAT_TX_COMMITS, 1);
 	}
 
 	tx.stage = TX_STAGE_ONCOMMIT;
@@ -1524,6 +1735,7 @@ pmemobj_tx_end()
 
 		tx.stage = TX_STAGE_NONE;
 		release_and_free_tx_locks(lane);
+		TRACE(TRACE_TX, TRACE_END, tx.snapshot_bytes);
 		lane_release(lane->pop);
 		tx.section = NULL;
 	} else {
@@ -1616,6 +1828,9 @@ pmemobj_tx_add_common(struct tx_add_range_args *args)
 
 #endif /* DEBUG */
 
+	tx.snapshot_bytes += args->size;
+	TRACE(TRACE_TX_SNAPSHOT, TRACE_INSTANT, args->size);
+
 	/* insert snapshot to undo log */
 	PMEMoid snapshot;
 	int ret = list_insert_new(args->pop, &layout->undo_set, 0,
@@ -1625,6 +1840,12 @@ pmemobj_tx_add_common(struct tx_add_range_args *args)
 
 	ASSERTeq(ret, 0);
 
+	if (ret == 0) {
+		OBJ_STATS_ADD(args->pop, OBJ_STAT_TX_SNAPSHOTS, 1);
+		OBJ_STATS_ADD(args->pop, OBJ_STAT_TX_SNAPSHOT_BYTES,
+			args->size);
+	}
+
 	return ret;
 }
 
@@ -1732,6 +1953,58 @@ pmemobj_tx_alloc(size_t size, unsigned int type_num)
 	return tx_alloc_common(size, type_num, constructor_tx_alloc);
 }
 
+/*
+ * pmemobj_tx_alloc_n -- allocates n new objects of the same size
+ */
+int
+pmemobj_tx_alloc_n(PMEMoid *oids, size_t n, size_t size,
+	unsigned int type_num)
+{
+	LOG(3, "oids %p n %zu size %zu type_num %u", oids, n, size, type_num);
+
+	if (tx.stage != TX_STAGE_WORK) {
+		ERR("invalid tx stage");
+		errno = EINVAL;
+		return EINVAL;
+	}
+
+	if (size == 0 || n == 0 || type_num >= PMEMOBJ_NUM_OID_TYPES) {
+		ERR("invalid size %zu, n %zu or type_num %u",
+			size, n, type_num);
+		errno = EINVAL;
+		pmemobj_tx_abort(EINVAL);
+		return EINVAL;
+	}
+
+	struct lane_tx_runtime *lane =
+			(struct lane_tx_runtime *)tx.section->runtime;
+
+	struct lane_tx_layout *layout =
+			(struct lane_tx_layout *)tx.section->layout;
+
+	struct tx_alloc_args args = {
+			.type_num = type_num,
+			.size = size,
+	};
+
+	for (size_t i = 0; i < n; ++i)
+		oids[i] = OID_NULL;
+
+	/*
+	 * All objects land on the undo_alloc list, so the ones allocated
+	 * before a failure are released by the abort below.
+	 */
+	if (list_insert_new_n(lane->pop, &layout->undo_alloc, size, n,
+			constructor_tx_alloc, &args, oids) != 0) {
+		ERR("out of memory");
+		errno = ENOMEM;
+		pmemobj_tx_abort(ENOMEM);
+		return ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * pmemobj_tx_zalloc -- allocates a new zeroed object
  */
@@ -1874,6 +2147,9 @@ pmemobj_tx_free(PMEMoid oid)
 					0, NULL, &oid, oobh->inactive_oob);
 		}
 #endif
+		tx_durable_ranges_drop_obj(lane->pop,
+				OBJ_OFF_TO_PTR(lane->pop, oid.off));
+
 		/*
 		 * The object has been allocated within the same transaction
 		 * so we can just remove and free the object from undo log.
@@ -1903,6 +2179,9 @@ lane_transaction_construct(struct lane_section *section)
 static int
 lane_transaction_destruct(struct lane_section *section)
 {
+	struct lane_tx_runtime *lane = section->runtime;
+
+	Free(lane->durable);
 	Free(section->runtime);
 
 	return 0;
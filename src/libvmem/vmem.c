@@ -41,6 +41,7 @@
 #include <errno.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include "libvmem.h"
 
@@ -143,14 +144,77 @@ vmem_fini(void)
 	out_fini();
 }
 
+/*
+ * vmem_file_commit -- (internal) allocate the pool file blocks of a range
+ */
+static bool
+vmem_file_commit(void *addr, size_t size, void *arg)
+{
+	struct vmem_file *file = arg;
+
+	if (util_file_commit(file->fd, (char *)addr - file->addr, size) != 0) {
+		LOG(1, "!fallocate: addr %p size %zu", addr, size);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * vmem_file_decommit -- (internal) punch a hole in the pool file
+ */
+static bool
+vmem_file_decommit(void *addr, size_t size, void *arg)
+{
+	struct vmem_file *file = arg;
+
+	if (util_file_decommit(file->fd, (char *)addr - file->addr,
+			size) != 0) {
+		LOG(4, "!fallocate: addr %p size %zu", addr, size);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * vmem_set_flags -- (internal) apply the creation flags to a new pool
+ */
+static int
+vmem_set_flags(pool_t *pool, int flags)
+{
+	if (flags & ~VMEM_RESET_ONLY) {
+		LOG(1, "invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (flags & VMEM_RESET_ONLY)
+		je_vmem_pool_set_reset_only(pool);
+
+	return 0;
+}
+
 /*
  * vmem_create -- create a memory pool in a temp file
  */
 VMEM *
 vmem_create(const char *dir, size_t size)
+{
+	return vmem_create_flags(dir, size, 0);
+}
+
+/*
+ * vmem_create_flags -- create a memory pool in a temp file with flags
+ *
+ * The file is sparse if the file system allows it; the pool reserves the
+ * whole range, but the file blocks are allocated only for the chunks in use.
+ */
+VMEM *
+vmem_create_flags(const char *dir, size_t size, int flags)
 {
 	vmem_init();
-	LOG(3, "dir \"%s\" size %zu", dir, size);
+	LOG(3, "dir \"%s\" size %zu flags 0x%x", dir, size, flags);
 
 	if (size < VMEM_MIN_POOL) {
 		LOG(1, "size %zu smaller than %zu", size, VMEM_MIN_POOL);
@@ -161,10 +225,35 @@ vmem_create(const char *dir, size_t size)
 	/* silently enforce multiple of page size */
 	size = roundup(size, Pagesize);
 
-	void *addr;
-	if ((addr = util_map_tmpfile(dir, size)) == NULL)
+	int oerrno;
+	int sparse = 1;
+	int fd;
+	if ((fd = util_tmpfile(dir, size, &sparse)) == -1)
 		return NULL;
 
+	void *addr;
+	if ((addr = util_map(fd, size, 0)) == NULL)
+		goto err_close;
+
+	struct vmem_file *file = NULL;
+	if (sparse) {
+		if (util_file_commit(fd, 0, Header_size) != 0) {
+			ERR("!fallocate");
+			goto err_unmap;
+		}
+
+		if ((file = Malloc(sizeof (*file))) == NULL) {
+			ERR("!Malloc");
+			goto err_unmap;
+		}
+
+		file->fd = fd;
+		file->addr = addr;
+	} else {
+		(void) close(fd);
+		fd = -1;
+	}
+
 	/* store opaque info at beginning of mapped area */
 	struct vmem *vmp = addr;
 	memset(&vmp->hdr, '\0', sizeof (vmp->hdr));
@@ -172,13 +261,31 @@ vmem_create(const char *dir, size_t size)
 	vmp->addr = addr;
 	vmp->size = size;
 	vmp->caller_mapped = 0;
+	vmp->file = file;
 
 	/* Prepare pool for jemalloc */
-	if (je_vmem_pool_create((void *)((uintptr_t)addr + Header_size),
-			size - Header_size, 1) == NULL) {
-		LOG(1, "return NULL");
-		util_unmap(vmp->addr, vmp->size);
-		return NULL;
+	void *pool_addr = (void *)((uintptr_t)addr + Header_size);
+	pool_t *pool;
+	if (file != NULL)
+		pool = je_vmem_pool_create_sparse(pool_addr,
+				size - Header_size, vmem_file_commit,
+				vmem_file_decommit, file);
+	else
+		pool = je_vmem_pool_create(pool_addr, size - Header_size, 1);
+
+	if (pool == NULL) {
+		LOG(1, "vmem pool creation failed");
+		if (file != NULL)
+			Free(file);
+		errno = ENOMEM;
+		goto err_unmap;
+	}
+
+	if (vmem_set_flags(pool, flags) != 0) {
+		je_vmem_pool_delete(pool);
+		if (file != NULL)
+			Free(file);
+		goto err_unmap;
 	}
 
 	/*
@@ -191,6 +298,19 @@ vmem_create(const char *dir, size_t size)
 
 	LOG(3, "vmp %p", vmp);
 	return vmp;
+
+err_unmap:
+	oerrno = errno;
+	util_unmap(addr, size);
+	errno = oerrno;
+err_close:
+	if (fd != -1) {
+		oerrno = errno;
+		(void) close(fd);
+		errno = oerrno;
+	}
+	LOG(1, "return NULL");
+	return NULL;
 }
 
 /*
@@ -198,9 +318,19 @@ vmem_create(const char *dir, size_t size)
  */
 VMEM *
 vmem_create_in_region(void *addr, size_t size)
+{
+	return vmem_create_in_region_flags(addr, size, 0);
+}
+
+/*
+ * vmem_create_in_region_flags -- create a memory pool in a given range with
+ *	flags
+ */
+VMEM *
+vmem_create_in_region_flags(void *addr, size_t size, int flags)
 {
 	vmem_init();
-	LOG(3, "addr %p size %zu", addr, size);
+	LOG(3, "addr %p size %zu flags 0x%x", addr, size, flags);
 
 	if (((uintptr_t)addr & (Pagesize - 1)) != 0) {
 		LOG(1, "addr %p not aligned to pagesize %lu", addr, Pagesize);
@@ -221,10 +351,19 @@ vmem_create_in_region(void *addr, size_t size)
 	vmp->addr = addr;
 	vmp->size = size;
 	vmp->caller_mapped = 1;
+	vmp->file = NULL;
 
 	/* Prepare pool for jemalloc */
-	if (je_vmem_pool_create((void *)((uintptr_t)addr + Header_size),
-				size - Header_size, 0) == NULL) {
+	pool_t *pool = je_vmem_pool_create(
+			(void *)((uintptr_t)addr + Header_size),
+			size - Header_size, 0);
+	if (pool == NULL) {
+		LOG(1, "return NULL");
+		return NULL;
+	}
+
+	if (vmem_set_flags(pool, flags) != 0) {
+		je_vmem_pool_delete(pool);
 		LOG(1, "return NULL");
 		return NULL;
 	}
@@ -252,8 +391,35 @@ vmem_delete(VMEM *vmp)
 	je_vmem_pool_delete((pool_t *)((uintptr_t)vmp + Header_size));
 	util_range_rw(vmp->addr, sizeof (struct pool_hdr));
 
+	struct vmem_file *file = vmp->file;
+
 	if (vmp->caller_mapped == 0)
 		util_unmap(vmp->addr, vmp->size);
+
+	if (file != NULL) {
+		(void) close(file->fd);
+		Free(file);
+	}
+}
+
+/*
+ * vmem_reset -- free all allocations of a memory pool at once
+ *
+ * The pool metadata is rebuilt in place, without unmapping the pool.
+ */
+int
+vmem_reset(VMEM *vmp)
+{
+	LOG(3, "vmp %p", vmp);
+
+	int err = je_vmem_pool_reset((pool_t *)((uintptr_t)vmp + Header_size));
+	if (err != 0) {
+		errno = err;
+		ERR("!pool reset");
+		return -1;
+	}
+
+	return 0;
 }
 
 /*
@@ -281,6 +447,51 @@ vmem_stats_print(VMEM *vmp, const char *opts)
 			print_jemalloc_stats, NULL, opts);
 }
 
+/*
+ * vmem_stats_get -- read the counters of a pool without stopping allocation
+ *
+ * Unlike vmem_stats_print(), no allocator lock but the one guarding the
+ * arenas array is taken, so the values may be off by the operations in
+ * flight.  VMEM_STATS_SAMPLE skips the copy of the per class counters.
+ */
+int
+vmem_stats_get(VMEM *vmp, struct vmem_stats *stats, int flags)
+{
+	LOG(3, "vmp %p stats %p flags 0x%x", vmp, stats, flags);
+
+	if (flags & ~VMEM_STATS_SAMPLE) {
+		ERR("invalid flags 0x%x", flags);
+		errno = EINVAL;
+		return -1;
+	}
+
+	pool_stats_t pstats;
+	pool_bin_stats_t bins[VMEM_STATS_NCLASSES];
+	unsigned nbins = (flags & VMEM_STATS_SAMPLE) ? 0 : VMEM_STATS_NCLASSES;
+
+	je_vmem_pool_stats_get((pool_t *)((uintptr_t)vmp + Header_size),
+			&pstats, nbins ? bins : NULL, nbins);
+
+	stats->allocated = pstats.allocated;
+	stats->active = pstats.active;
+	stats->mapped = pstats.mapped;
+	stats->nmalloc = pstats.nmalloc;
+	stats->ndalloc = pstats.ndalloc;
+	stats->nlock_contended = pstats.nlock_contended;
+	stats->nclasses = MIN(pstats.nbins, nbins);
+
+	for (unsigned i = 0; i < stats->nclasses; ++i) {
+		stats->classes[i].size = bins[i].size;
+		stats->classes[i].curobjs = bins[i].curobjs;
+		stats->classes[i].nmalloc = bins[i].nmalloc;
+		stats->classes[i].ndalloc = bins[i].ndalloc;
+		stats->classes[i].nrequests = bins[i].nrequests;
+		stats->classes[i].nlock_contended = bins[i].nlock_contended;
+	}
+
+	return 0;
+}
+
 /*
  * vmem_malloc -- allocate memory
  */
@@ -47,12 +47,22 @@
 
 extern unsigned long Pagesize;
 
+/*
+ * backing file of a pool grown on demand, kept outside of the pool header
+ * page as that page is inaccessible while the pool is in use
+ */
+struct vmem_file {
+	int fd;		/* sparse pool file */
+	char *addr;	/* address the file is mapped at */
+};
+
 struct vmem {
 	struct pool_hdr hdr;	/* memory pool header */
 
 	void *addr;	/* mapped region */
 	size_t size;	/* size of mapped region */
 	int caller_mapped;
+	struct vmem_file *file;	/* NULL unless the pool file is sparse */
 };
 
 void vmem_init(void);
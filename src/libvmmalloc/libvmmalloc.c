@@ -39,10 +39,10 @@
  *    to the standard jemalloc interfaces that operate on a system heap.
  *    There is no need to track these allocations.  For small allocations,
  *    jemalloc is able to detect the corresponding pool the memory was
- *    allocated from, and Vmp argument is actually ignored.  So, it is safe
- *    to reclaim this memory using je_vmem_pool_free().
- *    The problem may occur for huge allocations only (>2MB), but it seems
- *    like such allocations do not happen at initialization phase.
+ *    allocated from, and Vmp argument is actually ignored.  Anyway, free(3)
+ *    checks the address of the block, so any block not residing in the pool
+ *    is returned to the system heap.
+ *    Huge allocations (>2MB) are not expected at initialization phase.
  *
  * 2) Debug traces in malloc(3) functions are not available until library
  *    initialization (vmem pool creation) is completed.  This is to avoid
@@ -54,6 +54,11 @@
  *
  * 4) If the process forks, there is no separate log file open for a new
  *    process, even if the configured log file name is terminated with "-".
+ *
+ * 5) Small or frequently allocated blocks may be served from the system heap
+ *    (DRAM) instead of the pool - see VMMALLOC_DRAM_MAX_SIZE and
+ *    VMMALLOC_DRAM_HOT_SAMPLE.  Such blocks are found by their address, so
+ *    it is transparent for the application.
  */
 
 #define	_GNU_SOURCE
@@ -63,6 +68,7 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/param.h>
+#include <sys/ioctl.h>
 #include <errno.h>
 #include <stdint.h>
 #include <signal.h>
@@ -81,6 +87,17 @@
 
 #define	HUGE (2 * 1024 * 1024)
 
+#ifndef FICLONE
+#define	FICLONE _IOW(0x94, 9, int)
+#endif
+
+/*
+ * memory tiers the allocations are routed to
+ */
+#define	TIER_DRAM 0	/* system heap */
+#define	TIER_PMEM 1	/* memory pool */
+#define	MAX_TIER 2
+
 /*
  * private to this file...
  */
@@ -90,8 +107,190 @@ static char *Dir;
 static int Fd;
 static int Fd_clone;
 static int Private;
+static int Sparse = 1;	/* pool file blocks allocated on demand */
 static int Forkopt = 1; /* default behavior - remap as private */
 
+static size_t Dram_max_size; /* max size of allocations routed to DRAM */
+static unsigned Hot_sample; /* call site sampling period, 0 - disabled */
+static unsigned Hot_counts[VMMALLOC_HOT_SITES];
+static unsigned Hot_nsamples;
+static __thread unsigned Hot_tick __attribute__((tls_model("initial-exec")));
+
+static int Tier_stats;
+static size_t Tier_bytes[MAX_TIER];
+static size_t Tier_allocs[MAX_TIER];
+static const char *Tier_names[MAX_TIER] = { "DRAM", "pmem" };
+
+/*
+ * libvmmalloc_hot_decay -- (internal) age the call site hotness table
+ */
+static void
+libvmmalloc_hot_decay(void)
+{
+	for (unsigned i = 0; i < VMMALLOC_HOT_SITES; i++)
+		Hot_counts[i] >>= 1;
+}
+
+/*
+ * libvmmalloc_tier -- (internal) select the tier for a new allocation
+ *
+ * Allocations not larger than Dram_max_size are always served from the
+ * system heap.  If call site sampling is enabled, every Hot_sample-th
+ * allocation of a thread is attributed to its call site, and the sites
+ * that are sampled often enough are considered hot - their (small)
+ * allocations are served from the system heap too.  The table is aged
+ * periodically, so the sites that are no longer hot go back to the pool.
+ */
+static inline int
+libvmmalloc_tier(size_t size, const void *caller)
+{
+	if (Dram_max_size != 0 && size <= Dram_max_size)
+		return TIER_DRAM;
+
+	if (Hot_sample == 0 || size > VMMALLOC_HOT_MAX_SIZE)
+		return TIER_PMEM;
+
+	uintptr_t site = (uintptr_t)caller;
+	unsigned *cnt = &Hot_counts[((site >> 4) ^ (site >> 16)) &
+			(VMMALLOC_HOT_SITES - 1)];
+
+	if (++Hot_tick >= Hot_sample) {
+		Hot_tick = 0;
+		if (*cnt < VMMALLOC_HOT_MAX_COUNT)
+			__sync_fetch_and_add(cnt, 1);
+
+		if (__sync_add_and_fetch(&Hot_nsamples, 1) %
+				VMMALLOC_HOT_DECAY == 0)
+			libvmmalloc_hot_decay();
+	}
+
+	return *cnt >= VMMALLOC_HOT_THRESHOLD ? TIER_DRAM : TIER_PMEM;
+}
+
+/*
+ * libvmmalloc_tier_owner -- (internal) return the tier a block belongs to
+ */
+static inline int
+libvmmalloc_tier_owner(void *ptr)
+{
+	uintptr_t p = (uintptr_t)ptr;
+
+	if (p >= (uintptr_t)Vmp && p < (uintptr_t)Vmp + Vmp->size)
+		return TIER_PMEM;
+
+	return TIER_DRAM;
+}
+
+/*
+ * libvmmalloc_tier_usable -- (internal) get usable size of a block
+ */
+static inline size_t
+libvmmalloc_tier_usable(int tier, void *ptr)
+{
+	if (tier == TIER_DRAM)
+		return je_vmem_malloc_usable_size(ptr);
+
+	return je_vmem_pool_malloc_usable_size(
+			(pool_t *)((uintptr_t)Vmp + Header_size), ptr);
+}
+
+/*
+ * libvmmalloc_tier_count -- (internal) add or subtract a block to/from
+ * per tier statistics
+ */
+static inline void
+libvmmalloc_tier_count(int tier, void *ptr, int alloc)
+{
+	if (ptr == NULL)
+		return;
+
+	size_t size = libvmmalloc_tier_usable(tier, ptr);
+	if (alloc) {
+		__sync_fetch_and_add(&Tier_bytes[tier], size);
+		__sync_fetch_and_add(&Tier_allocs[tier], 1);
+	} else {
+		__sync_fetch_and_sub(&Tier_bytes[tier], size);
+	}
+}
+
+/*
+ * libvmmalloc_tier_account -- (internal) update per tier statistics
+ */
+static inline void
+libvmmalloc_tier_account(int tier, void *ptr, int alloc)
+{
+	if (Tier_stats)
+		libvmmalloc_tier_count(tier, ptr, alloc);
+}
+
+/*
+ * libvmmalloc_boot_account -- (internal) update statistics of the system
+ * heap before the pool is created
+ *
+ * Tier_stats is not known until the constructor runs, but the blocks
+ * allocated before that may be freed after, which would make Tier_bytes
+ * wrap around.  There are only a few of them, so they are always counted.
+ */
+static inline void
+libvmmalloc_boot_account(void *ptr, int alloc)
+{
+	libvmmalloc_tier_count(TIER_DRAM, ptr, alloc);
+}
+
+/*
+ * libvmmalloc_tier_malloc -- (internal) allocate a block from the given tier
+ */
+static void *
+libvmmalloc_tier_malloc(int tier, size_t size)
+{
+	void *ptr;
+
+	if (tier == TIER_DRAM)
+		ptr = je_vmem_malloc(size);
+	else
+		ptr = je_vmem_pool_malloc(
+			(pool_t *)((uintptr_t)Vmp + Header_size), size);
+
+	libvmmalloc_tier_account(tier, ptr, 1);
+	return ptr;
+}
+
+/*
+ * libvmmalloc_tier_aligned -- (internal) allocate an aligned block from
+ * the given tier
+ */
+static void *
+libvmmalloc_tier_aligned(int tier, size_t alignment, size_t size)
+{
+	void *ptr;
+
+	if (tier == TIER_DRAM)
+		ptr = je_vmem_memalign(alignment, size);
+	else
+		ptr = je_vmem_pool_aligned_alloc(
+			(pool_t *)((uintptr_t)Vmp + Header_size),
+			alignment, size);
+
+	libvmmalloc_tier_account(tier, ptr, 1);
+	return ptr;
+}
+
+/*
+ * libvmmalloc_tier_free -- (internal) free a block, whichever tier it is in
+ */
+static void
+libvmmalloc_tier_free(void *ptr)
+{
+	int tier = libvmmalloc_tier_owner(ptr);
+
+	libvmmalloc_tier_account(tier, ptr, 0);
+
+	if (tier == TIER_DRAM)
+		je_vmem_free(ptr);
+	else
+		je_vmem_pool_free((pool_t *)((uintptr_t)Vmp + Header_size),
+				ptr);
+}
 
 /*
  * malloc -- allocate a block of size bytes
@@ -103,11 +302,14 @@ malloc(size_t size)
 {
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_malloc(size);
+		void *ptr = je_vmem_malloc(size);
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "size %zu", size);
-	return je_vmem_pool_malloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size), size);
+	return libvmmalloc_tier_malloc(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
+			size);
 }
 
 /*
@@ -118,17 +320,36 @@ __ATTR_ALLOC_SIZE__(1, 2)
 void *
 calloc(size_t nmemb, size_t size)
 {
+	if (size != 0 && nmemb > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
 	if (Vmp == NULL) {
 		ASSERT((nmemb * size) <= HUGE);
-		return je_vmem_calloc(nmemb, size);
+		void *ptr = je_vmem_calloc(nmemb, size);
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "nmemb %zu, size %zu", nmemb, size);
-	return je_vmem_pool_calloc((pool_t *)((uintptr_t)Vmp + Header_size),
-			nmemb, size);
+
+	void *ptr;
+	int tier = libvmmalloc_tier(nmemb * size, __builtin_return_address(0));
+	if (tier == TIER_DRAM)
+		ptr = je_vmem_calloc(nmemb, size);
+	else
+		ptr = je_vmem_pool_calloc(
+			(pool_t *)((uintptr_t)Vmp + Header_size), nmemb, size);
+
+	libvmmalloc_tier_account(tier, ptr, 1);
+	return ptr;
 }
 
 /*
  * realloc -- resize a block previously allocated by malloc
+ *
+ * If the new size belongs to a different tier than the block, the block
+ * is moved to that tier.
  */
 __ATTR_ALLOC_SIZE__(2)
 void *
@@ -136,11 +357,52 @@ realloc(void *ptr, size_t size)
 {
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_realloc(ptr, size);
+		if (ptr != NULL)
+			libvmmalloc_boot_account(ptr, 0);
+		void *new_ptr = je_vmem_realloc(ptr, size);
+		if (new_ptr == NULL && size != 0)
+			libvmmalloc_boot_account(ptr, 1);
+		libvmmalloc_boot_account(new_ptr, 1);
+		return new_ptr;
 	}
 	LOG(4, "ptr %p, size %zu", ptr, size);
-	return je_vmem_pool_ralloc((pool_t *)((uintptr_t)Vmp + Header_size),
-			ptr, size);
+
+	int tier = libvmmalloc_tier(size, __builtin_return_address(0));
+	if (ptr == NULL)
+		return libvmmalloc_tier_malloc(tier, size);
+
+	int owner = libvmmalloc_tier_owner(ptr);
+	if (tier == owner || size == 0) {
+		size_t old_size = Tier_stats ?
+				libvmmalloc_tier_usable(owner, ptr) : 0;
+		void *new_ptr;
+
+		if (owner == TIER_DRAM)
+			new_ptr = je_vmem_realloc(ptr, size);
+		else
+			new_ptr = je_vmem_pool_ralloc(
+				(pool_t *)((uintptr_t)Vmp + Header_size),
+				ptr, size);
+
+		if (Tier_stats && (new_ptr != NULL || size == 0)) {
+			__sync_fetch_and_sub(&Tier_bytes[owner], old_size);
+			if (new_ptr != NULL)
+				__sync_fetch_and_add(&Tier_bytes[owner],
+					libvmmalloc_tier_usable(owner,
+						new_ptr));
+		}
+
+		return new_ptr;
+	}
+
+	void *new_ptr = libvmmalloc_tier_malloc(tier, size);
+	if (new_ptr == NULL)
+		return NULL;
+
+	memcpy(new_ptr, ptr, MIN(size, libvmmalloc_tier_usable(owner, ptr)));
+	libvmmalloc_tier_free(ptr);
+
+	return new_ptr;
 }
 
 /*
@@ -150,11 +412,12 @@ void
 free(void *ptr)
 {
 	if (Vmp == NULL) {
+		libvmmalloc_boot_account(ptr, 0);
 		je_vmem_free(ptr);
 		return;
 	}
 	LOG(4, "ptr %p", ptr);
-	je_vmem_pool_free((pool_t *)((uintptr_t)Vmp + Header_size), ptr);
+	libvmmalloc_tier_free(ptr);
 }
 
 /*
@@ -166,11 +429,12 @@ void
 cfree(void *ptr)
 {
 	if (Vmp == NULL) {
+		libvmmalloc_boot_account(ptr, 0);
 		je_vmem_free(ptr);
 		return;
 	}
 	LOG(4, "ptr %p", ptr);
-	je_vmem_pool_free((pool_t *)((uintptr_t)Vmp + Header_size), ptr);
+	libvmmalloc_tier_free(ptr);
 }
 
 #ifdef	VMMALLOC_OVERRIDE_MEMALIGN
@@ -186,11 +450,13 @@ memalign(size_t boundary, size_t size)
 {
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_memalign(boundary, size);
+		void *ptr = je_vmem_memalign(boundary, size);
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "boundary %zu  size %zu", boundary, size);
-	return je_vmem_pool_aligned_alloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size),
+	return libvmmalloc_tier_aligned(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
 			boundary, size);
 }
 #endif
@@ -212,11 +478,13 @@ aligned_alloc(size_t alignment, size_t size)
 
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_memalign(alignment, size);
+		void *ptr = je_vmem_memalign(alignment, size);
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "alignment %zu  size %zu", alignment, size);
-	return je_vmem_pool_aligned_alloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size),
+	return libvmmalloc_tier_aligned(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
 			alignment, size);
 }
 #endif
@@ -236,12 +504,14 @@ posix_memalign(void **memptr, size_t alignment, size_t size)
 		*memptr = je_vmem_memalign(alignment, size);
 		if (*memptr == NULL)
 			ret = errno;
+		else
+			libvmmalloc_boot_account(*memptr, 1);
 		errno = oerrno;
 		return ret;
 	}
 	LOG(4, "alignment %zu  size %zu", alignment, size);
-	*memptr = je_vmem_pool_aligned_alloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size),
+	*memptr = libvmmalloc_tier_aligned(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
 			alignment, size);
 	if (*memptr == NULL)
 		ret = errno;
@@ -261,11 +531,13 @@ valloc(size_t size)
 	ASSERTne(Pagesize, 0);
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_valloc(size);
+		void *ptr = je_vmem_valloc(size);
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "size %zu", size);
-	return je_vmem_pool_aligned_alloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size),
+	return libvmmalloc_tier_aligned(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
 			Pagesize, size);
 }
 
@@ -277,12 +549,15 @@ pvalloc(size_t size)
 	ASSERTne(Pagesize, 0);
 	if (Vmp == NULL) {
 		ASSERT(size <= HUGE);
-		return je_vmem_valloc(roundup(size, Pagesize));
+		void *ptr = je_vmem_valloc(roundup(size, Pagesize));
+		libvmmalloc_boot_account(ptr, 1);
+		return ptr;
 	}
 	LOG(4, "size %zu", size);
-	return je_vmem_pool_aligned_alloc(
-			(pool_t *)((uintptr_t)Vmp + Header_size),
-			Pagesize, roundup(size, Pagesize));
+	size = roundup(size, Pagesize);
+	return libvmmalloc_tier_aligned(
+			libvmmalloc_tier(size, __builtin_return_address(0)),
+			Pagesize, size);
 }
 #endif
 
@@ -296,8 +571,7 @@ malloc_usable_size(void *ptr)
 		return je_vmem_malloc_usable_size(ptr);
 	}
 	LOG(4, "ptr %p", ptr);
-	return je_vmem_pool_malloc_usable_size(
-			(pool_t *)((uintptr_t)Vmp + Header_size), ptr);
+	return libvmmalloc_tier_usable(libvmmalloc_tier_owner(ptr), ptr);
 }
 
 #if (defined(__GLIBC__) && !defined(__UCLIBC__))
@@ -337,8 +611,51 @@ print_jemalloc_stats(void *ignore, const char *s)
 	LOG_NONL(0, "%s", s);
 }
 
+/*
+ * libvmmalloc_commit -- (internal) allocate the pool file blocks of a range
+ *
+ * Once the pool is remapped as private, its pages are backed by anonymous
+ * memory and the file is not extended anymore.
+ */
+static bool
+libvmmalloc_commit(void *addr, size_t size, void *arg)
+{
+	if (Private)
+		return false;
+
+	if (util_file_commit(Fd, (char *)addr - (char *)Vmp, size) != 0) {
+		LOG(1, "!fallocate: addr %p size %zu", addr, size);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * libvmmalloc_decommit -- (internal) punch a hole in the pool file
+ *
+ * The file of a pool remapped as private may still be in use by the other
+ * process, so it is left untouched.
+ */
+static bool
+libvmmalloc_decommit(void *addr, size_t size, void *arg)
+{
+	if (Private)
+		return true;
+
+	if (util_file_decommit(Fd, (char *)addr - (char *)Vmp, size) != 0) {
+		LOG(4, "!fallocate: addr %p size %zu", addr, size);
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * libvmmalloc_create -- (internal) create a memory pool in a temp file
+ *
+ * The file is sparse if the file system allows it, so VMMALLOC_POOL_SIZE
+ * only limits the pool size and the file grows with the chunks in use.
  */
 static VMEM *
 libvmmalloc_create(const char *dir, size_t size)
@@ -354,7 +671,7 @@ libvmmalloc_create(const char *dir, size_t size)
 	/* silently enforce multiple of page size */
 	size = roundup(size, Pagesize);
 
-	Fd = util_tmpfile(dir, size);
+	Fd = util_tmpfile(dir, size, &Sparse);
 	if (Fd == -1)
 		return NULL;
 
@@ -362,6 +679,12 @@ libvmmalloc_create(const char *dir, size_t size)
 	if ((addr = util_map(Fd, size, 0)) == NULL)
 		return NULL;
 
+	if (Sparse && util_file_commit(Fd, 0, Header_size) != 0) {
+		LOG(1, "!fallocate");
+		util_unmap(addr, size);
+		return NULL;
+	}
+
 	/* store opaque info at beginning of mapped area */
 	struct vmem *vmp = addr;
 	memset(&vmp->hdr, '\0', sizeof (vmp->hdr));
@@ -371,8 +694,16 @@ libvmmalloc_create(const char *dir, size_t size)
 	vmp->caller_mapped = 0;
 
 	/* Prepare pool for jemalloc */
-	if (je_vmem_pool_create((void *)((uintptr_t)addr + Header_size),
-			size - Header_size, 1) == NULL) {
+	void *pool_addr = (void *)((uintptr_t)addr + Header_size);
+	pool_t *pool;
+	if (Sparse)
+		pool = je_vmem_pool_create_sparse(pool_addr,
+				size - Header_size, libvmmalloc_commit,
+				libvmmalloc_decommit, NULL);
+	else
+		pool = je_vmem_pool_create(pool_addr, size - Header_size, 1);
+
+	if (pool == NULL) {
 		LOG(1, "vmem pool creation failed");
 		util_unmap(vmp->addr, vmp->size);
 		return NULL;
@@ -390,34 +721,120 @@ libvmmalloc_create(const char *dir, size_t size)
 	return vmp;
 }
 
+/*
+ * libvmmalloc_clone_copy -- (internal) copy a range of the pool to the clone
+ *
+ * The data is written to the clone file directly from the pool mapping,
+ * so the clone file itself is never faulted in.
+ */
+static int
+libvmmalloc_clone_copy(off_t off, size_t len)
+{
+	char *src = (char *)Vmp->addr;
+
+	while (len > 0) {
+		ssize_t n = pwrite(Fd_clone, src + off, len, off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			LOG(1, "!pwrite");
+			return -1;
+		}
+
+		off += n;
+		len -= (size_t)n;
+	}
+
+	return 0;
+}
+
+/*
+ * libvmmalloc_clone_sparse -- (internal) copy the pool data to the clone
+ *
+ * The clone file reads as zeros, so only the ranges of the pool file that
+ * hold any data have to be copied.  The pool chunks never
+ * touched by jemalloc are reported as holes by lseek(2) and are skipped.
+ * If the file system does not support SEEK_DATA, the entire file is copied.
+ */
+static int
+libvmmalloc_clone_sparse(void)
+{
+	LOG(3, "copy the pool file data: src %p size %zu",
+			Vmp->addr, Vmp->size);
+
+	/*
+	 * Faults on the pool mapping must not read ahead, as the pages read
+	 * in from the holes would be reported as data by the next lseek(2).
+	 */
+	(void) madvise(Vmp->addr, Vmp->size, MADV_RANDOM);
+
+	util_range_rw(Vmp->addr, sizeof (struct pool_hdr));
+
+	int ret = 0;
+	off_t size = (off_t)Vmp->size;
+	off_t data = 0;
+	while (data < size) {
+		data = lseek(Fd, data, SEEK_DATA);
+		if (data == -1) {
+			if (errno != ENXIO) {
+				LOG(4, "!lseek SEEK_DATA");
+				ret = libvmmalloc_clone_copy(0, Vmp->size);
+			}
+			break;
+		}
+
+		off_t hole = lseek(Fd, data, SEEK_HOLE);
+		if (hole == -1 || hole > size)
+			hole = size;
+
+		LOG(4, "data range: off %ju len %ju",
+				(uintmax_t)data, (uintmax_t)(hole - data));
+		if ((ret = libvmmalloc_clone_copy(data,
+				(size_t)(hole - data))) != 0)
+			break;
+
+		data = hole;
+	}
+
+	util_range_none(Vmp->addr, sizeof (struct pool_hdr));
+
+	/* the application accesses the pool with the default read-ahead */
+	(void) madvise(Vmp->addr, Vmp->size, MADV_NORMAL);
+
+	return ret;
+}
+
 /*
  * libvmmalloc_clone - (internal) clone the entire pool
+ *
+ * If the file system supports sharing of file extents (reflink), the clone
+ * is created instantly and the data blocks are copied on write.  Otherwise
+ * only the pool ranges holding any data are copied.
  */
-static void *
+static int
 libvmmalloc_clone(void)
 {
 	LOG(3, NULL);
 
-	Fd_clone = util_tmpfile(Dir, Vmp->size);
+	int sparse = Sparse;
+	Fd_clone = util_tmpfile(Dir, Vmp->size, &sparse);
 	if (Fd_clone == -1)
-		return NULL;
+		return -1;
 
-	void *addr = mmap(NULL, Vmp->size, PROT_READ|PROT_WRITE,
-			MAP_SHARED, Fd_clone, 0);
-	if (addr == MAP_FAILED) {
-		LOG(1, "!mmap");
-		(void) close(Fd_clone);
-		return NULL;
+	if (ioctl(Fd_clone, FICLONE, Fd) == 0) {
+		LOG(3, "pool file cloned with FICLONE");
+		return 0;
 	}
 
-	LOG(3, "copy the entire pool file: dst %p src %p size %zu",
-			addr, Vmp->addr, Vmp->size);
+	LOG(4, "!FICLONE");
 
-	util_range_rw(Vmp->addr, sizeof (struct pool_hdr));
-	memcpy(addr, Vmp->addr, Vmp->size);
-	util_range_none(Vmp->addr, sizeof (struct pool_hdr));
+	if (libvmmalloc_clone_sparse() != 0) {
+		(void) close(Fd_clone);
+		return -1;
+	}
 
-	return addr;
+	return 0;
 }
 
 /*
@@ -454,7 +871,7 @@ libvmmalloc_prefork(void)
 	case 2:
 		LOG(3, "clone the entire pool file");
 
-		if (libvmmalloc_clone() != NULL)
+		if (libvmmalloc_clone() == 0)
 			break;
 
 		if (Forkopt == 2) {
@@ -632,6 +1049,19 @@ libvmmalloc_init(void)
 		LOG(4, "Fork action %d", Forkopt);
 	}
 
+	if ((env_str = getenv(VMMALLOC_DRAM_MAX_SIZE_VAR)) != NULL) {
+		Dram_max_size = atoll(env_str);
+		LOG(4, "DRAM tier max size %zu", Dram_max_size);
+	}
+
+	if ((env_str = getenv(VMMALLOC_DRAM_HOT_SAMPLE_VAR)) != NULL) {
+		Hot_sample = atoi(env_str);
+		LOG(4, "call site sampling period %u", Hot_sample);
+	}
+
+	env_str = getenv(VMMALLOC_LOG_STATS_VAR);
+	Tier_stats = env_str != NULL && strcmp(env_str, "1") == 0;
+
 	/*
 	 * XXX - vmem_create() could be used here, but then we need to
 	 * link vmem.o, including all the vmem API.
@@ -670,5 +1100,14 @@ libvmmalloc_fini(void)
 	je_vmem_pool_malloc_stats_print(
 		(pool_t *)((uintptr_t)Vmp + Header_size),
 		print_jemalloc_stats, NULL, "gba");
+
+	LOG_NONL(0, "\n=========  memory tiers  ========\n");
+	for (int i = 0; i < MAX_TIER; i++) {
+		char buf[128];
+		snprintf(buf, sizeof (buf),
+			"%s: allocated %zu bytes, allocations %zu\n",
+			Tier_names[i], Tier_bytes[i], Tier_allocs[i]);
+		print_jemalloc_stats(NULL, buf);
+	}
 	out_fini();
 }
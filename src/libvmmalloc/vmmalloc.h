@@ -42,3 +42,11 @@
 #define	VMMALLOC_POOL_DIR_VAR "VMMALLOC_POOL_DIR"
 #define	VMMALLOC_POOL_SIZE_VAR "VMMALLOC_POOL_SIZE"
 #define	VMMALLOC_FORK_VAR "VMMALLOC_FORK"
+#define	VMMALLOC_DRAM_MAX_SIZE_VAR "VMMALLOC_DRAM_MAX_SIZE"
+#define	VMMALLOC_DRAM_HOT_SAMPLE_VAR "VMMALLOC_DRAM_HOT_SAMPLE"
+
+#define	VMMALLOC_HOT_SITES 4096	/* size of call site hotness table */
+#define	VMMALLOC_HOT_THRESHOLD 16	/* samples to consider a site hot */
+#define	VMMALLOC_HOT_MAX_COUNT (2 * VMMALLOC_HOT_THRESHOLD)
+#define	VMMALLOC_HOT_DECAY (VMMALLOC_HOT_SITES * VMMALLOC_HOT_THRESHOLD)
+#define	VMMALLOC_HOT_MAX_SIZE (64 * 1024) /* max size routed by hotness */
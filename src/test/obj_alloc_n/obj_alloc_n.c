@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_alloc_n.c -- unit test for pmemobj_alloc_n and pmemobj_tx_alloc_n
+ */
+
+#include <stddef.h>
+
+#include "unittest.h"
+
+#define	LAYOUT_NAME "alloc_n"
+#define	MAX_OBJS 1000
+#define	TYPE_ATOMIC 1
+#define	TYPE_TX 2
+#define	CONSTR_MAGIC 0xabcdef
+
+static PMEMoid Oids[MAX_OBJS];
+static uint64_t Offs[MAX_OBJS];
+
+/*
+ * constructor -- stamps the object so the test can check it was called
+ */
+static void
+constructor(PMEMobjpool *pop, void *ptr, void *arg)
+{
+	uint64_t *magic = ptr;
+	*magic = *(uint64_t *)arg;
+	pmemobj_persist(pop, magic, sizeof (*magic));
+}
+
+/*
+ * count_objs -- returns the number of objects of given type
+ */
+static size_t
+count_objs(PMEMobjpool *pop, unsigned int type_num)
+{
+	size_t cnt = 0;
+	for (PMEMoid oid = pmemobj_first(pop, type_num); oid.off != 0;
+			oid = pmemobj_next(oid))
+		cnt++;
+
+	return cnt;
+}
+
+/*
+ * cmp_off -- qsort comparator for object offsets
+ */
+static int
+cmp_off(const void *a, const void *b)
+{
+	uint64_t l = *(const uint64_t *)a;
+	uint64_t r = *(const uint64_t *)b;
+
+	return l < r ? -1 : l > r;
+}
+
+/*
+ * check_oids -- verify the objects are valid, distinct and do not overlap
+ */
+static void
+check_oids(PMEMoid *oids, size_t n, size_t size)
+{
+	for (size_t i = 0; i < n; ++i) {
+		ASSERT(!OID_IS_NULL(oids[i]));
+		ASSERT(pmemobj_alloc_usable_size(oids[i]) >= size);
+		Offs[i] = oids[i].off;
+	}
+
+	qsort(Offs, n, sizeof (Offs[0]), cmp_off);
+	for (size_t i = 1; i < n; ++i)
+		ASSERT(Offs[i - 1] + size <= Offs[i]);
+}
+
+/*
+ * test_alloc_n -- allocates a batch and frees it again
+ */
+static void
+test_alloc_n(PMEMobjpool *pop, size_t n, size_t size)
+{
+	uint64_t magic = CONSTR_MAGIC + size;
+	size_t before = count_objs(pop, TYPE_ATOMIC);
+
+	int ret = pmemobj_alloc_n(pop, Oids, n, size, TYPE_ATOMIC,
+			constructor, &magic);
+	ASSERTeq(ret, 0);
+
+	check_oids(Oids, n, size);
+	for (size_t i = 0; i < n; ++i)
+		ASSERTeq(*(uint64_t *)pmemobj_direct(Oids[i]), magic);
+
+	ASSERTeq(count_objs(pop, TYPE_ATOMIC), before + n);
+
+	for (size_t i = 0; i < n; ++i)
+		pmemobj_free(&Oids[i]);
+
+	ASSERTeq(count_objs(pop, TYPE_ATOMIC), before);
+}
+
+/*
+ * test_tx_alloc_n -- allocates a batch in a committed and an aborted tx
+ */
+static void
+test_tx_alloc_n(PMEMobjpool *pop, size_t n, size_t size)
+{
+	size_t before = count_objs(pop, TYPE_TX);
+
+	TX_BEGIN(pop) {
+		ASSERTeq(pmemobj_tx_alloc_n(Oids, n, size, TYPE_TX), 0);
+		check_oids(Oids, n, size);
+		pmemobj_tx_abort(-1);
+	} TX_ONCOMMIT {
+		ASSERT(0);
+	} TX_END
+
+	ASSERTeq(count_objs(pop, TYPE_TX), before);
+
+	TX_BEGIN(pop) {
+		ASSERTeq(pmemobj_tx_alloc_n(Oids, n, size, TYPE_TX), 0);
+		check_oids(Oids, n, size);
+	} TX_ONABORT {
+		ASSERT(0);
+	} TX_END
+
+	ASSERTeq(count_objs(pop, TYPE_TX), before + n);
+}
+
+/*
+ * test_invalid -- checks argument validation
+ */
+static void
+test_invalid(PMEMobjpool *pop)
+{
+	ASSERTne(pmemobj_alloc_n(pop, Oids, 0, 64, TYPE_ATOMIC,
+			NULL, NULL), 0);
+	ASSERTeq(errno, EINVAL);
+
+	ASSERTne(pmemobj_alloc_n(pop, Oids, 1, 0, TYPE_ATOMIC,
+			NULL, NULL), 0);
+	ASSERTeq(errno, EINVAL);
+
+	ASSERTne(pmemobj_alloc_n(pop, Oids, 1, 64, PMEMOBJ_NUM_OID_TYPES,
+			NULL, NULL), 0);
+	ASSERTeq(errno, EINVAL);
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_alloc_n(Oids, 1, 0, TYPE_TX);
+	} TX_ONCOMMIT {
+		ASSERT(0);
+	} TX_END
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_alloc_n");
+
+	if (argc != 2)
+		FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	PMEMobjpool *pop = NULL;
+
+	if ((pop = pmemobj_create(path, LAYOUT_NAME,
+			PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR)) == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	test_invalid(pop);
+
+	test_alloc_n(pop, 1, 64);
+	test_alloc_n(pop, 100, 64);
+	test_alloc_n(pop, MAX_OBJS, 64);
+	test_alloc_n(pop, MAX_OBJS, 3000);
+	test_alloc_n(pop, 10, 100000);
+
+	test_tx_alloc_n(pop, MAX_OBJS, 128);
+	test_tx_alloc_n(pop, 10, 100000);
+
+	pmemobj_close(pop);
+
+	/* the committed tx batches must survive reopening the pool */
+	if ((pop = pmemobj_open(path, LAYOUT_NAME)) == NULL)
+		FATAL("!pmemobj_open: %s", path);
+
+	ASSERTeq(count_objs(pop, TYPE_ATOMIC), 0);
+	ASSERTeq(count_objs(pop, TYPE_TX), MAX_OBJS + 10);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -59,6 +59,15 @@ struct mock_pop {
 	void *heap;
 };
 
+/*
+ * obj_heap_persist -- msync with the pool persist signature
+ */
+static void
+obj_heap_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pmem_msync(addr, len);
+}
+
 void
 test_heap()
 {
@@ -67,7 +76,7 @@ test_heap()
 	memset(pop, 0, MOCK_POOL_SIZE);
 	pop->heap_size = MOCK_POOL_SIZE - sizeof (PMEMobjpool);
 	pop->heap_offset = (uint64_t)((uint64_t)&mpop->heap - (uint64_t)mpop);
-	pop->persist = (persist_fn)pmem_msync;
+	pop->persist = obj_heap_persist;
 
 	ASSERT(heap_check(pop) != 0);
 	ASSERT(heap_init(pop) == 0);
@@ -82,6 +91,21 @@ test_heap()
 	struct bucket *b_def = heap_get_default_bucket(pop);
 	ASSERT(bucket_unit_size(b_def) == CHUNKSIZE);
 
+	/*
+	 * The usable size of a block with the maximum number of units of the
+	 * last run bucket must still resolve to that bucket.
+	 */
+	struct bucket *b_last = b_small;
+	for (size_t size = 0; size < CHUNKSIZE; ++size) {
+		struct bucket *b = heap_get_best_bucket(pop, size);
+		if (b == b_def)
+			break;
+		b_last = b;
+	}
+	size_t last_max = bucket_unit_size(b_last) *
+		(bucket_unit_max(b_last) - 1);
+	ASSERT(heap_get_best_bucket(pop, last_max) == b_last);
+
 	/* new small buckets should be empty */
 	ASSERT(bucket_is_empty(b_small));
 	ASSERT(bucket_is_empty(b_big));
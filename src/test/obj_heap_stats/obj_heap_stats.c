@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_heap_stats.c -- unit test for pmemobj_heap_stats
+ */
+
+#include <stddef.h>
+
+#include "unittest.h"
+
+#define	LAYOUT_NAME "heap_stats"
+#define	SMALL_ALLOC_SIZE 16
+#define	BIG_ALLOC_SIZE (1024 * 1024)
+#define	CLASS_SMALL 0
+#define	CLASS_CHUNK (PMEMOBJ_MAX_ALLOC_CLASSES - 1)
+
+/*
+ * check_stats -- verify invariants of heap statistics
+ */
+static void
+check_stats(PMEMobjpool *pop, struct pobj_heap_stats *stats)
+{
+	ASSERTeq(pmemobj_heap_stats(pop, stats), 0);
+
+	ASSERT(stats->heap_size > 0);
+	ASSERT(stats->nzones_processed <= stats->nzones);
+	ASSERTeq(stats->nclasses, PMEMOBJ_MAX_ALLOC_CLASSES);
+
+	for (unsigned i = 0; i < stats->nclasses; ++i) {
+		struct pobj_alloc_class_stats *c = &stats->classes[i];
+		ASSERT(c->unit_size > 0);
+		ASSERT(c->free_units <= c->units);
+		ASSERT(c->free_blocks <= c->free_units);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_heap_stats");
+
+	if (argc != 2)
+		FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	PMEMobjpool *pop = NULL;
+
+	if ((pop = pmemobj_create(path, LAYOUT_NAME,
+			PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR)) == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	ASSERTne(pmemobj_heap_stats(pop, NULL), 0);
+	ASSERTeq(errno, EINVAL);
+
+	struct pobj_heap_stats before;
+	struct pobj_heap_stats after;
+	check_stats(pop, &before);
+
+	PMEMoid small;
+	PMEMoid big;
+	if (pmemobj_alloc(pop, &small, SMALL_ALLOC_SIZE, 0, NULL, NULL) != 0)
+		FATAL("!pmemobj_alloc");
+	if (pmemobj_alloc(pop, &big, BIG_ALLOC_SIZE, 0, NULL, NULL) != 0)
+		FATAL("!pmemobj_alloc");
+
+	check_stats(pop, &after);
+	ASSERT(after.nzones_processed > 0);
+	ASSERT(after.classes[CLASS_SMALL].nruns > 0);
+
+	uint64_t small_used = after.classes[CLASS_SMALL].units -
+		after.classes[CLASS_SMALL].free_units;
+	uint64_t chunk_used = after.classes[CLASS_CHUNK].units -
+		after.classes[CLASS_CHUNK].free_units;
+	ASSERTeq(small_used, 1);
+	/* the header of the object spills into one more chunk */
+	ASSERTeq(chunk_used, BIG_ALLOC_SIZE /
+		after.classes[CLASS_CHUNK].unit_size + 1);
+
+	pmemobj_free(&small);
+	pmemobj_free(&big);
+
+	check_stats(pop, &after);
+	ASSERTeq(after.classes[CLASS_SMALL].free_units,
+		after.classes[CLASS_SMALL].units);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -145,6 +145,33 @@ pmem_drain_nop(void)
 	/* nop */
 }
 
+/*
+ * obj_persist -- pool persist, the mock pool has no replicas
+ */
+static void
+obj_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->persist_local(addr, len);
+}
+
+/*
+ * obj_flush -- pool flush, the mock pool has no replicas
+ */
+static void
+obj_flush(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pop->flush_local(addr, len);
+}
+
+/*
+ * obj_drain -- pool drain, the mock pool has no replicas
+ */
+static void
+obj_drain(PMEMobjpool *pop)
+{
+	pop->drain_local();
+}
+
 /*
  * pmemobj_open -- pmemobj_open mock
  *
@@ -178,17 +205,22 @@ FUNC_MOCK_RUN_DEFAULT {
 	Pop->is_pmem = pmem_is_pmem(addr, stbuf.st_size);
 	Pop->rdonly = 0;
 	Pop->uuid_lo = 0x12345678;
+	Pop->stats = NULL;
 
 	if (Pop->is_pmem) {
-		Pop->persist = pmem_persist;
-		Pop->flush = pmem_flush;
-		Pop->drain = pmem_drain;
+		Pop->persist_local = pmem_persist;
+		Pop->flush_local = pmem_flush;
+		Pop->drain_local = pmem_drain;
 	} else {
-		Pop->persist = (persist_fn)pmem_msync;
-		Pop->flush = (persist_fn)pmem_msync;
-		Pop->drain = pmem_drain_nop;
+		Pop->persist_local = (persist_local_fn)pmem_msync;
+		Pop->flush_local = (flush_local_fn)pmem_msync;
+		Pop->drain_local = pmem_drain_nop;
 	}
 
+	Pop->persist = obj_persist;
+	Pop->flush = obj_flush;
+	Pop->drain = obj_drain;
+
 	Pop->heap_offset = HEAP_OFFSET;
 	Pop->heap_size = Pop->size - Pop->heap_offset;
 	uint64_t heap_offset = HEAP_OFFSET;
@@ -225,16 +257,16 @@ FUNC_MOCK_RUN_DEFAULT {
 	heap_offset += sizeof (*Item);
 	Item->oid.pool_uuid_lo = Pop->uuid_lo;
 	Item->oid.off = heap_offset;
-	Pop->persist(Item, sizeof (*Item));
+	Pop->persist(Pop, Item, sizeof (*Item));
 	heap_offset += sizeof (struct oob_item);
 
 	if (*Heap_offset == 0) {
 		*Heap_offset = heap_offset;
-		Pop->persist(Heap_offset, sizeof (*Heap_offset));
+		Pop->persist(Pop, Heap_offset, sizeof (*Heap_offset));
 	}
 
 
-	Pop->persist(Pop, HEAP_OFFSET);
+	Pop->persist(Pop, Pop, HEAP_OFFSET);
 
 	return Pop;
 }
@@ -299,7 +331,7 @@ FUNC_MOCK(pmemobj_alloc, PMEMoid, PMEMobjpool *pop, PMEMoid *oidp,
 		oid.off += OOB_OFF;
 		if (oidp) {
 			*oidp = oid;
-			Pop->persist(oidp, sizeof (*oidp));
+			Pop->persist(Pop, oidp, sizeof (*oidp));
 		}
 	return oid; }
 FUNC_MOCK_END
@@ -316,22 +348,22 @@ FUNC_MOCK(pmalloc, int, PMEMobjpool *pop, uint64_t *ptr, size_t size)
 		uint64_t *alloc_size = (uint64_t *)((uintptr_t)Pop
 				+ *Heap_offset);
 		*alloc_size = size;
-		Pop->persist(alloc_size, sizeof (*alloc_size));
+		Pop->persist(Pop, alloc_size, sizeof (*alloc_size));
 
 		*ptr = *Heap_offset + sizeof (uint64_t);
-		Pop->persist(ptr, sizeof (*ptr));
+		Pop->persist(Pop, ptr, sizeof (*ptr));
 
 		struct oob_item *item =
 			(struct oob_item *)((uintptr_t)Pop + *ptr);
 
 		item->item.id = *Id;
-		Pop->persist(&item->item.id, sizeof (item->item.id));
+		Pop->persist(Pop, &item->item.id, sizeof (item->item.id));
 
 		(*Id)++;
-		Pop->persist(Id, sizeof (*Id));
+		Pop->persist(Pop, Id, sizeof (*Id));
 
 		*Heap_offset = *Heap_offset + sizeof (uint64_t) + size;
-		Pop->persist(Heap_offset, sizeof (*Heap_offset));
+		Pop->persist(Pop, Heap_offset, sizeof (*Heap_offset));
 
 		OUT("pmalloc(id = %d)", item->item.id);
 		return 0;
@@ -349,7 +381,7 @@ FUNC_MOCK(pfree, int, PMEMobjpool *pop, uint64_t *ptr)
 			(struct oob_item *)((uintptr_t)Pop + *ptr);
 		OUT("pfree(id = %d)", item->item.id);
 		*ptr = 0;
-		Pop->persist(ptr, sizeof (*ptr));
+		Pop->persist(Pop, ptr, sizeof (*ptr));
 
 		return 0;
 	}
@@ -369,13 +401,13 @@ FUNC_MOCK(pmalloc_construct, int, PMEMobjpool *pop, uint64_t *off,
 		uint64_t *alloc_size = (uint64_t *)((uintptr_t)Pop +
 				*Heap_offset);
 		*alloc_size = size;
-		Pop->persist(alloc_size, sizeof (*alloc_size));
+		Pop->persist(Pop, alloc_size, sizeof (*alloc_size));
 
 		*off = *Heap_offset + sizeof (uint64_t);
-		Pop->persist(off, sizeof (*off));
+		Pop->persist(Pop, off, sizeof (*off));
 
 		*Heap_offset = *Heap_offset + sizeof (uint64_t) + size;
-		Pop->persist(Heap_offset, sizeof (*Heap_offset));
+		Pop->persist(Pop, Heap_offset, sizeof (*Heap_offset));
 
 		void *ptr = (void *)((uintptr_t)Pop + *off + data_off);
 		constructor(pop, ptr, arg);
@@ -384,6 +416,61 @@ FUNC_MOCK(pmalloc_construct, int, PMEMobjpool *pop, uint64_t *off,
 	}
 FUNC_MOCK_END
 
+/*
+ * pmalloc_reserve -- pmalloc_reserve mock
+ *
+ * Reserves all n blocks using linear allocator.
+ */
+FUNC_MOCK(pmalloc_reserve, int, PMEMobjpool *pop, uint64_t *offs,
+	size_t *n, size_t size, size_t max_hdrs)
+	FUNC_MOCK_RUN_DEFAULT {
+		size = 2 * (size - OOB_OFF) + OOB_OFF;
+		for (size_t i = 0; i < *n; ++i) {
+			uint64_t *alloc_size = (uint64_t *)((uintptr_t)Pop +
+					*Heap_offset);
+			*alloc_size = size;
+			Pop->persist(Pop, alloc_size, sizeof (*alloc_size));
+
+			offs[i] = *Heap_offset + sizeof (uint64_t);
+
+			*Heap_offset = *Heap_offset + sizeof (uint64_t) + size;
+			Pop->persist(Pop, Heap_offset, sizeof (*Heap_offset));
+		}
+
+		return 0;
+	}
+FUNC_MOCK_END
+
+/*
+ * pmalloc_publish -- pmalloc_publish mock
+ *
+ * The linear allocator has no allocation state to publish.
+ */
+FUNC_MOCK(pmalloc_publish, int, PMEMobjpool *pop, struct redo_log *redo,
+	size_t *redo_index, uint64_t *offs, size_t n)
+	FUNC_MOCK_RUN_DEFAULT {
+		return 0;
+	}
+FUNC_MOCK_END
+
+/*
+ * pmalloc_publish_end -- pmalloc_publish_end mock
+ */
+FUNC_MOCK(pmalloc_publish_end, void, PMEMobjpool *pop, uint64_t *offs,
+	size_t n)
+	FUNC_MOCK_RUN_DEFAULT {
+	}
+FUNC_MOCK_END
+
+/*
+ * pmalloc_cancel -- pmalloc_cancel mock
+ */
+FUNC_MOCK(pmalloc_cancel, void, PMEMobjpool *pop, uint64_t *offs,
+	size_t n)
+	FUNC_MOCK_RUN_DEFAULT {
+	}
+FUNC_MOCK_END
+
 /*
  * prealloc -- prealloc mock
  */
@@ -395,7 +482,7 @@ FUNC_MOCK(prealloc, int, PMEMobjpool *pop, uint64_t *off, size_t size)
 				*off + OOB_OFF);
 		if (*alloc_size >= size) {
 			*alloc_size = size;
-			Pop->persist(alloc_size, sizeof (*alloc_size));
+			Pop->persist(Pop, alloc_size, sizeof (*alloc_size));
 
 			OUT("prealloc(id = %d, size = %zu) = true",
 				item->id,
@@ -769,7 +856,7 @@ item_constructor(PMEMobjpool *pop, void *ptr, void *arg)
 	int id = *(int *)arg;
 	struct item *item = (struct item *)ptr;
 	item->id = id;
-	pop->persist(&item->id, sizeof (item->id));
+	pop->persist(pop, &item->id, sizeof (item->id));
 	OUT("constructor(id = %d)", id);
 }
 
@@ -792,7 +879,7 @@ realloc_constructor(PMEMobjpool *pop, void *ptr, void *arg)
 		size_t cpy_size = rarg->old_size < rarg->new_size ?
 			rarg->old_size : rarg->new_size;
 		memcpy(ptr, rarg->ptr, cpy_size);
-		pop->persist(ptr, cpy_size);
+		pop->persist(pop, ptr, cpy_size);
 	}
 	OUT("realloc_constructor(id = %d)", item->id);
 }
@@ -993,7 +1080,7 @@ do_realloc(PMEMobjpool *pop, const char *arg)
 	} else {
 		FATAL_USAGE_REALLOC();
 	}
-	Pop->persist(Item, sizeof (*Item));
+	Pop->persist(Pop, Item, sizeof (*Item));
 
 	size_t size = s * sizeof (struct item);
 
@@ -1057,7 +1144,7 @@ do_realloc_move(PMEMobjpool *pop, const char *arg)
 		head = (struct list_head *)&D_RW(List)->head;
 	}
 	Item->oid = get_item_oob_list(List_oob.oid, n);
-	Pop->persist(Item, sizeof (*Item));
+	Pop->persist(Pop, Item, sizeof (*Item));
 	size_t size = s * sizeof (struct item);
 	struct realloc_arg rarg = {
 		.ptr = OBJ_OFF_TO_PTR(pop, Item->oid.off),
@@ -43,6 +43,8 @@
 #include "list.h"
 #include "obj.h"
 #include "heap_layout.h"
+#include "heap.h"
+#include "bucket.h"
 #include "unittest.h"
 
 #define	MOCK_POOL_SIZE PMEMOBJ_MIN_POOL
@@ -70,11 +72,20 @@ static PMEMobjpool *mock_pop;
  * drain_empty -- (internal) empty function for drain on non-pmem memory
  */
 static void
-drain_empty(void)
+drain_empty(PMEMobjpool *pop)
 {
 	/* do nothing */
 }
 
+/*
+ * obj_msync -- msync with the pool persist and flush signature
+ */
+static void
+obj_msync(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pmem_msync(addr, len);
+}
+
 struct foo {
 	uintptr_t bar;
 };
@@ -135,6 +146,42 @@ test_realloc(size_t org, size_t dest)
 	ASSERTeq(err, 0);
 }
 
+/*
+ * test_realloc_next_chunks -- grows a chunk block into the free space behind
+ *	it which is described by two separate free chunks
+ */
+void
+test_realloc_next_chunks()
+{
+	int err;
+	err = pmalloc(mock_pop, &addr->ptr, TEST_HUGE_ALLOC_SIZE);
+	ASSERTeq(err, 0);
+	uint64_t off = addr->ptr;
+
+	struct allocation_header *alloc = (struct allocation_header *)
+		((char *)mock_pop + off - sizeof (struct allocation_header));
+	struct memory_block cnt = {alloc->chunk_id, alloc->zone_id, 1, 0};
+
+	/* split the free space behind the block in two */
+	struct bucket *b = heap_get_default_bucket(mock_pop);
+	struct memory_block next = {0};
+	err = heap_get_adjacent_free_block(mock_pop, &next, cnt, 0);
+	ASSERTeq(err, 0);
+	ASSERT(next.size_idx > 3);
+	err = heap_get_exact_block(mock_pop, b, &next, 1);
+	ASSERTeq(err, 0);
+	err = bucket_insert_block(b, next);
+	ASSERTeq(err, 0);
+
+	err = prealloc(mock_pop, &addr->ptr, 3 * CHUNKSIZE);
+	ASSERTeq(err, 0);
+	ASSERTeq(addr->ptr, off);
+	ASSERT(pmalloc_usable_size(mock_pop, addr->ptr) >= 3 * CHUNKSIZE);
+
+	err = pfree(mock_pop, &addr->ptr);
+	ASSERTeq(err, 0);
+}
+
 void
 test_mock_pool_allocs()
 {
@@ -146,11 +193,13 @@ test_mock_pool_allocs()
 	mock_pop->is_pmem = 0;
 	mock_pop->heap_offset = sizeof (struct mock_pop);
 	mock_pop->heap_size = MOCK_POOL_SIZE - mock_pop->heap_offset;
-	mock_pop->persist = (persist_fn)pmem_msync;
+	mock_pop->persist = obj_msync;
 	mock_pop->nlanes = 1;
 	mock_pop->lanes_offset = sizeof (PMEMobjpool);
-	mock_pop->flush = (flush_fn)pmem_msync;
+	mock_pop->flush = obj_msync;
 	mock_pop->drain = drain_empty;
+	mock_pop->stats = NULL;
+	mock_pop->locks = NULL;
 
 	lane_boot(mock_pop);
 
@@ -173,6 +222,7 @@ test_mock_pool_allocs()
 
 	test_realloc(TEST_SMALL_ALLOC_SIZE, TEST_MEDIUM_ALLOC_SIZE);
 	test_realloc(TEST_HUGE_ALLOC_SIZE, TEST_MEGA_ALLOC_SIZE);
+	test_realloc_next_chunks();
 
 	FREE(addr);
 }
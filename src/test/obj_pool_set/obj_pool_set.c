@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_pool_set.c -- unit test for pools made of several part files
+ *
+ * usage: obj_pool_set op file [errno]
+ *        obj_pool_set p file size part_index nparts
+ *
+ * op is one of:
+ *	p - create a part file of the pool set with pmemobj_create_part()
+ *	c - create the pool and fill it with objects
+ *	o - open the pool and verify the objects
+ *	e - expect pmemobj_create() to fail with errno
+ *	E - expect pmemobj_open() to fail with errno
+ */
+
+#include <stddef.h>
+
+#include "unittest.h"
+
+#define	LAYOUT_NAME "pool_set"
+#define	OBJ_SIZE (1024 * 1024 - 128) /* four chunks with the headers */
+
+struct root {
+	uint64_t nobjs;
+};
+
+/*
+ * obj_fill -- (internal) returns the byte pattern of the object
+ */
+static int
+obj_fill(uint64_t idx)
+{
+	return (int)(idx * 31 + 7) & 0xff;
+}
+
+/*
+ * obj_idx -- (internal) returns the index stored in the object
+ */
+static uint64_t
+obj_idx(PMEMoid oid)
+{
+	return *(uint64_t *)pmemobj_direct(oid);
+}
+
+/*
+ * pool_create -- allocates objects until the pool runs out of memory
+ */
+static void
+pool_create(const char *path)
+{
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT_NAME, 0,
+			S_IWUSR | S_IRUSR);
+	if (pop == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	PMEMoid root = pmemobj_root(pop, sizeof (struct root));
+	struct root *rootp = pmemobj_direct(root);
+
+	PMEMoid oid;
+	uint64_t n = 0;
+	while (pmemobj_alloc(pop, &oid, OBJ_SIZE, 0, NULL, NULL) == 0) {
+		char *ptr = pmemobj_direct(oid);
+		pmemobj_memset_persist(pop, ptr, obj_fill(n), OBJ_SIZE);
+		pmemobj_memcpy_persist(pop, ptr, &n, sizeof (n));
+		n++;
+	}
+
+	/* the objects have to span all the parts */
+	ASSERT(n * OBJ_SIZE > PMEMOBJ_MIN_POOL);
+
+	rootp->nobjs = n;
+	pmemobj_persist(pop, &rootp->nobjs, sizeof (rootp->nobjs));
+
+	pmemobj_close(pop);
+}
+
+/*
+ * pool_open -- verifies the content of the objects
+ */
+static void
+pool_open(const char *path)
+{
+	PMEMobjpool *pop = pmemobj_open(path, LAYOUT_NAME);
+	if (pop == NULL)
+		FATAL("!pmemobj_open: %s", path);
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+			sizeof (struct root)));
+
+	uint64_t n = 0;
+	PMEMoid oid;
+	for (oid = pmemobj_first(pop, 0); oid.off != 0;
+			oid = pmemobj_next(oid)) {
+		char *ptr = pmemobj_direct(oid);
+		uint64_t idx = obj_idx(oid);
+		ASSERT(idx < rootp->nobjs);
+
+		for (size_t i = sizeof (idx); i < OBJ_SIZE; ++i)
+			ASSERTeq(ptr[i], (char)obj_fill(idx));
+		n++;
+	}
+
+	ASSERTeq(n, rootp->nobjs);
+
+	pmemobj_close(pop);
+
+	ASSERTeq(pmemobj_check(path, LAYOUT_NAME), 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_pool_set");
+
+	if (argc < 3)
+		FATAL("usage: %s op file [errno]", argv[0]);
+
+	const char *path = argv[2];
+	int err = argc > 3 ? atoi(argv[3]) : 0;
+
+	switch (argv[1][0]) {
+	case 'p':
+		if (argc != 6)
+			FATAL("usage: %s p file size part_index nparts",
+				argv[0]);
+		if (pmemobj_create_part(path, LAYOUT_NAME,
+				strtoull(argv[3], NULL, 0), S_IWUSR | S_IRUSR,
+				atoi(argv[4]), atoi(argv[5]), 0, 1) != 0)
+			FATAL("!pmemobj_create_part: %s", path);
+		break;
+	case 'c':
+		pool_create(path);
+		break;
+	case 'o':
+		pool_open(path);
+		break;
+	case 'e':
+		ASSERTeq(pmemobj_create(path, LAYOUT_NAME, 0,
+			S_IWUSR | S_IRUSR), NULL);
+		ASSERTeq(errno, err);
+		break;
+	case 'E':
+		ASSERTeq(pmemobj_open(path, LAYOUT_NAME), NULL);
+		ASSERTeq(errno, err);
+		break;
+	default:
+		FATAL("unknown operation %s", argv[1]);
+	}
+
+	DONE(NULL);
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_replica.c -- unit test for pool replicas
+ *
+ * usage: obj_replica op file [arg]
+ *
+ * op is one of:
+ *	c - create the pool and fill it with objects
+ *	o - open the pool and verify the objects; arg is 'p' if the objects
+ *	    are expected to be read from the pool, 'r' if from a replica
+ *	w - open the pool, change the objects and exit without closing it
+ *	e - expect pmemobj_create() to fail with errno arg
+ *	E - expect pmemobj_open() to fail with errno arg
+ */
+
+#include <stddef.h>
+
+#include "unittest.h"
+
+#define	LAYOUT_NAME "replica"
+#define	NOBJS 64
+#define	OBJ_SIZE 4096
+
+struct root {
+	uint64_t gen;		/* generation of the object contents */
+	PMEMoid objs[NOBJS];
+};
+
+/*
+ * obj_fill -- (internal) returns the byte pattern of the object
+ */
+static int
+obj_fill(uint64_t gen, int idx)
+{
+	return (int)(gen * 17 + (uint64_t)idx * 31 + 7) & 0xff;
+}
+
+/*
+ * pool_fill -- (internal) writes the pattern of the generation to all the
+ *	objects
+ */
+static void
+pool_fill(PMEMobjpool *pop, struct root *rootp, uint64_t gen)
+{
+	for (int i = 0; i < NOBJS; ++i) {
+		char *ptr = pmemobj_direct(rootp->objs[i]);
+		pmemobj_memset_persist(pop, ptr, obj_fill(gen, i), OBJ_SIZE);
+	}
+
+	rootp->gen = gen;
+	pmemobj_persist(pop, &rootp->gen, sizeof (rootp->gen));
+}
+
+/*
+ * pool_create -- allocates the objects and fills them
+ */
+static void
+pool_create(const char *path)
+{
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT_NAME, 0,
+			S_IWUSR | S_IRUSR);
+	if (pop == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+			sizeof (struct root)));
+
+	for (int i = 0; i < NOBJS; ++i) {
+		if (pmemobj_alloc(pop, &rootp->objs[i], OBJ_SIZE, 0,
+				NULL, NULL))
+			FATAL("!pmemobj_alloc");
+	}
+
+	pool_fill(pop, rootp, 1);
+
+	pmemobj_close(pop);
+}
+
+/*
+ * pool_open -- verifies the objects, both in the pool and in the copy
+ *	local to the thread
+ */
+static void
+pool_open(const char *path, char where)
+{
+	PMEMobjpool *pop = pmemobj_open(path, LAYOUT_NAME);
+	if (pop == NULL)
+		FATAL("!pmemobj_open: %s", path);
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+			sizeof (struct root)));
+
+	for (int i = 0; i < NOBJS; ++i) {
+		PMEMoid oid = rootp->objs[i];
+		const char *ptr = pmemobj_direct(oid);
+		const char *lptr = pmemobj_direct_local(oid);
+
+		if (where == 'p')
+			ASSERTeq(lptr, ptr);
+		else
+			ASSERTne(lptr, ptr);
+
+		for (size_t j = 0; j < OBJ_SIZE; ++j) {
+			ASSERTeq(ptr[j], (char)obj_fill(rootp->gen, i));
+			ASSERTeq(lptr[j], ptr[j]);
+		}
+	}
+
+	pmemobj_close(pop);
+}
+
+/*
+ * pool_write -- changes the objects and leaves the pool open, like a crash
+ */
+static void
+pool_write(const char *path)
+{
+	PMEMobjpool *pop = pmemobj_open(path, LAYOUT_NAME);
+	if (pop == NULL)
+		FATAL("!pmemobj_open: %s", path);
+
+	struct root *rootp = pmemobj_direct(pmemobj_root(pop,
+			sizeof (struct root)));
+
+	pool_fill(pop, rootp, rootp->gen + 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_replica");
+
+	if (argc < 3)
+		FATAL("usage: %s op file [arg]", argv[0]);
+
+	const char *path = argv[2];
+	const char *arg = argc > 3 ? argv[3] : "p";
+
+	switch (argv[1][0]) {
+	case 'c':
+		pool_create(path);
+		break;
+	case 'o':
+		pool_open(path, arg[0]);
+		break;
+	case 'w':
+		pool_write(path);
+		break;
+	case 'e':
+		ASSERTeq(pmemobj_create(path, LAYOUT_NAME, 0,
+			S_IWUSR | S_IRUSR), NULL);
+		ASSERTeq(errno, atoi(arg));
+		break;
+	case 'E':
+		ASSERTeq(pmemobj_open(path, LAYOUT_NAME), NULL);
+		ASSERTeq(errno, atoi(arg));
+		break;
+	default:
+		FATAL("unknown operation %s", argv[1]);
+	}
+
+	DONE(NULL);
+}
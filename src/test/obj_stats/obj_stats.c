@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_stats.c -- unit test for pmemobj_stats_get
+ *
+ * usage: obj_stats file p|s [pmempool info-file]
+ *
+ * p - statistics in private memory
+ * s - statistics published in shared memory, pmempool info --stats is run
+ *     on the open pool
+ */
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "unittest.h"
+#include "stats.h"
+
+#define	LAYOUT_NAME	"obj_stats"
+#define	TEST_NTHREADS	4
+#define	TEST_NTX	8
+#define	TEST_SNAPSHOT	64
+
+struct foo {
+	char value[TEST_SNAPSHOT];
+};
+
+static PMEMobjpool *Pop;
+
+/*
+ * worker -- commit a few transactions and abort one
+ */
+static void *
+worker(void *arg)
+{
+	PMEMoid oid;
+	int ret = pmemobj_alloc(Pop, &oid, sizeof (struct foo), 1, NULL, NULL);
+	ASSERTeq(ret, 0);
+
+	for (int i = 0; i < TEST_NTX; ++i) {
+		TX_BEGIN(Pop) {
+			pmemobj_tx_add_range(oid, 0, TEST_SNAPSHOT);
+			struct foo *f = pmemobj_direct(oid);
+			f->value[0] = i;
+		} TX_ONABORT {
+			ASSERT(0);
+		} TX_END
+	}
+
+	TX_BEGIN(Pop) {
+		pmemobj_tx_add_range(oid, 0, TEST_SNAPSHOT);
+		pmemobj_tx_abort(ECANCELED);
+	} TX_END
+
+	pmemobj_free(&oid);
+
+	return NULL;
+}
+
+/*
+ * check_stats -- check the counters match the work done by the workers
+ */
+static void
+check_stats(struct pobj_stats *stats)
+{
+	unsigned nsnapshots = TEST_NTHREADS * (TEST_NTX + 1);
+
+	ASSERTeq(stats->tx_commits, TEST_NTHREADS * TEST_NTX);
+	ASSERTeq(stats->tx_aborts, TEST_NTHREADS);
+	ASSERTeq(stats->tx_snapshots, nsnapshots);
+	ASSERTeq(stats->tx_snapshot_bytes, nsnapshots * TEST_SNAPSHOT);
+
+	/* every transaction holds a lane at least for its begin and end */
+	ASSERT(stats->lane_holds >= 2 * TEST_NTHREADS * (TEST_NTX + 1));
+	ASSERT(stats->lane_contended <= stats->lane_holds);
+	ASSERTne(stats->zone_populations, 0);
+	ASSERTne(stats->bucket_refills, 0);
+
+	/* all but the root object are freed */
+	uint64_t allocs = 0;
+	uint64_t frees = 0;
+	ASSERTeq(stats->nclasses, PMEMOBJ_MAX_ALLOC_CLASSES);
+	for (unsigned i = 0; i < stats->nclasses; ++i) {
+		ASSERTne(stats->classes[i].unit_size, 0);
+		allocs += stats->classes[i].allocs;
+		frees += stats->classes[i].frees;
+	}
+	ASSERTeq(allocs, 1 + TEST_NTHREADS + nsnapshots);
+	ASSERTeq(frees, allocs - 1);
+}
+
+/*
+ * shm_name -- name of the shared memory object with the pool's statistics
+ *
+ * The root object is used to get the pool's uuid_lo.
+ */
+static void
+shm_name(PMEMobjpool *pop, uint64_t pid, char *name)
+{
+	PMEMoid root = pmemobj_root(pop, sizeof (struct foo));
+	sprintf(name, OBJ_STATS_SHM_NAME, (uintmax_t)root.pool_uuid_lo,
+		(uintmax_t)pid);
+}
+
+/*
+ * plant_shm -- create a shared memory object as if left behind by a crash
+ */
+static void
+plant_shm(const char *name)
+{
+	int fd = shm_open(name, O_RDWR|O_CREAT, S_IRUSR|S_IWUSR);
+	if (fd < 0)
+		FATAL("!shm_open %s", name);
+	if (ftruncate(fd, sizeof (struct obj_stats)))
+		FATAL("!ftruncate %s", name);
+	CLOSE(fd);
+}
+
+/*
+ * check_shm -- check the shared memory object holds the same statistics
+ */
+static void
+check_shm(const char *name, struct pobj_stats *stats)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		FATAL("!shm_open %s", name);
+
+	struct stat st;
+	FSTAT(fd, &st);
+
+	struct obj_stats *s = MMAP(NULL, st.st_size, PROT_READ, MAP_SHARED,
+			fd, 0);
+	CLOSE(fd);
+
+	ASSERTeq(memcmp(s->signature, OBJ_STATS_SIG, sizeof (s->signature)),
+		0);
+	ASSERTeq(s->major, OBJ_STATS_FORMAT_MAJOR);
+	ASSERTeq(s->pid, getpid());
+	ASSERTeq(s->size, st.st_size);
+
+	struct pobj_stats shm_stats;
+	obj_stats_merge(s, &shm_stats);
+	ASSERTeq(memcmp(&shm_stats, stats, sizeof (*stats)), 0);
+
+	MUNMAP(s, st.st_size);
+}
+
+/*
+ * run_pmempool_info -- run pmempool info --stats on the open pool
+ */
+static void
+run_pmempool_info(const char *pmempool, const char *path, const char *out)
+{
+	pid_t pid = fork();
+	if (pid < 0)
+		FATAL("!fork");
+
+	if (pid == 0) {
+		if (freopen(out, "w", stdout) == NULL)
+			FATAL("!freopen %s", out);
+		execl(pmempool, pmempool, "info", "--stats", path, NULL);
+		FATAL("!execl %s", pmempool);
+	}
+
+	int status;
+	ASSERTeq(waitpid(pid, &status, 0), pid);
+	ASSERT(WIFEXITED(status));
+	ASSERTeq(WEXITSTATUS(status), 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_stats");
+
+	if (argc < 3 || strchr("ps", argv[2][0]) == NULL ||
+			(argv[2][0] == 's' && argc != 5))
+		FATAL("usage: %s file p|s [pmempool info-file]", argv[0]);
+
+	const char *path = argv[1];
+
+	if ((Pop = pmemobj_create(path, LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR)) == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	char name[OBJ_STATS_SHM_NAME_MAX];
+	shm_name(Pop, getpid(), name);
+
+	/* PID_MAX_LIMIT is far below, there is no such process */
+	char dead_name[OBJ_STATS_SHM_NAME_MAX];
+	shm_name(Pop, INT32_MAX, dead_name);
+
+	struct pobj_stats stats;
+	ASSERTeq(pmemobj_stats_get(Pop, NULL), -1);
+	ASSERTeq(errno, EINVAL);
+
+	pthread_t threads[TEST_NTHREADS];
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, worker, NULL);
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	ASSERTeq(pmemobj_stats_get(Pop, &stats), 0);
+	check_stats(&stats);
+
+	if (argv[2][0] == 's') {
+		check_shm(name, &stats);
+
+		/* pmempool skips the objects of processes which are gone */
+		plant_shm(dead_name);
+		run_pmempool_info(argv[3], path, argv[4]);
+	} else {
+		ASSERTeq(shm_open(name, O_RDONLY, 0), -1);
+	}
+
+	pmemobj_close(Pop);
+
+	/* the shared memory object goes away with the pool */
+	ASSERTeq(shm_open(name, O_RDONLY, 0), -1);
+	ASSERTeq(errno, ENOENT);
+
+	if (argv[2][0] == 's') {
+		/* an object left behind by a process with the same pid */
+		plant_shm(name);
+
+		if ((Pop = pmemobj_open(path, LAYOUT_NAME)) == NULL)
+			FATAL("!pmemobj_open: %s", path);
+
+		ASSERTeq(pmemobj_stats_get(Pop, &stats), 0);
+		check_shm(name, &stats);
+		pmemobj_close(Pop);
+
+		ASSERTeq(shm_open(name, O_RDONLY, 0), -1);
+		ASSERTeq(shm_unlink(dead_name), 0);
+	}
+
+	DONE(NULL);
+}
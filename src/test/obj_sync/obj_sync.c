@@ -42,10 +42,12 @@
 #include "redo.h"
 #include "list.h"
 #include "obj.h"
+#include "sync.h"
 
 #define	DATA_SIZE 128
+#define	MANY_LOCKS (4 * SYNC_TABLE_MIN_SLOTS)
 
-#define	FATAL_USAGE() FATAL("usage: obj_sync [mrc] <num_threads> <runs>\n")
+#define	FATAL_USAGE() FATAL("usage: obj_sync [mrck] <num_threads> <runs>\n")
 
 /* posix thread worker typedef */
 typedef void *(*worker)(void *);
@@ -89,6 +91,15 @@ FUNC_MOCK(pthread_cond_init, int,
 	}
 } FUNC_MOCK_END
 
+/*
+ * mock_persist -- (internal) msync with the pool persist signature
+ */
+static void
+mock_persist(PMEMobjpool *pop, void *addr, size_t len)
+{
+	pmem_msync(addr, len);
+}
+
 /*
  * mock_open_pool -- (internal) simulate pool opening
  */
@@ -96,6 +107,11 @@ static void
 mock_open_pool(PMEMobjpool *pop)
 {
 	__sync_fetch_and_add(&pop->run_id, 2);
+
+	/* the volatile lock side-table lives only as long as the pool */
+	sync_cleanup(pop);
+	if (sync_boot(pop))
+		FATAL("!sync_boot");
 }
 
 /*
@@ -210,6 +226,142 @@ rwlock_check_worker(void *arg)
 	return NULL;
 }
 
+/*
+ * rwlock_wrlock_worker -- (internal) take and release the write lock
+ */
+static void *
+rwlock_wrlock_worker(void *arg)
+{
+	int ret = pmemobj_rwlock_wrlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_unlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+
+	return NULL;
+}
+
+/*
+ * recursive_rdlock_check -- (internal) re-enter a read lock a writer waits for
+ */
+static void
+recursive_rdlock_check(void)
+{
+	pthread_t writer;
+	int ret;
+
+	ret = pmemobj_rwlock_rdlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+
+	PTHREAD_CREATE(&writer, NULL, rwlock_wrlock_worker, NULL);
+	/* give the writer time to start waiting */
+	usleep(100000);
+
+	ret = pmemobj_rwlock_rdlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_wrlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, EDEADLK);
+
+	ret = pmemobj_rwlock_unlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_unlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+
+	PTHREAD_JOIN(writer, NULL);
+}
+
+/*
+ * mixed_kinds_check -- (internal) use one pmem location as each kind of lock
+ *
+ * The storage of a freed lock may be reused for a lock of another kind, the
+ * volatile side-table must hand out a lock of the right kind and size.
+ */
+static void
+mixed_kinds_check(void)
+{
+	PMEMrwlock *rwlockp = (PMEMrwlock *)&Test_obj->mutex;
+	PMEMcond *condp = (PMEMcond *)&Test_obj->mutex;
+	int ret;
+
+	ret = pmemobj_mutex_lock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_mutex_unlock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+
+	ret = pmemobj_rwlock_wrlock(&Mock_pop, rwlockp);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_unlock(&Mock_pop, rwlockp);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_rdlock(&Mock_pop, rwlockp);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_unlock(&Mock_pop, rwlockp);
+	ASSERTeq(ret, 0);
+
+	ret = pmemobj_cond_signal(&Mock_pop, condp);
+	ASSERTeq(ret, 0);
+
+	/* the mutex is still usable and not held by any of the above */
+	ret = pmemobj_mutex_trylock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_mutex_unlock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+}
+
+/*
+ * zero_check -- (internal) zeroing a lock must also reset its volatile lock
+ */
+static void
+zero_check(void)
+{
+	int ret;
+
+	ret = pmemobj_mutex_lock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+	pmemobj_mutex_zero(&Mock_pop, &Test_obj->mutex);
+	ret = pmemobj_mutex_trylock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_mutex_unlock(&Mock_pop, &Test_obj->mutex);
+	ASSERTeq(ret, 0);
+
+	ret = pmemobj_rwlock_wrlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+	pmemobj_rwlock_zero(&Mock_pop, &Test_obj->rwlock);
+	ret = pmemobj_rwlock_trywrlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_rwlock_unlock(&Mock_pop, &Test_obj->rwlock);
+	ASSERTeq(ret, 0);
+}
+
+/*
+ * many_locks_check -- (internal) use more locks than the initial side-table
+ */
+static void
+many_locks_check(void)
+{
+	PMEMmutex *mutexes = MALLOC(MANY_LOCKS * sizeof (PMEMmutex));
+	int ret;
+
+	for (int i = 0; i < MANY_LOCKS; ++i)
+		pmemobj_mutex_zero(&Mock_pop, &mutexes[i]);
+
+	for (int i = 0; i < MANY_LOCKS; ++i) {
+		ret = pmemobj_mutex_lock(&Mock_pop, &mutexes[i]);
+		ASSERTeq(ret, 0);
+	}
+
+	/* every lock still resolves to the volatile lock it was given */
+	for (int i = 0; i < MANY_LOCKS; ++i) {
+		ret = pmemobj_mutex_trylock(&Mock_pop, &mutexes[i]);
+		ASSERTeq(ret, EBUSY);
+		ret = pmemobj_mutex_unlock(&Mock_pop, &mutexes[i]);
+		ASSERTeq(ret, 0);
+	}
+
+	for (int i = 0; i < MANY_LOCKS; ++i)
+		pmemobj_mutex_zero(&Mock_pop, &mutexes[i]);
+
+	FREE(mutexes);
+}
+
 /*
  * cleanup -- (internal) clean up after each run
  */
@@ -228,6 +380,8 @@ cleanup(char test_type)
 			pthread_mutex_destroy(&Test_obj->mutex.pmemmutex.mutex);
 			pthread_cond_destroy(&Test_obj->cond.pmemcond.cond);
 			break;
+		case 'k':
+			break;
 		default:
 			FATAL_USAGE();
 	}
@@ -259,6 +413,10 @@ main(int argc, char *argv[])
 			writer = cond_write_worker;
 			checker = cond_check_worker;
 			break;
+		case 'k':
+			writer = mutex_write_worker;
+			checker = mutex_check_worker;
+			break;
 		default:
 			FATAL_USAGE();
 
@@ -275,7 +433,7 @@ main(int argc, char *argv[])
 
 	/* first pool open */
 	mock_open_pool(&Mock_pop);
-	Mock_pop.persist = (persist_fn)pmem_msync;
+	Mock_pop.persist = mock_persist;
 	Test_obj = MALLOC(sizeof (struct mock_obj));
 	/* zero-initialize the test object */
 	pmemobj_mutex_zero(&Mock_pop, &Test_obj->mutex);
@@ -284,6 +442,11 @@ main(int argc, char *argv[])
 	Test_obj->check_data = 0;
 	memset(&Test_obj->data, 0, DATA_SIZE);
 
+	int volatile_locks = Mock_pop.locks != NULL &&
+		Mock_pop.locks->volatile_locks;
+	int biased_rwlocks = Mock_pop.locks != NULL &&
+		Mock_pop.locks->biased_rwlocks;
+
 	for (int run = 0; run < runs; run++) {
 		for (int i = 0; i < num_threads; i++) {
 			PTHREAD_CREATE(&write_threads[i], NULL, writer,
@@ -295,11 +458,31 @@ main(int argc, char *argv[])
 			PTHREAD_JOIN(write_threads[i], NULL);
 			PTHREAD_JOIN(check_threads[i], NULL);
 		}
+		/* the second *_init call of each kind is mocked to fail */
+		if (test_type == 'k' && run == 1) {
+			mixed_kinds_check();
+			zero_check();
+			many_locks_check();
+		}
+
+		if (test_type == 'r' && biased_rwlocks && run == 0)
+			recursive_rdlock_check();
+
 		/* up the run_id counter and cleanup */
 		mock_open_pool(&Mock_pop);
 		cleanup(test_type);
 	}
 
+	/* with the volatile side-table the pmem locks are never written */
+	if (volatile_locks) {
+		ASSERTeq(Test_obj->mutex.pmemmutex.runid, 0);
+		ASSERTeq(Test_obj->cond.pmemcond.runid, 0);
+	}
+	if (volatile_locks || biased_rwlocks)
+		ASSERTeq(Test_obj->rwlock.pmemrwlock.runid, 0);
+
+	sync_cleanup(&Mock_pop);
+
 	FREE(check_threads);
 	FREE(write_threads);
 	FREE(Test_obj);
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_trace.c -- unit test for the event tracing of libpmemobj
+ *
+ * usage: obj_trace file dump-file e|d|s
+ *
+ * e - tracing enabled, the events are dumped with pmemobj_trace_dump()
+ * d - tracing disabled
+ * s - tracing enabled, the events are dumped on SIGUSR1
+ */
+
+#include <sys/stat.h>
+
+#include "unittest.h"
+#include "trace.h"
+
+#define	LAYOUT_NAME	"obj_trace"
+#define	TEST_NTHREADS	4
+#define	TEST_NTX	8
+#define	TEST_SNAPSHOT	64
+#define	MAX_STACK	16
+
+struct foo {
+	char value[TEST_SNAPSHOT];
+};
+
+static PMEMobjpool *Pop;
+
+/*
+ * worker -- commit a few transactions and abort one
+ */
+static void *
+worker(void *arg)
+{
+	PMEMoid oid;
+	int ret = pmemobj_alloc(Pop, &oid, sizeof (struct foo), 1, NULL, NULL);
+	ASSERTeq(ret, 0);
+
+	for (int i = 0; i < TEST_NTX; ++i) {
+		TX_BEGIN(Pop) {
+			pmemobj_tx_add_range(oid, 0, TEST_SNAPSHOT);
+			struct foo *f = pmemobj_direct(oid);
+			f->value[0] = i;
+		} TX_ONABORT {
+			ASSERT(0);
+		} TX_END
+	}
+
+	TX_BEGIN(Pop) {
+		pmemobj_tx_add_range(oid, 0, TEST_SNAPSHOT);
+		pmemobj_tx_abort(ECANCELED);
+	} TX_END
+
+	pmemobj_free(&oid);
+
+	return NULL;
+}
+
+/*
+ * thread_stack -- begin events of a thread waiting for their ends
+ */
+struct thread_stack {
+	uint32_t tid;
+	unsigned depth;
+	uint16_t types[MAX_STACK];
+};
+
+/*
+ * check_dump -- check the events of a dump file are consistent
+ */
+static void
+check_dump(const char *path)
+{
+	int fd = OPEN(path, O_RDONLY);
+
+	struct trace_file_header hdr;
+	READ(fd, &hdr, sizeof (hdr));
+	ASSERTeq(memcmp(hdr.signature, TRACE_HDR_SIG, sizeof (hdr.signature)),
+		0);
+	ASSERTeq(hdr.major, TRACE_FORMAT_MAJOR);
+	ASSERTeq(hdr.record_size, sizeof (struct trace_record));
+	ASSERTeq(hdr.pid, getpid());
+
+	struct thread_stack threads[TEST_NTHREADS + 1];
+	unsigned nthreads = 0;
+	uint64_t nbegin[MAX_TRACE_EVENT] = {0};
+	uint64_t nend[MAX_TRACE_EVENT] = {0};
+	uint64_t ninstant[MAX_TRACE_EVENT] = {0};
+
+	for (uint64_t i = 0; i < hdr.nrecords; ++i) {
+		struct trace_record rec;
+		READ(fd, &rec, sizeof (rec));
+		ASSERT(rec.type < MAX_TRACE_EVENT);
+
+		struct thread_stack *t = NULL;
+		for (unsigned j = 0; j < nthreads; ++j)
+			if (threads[j].tid == rec.tid)
+				t = &threads[j];
+		if (t == NULL) {
+			ASSERT(nthreads < TEST_NTHREADS + 1);
+			t = &threads[nthreads++];
+			t->tid = rec.tid;
+			t->depth = 0;
+		}
+
+		/* the events of a thread nest */
+		switch (rec.phase) {
+		case TRACE_BEGIN:
+			ASSERT(t->depth < MAX_STACK);
+			t->types[t->depth++] = rec.type;
+			nbegin[rec.type]++;
+			break;
+		case TRACE_END:
+			ASSERTne(t->depth, 0);
+			ASSERTeq(t->types[--t->depth], rec.type);
+			nend[rec.type]++;
+			break;
+		case TRACE_INSTANT:
+			ASSERTeq(rec.type, TRACE_TX_SNAPSHOT);
+			ASSERTeq(rec.arg, TEST_SNAPSHOT);
+			ninstant[rec.type]++;
+			break;
+		default:
+			FATAL("invalid phase %u", rec.phase);
+		}
+
+		if (rec.phase == TRACE_END && (rec.type == TRACE_TX ||
+				rec.type == TRACE_TX_COMMIT ||
+				rec.type == TRACE_TX_ABORT))
+			ASSERTeq(rec.arg, TEST_SNAPSHOT);
+	}
+
+	CLOSE(fd);
+
+	for (unsigned j = 0; j < nthreads; ++j)
+		ASSERTeq(threads[j].depth, 0);
+
+	for (int i = 0; i < MAX_TRACE_EVENT; ++i)
+		ASSERTeq(nbegin[i], nend[i]);
+
+	ASSERTeq(nend[TRACE_TX], TEST_NTHREADS * (TEST_NTX + 1));
+	ASSERTeq(nend[TRACE_TX_COMMIT], TEST_NTHREADS * TEST_NTX);
+	ASSERTeq(nend[TRACE_TX_ABORT], TEST_NTHREADS);
+	ASSERTeq(ninstant[TRACE_TX_SNAPSHOT], TEST_NTHREADS * (TEST_NTX + 1));
+	ASSERTne(nend[TRACE_LANE_WAIT], 0);
+	ASSERTeq(nend[TRACE_LANE_WAIT], nend[TRACE_LANE_HOLD]);
+	ASSERTne(nend[TRACE_HEAP_POPULATE], 0);
+	ASSERTne(nend[TRACE_BUCKET_REFILL], 0);
+	ASSERTne(nend[TRACE_REDO_PROCESS], 0);
+	ASSERTne(nend[TRACE_LIST_INSERT_NEW], 0);
+	ASSERTne(nend[TRACE_LIST_REMOVE_FREE], 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_trace");
+
+	if (argc != 4 || strchr("eds", argv[3][0]) == NULL)
+		FATAL("usage: %s file dump-file e|d|s", argv[0]);
+
+	const char *path = argv[1];
+	const char *dump = argv[2];
+
+	if ((Pop = pmemobj_create(path, LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR)) == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	pthread_t threads[TEST_NTHREADS];
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, worker, NULL);
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	switch (argv[3][0]) {
+	case 'e': {
+		int ret = pmemobj_trace_dump(dump);
+		ASSERTeq(ret, 0);
+		check_dump(dump);
+		break;
+	}
+	case 'd': {
+		int ret = pmemobj_trace_dump(dump);
+		ASSERTeq(ret, -1);
+		ASSERTeq(errno, EINVAL);
+
+		struct stat st;
+		ASSERTne(stat(dump, &st), 0);
+		break;
+	}
+	case 's':
+		raise(SIGUSR1);
+		check_dump(dump);
+		break;
+	}
+
+	pmemobj_close(Pop);
+
+	DONE(NULL);
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * obj_tx_flush.c -- unit test for flushing of objects allocated in
+ *	a transaction
+ *
+ * usage: obj_tx_flush file
+ *
+ * The number of cache lines flushed during the commit of a transaction
+ * which allocates an object is checked with the libpmem statistics, the
+ * parts of the object that were already made durable must not be flushed
+ * again. The lines saved are measured against a commit of an object filled
+ * with plain stores. The lines written back by the allocation itself are
+ * counted too, a zeroed object must not be written back before the commit.
+ */
+
+#include <sys/stat.h>
+
+#include "unittest.h"
+
+#define	LAYOUT_NAME	"obj_tx_flush"
+#define	TEST_OBJ_SIZE	(64 * 1024)
+#define	TEST_OBJ_LINES	(TEST_OBJ_SIZE / 64)
+
+enum fill {
+	FILL_STORE,		/* plain stores */
+	FILL_MEMCPY_PERSIST,	/* pmemobj_memcpy_persist of the whole object */
+	FILL_HALF_PERSIST,	/* pmemobj_memcpy_persist of the first half */
+	FILL_PERSIST,		/* plain stores and pmemobj_persist */
+	FILL_ZALLOC,		/* pmemobj_tx_zalloc and plain stores */
+	FILL_REUSE,		/* plain stores into a reused block */
+};
+
+static char Src[TEST_OBJ_SIZE];
+
+/*
+ * flushed_lines -- returns the number of cache lines flushed so far
+ */
+static uint64_t
+flushed_lines(void)
+{
+	struct pmem_stats stats;
+	pmem_stats_get(&stats);
+
+	return stats.total.flushed_lines;
+}
+
+/*
+ * persisted_lines -- returns the number of cache lines flushed or stored
+ *	with movnt so far
+ */
+static uint64_t
+persisted_lines(void)
+{
+	struct pmem_stats stats;
+	pmem_stats_get(&stats);
+
+	return stats.total.flushed_lines + stats.total.movnt_bytes / 64;
+}
+
+/*
+ * commit_lines -- allocates and fills an object in a transaction and returns
+ *	the number of cache lines flushed by the commit, and the number of
+ *	lines persisted by the allocation in alloc_lines, if not NULL
+ */
+static uint64_t
+commit_lines(PMEMobjpool *pop, enum fill fill, uint64_t *alloc_lines)
+{
+	ASSERTeq(pmemobj_tx_begin(pop, NULL, TX_LOCK_NONE), 0);
+
+	uint64_t alloc_before = persisted_lines();
+	PMEMoid oid = fill == FILL_ZALLOC ?
+		pmemobj_tx_zalloc(TEST_OBJ_SIZE, 1) :
+		pmemobj_tx_alloc(TEST_OBJ_SIZE, 1);
+	ASSERT(!OID_IS_NULL(oid));
+	if (alloc_lines != NULL)
+		*alloc_lines = persisted_lines() - alloc_before;
+
+	if (fill == FILL_REUSE) {
+		/* the block freed in the transaction gets allocated again */
+		pmemobj_memcpy_persist(pop, pmemobj_direct(oid), Src,
+			TEST_OBJ_SIZE);
+		ASSERTeq(pmemobj_tx_free(oid), 0);
+
+		PMEMoid reused = pmemobj_tx_alloc(TEST_OBJ_SIZE, 1);
+		ASSERTeq(reused.off, oid.off);
+		oid = reused;
+	}
+
+	char *ptr = pmemobj_direct(oid);
+	switch (fill) {
+	case FILL_STORE:
+	case FILL_ZALLOC:
+	case FILL_REUSE:
+		memcpy(ptr, Src, TEST_OBJ_SIZE);
+		break;
+	case FILL_MEMCPY_PERSIST:
+		pmemobj_memcpy_persist(pop, ptr, Src, TEST_OBJ_SIZE);
+		break;
+	case FILL_HALF_PERSIST:
+		pmemobj_memcpy_persist(pop, ptr, Src, TEST_OBJ_SIZE / 2);
+		memcpy(ptr + TEST_OBJ_SIZE / 2, Src, TEST_OBJ_SIZE / 2);
+		break;
+	case FILL_PERSIST:
+		memcpy(ptr, Src, TEST_OBJ_SIZE);
+		pmemobj_persist(pop, ptr, TEST_OBJ_SIZE);
+		break;
+	}
+
+	uint64_t before = flushed_lines();
+	ASSERTeq(pmemobj_tx_commit(), 0);
+	uint64_t lines = flushed_lines() - before;
+	pmemobj_tx_end();
+
+	ASSERTeq(memcmp(ptr, Src, TEST_OBJ_SIZE), 0);
+
+	return lines;
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "obj_tx_flush");
+
+	if (argc != 2)
+		FATAL("usage: %s file", argv[0]);
+
+	if (!pmem_stats_enabled())
+		FATAL("PMEM_STATS not enabled");
+
+	PMEMobjpool *pop;
+	if ((pop = pmemobj_create(argv[1], LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR)) == NULL)
+		FATAL("!pmemobj_create: %s", argv[1]);
+
+	memset(Src, 0xc5, TEST_OBJ_SIZE);
+
+	uint64_t all = commit_lines(pop, FILL_STORE, NULL);
+	ASSERT(all >= TEST_OBJ_LINES);
+
+	ASSERTeq(all - commit_lines(pop, FILL_MEMCPY_PERSIST, NULL),
+		TEST_OBJ_LINES);
+	ASSERTeq(all - commit_lines(pop, FILL_PERSIST, NULL), TEST_OBJ_LINES);
+	ASSERTeq(all - commit_lines(pop, FILL_HALF_PERSIST, NULL),
+		TEST_OBJ_LINES / 2);
+
+	/*
+	 * Zeroing must not write the object back ahead of the commit, the
+	 * allocation itself only persists a few lines of heap metadata.
+	 */
+	uint64_t alloc;
+	uint64_t ret = commit_lines(pop, FILL_ZALLOC, &alloc);
+	ASSERTeq(ret, all);
+	ASSERT(alloc < TEST_OBJ_LINES);
+
+	ASSERTeq(commit_lines(pop, FILL_REUSE, NULL), all);
+
+	pmemobj_close(pop);
+
+	DONE(NULL);
+}
@@ -168,6 +168,47 @@ do_aborted_nested_tx(void *arg)
 	return NULL;
 }
 
+/*
+ * do_free_check -- (internal) a lock in freed memory must not stay locked
+ */
+static void
+do_free_check(PMEMobjpool *pop)
+{
+	PMEMoid oid;
+	int ret = pmemobj_zalloc(pop, &oid, sizeof (PMEMmutex), 0);
+	ASSERTeq(ret, 0);
+	uint64_t off = oid.off;
+
+	PMEMmutex *mutexp = pmemobj_direct(oid);
+	ret = pmemobj_mutex_lock(pop, mutexp);
+	ASSERTeq(ret, 0);
+	pmemobj_free(&oid);
+
+	/* the same memory comes back with a fresh, unlocked mutex */
+	ret = pmemobj_zalloc(pop, &oid, sizeof (PMEMmutex), 0);
+	ASSERTeq(ret, 0);
+	ASSERTeq(oid.off, off);
+
+	mutexp = pmemobj_direct(oid);
+	ret = pmemobj_mutex_trylock(pop, mutexp);
+	ASSERTeq(ret, 0);
+	ret = pmemobj_mutex_unlock(pop, mutexp);
+	ASSERTeq(ret, 0);
+
+	/* freeing memory without locks leaves the other locks alone */
+	ret = pmemobj_mutex_lock(pop, mutexp);
+	ASSERTeq(ret, 0);
+	PMEMoid other;
+	ret = pmemobj_zalloc(pop, &other, sizeof (PMEMmutex), 0);
+	ASSERTeq(ret, 0);
+	pmemobj_free(&other);
+	ret = pmemobj_mutex_trylock(pop, mutexp);
+	ASSERTeq(ret, EBUSY);
+	ret = pmemobj_mutex_unlock(pop, mutexp);
+	ASSERTeq(ret, 0);
+	pmemobj_free(&oid);
+}
+
 static void
 run_mt_test(void *(*worker)(void *), void *arg)
 {
@@ -186,16 +227,18 @@ main(int argc, char *argv[])
 	START(argc, argv, "obj_tx_locks");
 
 	if (argc > 3)
-		FATAL("usage: %s <file> [m]", argv[0]);
+		FATAL("usage: %s <file> [m|f]", argv[0]);
 
 	if ((test_obj.pop = pmemobj_create(argv[1], LAYOUT_NAME,
 	    PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR)) == NULL)
 		FATAL("!pmemobj_create");
 
 	int multithread = 0;
+	int free_check = 0;
 	if (argc == 3) {
 		multithread = (argv[2][0] == 'm');
-		if (!multithread)
+		free_check = (argv[2][0] == 'f');
+		if (!multithread && !free_check)
 			FATAL("wrong test type supplied %c", argv[1][0]);
 	}
 
@@ -246,6 +289,9 @@ main(int argc, char *argv[])
 	ASSERT(test_obj.b == TEST_VALUE_A);
 	ASSERT(test_obj.c == TEST_VALUE_C);
 
+	if (free_check)
+		do_free_check(test_obj.pop);
+
 	pmemobj_close(test_obj.pop);
 
 	DONE(NULL);
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmem_emul.c -- unit test for the NVM latency and bandwidth emulation
+ *
+ * usage: pmem_emul file f|d|m
+ *
+ * f - each flushed cache line takes PMEM_EMUL_FLUSH_NS
+ * d - each drain takes PMEM_EMUL_FENCE_NS
+ * m - non-temporal stores do not exceed PMEM_EMUL_MOVNT_BW
+ *
+ * The delays are only checked from below, with some slack for the
+ * calibration of the TSC.
+ */
+
+#include <time.h>
+
+#include "unittest.h"
+
+#define	TEST_SIZE	(1024 * 1024)
+#define	TEST_NDRAINS	50
+
+/*
+ * now_ns -- monotonic time in nanoseconds
+ */
+static uint64_t
+now_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000 + (uint64_t)t.tv_nsec;
+}
+
+/*
+ * env_ull -- the value of an environment variable set by the TEST script
+ */
+static unsigned long long
+env_ull(const char *name)
+{
+	char *ptr = getenv(name);
+	if (ptr == NULL)
+		FATAL("%s not set", name);
+
+	return strtoull(ptr, NULL, 10);
+}
+
+/*
+ * check_elapsed -- make sure an operation took at least 90% of the expected
+ */
+static void
+check_elapsed(uint64_t start, unsigned long long expected)
+{
+	uint64_t elapsed = now_ns() - start;
+
+	if (elapsed < expected / 10 * 9)
+		FATAL("took %llu ns, expected at least %llu ns",
+			(unsigned long long)elapsed, expected);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem_emul");
+
+	if (argc != 3 || strchr("fdm", argv[2][0]) == NULL)
+		FATAL("usage: %s file f|d|m", argv[0]);
+
+	int fd = OPEN(argv[1], O_RDWR);
+	char *buf = pmem_map(fd);
+	if (buf == NULL)
+		FATAL("!pmem_map");
+	CLOSE(fd);
+
+	static char src[TEST_SIZE];
+	unsigned long long val;
+	uint64_t start;
+
+	switch (argv[2][0]) {
+	case 'f':
+		val = env_ull("PMEM_EMUL_FLUSH_NS");
+		start = now_ns();
+		pmem_flush(buf, TEST_SIZE);
+		check_elapsed(start, val * (TEST_SIZE / 64));
+
+		/* a partial line is a whole line to flush */
+		start = now_ns();
+		for (int i = 0; i < 1000; ++i)
+			pmem_flush(buf + 63, 2);
+		check_elapsed(start, val * 2 * 1000);
+		break;
+	case 'd':
+		val = env_ull("PMEM_EMUL_FENCE_NS");
+		start = now_ns();
+		for (int i = 0; i < TEST_NDRAINS; ++i)
+			pmem_drain();
+		check_elapsed(start, val * TEST_NDRAINS);
+		break;
+	case 'm':
+		/* MB/s, so a byte takes 1000 / val ns */
+		val = env_ull("PMEM_EMUL_MOVNT_BW");
+		start = now_ns();
+		pmem_memcpy_nodrain(buf, src, TEST_SIZE);
+		check_elapsed(start, TEST_SIZE * 1000ULL / val);
+
+		start = now_ns();
+		pmem_memset_nodrain(buf, 0, TEST_SIZE);
+		check_elapsed(start, TEST_SIZE * 1000ULL / val);
+		break;
+	}
+
+	MUNMAP(buf, TEST_SIZE);
+
+	DONE(NULL);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * pmem_map_flags.c -- unit test for pmem_map_flags() and pmem_map_pagesizes()
+ *
+ * usage: pmem_map_flags file flags...
+ */
+
+#include "unittest.h"
+
+#define	CHECK_BYTES 4096	/* bytes to compare after map call */
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem_map_flags");
+
+	if (argc < 3)
+		FATAL("usage: %s file flags...", argv[0]);
+
+	int fd = OPEN(argv[1], O_RDWR);
+
+	struct stat stbuf;
+	FSTAT(fd, &stbuf);
+
+	char pat[CHECK_BYTES];
+
+	for (int arg = 2; arg < argc; arg++) {
+		int flags = (int)strtol(argv[arg], NULL, 0);
+
+		void *addr = pmem_map_flags(fd, flags);
+		if (addr == NULL) {
+			OUT("flags 0x%x: %s", flags, pmem_errormsg());
+			continue;
+		}
+
+		/* the mapping must see what is written to the file */
+		memset(pat, arg, CHECK_BYTES);
+		LSEEK(fd, (off_t)(stbuf.st_size - CHECK_BYTES), SEEK_SET);
+		WRITE(fd, pat, CHECK_BYTES);
+		ASSERTeq(memcmp(pat, (char *)addr + stbuf.st_size -
+				CHECK_BYTES, CHECK_BYTES), 0);
+
+		size_t huge2m = SIZE_MAX;
+		size_t huge1g = SIZE_MAX;
+		ASSERTeq(pmem_map_pagesizes(addr, stbuf.st_size,
+				&huge2m, &huge1g), 0);
+		ASSERT(huge2m + huge1g <= (size_t)stbuf.st_size);
+
+		MUNMAP(addr, stbuf.st_size);
+
+		OUT("flags 0x%x: mapped", flags);
+	}
+
+	CLOSE(fd);
+
+	DONE(NULL);
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * pmem_stats.c -- unit test for the flush, fence and copy statistics
+ *
+ * usage: pmem_stats file e|d|n|o
+ *
+ * e - statistics enabled
+ * d - statistics disabled
+ * n - statistics enabled, movnt disabled
+ * o - statistics of libpmemobj subsystems, the file is a new pool
+ */
+
+#include "unittest.h"
+
+#define	TEST_SIZE	(64 * 1024)
+#define	TEST_SMALL	(100)
+#define	TEST_CONTEXT	(5)
+#define	TEST_NTHREADS	(4)
+#define	LAYOUT_NAME	"pmem_stats"
+
+struct foo {
+	uint64_t value[8];
+};
+
+/*
+ * stats_diff -- counters of a context since the last call for that context
+ */
+static struct pmem_stats_counters
+stats_diff(unsigned context)
+{
+	static struct pmem_stats_counters prev[PMEM_STATS_NCONTEXTS];
+	struct pmem_stats stats;
+
+	pmem_stats_get(&stats);
+
+	struct pmem_stats_counters d = stats.contexts[context];
+	d.flushed_lines -= prev[context].flushed_lines;
+	d.fences -= prev[context].fences;
+	d.movnt_bytes -= prev[context].movnt_bytes;
+	d.temporal_bytes -= prev[context].temporal_bytes;
+
+	/* the total is the sum of the contexts */
+	struct pmem_stats_counters sum = {0, 0, 0, 0};
+	for (unsigned i = 0; i < PMEM_STATS_NCONTEXTS; ++i) {
+		sum.flushed_lines += stats.contexts[i].flushed_lines;
+		sum.fences += stats.contexts[i].fences;
+		sum.movnt_bytes += stats.contexts[i].movnt_bytes;
+		sum.temporal_bytes += stats.contexts[i].temporal_bytes;
+	}
+	ASSERTeq(sum.flushed_lines, stats.total.flushed_lines);
+	ASSERTeq(sum.fences, stats.total.fences);
+	ASSERTeq(sum.movnt_bytes, stats.total.movnt_bytes);
+	ASSERTeq(sum.temporal_bytes, stats.total.temporal_bytes);
+
+	prev[context] = stats.contexts[context];
+	return d;
+}
+
+/*
+ * worker -- persist the thread's part of the buffer and exit
+ */
+static void *
+worker(void *arg)
+{
+	pmem_persist(arg, TEST_SIZE / TEST_NTHREADS);
+	return NULL;
+}
+
+/*
+ * test_enabled -- check the counters follow the operations
+ */
+static void
+test_enabled(char *buf, int movnt)
+{
+	static char src[TEST_SIZE];
+	struct pmem_stats_counters d;
+
+	ASSERTeq(pmem_stats_enabled(), 1);
+	stats_diff(0);
+
+	/* flushes are counted in cache lines, partial ones included */
+	pmem_flush(buf, TEST_SIZE);
+	ASSERTeq(stats_diff(0).flushed_lines, TEST_SIZE / 64);
+	pmem_flush(buf + 1, 64);
+	ASSERTeq(stats_diff(0).flushed_lines, 2);
+	pmem_flush(buf, 0);
+	ASSERTeq(stats_diff(0).flushed_lines, 0);
+
+	/* every drain issues the same number of fences */
+	pmem_drain();
+	uint64_t fences = stats_diff(0).fences;
+	ASSERT(fences <= 2);
+	for (int i = 0; i < 10; ++i)
+		pmem_drain();
+	ASSERTeq(stats_diff(0).fences, 10 * fences);
+
+	/* large copies go through movnt unless it is disabled */
+	pmem_memcpy_persist(buf, src, TEST_SIZE);
+	d = stats_diff(0);
+	ASSERTeq(d.movnt_bytes + d.temporal_bytes, TEST_SIZE);
+	if (!movnt)
+		ASSERTeq(d.movnt_bytes, 0);
+	ASSERTeq(d.fences, fences);
+
+	pmem_memset_persist(buf, 0, TEST_SIZE);
+	d = stats_diff(0);
+	ASSERTeq(d.movnt_bytes + d.temporal_bytes, TEST_SIZE);
+	if (!movnt)
+		ASSERTeq(d.movnt_bytes, 0);
+
+	/* small ones never do */
+	pmem_memmove_persist(buf, src, TEST_SMALL);
+	d = stats_diff(0);
+	ASSERTeq(d.movnt_bytes, 0);
+	ASSERTeq(d.temporal_bytes, TEST_SMALL);
+
+	/* operations are charged to the current context of the thread */
+	unsigned prev = pmem_stats_set_context(TEST_CONTEXT);
+	ASSERTeq(prev, 0);
+	pmem_persist(buf, TEST_SIZE);
+	ASSERTeq(stats_diff(0).flushed_lines, 0);
+	ASSERTeq(stats_diff(TEST_CONTEXT).flushed_lines, TEST_SIZE / 64);
+
+	/* an invalid context leaves the current one */
+	prev = pmem_stats_set_context(PMEM_STATS_NCONTEXTS);
+	ASSERTeq(prev, TEST_CONTEXT);
+	prev = pmem_stats_set_context(0);
+	ASSERTeq(prev, TEST_CONTEXT);
+
+	/* the counters of exited threads are kept */
+	pthread_t threads[TEST_NTHREADS];
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, worker,
+			buf + i * (TEST_SIZE / TEST_NTHREADS));
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	d = stats_diff(0);
+	ASSERTeq(d.flushed_lines, TEST_SIZE / 64);
+	ASSERTeq(d.fences, TEST_NTHREADS * fences);
+}
+
+/*
+ * test_disabled -- check nothing is counted
+ */
+static void
+test_disabled(char *buf)
+{
+	struct pmem_stats stats;
+
+	ASSERTeq(pmem_stats_enabled(), 0);
+	ASSERTeq(pmem_stats_set_context(TEST_CONTEXT), 0);
+
+	pmem_memset_persist(buf, 0, TEST_SIZE);
+	pmem_persist(buf, TEST_SIZE);
+
+	pmem_stats_get(&stats);
+	ASSERTeq(stats.total.flushed_lines, 0);
+	ASSERTeq(stats.total.fences, 0);
+	ASSERTeq(stats.total.movnt_bytes, 0);
+	ASSERTeq(stats.total.temporal_bytes, 0);
+}
+
+/*
+ * test_obj -- check the flushes of libpmemobj are charged to its subsystems
+ */
+static void
+test_obj(const char *path)
+{
+	PMEMobjpool *pop = pmemobj_create(path, LAYOUT_NAME, PMEMOBJ_MIN_POOL,
+			S_IWUSR | S_IRUSR);
+	if (pop == NULL)
+		FATAL("!pmemobj_create: %s", path);
+
+	stats_diff(PMEMOBJ_STATS_REDO);
+	stats_diff(PMEMOBJ_STATS_LIST);
+	stats_diff(PMEMOBJ_STATS_HEAP);
+
+	PMEMoid oid;
+	int ret = pmemobj_alloc(pop, &oid, sizeof (struct foo), 1, NULL, NULL);
+	ASSERTeq(ret, 0);
+
+	struct pmem_stats stats;
+	pmem_stats_get(&stats);
+	ASSERTne(stats.contexts[PMEMOBJ_STATS_REDO].flushed_lines, 0);
+	ASSERTne(stats.contexts[PMEMOBJ_STATS_LIST].flushed_lines, 0);
+	ASSERTne(stats.contexts[PMEMOBJ_STATS_HEAP].flushed_lines, 0);
+	uint64_t tx_lines = stats.contexts[PMEMOBJ_STATS_TX].flushed_lines;
+
+	TX_BEGIN(pop) {
+		pmemobj_tx_add_range(oid, 0, sizeof (struct foo));
+		struct foo *f = pmemobj_direct(oid);
+		f->value[0] = 1;
+	} TX_ONABORT {
+		ASSERT(0);
+	} TX_END
+
+	pmem_stats_get(&stats);
+	ASSERT(stats.contexts[PMEMOBJ_STATS_TX].flushed_lines > tx_lines);
+
+	/* the context of the thread is restored after the operations */
+	ASSERTeq(pmem_stats_set_context(0), 0);
+
+	pmemobj_free(&oid);
+	pmemobj_close(pop);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "pmem_stats");
+
+	if (argc != 3 || strchr("edno", argv[2][0]) == NULL)
+		FATAL("usage: %s file e|d|n|o", argv[0]);
+
+	if (argv[2][0] == 'o') {
+		test_obj(argv[1]);
+		DONE(NULL);
+	}
+
+	int fd = OPEN(argv[1], O_RDWR);
+	char *buf = pmem_map(fd);
+	if (buf == NULL)
+		FATAL("!pmem_map");
+	CLOSE(fd);
+
+	switch (argv[2][0]) {
+	case 'e':
+		test_enabled(buf, 1);
+		break;
+	case 'n':
+		test_enabled(buf, 0);
+		break;
+	case 'd':
+		test_disabled(buf);
+		break;
+	}
+
+	MUNMAP(buf, TEST_SIZE);
+
+	DONE(NULL);
+}
@@ -34,7 +34,7 @@
  * pmemmalloc.c -- simple tool for allocating objects from pmemobj
  *
  * usage: pmemalloc [-r <size>] [-o <size>] [-t <type_num>]
- *			[-c <count>] [-e <num>] <file>
+ *			[-c <count>] [-F <n>] [-e <num>] <file>
  */
 
 #include <stdio.h>
@@ -44,8 +44,8 @@
 
 #define	USAGE()\
 printf("usage: pmemalloc"\
-	" [-r <size>] [-o <size>] [-t <type_num>]"\
-	" [-s] [-f] [-e a|f|s] <file>\n")
+	" [-r <size>] [-o <size>] [-t <type_num>] [-c <count>]"\
+	" [-F <n>] [-s] [-f] [-e a|f|s] <file>\n")
 
 int
 main(int argc, char *argv[])
@@ -57,13 +57,15 @@ main(int argc, char *argv[])
 	char exit_at = '\0';
 	int do_set = 0;
 	int do_free = 0;
+	unsigned count = 1;
+	unsigned keep_nth = 0;
 
 	if (argc < 2) {
 		USAGE();
 		return -1;
 	}
 
-	while ((opt = getopt(argc, argv, "r:o:t:e:sf")) != -1) {
+	while ((opt = getopt(argc, argv, "r:o:t:c:F:e:sf")) != -1) {
 		switch (opt) {
 		case 'r':
 			root_size = atoll(optarg);
@@ -74,6 +76,12 @@ main(int argc, char *argv[])
 		case 't':
 			type_num = atoi(optarg);
 			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		case 'F':
+			keep_nth = atoi(optarg);
+			break;
 		case 'e':
 			exit_at = optarg[0];
 			break;
@@ -106,7 +114,7 @@ main(int argc, char *argv[])
 		}
 	}
 
-	if (size) {
+	for (unsigned n = 0; size && n < count; n++) {
 		PMEMoid oid;
 		TX_BEGIN(pop) {
 			oid = pmemobj_tx_alloc(size, type_num);
@@ -136,6 +144,19 @@ main(int argc, char *argv[])
 		}
 	}
 
+	/* free all objects of the type except every n-th one */
+	if (keep_nth) {
+		PMEMoid oid;
+		PMEMoid next;
+		unsigned n = 0;
+		for (oid = pmemobj_first(pop, type_num); oid.off != 0;
+				oid = next) {
+			next = pmemobj_next(oid);
+			if (n++ % keep_nth)
+				pmemobj_free(&oid);
+		}
+	}
+
 	pmemobj_close(pop);
 
 	return 0;
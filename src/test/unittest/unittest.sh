@@ -228,6 +228,16 @@ function require_no_superuser() {
 	exit 0
 }
 
+#
+# require_superuser -- require user with superuser rights
+#
+function require_superuser() {
+	local user_id=$(id -u)
+	[ "$user_id" = "0" ] && return
+	echo "$UNITTEST_NAME: SKIP required: run with superuser rights"
+	exit 0
+}
+
 #
 # require_test_type -- only allow script to continue for a certain test type
 #
@@ -33,13 +33,78 @@
 /*
  * vmem_multiple_pools.c -- unit test for vmem_multiple_pools
  *
- * usage: vmem_multiple_pools directory
+ * usage: vmem_multiple_pools directory [npools nthreads]
+ *
+ * With npools and nthreads given, the threads concurrently create and
+ * delete npools pools in regions, npools / nthreads each.
  */
 
 #include "unittest.h"
 
 #define	TEST_POOLS_MAX (9)
 #define	TEST_REPEAT_CREATE_POOLS (30)
+#define	TEST_REPEAT_CREATE_POOLS_MT (3)
+
+static unsigned Pools_per_thread;
+
+/*
+ * thread_func -- repeatedly create, use and delete the pools of a thread
+ */
+static void *
+thread_func(void *arg)
+{
+	char **mem_pools = arg;
+	VMEM **pools = MALLOC(Pools_per_thread * sizeof (VMEM *));
+
+	for (int repeat = 0; repeat < TEST_REPEAT_CREATE_POOLS_MT; ++repeat) {
+		for (unsigned i = 0; i < Pools_per_thread; ++i) {
+			pools[i] = vmem_create_in_region(mem_pools[i],
+					VMEM_MIN_POOL);
+			if (pools[i] == NULL)
+				FATAL("!vmem_create_in_region");
+
+			void *test = vmem_malloc(pools[i], sizeof (void *));
+
+			ASSERTne(test, NULL);
+			vmem_free(pools[i], test);
+		}
+
+		for (unsigned i = 0; i < Pools_per_thread; ++i)
+			vmem_delete(pools[i]);
+	}
+
+	FREE(pools);
+
+	return NULL;
+}
+
+/*
+ * test_mt -- create and delete many pools from many threads at once
+ */
+static void
+test_mt(unsigned npools, unsigned nthreads)
+{
+	Pools_per_thread = npools / nthreads;
+
+	pthread_t *threads = MALLOC(nthreads * sizeof (pthread_t));
+	char **mem_pools = MALLOC(npools * sizeof (char *));
+
+	for (unsigned i = 0; i < npools; ++i)
+		mem_pools[i] = MMAP_ANON_ALIGNED(VMEM_MIN_POOL, 4 << 20);
+
+	for (unsigned t = 0; t < nthreads; ++t)
+		PTHREAD_CREATE(&threads[t], NULL, thread_func,
+				&mem_pools[t * Pools_per_thread]);
+
+	for (unsigned t = 0; t < nthreads; ++t)
+		PTHREAD_JOIN(threads[t], NULL);
+
+	for (unsigned i = 0; i < npools; ++i)
+		MUNMAP_ANON_ALIGNED(mem_pools[i], VMEM_MIN_POOL);
+
+	FREE(mem_pools);
+	FREE(threads);
+}
 
 int
 main(int argc, char *argv[])
@@ -52,11 +117,23 @@ main(int argc, char *argv[])
 
 	START(argc, argv, "vmem_multiple_pools");
 
-	if (argc < 2 || argc > 3)
-		FATAL("usage: %s directory", argv[0]);
+	if (argc != 2 && argc != 4)
+		FATAL("usage: %s directory [npools nthreads]", argv[0]);
 
 	const char *dir = argv[1];
 
+	if (argc == 4) {
+		unsigned npools = atoi(argv[2]);
+		unsigned nthreads = atoi(argv[3]);
+
+		if (nthreads == 0 || npools < nthreads)
+			FATAL("npools must be at least nthreads");
+
+		test_mt(npools, nthreads);
+
+		DONE(NULL);
+	}
+
 	/* create and destroy pools multiple times */
 	size_t repeat;
 	size_t pool_id;
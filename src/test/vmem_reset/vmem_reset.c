@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * vmem_reset.c -- unit test for vmem_reset
+ *
+ * usage: vmem_reset directory
+ */
+
+#include "unittest.h"
+
+#define	TEST_ALLOC_SIZE	(1024)
+#define	TEST_REPEAT	(3)
+#define	TEST_NTHREADS	(4)
+#define	TEST_NOBJS	(10000)
+
+/*
+ * fill_pool -- allocate objects until the pool is exhausted
+ */
+static size_t
+fill_pool(VMEM *vmp, size_t size)
+{
+	size_t count = 0;
+	void *ptr;
+
+	while ((ptr = vmem_malloc(vmp, size)) != NULL) {
+		memset(ptr, 0xc5, size);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * test_reset -- check the whole pool is available again after each reset
+ */
+static void
+test_reset(VMEM *vmp)
+{
+	size_t count = 0;
+
+	for (int repeat = 0; repeat < TEST_REPEAT; ++repeat) {
+		ASSERTeq(vmem_reset(vmp), 0);
+		ASSERTeq(vmem_check(vmp), 1);
+
+		size_t n = fill_pool(vmp, TEST_ALLOC_SIZE);
+		ASSERTne(n, 0);
+		if (repeat == 0)
+			count = n;
+		ASSERTeq(n, count);
+	}
+}
+
+/*
+ * test_reset_only -- check the allocation functions of a reset-only pool
+ */
+static void
+test_reset_only(VMEM *vmp)
+{
+	char *ptr = vmem_malloc(vmp, 10);
+	ASSERTne(ptr, NULL);
+	ASSERTeq((uintptr_t)ptr & 15, 0);
+	ASSERT(vmem_malloc_usable_size(vmp, ptr) >= 10);
+	strcpy(ptr, "reset");
+
+	char *big = vmem_realloc(vmp, ptr, 1 << 20);
+	ASSERTne(big, NULL);
+	ASSERTeq(strcmp(big, "reset"), 0);
+	ASSERT(vmem_malloc_usable_size(vmp, big) >= 1 << 20);
+	ASSERTeq(vmem_realloc(vmp, big, 100), big);
+
+	char *zeroed = vmem_calloc(vmp, 100, 10);
+	ASSERTne(zeroed, NULL);
+	for (int i = 0; i < 1000; ++i)
+		ASSERTeq(zeroed[i], 0);
+
+	void *aligned = vmem_aligned_alloc(vmp, 4096, 100);
+	ASSERTne(aligned, NULL);
+	ASSERTeq((uintptr_t)aligned & 4095, 0);
+
+	char *str = vmem_strdup(vmp, "reset-only");
+	ASSERTne(str, NULL);
+	ASSERTeq(strcmp(str, "reset-only"), 0);
+
+	/* objects are only reclaimed by the reset */
+	vmem_free(vmp, str);
+	ASSERTeq(strcmp(str, "reset-only"), 0);
+
+	test_reset(vmp);
+}
+
+/*
+ * thread_func -- allocate objects tagged with the thread number
+ */
+static void *
+thread_func(void *arg)
+{
+	VMEM *vmp = *(VMEM **)arg;
+	uintptr_t id = (uintptr_t)arg;
+	uintptr_t **objs = MALLOC(TEST_NOBJS * sizeof (uintptr_t *));
+
+	for (int i = 0; i < TEST_NOBJS; ++i) {
+		size_t n = 1 + i % 16;
+		objs[i] = vmem_malloc(vmp, n * sizeof (uintptr_t));
+		ASSERTne(objs[i], NULL);
+		for (size_t j = 0; j < n; ++j)
+			objs[i][j] = id;
+	}
+
+	for (int i = 0; i < TEST_NOBJS; ++i) {
+		size_t n = 1 + i % 16;
+		for (size_t j = 0; j < n; ++j)
+			ASSERTeq(objs[i][j], id);
+	}
+
+	FREE(objs);
+
+	return NULL;
+}
+
+/*
+ * test_reset_only_mt -- allocate from a reset-only pool in many threads
+ */
+static void
+test_reset_only_mt(VMEM *vmp)
+{
+	pthread_t threads[TEST_NTHREADS];
+	VMEM *args[TEST_NTHREADS];
+
+	for (int repeat = 0; repeat < TEST_REPEAT; ++repeat) {
+		for (int t = 0; t < TEST_NTHREADS; ++t) {
+			args[t] = vmp;
+			PTHREAD_CREATE(&threads[t], NULL, thread_func,
+					&args[t]);
+		}
+
+		for (int t = 0; t < TEST_NTHREADS; ++t)
+			PTHREAD_JOIN(threads[t], NULL);
+
+		ASSERTeq(vmem_reset(vmp), 0);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmem_reset");
+
+	if (argc != 2)
+		FATAL("usage: %s directory", argv[0]);
+
+	const char *dir = argv[1];
+	VMEM *vmp;
+
+	vmp = vmem_create(dir, VMEM_MIN_POOL);
+	if (vmp == NULL)
+		FATAL("!vmem_create");
+	test_reset(vmp);
+	vmem_delete(vmp);
+
+	void *mem_pool = MMAP_ANON_ALIGNED(VMEM_MIN_POOL, 4 << 20);
+	vmp = vmem_create_in_region(mem_pool, VMEM_MIN_POOL);
+	if (vmp == NULL)
+		FATAL("!vmem_create_in_region");
+	test_reset(vmp);
+	vmem_delete(vmp);
+
+	vmp = vmem_create_in_region_flags(mem_pool, VMEM_MIN_POOL,
+			VMEM_RESET_ONLY);
+	if (vmp == NULL)
+		FATAL("!vmem_create_in_region_flags");
+	test_reset_only(vmp);
+	vmem_delete(vmp);
+	MUNMAP_ANON_ALIGNED(mem_pool, VMEM_MIN_POOL);
+
+	vmp = vmem_create_flags(dir, VMEM_MIN_POOL * 4, VMEM_RESET_ONLY);
+	if (vmp == NULL)
+		FATAL("!vmem_create_flags");
+	test_reset_only_mt(vmp);
+	vmem_delete(vmp);
+
+	ASSERTeq(vmem_create_flags(dir, VMEM_MIN_POOL, ~VMEM_RESET_ONLY), NULL);
+	ASSERTeq(errno, EINVAL);
+
+	DONE(NULL);
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vmem_sparse -- unit test for pools backed by sparse files
+ *
+ * usage: vmem_sparse op directory
+ *
+ * op is one of:
+ *	g - the file grows with the allocations and shrinks after they are freed
+ *	f - a pool larger than its file system runs out of memory cleanly
+ */
+
+#include <dirent.h>
+#include <limits.h>
+
+#include "unittest.h"
+
+#define	POOL_SIZE ((size_t)(64 << 20))
+#define	ALLOC_SIZE ((size_t)(4 << 20)) /* one chunk, released on free */
+#define	NALLOCS 8
+
+/*
+ * pool_fd -- (internal) find the descriptor of the unlinked pool file
+ */
+static int
+pool_fd(const char *dir)
+{
+	char prefix[PATH_MAX];
+	if (realpath(dir, prefix) == NULL)
+		FATAL("!realpath: %s", dir);
+	strncat(prefix, "/vmem.", sizeof (prefix) - strlen(prefix) - 1);
+
+	DIR *fds = opendir("/proc/self/fd");
+	if (fds == NULL)
+		FATAL("!opendir");
+
+	int fd = -1;
+	struct dirent *d;
+	while (fd == -1 && (d = readdir(fds)) != NULL) {
+		char link[PATH_MAX];
+		char target[PATH_MAX];
+		snprintf(link, sizeof (link), "/proc/self/fd/%s", d->d_name);
+
+		ssize_t len = readlink(link, target, sizeof (target) - 1);
+		if (len <= 0)
+			continue;
+		target[len] = '\0';
+
+		if (strncmp(target, prefix, strlen(prefix)) == 0)
+			fd = atoi(d->d_name);
+	}
+
+	closedir(fds);
+
+	if (fd == -1)
+		FATAL("pool file not found in %s", dir);
+
+	return fd;
+}
+
+/*
+ * file_used -- (internal) return the number of bytes allocated to the file
+ */
+static size_t
+file_used(int fd)
+{
+	struct stat st;
+	FSTAT(fd, &st);
+
+	return (size_t)st.st_blocks * 512;
+}
+
+/*
+ * grow_check -- (internal) file blocks follow the chunks in use
+ */
+static void
+grow_check(const char *dir)
+{
+	VMEM *vmp = vmem_create(dir, POOL_SIZE);
+	if (vmp == NULL)
+		FATAL("!vmem_create");
+
+	int fd = pool_fd(dir);
+	size_t empty = file_used(fd);
+	ASSERT(empty < POOL_SIZE / 2);
+
+	void *ptr[NALLOCS];
+	for (int i = 0; i < NALLOCS; ++i) {
+		ptr[i] = vmem_malloc(vmp, ALLOC_SIZE);
+		ASSERTne(ptr[i], NULL);
+		memset(ptr[i], 0xc5, ALLOC_SIZE);
+	}
+
+	size_t used = file_used(fd);
+	ASSERT(used >= empty + NALLOCS * ALLOC_SIZE);
+
+	for (int i = 0; i < NALLOCS; ++i)
+		vmem_free(vmp, ptr[i]);
+
+	/* the released chunks are punched out of the file */
+	ASSERT(file_used(fd) <= used - NALLOCS * ALLOC_SIZE);
+
+	vmem_delete(vmp);
+}
+
+/*
+ * full_check -- (internal) a full file system makes allocations fail
+ *
+ * The pool is bigger than the file system, touching memory the file has
+ * no blocks for would raise SIGBUS.
+ */
+static void
+full_check(const char *dir)
+{
+	VMEM *vmp = vmem_create(dir, POOL_SIZE);
+	if (vmp == NULL)
+		FATAL("!vmem_create");
+
+	void *ptr[POOL_SIZE / ALLOC_SIZE];
+	int n = 0;
+	while ((ptr[n] = vmem_malloc(vmp, ALLOC_SIZE)) != NULL) {
+		memset(ptr[n], 0xc5, ALLOC_SIZE);
+		++n;
+	}
+
+	ASSERTeq(errno, ENOMEM);
+	ASSERTne(n, 0);
+	ASSERT(n < POOL_SIZE / ALLOC_SIZE - 1);
+
+	/* the space of the freed chunks can be taken again */
+	for (int i = 0; i < n; ++i)
+		vmem_free(vmp, ptr[i]);
+
+	for (int i = 0; i < n; ++i) {
+		ptr[i] = vmem_malloc(vmp, ALLOC_SIZE);
+		ASSERTne(ptr[i], NULL);
+		memset(ptr[i], 0xc5, ALLOC_SIZE);
+	}
+
+	for (int i = 0; i < n; ++i)
+		vmem_free(vmp, ptr[i]);
+
+	vmem_delete(vmp);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmem_sparse");
+
+	if (argc != 3)
+		FATAL("usage: %s op directory", argv[0]);
+
+	switch (argv[1][0]) {
+	case 'g':
+		grow_check(argv[2]);
+		break;
+	case 'f':
+		full_check(argv[2]);
+		break;
+	default:
+		FATAL("unknown operation %s", argv[1]);
+	}
+
+	DONE(NULL);
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * vmem_stats_get.c -- unit test for vmem_stats_get
+ *
+ * usage: vmem_stats_get directory
+ */
+
+#include "unittest.h"
+
+#define	TEST_SMALL_SIZE	(64)
+#define	TEST_LARGE_SIZE	(1024 * 1024)
+#define	TEST_NOBJS	(1000)
+#define	TEST_NTHREADS	(4)
+#define	TEST_NSAMPLES	(100)
+
+static VMEM *Vmp;
+static int Done;
+
+/*
+ * find_class -- return the size class holding objects of the given size
+ */
+static struct vmem_class_stats *
+find_class(struct vmem_stats *stats, size_t size)
+{
+	for (unsigned i = 0; i < stats->nclasses; ++i)
+		if (stats->classes[i].size >= size)
+			return &stats->classes[i];
+
+	FATAL("no size class for %zu bytes", size);
+	return NULL;
+}
+
+/*
+ * stats_get -- read the statistics, which must never fail
+ */
+static void
+stats_get(VMEM *vmp, struct vmem_stats *stats, int flags)
+{
+	int ret = vmem_stats_get(vmp, stats, flags);
+	ASSERTeq(ret, 0);
+}
+
+/*
+ * test_counters -- check the counters follow allocations and frees
+ */
+static void
+test_counters(VMEM *vmp)
+{
+	struct vmem_stats before, stats, sample;
+	void *ptrs[TEST_NOBJS];
+
+	stats_get(vmp, &before, 0);
+	ASSERT(before.nclasses > 0);
+	ASSERT(before.nclasses <= VMEM_STATS_NCLASSES);
+	for (unsigned i = 1; i < before.nclasses; ++i)
+		ASSERT(before.classes[i].size > before.classes[i - 1].size);
+
+	for (int i = 0; i < TEST_NOBJS; ++i) {
+		ptrs[i] = vmem_malloc(vmp, TEST_SMALL_SIZE);
+		ASSERTne(ptrs[i], NULL);
+	}
+
+	stats_get(vmp, &stats, 0);
+	ASSERT(stats.allocated >= before.allocated +
+			TEST_NOBJS * TEST_SMALL_SIZE);
+	ASSERT(stats.nmalloc >= before.nmalloc + TEST_NOBJS);
+	ASSERT(stats.active >= stats.allocated);
+	ASSERT(stats.mapped >= stats.active);
+
+	struct vmem_class_stats *c = find_class(&stats, TEST_SMALL_SIZE);
+	ASSERTeq(c->size, TEST_SMALL_SIZE);
+	ASSERT(c->curobjs >= TEST_NOBJS);
+
+	/* nothing changed, the sampled totals are the same */
+	stats_get(vmp, &sample, VMEM_STATS_SAMPLE);
+	ASSERTeq(sample.nclasses, 0);
+	ASSERTeq(sample.allocated, stats.allocated);
+	ASSERTeq(sample.active, stats.active);
+	ASSERTeq(sample.mapped, stats.mapped);
+	ASSERTeq(sample.nmalloc, stats.nmalloc);
+
+	/* large objects are not cached by threads, they show up at once */
+	void *large = vmem_malloc(vmp, TEST_LARGE_SIZE);
+	ASSERTne(large, NULL);
+	stats_get(vmp, &sample, VMEM_STATS_SAMPLE);
+	ASSERTeq(sample.allocated, stats.allocated + TEST_LARGE_SIZE);
+
+	vmem_free(vmp, large);
+	stats_get(vmp, &sample, VMEM_STATS_SAMPLE);
+	ASSERTeq(sample.allocated, stats.allocated);
+	ASSERTeq(sample.ndalloc, stats.ndalloc + 1);
+
+	for (int i = 0; i < TEST_NOBJS; ++i)
+		vmem_free(vmp, ptrs[i]);
+}
+
+/*
+ * worker -- allocate and free objects of various sizes until told to stop
+ */
+static void *
+worker(void *arg)
+{
+	void *ptrs[TEST_NOBJS];
+
+	while (!__atomic_load_n(&Done, __ATOMIC_ACQUIRE)) {
+		for (int i = 0; i < TEST_NOBJS; ++i)
+			ptrs[i] = vmem_malloc(Vmp, 16 << (i % 10));
+		for (int i = 0; i < TEST_NOBJS; ++i)
+			vmem_free(Vmp, ptrs[i]);
+	}
+
+	return NULL;
+}
+
+/*
+ * test_sample_mt -- sample the pool while other threads use it
+ */
+static void
+test_sample_mt(VMEM *vmp)
+{
+	pthread_t threads[TEST_NTHREADS];
+	struct vmem_stats prev, stats;
+
+	Vmp = vmp;
+	Done = 0;
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_CREATE(&threads[i], NULL, worker, NULL);
+
+	stats_get(vmp, &prev, VMEM_STATS_SAMPLE);
+	for (int i = 0; i < TEST_NSAMPLES; ++i) {
+		stats_get(vmp, &stats, i % 2 ? VMEM_STATS_SAMPLE : 0);
+
+		/* counters of events never go back */
+		ASSERT(stats.nmalloc >= prev.nmalloc);
+		ASSERT(stats.ndalloc >= prev.ndalloc);
+		ASSERT(stats.nlock_contended >= prev.nlock_contended);
+		prev = stats;
+		usleep(1000);
+	}
+
+	__atomic_store_n(&Done, 1, __ATOMIC_RELEASE);
+	for (int i = 0; i < TEST_NTHREADS; ++i)
+		PTHREAD_JOIN(threads[i], NULL);
+
+	stats_get(vmp, &stats, 0);
+	ASSERT(stats.nmalloc >= TEST_NOBJS);
+	ASSERT(stats.ndalloc <= stats.nmalloc);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmem_stats_get");
+
+	if (argc != 2)
+		FATAL("usage: %s directory", argv[0]);
+
+	const char *dir = argv[1];
+	VMEM *vmp;
+
+	vmp = vmem_create(dir, VMEM_MIN_POOL);
+	if (vmp == NULL)
+		FATAL("!vmem_create");
+	test_counters(vmp);
+	vmem_delete(vmp);
+
+	vmp = vmem_create(dir, VMEM_MIN_POOL * 4);
+	if (vmp == NULL)
+		FATAL("!vmem_create");
+	test_sample_mt(vmp);
+
+	struct vmem_stats stats;
+	ASSERTeq(vmem_stats_get(vmp, &stats, ~VMEM_STATS_SAMPLE), -1);
+	ASSERTeq(errno, EINVAL);
+	vmem_delete(vmp);
+
+	DONE(NULL);
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2014-2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * vmmalloc_tiering.c -- unit test for libvmmalloc DRAM/pmem tiering
+ *
+ * usage: vmmalloc_tiering s|h
+ *
+ * s - check routing of allocations by size (VMMALLOC_DRAM_MAX_SIZE=1024)
+ * h - check routing by call site hotness (VMMALLOC_DRAM_HOT_SAMPLE=1)
+ */
+
+#include <malloc.h>
+#include "unittest.h"
+
+#define	SMALL 64
+#define	LARGE 4096
+#define	NALLOCS 64
+
+static uintptr_t Pool_start;
+static uintptr_t Pool_end;
+
+/*
+ * find_pool -- find the mapping of the pool file
+ */
+static void
+find_pool(void)
+{
+	FILE *fp = fopen("/proc/self/maps", "r");
+	ASSERTne(fp, NULL);
+
+	char line[4096];
+	while (fgets(line, sizeof (line), fp) != NULL) {
+		if (strstr(line, "/vmem.") == NULL)
+			continue;
+
+		/* the pool header page is mapped with different protection */
+		unsigned long start, end;
+		ASSERTeq(sscanf(line, "%lx-%lx", &start, &end), 2);
+		if (Pool_start == 0 || start < Pool_start)
+			Pool_start = start;
+		if (end > Pool_end)
+			Pool_end = end;
+	}
+
+	fclose(fp);
+	ASSERTne(Pool_start, 0);
+}
+
+/*
+ * in_pool -- check if the block resides in the pool
+ */
+static int
+in_pool(void *ptr)
+{
+	return (uintptr_t)ptr >= Pool_start && (uintptr_t)ptr < Pool_end;
+}
+
+/*
+ * test_size -- check routing of allocations by size
+ */
+static void
+test_size(void)
+{
+	char *small = malloc(SMALL);
+	ASSERTne(small, NULL);
+	ASSERT(!in_pool(small));
+	ASSERT(malloc_usable_size(small) >= SMALL);
+	memset(small, 0xAB, SMALL);
+
+	char *large = malloc(LARGE);
+	ASSERTne(large, NULL);
+	ASSERT(in_pool(large));
+	ASSERT(malloc_usable_size(large) >= LARGE);
+
+	int *zeroed = calloc(SMALL, sizeof (int));
+	ASSERTne(zeroed, NULL);
+	ASSERT(!in_pool(zeroed));
+	for (int i = 0; i < SMALL; i++)
+		ASSERTeq(zeroed[i], 0);
+
+	void *aligned;
+	ASSERTeq(posix_memalign(&aligned, 256, SMALL), 0);
+	ASSERT(!in_pool(aligned));
+	ASSERTeq((uintptr_t)aligned % 256, 0);
+
+	/* growing block moves to the pool */
+	small = realloc(small, LARGE);
+	ASSERTne(small, NULL);
+	ASSERT(in_pool(small));
+	for (int i = 0; i < SMALL; i++)
+		ASSERTeq(small[i], (char)0xAB);
+
+	/* shrinking block moves to DRAM */
+	memset(large, 0xCD, LARGE);
+	large = realloc(large, SMALL);
+	ASSERTne(large, NULL);
+	ASSERT(!in_pool(large));
+	for (int i = 0; i < SMALL; i++)
+		ASSERTeq(large[i], (char)0xCD);
+
+	free(small);
+	free(large);
+	free(zeroed);
+	free(aligned);
+}
+
+/*
+ * test_hot -- check routing of allocations by call site hotness
+ */
+static void
+test_hot(void)
+{
+	void *ptrs[NALLOCS];
+
+	for (int i = 0; i < NALLOCS; i++) {
+		ptrs[i] = malloc(LARGE);
+		ASSERTne(ptrs[i], NULL);
+	}
+
+	/* the site becomes hot after it was sampled enough times */
+	ASSERT(in_pool(ptrs[0]));
+	ASSERT(!in_pool(ptrs[NALLOCS - 1]));
+
+	for (int i = 0; i < NALLOCS; i++)
+		free(ptrs[i]);
+
+	/* large allocations are never routed by hotness */
+	for (int i = 0; i < NALLOCS; i++) {
+		ptrs[i] = malloc(128 * 1024);
+		ASSERTne(ptrs[i], NULL);
+		ASSERT(in_pool(ptrs[i]));
+	}
+
+	for (int i = 0; i < NALLOCS; i++)
+		free(ptrs[i]);
+}
+
+int
+main(int argc, char *argv[])
+{
+	START(argc, argv, "vmmalloc_tiering");
+
+	if (argc != 2)
+		FATAL("usage: %s s|h", argv[0]);
+
+	find_pool();
+
+	switch (argv[1][0]) {
+	case 's':
+		test_size();
+		break;
+	case 'h':
+		test_hot();
+		break;
+	default:
+		FATAL("unknown test %s", argv[1]);
+	}
+
+	DONE(NULL);
+}
@@ -34,6 +34,7 @@
  * check.c -- pmempool check command source file
  */
 #include <stdio.h>
+#include <stdarg.h>
 #include <getopt.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -48,6 +49,8 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <err.h>
+#include <pthread.h>
+#include <limits.h>
 #define	__USE_UNIX98
 #include <unistd.h>
 #include "common.h"
@@ -88,6 +91,9 @@ struct pmempool_check {
 		struct pmemlog log;
 		struct pmemblk blk;
 	} hdr;			/* headers */
+	struct pmemobjpool *pop; /* memory mapped pmemobj pool */
+	size_t size;		/* size of memory mapped pool */
+	unsigned nthreads;	/* number of threads for pmemobj check */
 	enum {
 		UUID_NOP = 0,	/* nothing changed */
 		UUID_FROM_BTT,	/* UUID restored from valid BTT Info header */
@@ -313,6 +319,9 @@ const struct pmempool_check pmempool_check_default = {
 	.backup_fname	= NULL,
 	.exec		= true,
 	.ptype		= PMEM_POOL_TYPE_UNKNOWN,
+	.pop		= NULL,
+	.size		= 0,
+	.nthreads	= 0,
 	.narenas	= 0,
 	.ans		= '?',
 };
@@ -332,6 +341,9 @@ static const char *help_str =
 "  -v, --verbose        increase verbosity level\n"
 "  -h, --help           display this help and exit\n"
 "\n"
+"Options for PMEMOBJ:\n"
+"  -j, --jobs <num>     number of threads used for checking the pool\n"
+"\n"
 "For complete documentation see %s-check(1) manual page.\n"
 ;
 
@@ -346,6 +358,7 @@ static const struct option long_options[] = {
 	{"quiet",	no_argument,		0,	'q'},
 	{"verbose",	no_argument,		0,	'v'},
 	{"help",	no_argument,		0,	'h'},
+	{"jobs",	required_argument,	0,	'j'},
 	{0,		0,			0,	 0 },
 };
 
@@ -386,7 +399,9 @@ pmempool_check_parse_args(struct pmempool_check *pcp, char *appname,
 		int argc, char *argv[])
 {
 	int opt;
-	while ((opt = getopt_long(argc, argv, "hvrNb:qy",
+	long long nthreads;
+	char *endptr;
+	while ((opt = getopt_long(argc, argv, "hvrNb:qyj:",
 			long_options, NULL)) != -1) {
 		switch (opt) {
 		case 'r':
@@ -411,6 +426,16 @@ pmempool_check_parse_args(struct pmempool_check *pcp, char *appname,
 		case 'h':
 			pmempool_check_help(appname);
 			exit(EXIT_SUCCESS);
+		case 'j':
+			nthreads = strtoll(optarg, &endptr, 10);
+			if (*endptr != '\0' || nthreads <= 0 ||
+					nthreads > UINT_MAX) {
+				out_err("invalid number of threads -- '%s'\n",
+						optarg);
+				exit(EXIT_FAILURE);
+			}
+			pcp->nthreads = (unsigned)nthreads;
+			break;
 		default:
 			print_usage(appname);
 			exit(EXIT_FAILURE);
@@ -434,6 +459,11 @@ pmempool_check_parse_args(struct pmempool_check *pcp, char *appname,
 		exit(EXIT_FAILURE);
 	}
 
+	if (pcp->nthreads == 0) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		pcp->nthreads = ncpus > 0 ? (unsigned)ncpus : 1;
+	}
+
 	return 0;
 }
 
@@ -645,6 +675,11 @@ pmempool_check_pool_hdr(struct pmempool_check *pcp)
 		default_hdr.compat_features = BLK_FORMAT_COMPAT;
 		default_hdr.incompat_features = BLK_FORMAT_INCOMPAT;
 		default_hdr.ro_compat_features = BLK_FORMAT_RO_COMPAT;
+	} else if (pcp->ptype == PMEM_POOL_TYPE_OBJ) {
+		default_hdr.major = OBJ_FORMAT_MAJOR;
+		default_hdr.compat_features = OBJ_FORMAT_COMPAT;
+		default_hdr.incompat_features = OBJ_FORMAT_INCOMPAT;
+		default_hdr.ro_compat_features = OBJ_FORMAT_RO_COMPAT;
 	} else {
 		out_err("Unsupported pool type '%s'",
 				out_get_pool_type_str(pcp->ptype));
@@ -1797,6 +1832,946 @@ pmempool_check_write_blk(struct pmempool_check *pcp)
 
 	return 0;
 }
+/*
+ * check_obj_item -- result of checking single pmemobj structure
+ */
+struct check_obj_item {
+	unsigned nerrors;	/* number of errors found */
+	bool repairable;	/* all errors found may be repaired */
+	char *msg;		/* error messages */
+	size_t msglen;		/* length of error messages */
+};
+
+/*
+ * check_obj_ctx -- context shared by pmemobj check threads
+ */
+struct check_obj_ctx {
+	struct pmempool_check *pcp;	/* pmempool check context */
+	struct pmemobjpool *pop;	/* memory mapped pool */
+	uint64_t uuid_lo;		/* pool's uuid_lo */
+	int max_zone;			/* number of zones */
+	uint64_t nitems;		/* number of items to check */
+	uint64_t next;			/* next item to check */
+	struct check_obj_item *items;	/* results of checked items */
+	void (*func)(struct check_obj_ctx *ctx, uint64_t i,
+			struct check_obj_item *itemp); /* check function */
+};
+
+/*
+ * check_obj_err -- append error message to the item's report
+ */
+static void
+check_obj_err(struct check_obj_item *itemp, const char *fmt, ...)
+{
+	char buff[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	int len = vsnprintf(buff, sizeof (buff), fmt, ap);
+	va_end(ap);
+
+	itemp->nerrors++;
+
+	if (len < 0)
+		return;
+	if ((size_t)len >= sizeof (buff))
+		len = sizeof (buff) - 1;
+
+	char *msg = realloc(itemp->msg, itemp->msglen + len + 2);
+	if (msg == NULL)
+		return;
+
+	memcpy(msg + itemp->msglen, buff, len);
+	itemp->msglen += len;
+	msg[itemp->msglen++] = '\n';
+	msg[itemp->msglen] = '\0';
+	itemp->msg = msg;
+}
+
+/*
+ * check_obj_worker -- check items until there is nothing left to check
+ */
+static void *
+check_obj_worker(void *arg)
+{
+	struct check_obj_ctx *ctx = arg;
+	uint64_t i;
+
+	while ((i = __sync_fetch_and_add(&ctx->next, 1)) < ctx->nitems)
+		ctx->func(ctx, i, &ctx->items[i]);
+
+	return NULL;
+}
+
+/*
+ * check_obj_run -- check all items using worker threads
+ *
+ * The results are stored in ctx->items, the messages are not printed
+ * by worker threads so the report does not depend on the order in which
+ * the items have been checked.
+ */
+static int
+check_obj_run(struct check_obj_ctx *ctx, uint64_t nitems,
+		void (*func)(struct check_obj_ctx *ctx, uint64_t i,
+			struct check_obj_item *itemp))
+{
+	ctx->nitems = nitems;
+	ctx->next = 0;
+	ctx->func = func;
+	ctx->items = calloc(nitems ? nitems : 1, sizeof (*ctx->items));
+	if (ctx->items == NULL) {
+		out_err("cannot allocate memory for check results\n");
+		return -1;
+	}
+
+	unsigned nthreads = ctx->pcp->nthreads;
+	if (nthreads > nitems)
+		nthreads = nitems;
+
+	pthread_t *threads = NULL;
+	unsigned started = 0;
+	if (nthreads > 1 &&
+		(threads = malloc(nthreads * sizeof (*threads))) != NULL) {
+		for (; started < nthreads; started++) {
+			if (pthread_create(&threads[started], NULL,
+					check_obj_worker, ctx))
+				break;
+		}
+	}
+
+	/* check the rest of items if no thread could be started */
+	if (started == 0)
+		check_obj_worker(ctx);
+
+	for (unsigned i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+
+	return 0;
+}
+
+/*
+ * check_obj_report -- print messages of all items and free the results
+ *
+ * Returns total number of errors, the *repairablep is set if all the
+ * errors may be repaired.
+ */
+static uint64_t
+check_obj_report(struct check_obj_ctx *ctx, bool *repairablep)
+{
+	uint64_t nerrors = 0;
+	bool repairable = true;
+
+	for (uint64_t i = 0; i < ctx->nitems; i++) {
+		struct check_obj_item *itemp = &ctx->items[i];
+		if (itemp->nerrors == 0)
+			continue;
+
+		nerrors += itemp->nerrors;
+		if (!itemp->repairable)
+			repairable = false;
+
+		if (itemp->msg)
+			outv(1, "%s", itemp->msg);
+	}
+
+	if (repairablep)
+		*repairablep = repairable;
+
+	return nerrors;
+}
+
+/*
+ * check_obj_free -- free results of checked items
+ */
+static void
+check_obj_free(struct check_obj_ctx *ctx)
+{
+	for (uint64_t i = 0; i < ctx->nitems; i++)
+		free(ctx->items[i].msg);
+
+	free(ctx->items);
+	ctx->items = NULL;
+	ctx->nitems = 0;
+}
+
+/*
+ * check_obj_ctx_init -- initialize context of pmemobj check threads
+ */
+static void
+check_obj_ctx_init(struct pmempool_check *pcp, struct check_obj_ctx *ctx)
+{
+	struct pmemobjpool *pop = pcp->pop;
+
+	memset(ctx, 0, sizeof (*ctx));
+	ctx->pcp = pcp;
+	ctx->pop = pop;
+	ctx->max_zone = util_heap_max_zone(pop->heap_size);
+
+	for (int i = 0; i < 8; i++) {
+		ctx->uuid_lo = (ctx->uuid_lo << 8) |
+			(pop->hdr.poolset_uuid[i] ^
+				pop->hdr.poolset_uuid[8 + i]);
+	}
+}
+
+/*
+ * check_obj_off_is_object -- check if offset may point to an object
+ */
+static int
+check_obj_off_is_object(struct pmemobjpool *pop, uint64_t off)
+{
+	uint64_t min = pop->heap_offset + sizeof (struct heap_header) +
+		sizeof (struct allocation_header) + OBJ_OOB_SIZE;
+
+	return off >= min && off < pop->heap_offset + pop->heap_size;
+}
+
+/*
+ * check_obj_list -- check linkage of persistent list
+ *
+ * The obj_cb is called for each element of the list. Returns number of
+ * elements on the list or -1 if the list is broken.
+ */
+static int64_t
+check_obj_list(struct check_obj_ctx *ctx, struct check_obj_item *itemp,
+		const char *name, struct list_head *headp,
+		void (*obj_cb)(struct check_obj_ctx *ctx,
+			struct check_obj_item *itemp, const char *name,
+			uint64_t off))
+{
+	struct pmemobjpool *pop = ctx->pop;
+	uint64_t first = headp->pe_first.off;
+	if (first == 0)
+		return 0;
+
+	/* each object occupies at least one block of the smallest size */
+	uint64_t max = pop->heap_size / MIN_RUN_SIZE;
+	uint64_t off = first;
+	int64_t n = 0;
+
+	if (!check_obj_off_is_object(pop, first)) {
+		check_obj_err(itemp, "%s: invalid offset of first element "
+				"0x%jx", name, first);
+		return -1;
+	}
+
+	do {
+		struct list_entry *entryp = PLIST_OFF_TO_PTR(pop, off);
+
+		if (entryp->pe_next.pool_uuid_lo != ctx->uuid_lo) {
+			check_obj_err(itemp, "%s: element 0x%jx: invalid "
+					"pe_next.pool_uuid_lo 0x%jx", name, off,
+					entryp->pe_next.pool_uuid_lo);
+			return -1;
+		}
+
+		uint64_t next = entryp->pe_next.off;
+		if (!check_obj_off_is_object(pop, next)) {
+			check_obj_err(itemp, "%s: element 0x%jx: invalid "
+					"pe_next.off 0x%jx", name, off, next);
+			return -1;
+		}
+
+		struct list_entry *nextp = PLIST_OFF_TO_PTR(pop, next);
+		if (nextp->pe_prev.off != off) {
+			check_obj_err(itemp, "%s: element 0x%jx: invalid "
+					"pe_prev.off 0x%jx", name, next,
+					nextp->pe_prev.off);
+			return -1;
+		}
+
+		if (obj_cb)
+			obj_cb(ctx, itemp, name, off);
+
+		off = next;
+		if ((uint64_t)++n > max) {
+			check_obj_err(itemp, "%s: loop detected", name);
+			return -1;
+		}
+	} while (off != first);
+
+	return n;
+}
+
+/*
+ * check_obj_redo_off -- check if redo log entry's offset is valid
+ */
+static int
+check_obj_redo_off(struct pmemobjpool *pop, uint64_t off)
+{
+	return OBJ_OFF_FROM_LANES(pop, off) ||
+		OBJ_OFF_FROM_OBJ_STORE(pop, off) ||
+		OBJ_OFF_FROM_HEAP(pop, off);
+}
+
+/*
+ * check_obj_redo -- check consistency of redo log
+ */
+static int
+check_obj_redo(struct pmemobjpool *pop, struct redo_log *redo,
+		size_t nentries)
+{
+	size_t nflags = 0;
+	size_t last = 0;
+
+	for (size_t i = 0; i < nentries; i++) {
+		if (redo[i].offset & REDO_FINISH_FLAG) {
+			nflags++;
+			last = i;
+		}
+	}
+
+	if (nflags == 0)
+		return 0;
+
+	if (nflags > 1)
+		return -1;
+
+	for (size_t i = 0; i <= last; i++) {
+		if (!check_obj_redo_off(pop, redo[i].offset & REDO_FLAG_MASK))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * check_obj_tx_undo_alloc -- check object from transaction's undo_alloc log
+ */
+static void
+check_obj_tx_undo_alloc(struct check_obj_ctx *ctx,
+		struct check_obj_item *itemp, const char *name, uint64_t off)
+{
+	struct oob_header *oob = OOB_HEADER_FROM_OID(ctx->pop,
+			(PMEMoid) {.off = off});
+
+	if (oob->internal_type != TYPE_NONE ||
+			oob->user_type >= PMEMOBJ_NUM_OID_TYPES)
+		check_obj_err(itemp, "%s: object 0x%jx: invalid type",
+				name, off);
+}
+
+/*
+ * check_obj_tx_undo_free -- check object from transaction's undo_free log
+ */
+static void
+check_obj_tx_undo_free(struct check_obj_ctx *ctx,
+		struct check_obj_item *itemp, const char *name, uint64_t off)
+{
+	struct oob_header *oob = OOB_HEADER_FROM_OID(ctx->pop,
+			(PMEMoid) {.off = off});
+
+	if (oob->internal_type != TYPE_ALLOCATED ||
+			oob->user_type >= PMEMOBJ_NUM_OID_TYPES)
+		check_obj_err(itemp, "%s: object 0x%jx: invalid type",
+				name, off);
+}
+
+/*
+ * check_obj_tx_undo_set -- check range from transaction's undo_set log
+ */
+static void
+check_obj_tx_undo_set(struct check_obj_ctx *ctx,
+		struct check_obj_item *itemp, const char *name, uint64_t off)
+{
+	struct pmemobjpool *pop = ctx->pop;
+	struct tx_range *range = OBJ_OFF_TO_PTR(pop, off);
+
+	if (!OBJ_OFF_FROM_HEAP(pop, range->offset) ||
+		!OBJ_OFF_FROM_HEAP(pop, range->offset + range->size))
+		check_obj_err(itemp, "%s: range 0x%jx: invalid offset 0x%jx "
+				"or size 0x%jx", name, off, range->offset,
+				range->size);
+}
+
+/*
+ * check_obj_lane -- check all sections of a single lane
+ */
+static void
+check_obj_lane(struct check_obj_ctx *ctx, uint64_t i,
+		struct check_obj_item *itemp)
+{
+	struct pmemobjpool *pop = ctx->pop;
+	struct lane_layout *lane = OBJ_OFF_TO_PTR(pop, pop->lanes_offset +
+			i * sizeof (struct lane_layout));
+	char name[64];
+
+	struct allocator_lane_section *alloc = (struct allocator_lane_section *)
+		&lane->sections[LANE_SECTION_ALLOCATOR];
+	struct lane_list_section *list = (struct lane_list_section *)
+		&lane->sections[LANE_SECTION_LIST];
+	struct lane_tx_layout *tx = (struct lane_tx_layout *)
+		&lane->sections[LANE_SECTION_TRANSACTION];
+
+	/* only redo logs and list section may be repaired */
+	itemp->repairable = true;
+
+	if (check_obj_redo(pop, alloc->redo, REDO_LOG_SIZE))
+		check_obj_err(itemp, "lane %ju: allocator: invalid redo log",
+				i);
+
+	if (check_obj_redo(pop, list->redo, REDO_NUM_ENTRIES))
+		check_obj_err(itemp, "lane %ju: list: invalid redo log", i);
+
+	if (list->obj_offset && !OBJ_OFF_FROM_HEAP(pop, list->obj_offset))
+		check_obj_err(itemp, "lane %ju: list: invalid object offset "
+				"0x%jx", i, list->obj_offset);
+
+	unsigned nerrors = itemp->nerrors;
+
+	if (tx->state != TX_STATE_NONE && tx->state != TX_STATE_COMMITTED)
+		check_obj_err(itemp, "lane %ju: tx: invalid state 0x%jx",
+				i, tx->state);
+
+	snprintf(name, sizeof (name), "lane %ju: tx: undo_alloc", i);
+	check_obj_list(ctx, itemp, name, &tx->undo_alloc,
+			check_obj_tx_undo_alloc);
+
+	snprintf(name, sizeof (name), "lane %ju: tx: undo_free", i);
+	check_obj_list(ctx, itemp, name, &tx->undo_free,
+			check_obj_tx_undo_free);
+
+	snprintf(name, sizeof (name), "lane %ju: tx: undo_set", i);
+	check_obj_list(ctx, itemp, name, &tx->undo_set,
+			check_obj_tx_undo_set);
+
+	if (itemp->nerrors != nerrors)
+		itemp->repairable = false;
+}
+
+/*
+ * check_obj_lane_repair -- clear invalid redo logs and list section of lane
+ */
+static void
+check_obj_lane_repair(struct pmempool_check *pcp, uint64_t i)
+{
+	struct pmemobjpool *pop = pcp->pop;
+	struct lane_layout *lane = OBJ_OFF_TO_PTR(pop, pop->lanes_offset +
+			i * sizeof (struct lane_layout));
+
+	struct allocator_lane_section *alloc = (struct allocator_lane_section *)
+		&lane->sections[LANE_SECTION_ALLOCATOR];
+	struct lane_list_section *list = (struct lane_list_section *)
+		&lane->sections[LANE_SECTION_LIST];
+
+	if (check_obj_redo(pop, alloc->redo, REDO_LOG_SIZE)) {
+		outv(1, "lane %ju: clearing allocator redo log\n", i);
+		memset(alloc->redo, 0, sizeof (alloc->redo));
+	}
+
+	if (check_obj_redo(pop, list->redo, REDO_NUM_ENTRIES) ||
+		(list->obj_offset &&
+		!OBJ_OFF_FROM_HEAP(pop, list->obj_offset))) {
+		outv(1, "lane %ju: clearing list section\n", i);
+		memset(list, 0, sizeof (*list));
+	}
+}
+
+/*
+ * check_obj_zone_size_idx -- calculate expected size of zone in chunks
+ */
+static uint32_t
+check_obj_zone_size_idx(uint32_t zone_id, int max_zone, size_t heap_size)
+{
+	if (zone_id < max_zone - 1)
+		return MAX_CHUNK - 1;
+
+	size_t zone_raw_size = heap_size - zone_id * ZONE_MAX_SIZE;
+
+	zone_raw_size -= sizeof (struct zone_header) +
+		(sizeof (struct chunk_header) * MAX_CHUNK);
+
+	return zone_raw_size / CHUNKSIZE;
+}
+
+/*
+ * check_obj_block_size -- check if block size of run is a valid class size
+ */
+static int
+check_obj_block_size(uint64_t block_size)
+{
+	uint64_t size = MIN_RUN_SIZE;
+
+	for (int i = 0; i < DEFAULT_BUCKET; i++) {
+		if (block_size == size)
+			return 1;
+		size *= RUN_UNIT_MAX;
+	}
+
+	return 0;
+}
+
+/*
+ * check_obj_chunk_run -- check chunk run's block size and bitmap
+ */
+static void
+check_obj_chunk_run(struct check_obj_item *itemp, uint64_t zone_id,
+		uint32_t chunk_id, struct chunk_run *run)
+{
+	if (!check_obj_block_size(run->block_size)) {
+		check_obj_err(itemp, "zone %ju: chunk %u: invalid run block "
+				"size %ju", zone_id, chunk_id, run->block_size);
+		return;
+	}
+
+	/* bits which are not available for allocations must be set */
+	uint32_t nallocs = RUNSIZE / run->block_size;
+	uint32_t unused_bits = RUN_BITMAP_SIZE - nallocs;
+	uint32_t unused_values = unused_bits / BITS_PER_VALUE;
+	uint32_t nval = MAX_BITMAP_VALUES - unused_values;
+	unused_bits -= unused_values * BITS_PER_VALUE;
+	uint64_t lastval = ((1L << unused_bits) - 1L) <<
+		(BITS_PER_VALUE - unused_bits);
+
+	int valid = (run->bitmap[nval - 1] & lastval) == lastval;
+	for (uint32_t v = nval; v < MAX_BITMAP_VALUES; v++) {
+		if (run->bitmap[v] != UINT64_MAX)
+			valid = 0;
+	}
+
+	if (!valid)
+		check_obj_err(itemp, "zone %ju: chunk %u: invalid run bitmap",
+				zone_id, chunk_id);
+}
+
+/*
+ * check_obj_zone -- check zone header, chunk headers and runs
+ */
+static void
+check_obj_zone(struct check_obj_ctx *ctx, uint64_t i,
+		struct check_obj_item *itemp)
+{
+	struct pmemobjpool *pop = ctx->pop;
+	struct heap_layout *layout = OBJ_OFF_TO_PTR(pop, pop->heap_offset);
+	struct zone *zone = &layout->zones[i];
+
+	if (zone->header.magic == 0)
+		return; /* not initialized, and that is OK */
+
+	if (zone->header.magic != ZONE_HEADER_MAGIC) {
+		check_obj_err(itemp, "zone %ju: invalid magic 0x%x", i,
+				zone->header.magic);
+		return;
+	}
+
+	uint32_t size_idx = check_obj_zone_size_idx(i, ctx->max_zone,
+			pop->heap_size);
+	if (zone->header.size_idx != size_idx) {
+		check_obj_err(itemp, "zone %ju: invalid size_idx %u",
+				i, zone->header.size_idx);
+		return;
+	}
+
+	uint32_t c;
+	for (c = 0; c < size_idx; ) {
+		struct chunk_header *hdr = &zone->chunk_headers[c];
+
+		if (hdr->type == CHUNK_TYPE_UNKNOWN ||
+				hdr->type == CHUNK_TYPE_FOOTER ||
+				hdr->type >= MAX_CHUNK_TYPE) {
+			check_obj_err(itemp, "zone %ju: chunk %u: invalid "
+					"type %s", i, c,
+					out_get_chunk_type_str(hdr->type));
+			return;
+		}
+
+		if (hdr->flags & CHUNK_FLAG_ZEROED)
+			check_obj_err(itemp, "zone %ju: chunk %u: invalid "
+					"flags 0x%x", i, c, hdr->flags);
+
+		if (hdr->size_idx == 0 || hdr->size_idx > size_idx - c) {
+			check_obj_err(itemp, "zone %ju: chunk %u: invalid "
+					"size_idx %u", i, c, hdr->size_idx);
+			return;
+		}
+
+		if (hdr->type == CHUNK_TYPE_RUN) {
+			if (hdr->size_idx != 1)
+				check_obj_err(itemp, "zone %ju: chunk %u: "
+					"invalid run size_idx %u", i, c,
+					hdr->size_idx);
+			check_obj_chunk_run(itemp, i, c,
+				(struct chunk_run *)&zone->chunks[c]);
+		}
+
+		c += hdr->size_idx;
+	}
+}
+
+/*
+ * check_obj_alloc -- check if object is placed in allocated memory block
+ */
+static void
+check_obj_alloc(struct check_obj_ctx *ctx, struct check_obj_item *itemp,
+		const char *name, uint64_t off)
+{
+	struct pmemobjpool *pop = ctx->pop;
+	struct heap_layout *layout = OBJ_OFF_TO_PTR(pop, pop->heap_offset);
+	struct allocation_header *alloc =
+		ENTRY_TO_ALLOC_HDR(PLIST_OFF_TO_PTR(pop, off));
+
+	if (alloc->zone_id >= ctx->max_zone) {
+		check_obj_err(itemp, "%s: object 0x%jx: invalid zone id %u",
+				name, off, alloc->zone_id);
+		return;
+	}
+
+	struct zone *zone = &layout->zones[alloc->zone_id];
+	if (zone->header.magic != ZONE_HEADER_MAGIC ||
+		alloc->chunk_id >= zone->header.size_idx) {
+		check_obj_err(itemp, "%s: object 0x%jx: invalid chunk id %u",
+				name, off, alloc->chunk_id);
+		return;
+	}
+
+	struct chunk_header *hdr = &zone->chunk_headers[alloc->chunk_id];
+	uintptr_t data = (uintptr_t)&zone->chunks[alloc->chunk_id].data;
+	uintptr_t addr = (uintptr_t)alloc;
+
+	if (hdr->type == CHUNK_TYPE_USED) {
+		if (addr != data || alloc->size >
+				(uint64_t)hdr->size_idx * CHUNKSIZE)
+			check_obj_err(itemp, "%s: object 0x%jx: does not match "
+					"chunk %u", name, off, alloc->chunk_id);
+	} else if (hdr->type == CHUNK_TYPE_RUN) {
+		struct chunk_run *run = (struct chunk_run *)data;
+		uintptr_t run_data = (uintptr_t)&run->data;
+		uint64_t bs = run->block_size;
+
+		if (!check_obj_block_size(bs) || addr < run_data ||
+			(addr - run_data) % bs || alloc->size % bs) {
+			check_obj_err(itemp, "%s: object 0x%jx: does not match "
+					"run in chunk %u", name, off,
+					alloc->chunk_id);
+			return;
+		}
+
+		uint64_t block_off = (addr - run_data) / bs;
+		uint64_t units = alloc->size / bs;
+		if (units == 0 || units > RUN_UNIT_MAX ||
+			block_off + units > RUNSIZE / bs ||
+			block_off % BITS_PER_VALUE + units > BITS_PER_VALUE) {
+			check_obj_err(itemp, "%s: object 0x%jx: invalid size "
+					"%ju", name, off, alloc->size);
+			return;
+		}
+
+		uint64_t bmask = ((1L << units) - 1L) <<
+			(block_off % BITS_PER_VALUE);
+		if ((run->bitmap[block_off / BITS_PER_VALUE] & bmask) != bmask)
+			check_obj_err(itemp, "%s: object 0x%jx: blocks not "
+					"marked as used in chunk %u", name,
+					off, alloc->chunk_id);
+	} else {
+		check_obj_err(itemp, "%s: object 0x%jx: placed in %s chunk %u",
+				name, off, out_get_chunk_type_str(hdr->type),
+				alloc->chunk_id);
+	}
+}
+
+/*
+ * check_obj_store_obj -- check object from object store
+ */
+static void
+check_obj_store_obj(struct check_obj_ctx *ctx, struct check_obj_item *itemp,
+		const char *name, uint64_t off)
+{
+	struct oob_header *oob = OOB_HEADER_FROM_OID(ctx->pop,
+			(PMEMoid) {.off = off});
+	uint64_t i = itemp - ctx->items;
+	uint64_t type = i == 0 ? POBJ_ROOT_TYPE_NUM : i - 1;
+
+	if (oob->internal_type != TYPE_ALLOCATED)
+		check_obj_err(itemp, "%s: object 0x%jx: invalid internal type "
+				"%u", name, off, oob->internal_type);
+
+	if (oob->user_type != type)
+		check_obj_err(itemp, "%s: object 0x%jx: invalid user type %u",
+				name, off, oob->user_type);
+
+	check_obj_alloc(ctx, itemp, name, off);
+}
+
+/*
+ * check_obj_store_list -- check list of objects of a single type
+ *
+ * The item 0 is the root object's list.
+ */
+static void
+check_obj_store_list(struct check_obj_ctx *ctx, uint64_t i,
+		struct check_obj_item *itemp)
+{
+	struct object_store *store = OBJ_OFF_TO_PTR(ctx->pop,
+			ctx->pop->obj_store_offset);
+	char name[64];
+	struct list_head *headp;
+
+	if (i == 0) {
+		snprintf(name, sizeof (name), "root object");
+		headp = &store->root.head;
+	} else {
+		snprintf(name, sizeof (name), "type number %ju", i - 1);
+		headp = &store->bytype[i - 1].head;
+	}
+
+	int64_t n = check_obj_list(ctx, itemp, name, headp,
+			check_obj_store_obj);
+	if (i == 0 && n > 1)
+		check_obj_err(itemp, "%s: more than one object", name);
+}
+
+/*
+ * pmempool_check_pmemobj -- check pmemobj pool descriptor
+ */
+static check_result_t
+pmempool_check_pmemobj(struct pmempool_check *pcp)
+{
+	outv(2, "checking pmemobj descriptor\n");
+
+	struct stat buff;
+	if (fstat(pcp->fd, &buff)) {
+		warn("%s", pcp->fname);
+		return CHECK_RESULT_ERROR;
+	}
+
+	/*
+	 * Changes are written directly to the pool file only if repair
+	 * is to be executed, otherwise private mapping is used.
+	 */
+	int flags = pcp->repair && pcp->exec ? MAP_SHARED : MAP_PRIVATE;
+	void *addr = mmap(NULL, buff.st_size, PROT_READ|PROT_WRITE, flags,
+			pcp->fd, 0);
+	if (addr == MAP_FAILED) {
+		warn("%s", pcp->fname);
+		return CHECK_RESULT_ERROR;
+	}
+
+	pcp->pop = addr;
+	pcp->size = buff.st_size;
+
+	struct pmemobjpool *pop = pcp->pop;
+	void *dscp = (void *)((uintptr_t)&pop->hdr +
+			sizeof (struct pool_hdr));
+
+	if (!util_checksum(dscp, OBJ_DSC_P_SIZE, &pop->checksum, 0)) {
+		outv(1, "invalid pmemobj.checksum\n");
+		return pcp->repair ? CHECK_RESULT_CANNOT_REPAIR :
+			CHECK_RESULT_NOT_CONSISTENT;
+	}
+
+	uint64_t lanes_size = pop->nlanes * sizeof (struct lane_layout);
+	uint64_t obj_store_size = (PMEMOBJ_NUM_OID_TYPES + 1) *
+		sizeof (struct object_store_item);
+
+	const char *invalid = NULL;
+	if (pop->lanes_offset != OBJ_LANES_OFFSET)
+		invalid = "lanes_offset";
+	else if (pop->nlanes == 0 || pop->nlanes > OBJ_NLANES)
+		invalid = "nlanes";
+	else if (pop->obj_store_offset != pop->lanes_offset + lanes_size)
+		invalid = "obj_store_offset";
+	else if (pop->obj_store_size != obj_store_size)
+		invalid = "obj_store_size";
+	else if (pop->heap_offset !=
+			pop->obj_store_offset + pop->obj_store_size)
+		invalid = "heap_offset";
+	else if (pop->heap_size < HEAP_MIN_SIZE ||
+			pop->heap_offset + pop->heap_size != pcp->size)
+		invalid = "heap_size";
+	else if (pop->run_id % 2)
+		invalid = "run_id";
+
+	if (invalid) {
+		outv(1, "invalid pmemobj.%s\n", invalid);
+		return pcp->repair ? CHECK_RESULT_CANNOT_REPAIR :
+			CHECK_RESULT_NOT_CONSISTENT;
+	}
+
+	outv(2, "pmemobj descriptor correct\n");
+
+	return CHECK_RESULT_CONSISTENT;
+}
+
+/*
+ * pmempool_check_obj_lanes -- check and repair lanes
+ */
+static check_result_t
+pmempool_check_obj_lanes(struct pmempool_check *pcp)
+{
+	outv(2, "checking lanes\n");
+
+	struct check_obj_ctx ctx;
+	check_obj_ctx_init(pcp, &ctx);
+
+	if (check_obj_run(&ctx, pcp->pop->nlanes, check_obj_lane))
+		return CHECK_RESULT_ERROR;
+
+	bool repairable;
+	uint64_t nerrors = check_obj_report(&ctx, &repairable);
+	check_result_t ret = CHECK_RESULT_CONSISTENT;
+
+	if (nerrors)
+		outv(1, "lanes: %ju error(s) found\n", nerrors);
+
+	if (nerrors == 0) {
+		outv(2, "lanes correct\n");
+	} else if (!pcp->repair) {
+		ret = CHECK_RESULT_NOT_CONSISTENT;
+	} else if (!repairable) {
+		ret = CHECK_RESULT_CANNOT_REPAIR;
+	} else if (ask_Yn(pcp->ans, "Do you want to clear invalid redo "
+			"logs?") == 'y') {
+		for (uint64_t i = 0; i < ctx.nitems; i++) {
+			if (ctx.items[i].nerrors)
+				check_obj_lane_repair(pcp, i);
+		}
+		ret = CHECK_RESULT_REPAIRED;
+	} else {
+		ret = CHECK_RESULT_CANNOT_REPAIR;
+	}
+
+	check_obj_free(&ctx);
+
+	return ret;
+}
+
+/*
+ * pmempool_check_obj_heap -- check heap header, zones and chunks
+ */
+static check_result_t
+pmempool_check_obj_heap(struct pmempool_check *pcp)
+{
+	outv(2, "checking heap\n");
+
+	struct pmemobjpool *pop = pcp->pop;
+	struct heap_header *hdr = OBJ_OFF_TO_PTR(pop, pop->heap_offset);
+
+	const char *invalid = NULL;
+	if (memcmp(hdr->signature, HEAP_SIGNATURE, HEAP_SIGNATURE_LEN))
+		invalid = "signature";
+	else if (!util_checksum(hdr, sizeof (*hdr), &hdr->checksum, 0))
+		invalid = "checksum";
+	else if (hdr->size != pop->heap_size)
+		invalid = "size";
+	else if (hdr->chunksize != CHUNKSIZE)
+		invalid = "chunksize";
+	else if (hdr->chunks_per_zone != MAX_CHUNK)
+		invalid = "chunks_per_zone";
+
+	if (invalid) {
+		outv(1, "invalid heap.%s\n", invalid);
+		return pcp->repair ? CHECK_RESULT_CANNOT_REPAIR :
+			CHECK_RESULT_NOT_CONSISTENT;
+	}
+
+	struct check_obj_ctx ctx;
+	check_obj_ctx_init(pcp, &ctx);
+
+	if (check_obj_run(&ctx, ctx.max_zone, check_obj_zone))
+		return CHECK_RESULT_ERROR;
+
+	uint64_t nerrors = check_obj_report(&ctx, NULL);
+	check_obj_free(&ctx);
+
+	if (nerrors) {
+		outv(1, "heap: %ju error(s) found\n", nerrors);
+		return pcp->repair ? CHECK_RESULT_CANNOT_REPAIR :
+			CHECK_RESULT_NOT_CONSISTENT;
+	}
+
+	outv(2, "heap correct\n");
+
+	return CHECK_RESULT_CONSISTENT;
+}
+
+/*
+ * pmempool_check_obj_store -- check object store lists
+ */
+static check_result_t
+pmempool_check_obj_store(struct pmempool_check *pcp)
+{
+	outv(2, "checking object store\n");
+
+	struct check_obj_ctx ctx;
+	check_obj_ctx_init(pcp, &ctx);
+
+	if (check_obj_run(&ctx, PMEMOBJ_NUM_OID_TYPES + 1,
+			check_obj_store_list))
+		return CHECK_RESULT_ERROR;
+
+	uint64_t nerrors = check_obj_report(&ctx, NULL);
+	check_obj_free(&ctx);
+
+	if (nerrors) {
+		outv(1, "object store: %ju error(s) found\n", nerrors);
+		return pcp->repair ? CHECK_RESULT_CANNOT_REPAIR :
+			CHECK_RESULT_NOT_CONSISTENT;
+	}
+
+	outv(2, "object store correct\n");
+
+	return CHECK_RESULT_CONSISTENT;
+}
+
+/*
+ * pmempool_check_pmemobj_structs -- check lanes, heap and object store
+ *
+ * All the structures are checked even if some of them are not consistent
+ * in order to report as many errors as possible. The object store is
+ * checked only if the heap is consistent because objects are verified
+ * against the heap's metadata.
+ */
+static check_result_t
+pmempool_check_pmemobj_structs(struct pmempool_check *pcp)
+{
+	check_result_t results[3];
+	int n = 0;
+
+	results[n++] = pmempool_check_obj_lanes(pcp);
+	results[n] = pmempool_check_obj_heap(pcp);
+	if (results[n++] == CHECK_RESULT_CONSISTENT)
+		results[n++] = pmempool_check_obj_store(pcp);
+
+	check_result_t ret = CHECK_RESULT_CONSISTENT;
+	for (int i = 0; i < n; i++) {
+		if (results[i] == CHECK_RESULT_ERROR)
+			return CHECK_RESULT_ERROR;
+		if (results[i] == CHECK_RESULT_CANNOT_REPAIR)
+			ret = CHECK_RESULT_CANNOT_REPAIR;
+		else if (results[i] == CHECK_RESULT_NOT_CONSISTENT &&
+				ret != CHECK_RESULT_CANNOT_REPAIR)
+			ret = CHECK_RESULT_NOT_CONSISTENT;
+		else if (results[i] == CHECK_RESULT_REPAIRED &&
+				ret == CHECK_RESULT_CONSISTENT)
+			ret = CHECK_RESULT_REPAIRED;
+	}
+
+	return ret;
+}
+
+/*
+ * pmempool_check_write_obj -- write all structures for obj pool
+ */
+static check_result_t
+pmempool_check_write_obj(struct pmempool_check *pcp)
+{
+	if (!pcp->repair || !pcp->exec)
+		return 0;
+
+	/* the pool header is the only structure not modified in place */
+	memcpy(&pcp->pop->hdr, &pcp->hdr.pool, sizeof (pcp->hdr.pool));
+
+	if (msync(pcp->pop, pcp->size, MS_SYNC)) {
+		warn("%s", pcp->fname);
+		out_err("writing pmemobj structures failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
 /*
  * pmempool_check_steps -- check steps
  */
@@ -1804,6 +2779,7 @@ static const struct pmempool_check_step pmempool_check_steps[] = {
 	{
 		.type	= PMEM_POOL_TYPE_BLK
 				| PMEM_POOL_TYPE_LOG
+				| PMEM_POOL_TYPE_OBJ
 				| PMEM_POOL_TYPE_UNKNOWN,
 		.func	= pmempool_check_pool_hdr,
 	},
@@ -1823,6 +2799,14 @@ static const struct pmempool_check_step pmempool_check_steps[] = {
 		.type	= PMEM_POOL_TYPE_BLK,
 		.func	= pmempool_check_btt_map_flog,
 	},
+	{
+		.type	= PMEM_POOL_TYPE_OBJ,
+		.func	= pmempool_check_pmemobj,
+	},
+	{
+		.type	= PMEM_POOL_TYPE_OBJ,
+		.func	= pmempool_check_pmemobj_structs,
+	},
 	{
 		.type	= PMEM_POOL_TYPE_LOG,
 		.func	= pmempool_check_write_log,
@@ -1831,6 +2815,10 @@ static const struct pmempool_check_step pmempool_check_steps[] = {
 		.type	= PMEM_POOL_TYPE_BLK,
 		.func	= pmempool_check_write_blk,
 	},
+	{
+		.type	= PMEM_POOL_TYPE_OBJ,
+		.func	= pmempool_check_write_obj,
+	},
 	{
 		.func	= NULL,
 	},
@@ -1901,6 +2889,11 @@ pmempool_check_all_steps(struct pmempool_check *pcp)
 	while (!pmempool_check_single_step(pcp,
 			&pmempool_check_steps[i++], &ret));
 
+	if (pcp->pop != NULL) {
+		munmap(pcp->pop, pcp->size);
+		pcp->pop = NULL;
+	}
+
 	close(pcp->fd);
 
 	return ret;
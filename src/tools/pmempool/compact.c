@@ -0,0 +1,1297 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * compact.c -- pmempool compact command source file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <err.h>
+#include <errno.h>
+#include <libgen.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "output.h"
+#include "compact.h"
+
+#define	VERBOSE_DEFAULT	1
+
+/*
+ * compact_obj -- object from the object store
+ */
+struct compact_obj {
+	uint64_t off;			/* offset of object's data */
+	uint64_t orig_off;		/* offset before relocation */
+	struct list_head *headp;	/* object store list */
+	uint32_t zone_id;
+	uint32_t chunk_id;
+	uint32_t block_off;		/* block offset within a run */
+	uint32_t units;			/* number of blocks or chunks */
+};
+
+/*
+ * compact_run -- chunk of run type
+ */
+struct compact_run {
+	uint32_t zone_id;
+	uint32_t chunk_id;
+	uint64_t block_size;
+	uint32_t nallocs;		/* number of blocks in run */
+	uint32_t used;			/* number of used blocks */
+	size_t obj_first;		/* index of the first object in run */
+	size_t nobjs;			/* number of objects in run */
+	int known;			/* all used blocks belong to objects */
+};
+
+/*
+ * pmempool_compact -- context and arguments for compact command
+ */
+struct pmempool_compact {
+	char *fname;
+	int fd;
+	char *path;			/* resolved path of the pool file */
+	char *tmpfname;			/* copy of the pool being compacted */
+	int tmpfd;
+	int relocate;
+	int force;
+	int dry_run;
+	char *mapfname;
+	FILE *mapfh;
+	struct pmemobjpool *pop;
+	size_t size;
+	struct heap_layout *layout;
+	int max_zone;
+	struct compact_obj *objs;
+	size_t nobjs;
+	size_t objs_size;
+	struct compact_run *runs;
+	size_t nruns;
+	uint64_t n_objs_moved;
+	uint64_t n_chunks_moved;
+	uint64_t n_runs_freed;
+	uint64_t max_free_before;
+	uint64_t max_free_after;
+};
+
+/*
+ * pmempool_compact_default -- default arguments and context values
+ */
+static const struct pmempool_compact pmempool_compact_default = {
+	.fname		= NULL,
+	.fd		= -1,
+	.path		= NULL,
+	.tmpfname	= NULL,
+	.tmpfd		= -1,
+	.relocate	= 0,
+	.force		= 0,
+	.dry_run	= 0,
+	.mapfname	= NULL,
+	.mapfh		= NULL,
+	.pop		= NULL,
+	.size		= 0,
+};
+
+/*
+ * long_options -- command line options
+ */
+static const struct option long_options[] = {
+	{"relocate",	no_argument,		0,	'r'},
+	{"map",		required_argument,	0,	'm'},
+	{"force",	no_argument,		0,	'f'},
+	{"dry-run",	no_argument,		0,	'n'},
+	{"verbose",	no_argument,		0,	'v'},
+	{"help",	no_argument,		0,	'h'},
+	{0,		0,			0,	 0 },
+};
+
+/*
+ * help_str -- string for help message
+ */
+static const char *help_str =
+"Compact heap of the pmemobj pool\n"
+"\n"
+"Available options:\n"
+"  -r, --relocate       relocate objects to pack runs and chunks\n"
+"  -m, --map <file>     write map of relocated objects to file\n"
+"  -f, --force          relocate objects without writing the map\n"
+"  -n, --dry-run        do not write any changes to the pool\n"
+"  -v, --verbose        increase verbosity level\n"
+"  -h, --help           display this help and exit\n"
+"\n"
+"For complete documentation see %s-compact(1) manual page.\n"
+;
+
+/*
+ * print_usage -- print application usage short description
+ */
+static void
+print_usage(char *appname)
+{
+	printf("Usage: %s compact [<args>] <file>\n", appname);
+}
+
+/*
+ * print_version -- print version string
+ */
+static void
+print_version(char *appname)
+{
+	printf("%s %s\n", appname, SRCVERSION);
+}
+
+/*
+ * pmempool_compact_help -- print help message for compact command
+ */
+void
+pmempool_compact_help(char *appname)
+{
+	print_usage(appname);
+	print_version(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * compact_lists_empty -- (internal) check if all lists are empty
+ */
+static int
+compact_lists_empty(struct list_head *heads, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		if (!PLIST_EMPTY(&heads[i]))
+			return 0;
+
+	return 1;
+}
+
+/*
+ * compact_redo_pending -- (internal) check if redo log is not processed
+ */
+static int
+compact_redo_pending(struct redo_log *redo, size_t nentries)
+{
+	for (size_t i = 0; i < nentries; i++)
+		if (redo[i].offset & REDO_FINISH_FLAG)
+			return 1;
+
+	return 0;
+}
+
+/*
+ * compact_lanes_clean -- (internal) check if pool does not need recovery
+ *
+ * Objects may be referenced by lanes only while an operation is in progress,
+ * so the pool must be closed cleanly before relocating anything.
+ */
+static int
+compact_lanes_clean(struct pmempool_compact *pcp)
+{
+	struct pmemobjpool *pop = pcp->pop;
+
+	for (uint64_t i = 0; i < pop->nlanes; i++) {
+		struct lane_layout *lane = OBJ_OFF_TO_PTR(pop,
+				pop->lanes_offset +
+				i * sizeof (struct lane_layout));
+		struct allocator_lane_section *alloc =
+			(struct allocator_lane_section *)
+			&lane->sections[LANE_SECTION_ALLOCATOR];
+		struct lane_list_section *list =
+			(struct lane_list_section *)
+			&lane->sections[LANE_SECTION_LIST];
+		struct lane_tx_layout *tx = (struct lane_tx_layout *)
+			&lane->sections[LANE_SECTION_TRANSACTION];
+
+		if (compact_redo_pending(alloc->redo, REDO_LOG_SIZE) ||
+			compact_redo_pending(list->redo, REDO_NUM_ENTRIES) ||
+			tx->state != TX_STATE_NONE ||
+			!compact_lists_empty(&tx->undo_alloc,
+				(sizeof (*tx) - offsetof(struct lane_tx_layout,
+				undo_alloc)) / sizeof (struct list_head))) {
+			outv(2, "lane %ju requires recovery\n", i);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * compact_zone -- (internal) get zone, NULL if not initialized
+ */
+static struct zone *
+compact_zone(struct pmempool_compact *pcp, uint32_t zone_id)
+{
+	struct zone *zone = &pcp->layout->zones[zone_id];
+
+	return zone->header.magic == ZONE_HEADER_MAGIC ? zone : NULL;
+}
+
+/*
+ * compact_chunk_write -- (internal) write chunk header and footer
+ */
+static void
+compact_chunk_write(struct zone *zone, uint32_t chunk_id, uint16_t type,
+		uint16_t flags, uint32_t size_idx)
+{
+	struct chunk_header hdr = {
+		.type = type,
+		.flags = flags,
+		.size_idx = size_idx,
+	};
+
+	zone->chunk_headers[chunk_id] = hdr;
+	if (size_idx > 1) {
+		hdr.type = CHUNK_TYPE_FOOTER;
+		zone->chunk_headers[chunk_id + size_idx - 1] = hdr;
+	}
+}
+
+/*
+ * compact_chunk_merge -- (internal) merge free chunk with following ones
+ */
+static void
+compact_chunk_merge(struct zone *zone, uint32_t chunk_id)
+{
+	struct chunk_header *hdr = &zone->chunk_headers[chunk_id];
+	uint32_t size_idx = hdr->size_idx;
+	uint16_t flags = hdr->flags;
+
+	for (;;) {
+		uint32_t next = chunk_id + size_idx;
+		if (next >= zone->header.size_idx)
+			break;
+
+		struct chunk_header *nhdr = &zone->chunk_headers[next];
+		if (nhdr->type != CHUNK_TYPE_FREE || nhdr->size_idx == 0)
+			break;
+
+		size_idx += nhdr->size_idx;
+		flags &= nhdr->flags;
+
+		/* the absorbed header is no longer a chunk boundary */
+		memset(nhdr, 0, sizeof (*nhdr));
+	}
+
+	if (size_idx != hdr->size_idx) {
+		/* clear stale footer of the first chunk */
+		if (hdr->size_idx > 1)
+			memset(hdr + hdr->size_idx - 1, 0, sizeof (*hdr));
+		compact_chunk_write(zone, chunk_id, CHUNK_TYPE_FREE, flags,
+				size_idx);
+	}
+}
+
+/*
+ * compact_max_free -- (internal) get the largest free extent in chunks
+ */
+static uint64_t
+compact_max_free(struct pmempool_compact *pcp)
+{
+	uint64_t max = 0;
+
+	for (int z = 0; z < pcp->max_zone; z++) {
+		struct zone *zone = compact_zone(pcp, z);
+		if (!zone)
+			continue;
+
+		uint64_t cur = 0;
+		for (uint32_t c = 0; c < zone->header.size_idx; ) {
+			struct chunk_header *hdr = &zone->chunk_headers[c];
+			uint32_t size_idx = hdr->size_idx ? hdr->size_idx : 1;
+
+			if (hdr->type == CHUNK_TYPE_FREE) {
+				cur += size_idx;
+				if (cur > max)
+					max = cur;
+			} else {
+				cur = 0;
+			}
+
+			c += size_idx;
+		}
+	}
+
+	return max;
+}
+
+/*
+ * compact_add_obj -- (internal) add object to the objects array
+ */
+static int
+compact_add_obj(struct pmempool_compact *pcp, struct list_head *headp,
+		struct list_entry *entryp)
+{
+	struct pmemobjpool *pop = pcp->pop;
+	struct allocation_header *alloc = ENTRY_TO_ALLOC_HDR(entryp);
+	uint64_t off = OBJ_PTR_TO_OFF(pop, ENTRY_TO_DATA(entryp));
+
+	if (alloc->zone_id >= pcp->max_zone)
+		goto err;
+
+	struct zone *zone = compact_zone(pcp, alloc->zone_id);
+	if (!zone || alloc->chunk_id >= zone->header.size_idx)
+		goto err;
+
+	struct chunk_header *hdr = &zone->chunk_headers[alloc->chunk_id];
+	struct compact_obj obj = {
+		.off = off,
+		.orig_off = off,
+		.headp = headp,
+		.zone_id = alloc->zone_id,
+		.chunk_id = alloc->chunk_id,
+		.block_off = 0,
+		.units = hdr->size_idx,
+	};
+
+	if (hdr->type == CHUNK_TYPE_RUN) {
+		struct chunk_run *run =
+			(struct chunk_run *)&zone->chunks[alloc->chunk_id];
+		if (run->block_size == 0)
+			goto err;
+
+		obj.block_off = ((uintptr_t)alloc - (uintptr_t)run->data) /
+			run->block_size;
+		obj.units = alloc->size / run->block_size;
+	} else if (hdr->type != CHUNK_TYPE_USED) {
+		goto err;
+	}
+
+	if (pcp->nobjs == pcp->objs_size) {
+		size_t size = pcp->objs_size ? 2 * pcp->objs_size : 1024;
+		struct compact_obj *objs = realloc(pcp->objs,
+				size * sizeof (*objs));
+		if (!objs)
+			err(1, "Cannot allocate memory for objects");
+		pcp->objs = objs;
+		pcp->objs_size = size;
+	}
+
+	pcp->objs[pcp->nobjs++] = obj;
+
+	return 0;
+err:
+	out_err("object 0x%jx: invalid allocation header\n", off);
+	return -1;
+}
+
+/*
+ * compact_collect_objs -- (internal) collect all objects from object store
+ */
+static int
+compact_collect_objs(struct pmempool_compact *pcp)
+{
+	struct pmemobjpool *pop = pcp->pop;
+	struct object_store *store = OBJ_OFF_TO_PTR(pop, pop->obj_store_offset);
+	struct list_entry *entryp;
+
+	PLIST_FOREACH(entryp, pop, &store->root.head) {
+		if (compact_add_obj(pcp, &store->root.head, entryp))
+			return -1;
+	}
+
+	for (size_t i = 0; i < PMEMOBJ_NUM_OID_TYPES; i++) {
+		struct list_head *headp = &store->bytype[i].head;
+		PLIST_FOREACH(entryp, pop, headp) {
+			if (compact_add_obj(pcp, headp, entryp))
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * compact_obj_cmp -- (internal) compare objects by location
+ */
+static int
+compact_obj_cmp(const void *a, const void *b)
+{
+	const struct compact_obj *o1 = a;
+	const struct compact_obj *o2 = b;
+
+	if (o1->zone_id != o2->zone_id)
+		return o1->zone_id < o2->zone_id ? -1 : 1;
+	if (o1->chunk_id != o2->chunk_id)
+		return o1->chunk_id < o2->chunk_id ? -1 : 1;
+	if (o1->block_off != o2->block_off)
+		return o1->block_off < o2->block_off ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * compact_obj_find -- (internal) find the first object in the chunk
+ */
+static size_t
+compact_obj_find(struct pmempool_compact *pcp, uint32_t zone_id,
+		uint32_t chunk_id)
+{
+	size_t l = 0;
+	size_t r = pcp->nobjs;
+
+	while (l < r) {
+		size_t m = l + (r - l) / 2;
+		struct compact_obj *o = &pcp->objs[m];
+		if (o->zone_id < zone_id ||
+			(o->zone_id == zone_id && o->chunk_id < chunk_id))
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	return l;
+}
+
+/*
+ * compact_run_used -- (internal) get number of used blocks in run
+ */
+static uint32_t
+compact_run_used(struct chunk_run *run, uint32_t nallocs)
+{
+	uint32_t ret = 0;
+	for (int i = 0; i < MAX_BITMAP_VALUES; i++)
+		ret += util_count_ones(run->bitmap[i]);
+
+	/* blocks past the end of the run are marked as used */
+	return ret - (RUN_BITMAP_SIZE - nallocs);
+}
+
+/*
+ * compact_scan -- (internal) sort objects and collect runs
+ */
+static void
+compact_scan(struct pmempool_compact *pcp)
+{
+	qsort(pcp->objs, pcp->nobjs, sizeof (*pcp->objs), compact_obj_cmp);
+
+	pcp->nruns = 0;
+	size_t runs_size = 0;
+
+	for (int z = 0; z < pcp->max_zone; z++) {
+		struct zone *zone = compact_zone(pcp, z);
+		if (!zone)
+			continue;
+
+		for (uint32_t c = 0; c < zone->header.size_idx; ) {
+			struct chunk_header *hdr = &zone->chunk_headers[c];
+			uint32_t size_idx = hdr->size_idx ? hdr->size_idx : 1;
+			struct chunk_run *run =
+				(struct chunk_run *)&zone->chunks[c];
+
+			if (hdr->type != CHUNK_TYPE_RUN ||
+				run->block_size < MIN_RUN_SIZE) {
+				c += size_idx;
+				continue;
+			}
+
+			if (pcp->nruns == runs_size) {
+				runs_size = runs_size ? 2 * runs_size : 64;
+				pcp->runs = realloc(pcp->runs,
+					runs_size * sizeof (*pcp->runs));
+				if (!pcp->runs)
+					err(1, "Cannot allocate memory for "
+						"runs");
+			}
+
+			struct compact_run *r = &pcp->runs[pcp->nruns++];
+			r->zone_id = z;
+			r->chunk_id = c;
+			r->block_size = run->block_size;
+			r->nallocs = RUNSIZE / run->block_size;
+			r->used = compact_run_used(run, r->nallocs);
+			r->obj_first = compact_obj_find(pcp, z, c);
+			r->nobjs = 0;
+
+			uint32_t units = 0;
+			for (size_t i = r->obj_first; i < pcp->nobjs &&
+				pcp->objs[i].zone_id == z &&
+				pcp->objs[i].chunk_id == c; i++) {
+				units += pcp->objs[i].units;
+				r->nobjs++;
+			}
+
+			r->known = units == r->used;
+
+			c += size_idx;
+		}
+	}
+}
+
+/*
+ * compact_tr -- (internal) translate offset from moved range
+ */
+static uint64_t
+compact_tr(uint64_t off, uint64_t lo, uint64_t hi, uint64_t new_lo)
+{
+	return off >= lo && off < hi ? off - lo + new_lo : off;
+}
+
+/*
+ * compact_relink -- (internal) update list linkage of moved objects
+ *
+ * The objects from range [lo, hi) have been copied to the range starting at
+ * new_lo. The neighbours of each object may be either outside the range or
+ * already at their new location.
+ */
+static void
+compact_relink(struct pmempool_compact *pcp, struct compact_obj *objs,
+		size_t nobjs, uint64_t lo, uint64_t hi, uint64_t new_lo)
+{
+	struct pmemobjpool *pop = pcp->pop;
+
+	for (size_t i = 0; i < nobjs; i++) {
+		uint64_t old_off = objs[i].off;
+		uint64_t new_off = compact_tr(old_off, lo, hi, new_lo);
+		struct list_entry *entryp = PLIST_OFF_TO_PTR(pop, new_off);
+
+		uint64_t next = compact_tr(entryp->pe_next.off, lo, hi, new_lo);
+		uint64_t prev = compact_tr(entryp->pe_prev.off, lo, hi, new_lo);
+		entryp->pe_next.off = next;
+		entryp->pe_prev.off = prev;
+
+		struct list_entry *nextp = PLIST_OFF_TO_PTR(pop, next);
+		struct list_entry *prevp = PLIST_OFF_TO_PTR(pop, prev);
+		nextp->pe_prev.off = new_off;
+		prevp->pe_next.off = new_off;
+
+		if (objs[i].headp->pe_first.off == old_off)
+			objs[i].headp->pe_first.off = new_off;
+
+		objs[i].off = new_off;
+	}
+}
+
+/*
+ * compact_run_find_free -- (internal) find free blocks in run
+ *
+ * A single allocation never crosses a bitmap value boundary.
+ */
+static int
+compact_run_find_free(struct chunk_run *run, uint32_t units,
+		uint32_t *block_off)
+{
+	uint64_t mask = (1ULL << units) - 1;
+
+	for (int i = 0; i < MAX_BITMAP_VALUES; i++) {
+		uint64_t v = run->bitmap[i];
+		if (v == ~0ULL)
+			continue;
+
+		for (uint32_t j = 0; j + units <= BITS_PER_VALUE; j++) {
+			if ((v & (mask << j)) == 0) {
+				*block_off = i * BITS_PER_VALUE + j;
+				return 0;
+			}
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * compact_run_set -- (internal) mark blocks in run as used or free
+ */
+static void
+compact_run_set(struct chunk_run *run, uint32_t block_off, uint32_t units,
+		int used)
+{
+	uint64_t mask = ((1ULL << units) - 1) << (block_off % BITS_PER_VALUE);
+	uint64_t *v = &run->bitmap[block_off / BITS_PER_VALUE];
+
+	if (used)
+		*v |= mask;
+	else
+		*v &= ~mask;
+}
+
+/*
+ * compact_run_obj -- (internal) get run and allocation header of the object
+ */
+static struct chunk_run *
+compact_run_obj(struct pmempool_compact *pcp, struct compact_obj *obj,
+		struct allocation_header **allocp)
+{
+	struct zone *zone = &pcp->layout->zones[obj->zone_id];
+	struct chunk_run *run =
+		(struct chunk_run *)&zone->chunks[obj->chunk_id];
+
+	*allocp = ENTRY_TO_ALLOC_HDR(PLIST_OFF_TO_PTR(pcp->pop, obj->off));
+
+	return run;
+}
+
+/*
+ * compact_move_to_run -- (internal) move object to free blocks of run
+ */
+static int
+compact_move_to_run(struct pmempool_compact *pcp, struct compact_obj *obj,
+		struct compact_run *dst)
+{
+	struct zone *zone = &pcp->layout->zones[dst->zone_id];
+	struct chunk_run *drun =
+		(struct chunk_run *)&zone->chunks[dst->chunk_id];
+	uint32_t block_off;
+
+	if (compact_run_find_free(drun, obj->units, &block_off))
+		return -1;
+
+	struct allocation_header *alloc;
+	struct chunk_run *srun = compact_run_obj(pcp, obj, &alloc);
+	struct allocation_header *dalloc = (struct allocation_header *)
+		&drun->data[block_off * dst->block_size];
+
+	memcpy(dalloc, alloc, alloc->size);
+	dalloc->zone_id = dst->zone_id;
+	dalloc->chunk_id = dst->chunk_id;
+
+	compact_run_set(drun, block_off, obj->units, 1);
+	compact_run_set(srun, obj->block_off, obj->units, 0);
+
+	uint64_t lo = OBJ_PTR_TO_OFF(pcp->pop, alloc);
+	compact_relink(pcp, obj, 1, lo, lo + alloc->size,
+			OBJ_PTR_TO_OFF(pcp->pop, dalloc));
+
+	obj->zone_id = dst->zone_id;
+	obj->chunk_id = dst->chunk_id;
+	obj->block_off = block_off;
+	dst->used += obj->units;
+
+	return 0;
+}
+
+/*
+ * compact_run_cmp -- (internal) compare runs by block size and usage
+ */
+static int
+compact_run_cmp(const void *a, const void *b)
+{
+	const struct compact_run *r1 = a;
+	const struct compact_run *r2 = b;
+
+	if (r1->block_size != r2->block_size)
+		return r1->block_size < r2->block_size ? -1 : 1;
+	if (r1->used != r2->used)
+		return r1->used > r2->used ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * compact_pack_class -- (internal) move objects from the least used runs
+ *
+ * The runs [first, last) are of the same block size and sorted by the
+ * number of used blocks in descending order.
+ */
+static void
+compact_pack_class(struct pmempool_compact *pcp, size_t first, size_t last)
+{
+	for (size_t s = last - 1; s > first; s--) {
+		struct compact_run *src = &pcp->runs[s];
+		if (src->used == 0 || !src->known)
+			continue;
+
+		uint64_t nfree = 0;
+		for (size_t t = first; t < s; t++)
+			nfree += pcp->runs[t].nallocs - pcp->runs[t].used;
+
+		/* moving objects pays off only if the run becomes empty */
+		if (nfree < src->used)
+			return;
+
+		for (size_t i = 0; i < src->nobjs; i++) {
+			struct compact_obj *obj =
+				&pcp->objs[src->obj_first + i];
+
+			size_t t;
+			for (t = first; t < s; t++) {
+				if (compact_move_to_run(pcp, obj,
+						&pcp->runs[t]) == 0)
+					break;
+			}
+
+			if (t == s)
+				return;
+
+			src->used -= obj->units;
+		}
+	}
+}
+
+/*
+ * compact_pack_runs -- (internal) pack objects into the most used runs
+ */
+static void
+compact_pack_runs(struct pmempool_compact *pcp)
+{
+	qsort(pcp->runs, pcp->nruns, sizeof (*pcp->runs), compact_run_cmp);
+
+	size_t first = 0;
+	for (size_t i = 1; i <= pcp->nruns; i++) {
+		if (i == pcp->nruns || pcp->runs[i].block_size !=
+				pcp->runs[first].block_size) {
+			compact_pack_class(pcp, first, i);
+			first = i;
+		}
+	}
+}
+
+/*
+ * compact_free_runs -- (internal) convert empty runs to free chunks
+ */
+static void
+compact_free_runs(struct pmempool_compact *pcp)
+{
+	for (size_t i = 0; i < pcp->nruns; i++) {
+		struct compact_run *r = &pcp->runs[i];
+		if (r->used != 0)
+			continue;
+
+		struct zone *zone = &pcp->layout->zones[r->zone_id];
+		compact_chunk_write(zone, r->chunk_id, CHUNK_TYPE_FREE, 0, 1);
+		pcp->n_runs_freed++;
+	}
+}
+
+/*
+ * compact_merge_free -- (internal) merge adjacent free chunks in all zones
+ */
+static void
+compact_merge_free(struct pmempool_compact *pcp)
+{
+	for (int z = 0; z < pcp->max_zone; z++) {
+		struct zone *zone = compact_zone(pcp, z);
+		if (!zone)
+			continue;
+
+		for (uint32_t c = 0; c < zone->header.size_idx; ) {
+			struct chunk_header *hdr = &zone->chunk_headers[c];
+			if (hdr->type == CHUNK_TYPE_FREE)
+				compact_chunk_merge(zone, c);
+
+			c += hdr->size_idx ? hdr->size_idx : 1;
+		}
+	}
+}
+
+/*
+ * compact_find_free -- (internal) find the first free extent of given size
+ *
+ * Only extents starting before the limit are considered. The *hintp is
+ * the first chunk which may be free, it is updated on return.
+ */
+static int
+compact_find_free(struct zone *zone, uint32_t size_idx, uint32_t limit,
+		uint32_t *hintp, uint32_t *chunk_idp)
+{
+	int hint_set = 0;
+
+	for (uint32_t c = *hintp; c < limit; ) {
+		struct chunk_header *hdr = &zone->chunk_headers[c];
+		if (hdr->type == CHUNK_TYPE_FREE) {
+			compact_chunk_merge(zone, c);
+			if (!hint_set) {
+				*hintp = c;
+				hint_set = 1;
+			}
+
+			if (hdr->size_idx >= size_idx) {
+				*chunk_idp = c;
+				return 0;
+			}
+		}
+
+		c += hdr->size_idx ? hdr->size_idx : 1;
+	}
+
+	if (!hint_set)
+		*hintp = limit;
+
+	return -1;
+}
+
+/*
+ * compact_move_chunk -- (internal) move used chunk or run to free extent
+ */
+static int
+compact_move_chunk(struct pmempool_compact *pcp, uint32_t zone_id,
+		uint32_t chunk_id, uint32_t *hintp)
+{
+	struct zone *zone = &pcp->layout->zones[zone_id];
+	struct chunk_header hdr = zone->chunk_headers[chunk_id];
+	size_t first = compact_obj_find(pcp, zone_id, chunk_id);
+	size_t nobjs = 0;
+
+	while (first + nobjs < pcp->nobjs &&
+		pcp->objs[first + nobjs].zone_id == zone_id &&
+		pcp->objs[first + nobjs].chunk_id == chunk_id)
+		nobjs++;
+
+	if (hdr.type == CHUNK_TYPE_USED) {
+		/* used chunk holds exactly one object */
+		if (nobjs != 1 || pcp->objs[first].units != hdr.size_idx)
+			return 0;
+	} else {
+		struct chunk_run *run =
+			(struct chunk_run *)&zone->chunks[chunk_id];
+		uint32_t units = 0;
+		for (size_t i = 0; i < nobjs; i++)
+			units += pcp->objs[first + i].units;
+
+		if (nobjs == 0 || units !=
+			compact_run_used(run, RUNSIZE / run->block_size))
+			return 0;
+	}
+
+	uint32_t dst_id;
+	if (compact_find_free(zone, hdr.size_idx, chunk_id, hintp, &dst_id))
+		return 0;
+
+	uint32_t free_size = zone->chunk_headers[dst_id].size_idx;
+	void *src = &zone->chunks[chunk_id];
+	void *dst = &zone->chunks[dst_id];
+	size_t len = hdr.type == CHUNK_TYPE_RUN ? CHUNKSIZE :
+		((struct allocation_header *)src)->size;
+
+	memcpy(dst, src, len);
+
+	/* clear stale footer of the free extent */
+	if (free_size > 1)
+		memset(&zone->chunk_headers[dst_id + free_size - 1], 0,
+				sizeof (hdr));
+	compact_chunk_write(zone, dst_id, hdr.type, 0, hdr.size_idx);
+	if (free_size > hdr.size_idx)
+		compact_chunk_write(zone, dst_id + hdr.size_idx,
+				CHUNK_TYPE_FREE, 0, free_size - hdr.size_idx);
+	compact_chunk_write(zone, chunk_id, CHUNK_TYPE_FREE, 0,
+			hdr.size_idx);
+
+	for (size_t i = 0; i < nobjs; i++) {
+		struct compact_obj *obj = &pcp->objs[first + i];
+		uint64_t off = obj->off - OBJ_PTR_TO_OFF(pcp->pop, src) +
+			OBJ_PTR_TO_OFF(pcp->pop, dst);
+		struct allocation_header *alloc = ENTRY_TO_ALLOC_HDR(
+				PLIST_OFF_TO_PTR(pcp->pop, off));
+		alloc->chunk_id = dst_id;
+	}
+
+	uint64_t lo = OBJ_PTR_TO_OFF(pcp->pop, src);
+	compact_relink(pcp, &pcp->objs[first], nobjs, lo, lo + len,
+			OBJ_PTR_TO_OFF(pcp->pop, dst));
+
+	/* keep the objects array sorted */
+	for (size_t i = 0; i < nobjs; i++)
+		pcp->objs[first + i].chunk_id = dst_id;
+	qsort(pcp->objs, pcp->nobjs, sizeof (*pcp->objs), compact_obj_cmp);
+
+	pcp->n_chunks_moved++;
+
+	return 0;
+}
+
+/*
+ * compact_pack_chunks -- (internal) move chunks towards the zone's beginning
+ */
+static void
+compact_pack_chunks(struct pmempool_compact *pcp)
+{
+	for (int z = 0; z < pcp->max_zone; z++) {
+		struct zone *zone = compact_zone(pcp, z);
+		if (!zone)
+			continue;
+
+		/* collect chunks first, the headers change while moving */
+		uint32_t *chunks = malloc(zone->header.size_idx *
+				sizeof (*chunks));
+		if (!chunks)
+			err(1, "Cannot allocate memory for chunks");
+
+		uint32_t n = 0;
+		for (uint32_t c = 0; c < zone->header.size_idx; ) {
+			struct chunk_header *hdr = &zone->chunk_headers[c];
+			if (hdr->type == CHUNK_TYPE_USED ||
+				hdr->type == CHUNK_TYPE_RUN)
+				chunks[n++] = c;
+
+			c += hdr->size_idx ? hdr->size_idx : 1;
+		}
+
+		uint32_t hint = 0;
+		while (n-- > 0) {
+			if (hint >= chunks[n])
+				break;
+			compact_move_chunk(pcp, z, chunks[n], &hint);
+		}
+
+		free(chunks);
+	}
+}
+
+/*
+ * compact_write_map -- (internal) write map of relocated objects
+ *
+ * An object may be moved by both passes and the offsets it passed through
+ * may be taken by other objects, so only the original and the final offset
+ * of each object are written.
+ */
+static int
+compact_write_map(struct pmempool_compact *pcp)
+{
+	for (size_t i = 0; i < pcp->nobjs; i++) {
+		struct compact_obj *obj = &pcp->objs[i];
+		if (obj->off == obj->orig_off)
+			continue;
+
+		if (fprintf(pcp->mapfh, "0x%016jx 0x%016jx\n",
+				obj->orig_off, obj->off) < 0) {
+			warn("%s", pcp->mapfname);
+			return -1;
+		}
+	}
+
+	if (fflush(pcp->mapfh)) {
+		warn("%s", pcp->mapfname);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * compact_copy -- (internal) create a copy of the pool file to work on
+ *
+ * The copy is created next to the pool file, so that it can be renamed over
+ * it atomically.  A crash or an error at any point before that leaves the
+ * pool file untouched.
+ */
+static int
+compact_copy(struct pmempool_compact *pcp, struct stat *bufp)
+{
+	size_t len = strlen(pcp->path) + sizeof (".XXXXXX");
+	pcp->tmpfname = malloc(len);
+	if (!pcp->tmpfname) {
+		warn("%s", pcp->fname);
+		return -1;
+	}
+
+	snprintf(pcp->tmpfname, len, "%s.XXXXXX", pcp->path);
+	if ((pcp->tmpfd = mkstemp(pcp->tmpfname)) < 0) {
+		warn("%s", pcp->tmpfname);
+		free(pcp->tmpfname);
+		pcp->tmpfname = NULL;
+		return -1;
+	}
+
+	if (fchmod(pcp->tmpfd, bufp->st_mode & 07777)) {
+		warn("%s", pcp->tmpfname);
+		return -1;
+	}
+
+	off_t off = 0;
+	while (off < bufp->st_size) {
+		ssize_t ret = sendfile(pcp->tmpfd, pcp->fd, &off,
+				bufp->st_size - off);
+		if (ret <= 0) {
+			if (ret == 0)
+				errno = EIO;
+			warn("copying file '%s' to '%s' failed",
+					pcp->fname, pcp->tmpfname);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * compact_replace -- (internal) atomically replace the pool file by the copy
+ */
+static int
+compact_replace(struct pmempool_compact *pcp)
+{
+	if (rename(pcp->tmpfname, pcp->path)) {
+		warn("%s", pcp->fname);
+		return -1;
+	}
+
+	free(pcp->tmpfname);
+	pcp->tmpfname = NULL;
+
+	/* make the rename itself durable */
+	char *dir = strdup(pcp->path);
+	if (!dir) {
+		warn("%s", pcp->fname);
+		return -1;
+	}
+
+	int ret = 0;
+	int dfd = open(dirname(dir), O_RDONLY);
+	if (dfd < 0 || fsync(dfd)) {
+		warn("%s", dir);
+		ret = -1;
+	}
+
+	if (dfd >= 0)
+		close(dfd);
+	free(dir);
+
+	return ret;
+}
+
+/*
+ * pmempool_compact_obj -- compact heap of pmemobj pool
+ */
+static int
+pmempool_compact_obj(struct pmempool_compact *pcp)
+{
+	struct stat buf;
+	if (fstat(pcp->fd, &buf)) {
+		warn("%s", pcp->fname);
+		return -1;
+	}
+
+	pcp->size = buf.st_size;
+
+	/* the pool file itself is only replaced once the copy is complete */
+	if (!pcp->dry_run && compact_copy(pcp, &buf))
+		return -1;
+
+	int fd = pcp->dry_run ? pcp->fd : pcp->tmpfd;
+	pcp->pop = mmap(NULL, pcp->size, PROT_READ|PROT_WRITE,
+			pcp->dry_run ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	if (pcp->pop == MAP_FAILED) {
+		warn("%s", pcp->fname);
+		pcp->pop = NULL;
+		return -1;
+	}
+
+	struct pmemobjpool *pop = pcp->pop;
+	if (pop->heap_offset + pop->heap_size > pcp->size ||
+		pop->heap_size < HEAP_MIN_SIZE) {
+		out_err("invalid heap size\n");
+		return -1;
+	}
+
+	if (!compact_lanes_clean(pcp)) {
+		out_err("pool requires recovery, open it with libpmemobj "
+				"first\n");
+		return -1;
+	}
+
+	pcp->layout = OBJ_OFF_TO_PTR(pop, pop->heap_offset);
+	pcp->max_zone = util_heap_max_zone(pop->heap_size);
+	pcp->max_free_before = compact_max_free(pcp);
+
+	if (compact_collect_objs(pcp))
+		return -1;
+
+	compact_scan(pcp);
+
+	if (pcp->relocate)
+		compact_pack_runs(pcp);
+
+	compact_free_runs(pcp);
+	compact_merge_free(pcp);
+
+	if (pcp->relocate) {
+		compact_scan(pcp);
+		compact_pack_chunks(pcp);
+		compact_merge_free(pcp);
+	}
+
+	pcp->max_free_after = compact_max_free(pcp);
+
+	/* objects moved by both passes are counted once */
+	for (size_t i = 0; i < pcp->nobjs; i++)
+		if (pcp->objs[i].off != pcp->objs[i].orig_off)
+			pcp->n_objs_moved++;
+
+	if (pcp->mapfh && compact_write_map(pcp))
+		return -1;
+
+	outv_field(VERBOSE_DEFAULT, "Objects relocated", "%ju",
+			pcp->n_objs_moved);
+	outv_field(VERBOSE_DEFAULT, "Chunks relocated", "%ju",
+			pcp->n_chunks_moved);
+	outv_field(VERBOSE_DEFAULT, "Runs freed", "%ju", pcp->n_runs_freed);
+	char before[64];
+	snprintf(before, sizeof (before), "%s",
+			out_get_size_str(pcp->max_free_before * CHUNKSIZE, 0));
+	outv_field(VERBOSE_DEFAULT, "Largest free extent", "%s (was %s)",
+			out_get_size_str(pcp->max_free_after * CHUNKSIZE, 0),
+			before);
+
+	if (pcp->dry_run)
+		return 0;
+
+	if (msync(pop, pcp->size, MS_SYNC) || fsync(pcp->tmpfd)) {
+		warn("%s", pcp->tmpfname);
+		return -1;
+	}
+
+	return compact_replace(pcp);
+}
+
+/*
+ * pmempool_compact_func -- compact command main function
+ */
+int
+pmempool_compact_func(char *appname, int argc, char *argv[])
+{
+	struct pmempool_compact pc = pmempool_compact_default;
+	int vlevel = VERBOSE_DEFAULT;
+	int ret = 0;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "rm:fnvh",
+				long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			pc.relocate = 1;
+			break;
+		case 'm':
+			pc.mapfname = optarg;
+			break;
+		case 'f':
+			pc.force = 1;
+			break;
+		case 'n':
+			pc.dry_run = 1;
+			break;
+		case 'v':
+			vlevel++;
+			break;
+		case 'h':
+			pmempool_compact_help(appname);
+			exit(EXIT_SUCCESS);
+		default:
+			print_usage(appname);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind < argc) {
+		pc.fname = argv[optind];
+	} else {
+		print_usage(appname);
+		exit(EXIT_FAILURE);
+	}
+
+	if (pc.mapfname && !pc.relocate) {
+		out_err("'-m' requires '-r' option\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Persistent pointers stored in objects are not updated, without
+	 * the map there would be no way to fix them after relocation.
+	 * A dry run changes nothing, so it does not need the map.
+	 */
+	if (pc.relocate && !pc.mapfname && !pc.force && !pc.dry_run) {
+		out_err("'-r' requires '-m' option, use '-f' to relocate "
+				"without the map\n");
+		exit(EXIT_FAILURE);
+	}
+
+	out_set_vlevel(vlevel);
+
+	struct pmem_pool_params params;
+	if (pmem_pool_parse_params(pc.fname, &params)) {
+		warn("%s", pc.fname);
+		exit(EXIT_FAILURE);
+	}
+
+	if (params.type != PMEM_POOL_TYPE_OBJ) {
+		out_err("%s: only obj pool type supported\n", pc.fname);
+		exit(EXIT_FAILURE);
+	}
+
+	if ((pc.path = realpath(pc.fname, NULL)) == NULL) {
+		warn("%s", pc.fname);
+		exit(EXIT_FAILURE);
+	}
+
+	if ((pc.fd = open(pc.path, O_RDONLY)) < 0) {
+		warn("%s", pc.fname);
+		free(pc.path);
+		exit(EXIT_FAILURE);
+	}
+
+	/* keep other users of the pool file away while it is being compacted */
+	if (flock(pc.fd, (pc.dry_run ? LOCK_SH : LOCK_EX) | LOCK_NB)) {
+		if (errno == EWOULDBLOCK)
+			out_err("%s: pool file is in use\n", pc.fname);
+		else
+			warn("%s", pc.fname);
+		close(pc.fd);
+		free(pc.path);
+		exit(EXIT_FAILURE);
+	}
+
+	if (pc.mapfname) {
+		pc.mapfh = fopen(pc.mapfname, "w");
+		if (!pc.mapfh) {
+			warn("%s", pc.mapfname);
+			close(pc.fd);
+			free(pc.path);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	ret = pmempool_compact_obj(&pc);
+	if (ret)
+		out_err("compacting pool file failed\n");
+
+	if (pc.pop)
+		munmap(pc.pop, pc.size);
+	if (pc.mapfh)
+		fclose(pc.mapfh);
+	if (pc.tmpfd >= 0)
+		close(pc.tmpfd);
+	if (pc.tmpfname) {
+		/* the pool file was not replaced, discard the copy */
+		unlink(pc.tmpfname);
+		free(pc.tmpfname);
+	}
+	free(pc.objs);
+	free(pc.runs);
+	free(pc.path);
+	close(pc.fd);
+
+	return ret;
+}
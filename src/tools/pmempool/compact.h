@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014, Intel Corporation
+ * Copyright (c) 2015, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -26,26 +26,13 @@
  * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
  * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
  * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
- * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY LOG OF THE USE
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <stdbool.h>
-
-#define	DEF_VEC_SIZE 1
-#define	MIN_VEC_SIZE 1
-
-#define	DEF_EL_SIZE 512
-#define	MIN_EL_SIZE 1
+/*
+ * compact.h -- pmempool compact command header file
+ */
 
-/* program arguments */
-struct prog_args {
-	unsigned int seed;
-	bool rand;
-	size_t vec_size;
-	size_t el_size;
-	int threads_count;
-	int ops_count;
-	bool fileio_mode;
-	char *file_name;
-};
+int pmempool_compact_func(char *appname, int argc, char *argv[]);
+void pmempool_compact_help(char *appname);
@@ -118,17 +118,26 @@ struct pmem_obj_class_stats {
 	uint64_t n_used;
 };
 
+/*
+ * Run utilization histogram buckets: empty, up to 25%, 50%, 75%,
+ * below 100% and full.
+ */
+#define	RUN_UTIL_MAX 6
+
 struct pmem_obj_zone_stats {
 	uint64_t n_chunks;
 	uint64_t n_chunks_type[MAX_CHUNK_TYPE];
 	uint64_t size_chunks;
 	uint64_t size_chunks_type[MAX_CHUNK_TYPE];
+	uint64_t max_free_chunks;
+	uint64_t n_runs_util[RUN_UTIL_MAX];
 	struct pmem_obj_class_stats class_stats[MAX_BUCKETS];
 };
 
 struct pmem_obj_stats {
 	uint64_t n_total_objects;
 	uint64_t n_total_bytes;
+	uint64_t n_total_alloc_bytes;
 	uint64_t n_type_objects[PMEMOBJ_NUM_OID_TYPES];
 	uint64_t n_type_bytes[PMEMOBJ_NUM_OID_TYPES];
 	uint64_t n_zones;
@@ -35,8 +35,14 @@
  */
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <err.h>
 #include <signal.h>
+#include <dirent.h>
+#include <inttypes.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <assert.h>
@@ -44,6 +50,7 @@
 #include "common.h"
 #include "output.h"
 #include "info.h"
+#include "stats.h"
 
 #define	BITMAP_BUFF_SIZE 1024
 #define	TYPE_NUM_BUFF_SIZE 32
@@ -196,13 +203,56 @@ get_bitmap_reserved(struct chunk_run *run)
 	uint32_t ret = 0;
 	int size = get_bitmap_size(run);
 	int used_values = size / BITS_PER_VALUE;
+	int mod = size % BITS_PER_VALUE;
 	for (int i = 0; i < used_values; i++) {
 		ret += util_count_ones(run->bitmap[i]);
 	}
 
+	/*
+	 * the bits past the end of the run are always set in the last value,
+	 * count only the ones of existing blocks
+	 */
+	if (mod)
+		ret += util_count_ones(run->bitmap[used_values] &
+				((1ULL << mod) - 1));
+
 	return ret;
 }
 
+/*
+ * get_run_util -- get run utilization histogram bucket
+ */
+static int
+get_run_util(uint32_t used, uint32_t units)
+{
+	if (used == 0)
+		return 0;
+	if (used == units)
+		return RUN_UTIL_MAX - 1;
+
+	int util = 1 + (int)(4 * (uint64_t)used / units);
+
+	return util < RUN_UTIL_MAX - 1 ? util : RUN_UTIL_MAX - 2;
+}
+
+/*
+ * get_run_util_str -- get run utilization histogram bucket string
+ */
+static const char *
+get_run_util_str(int util)
+{
+	static const char *names[RUN_UTIL_MAX] = {
+		"empty",
+		"0% - 25%",
+		"25% - 50%",
+		"50% - 75%",
+		"75% - 100%",
+		"full",
+	};
+
+	return names[util];
+}
+
 /*
  * get_bitmap_str -- get bitmap single value string
  */
@@ -495,6 +545,7 @@ info_obj_store_object_cb(struct pmem_info *pip, int v, int vnum,
 
 	pip->obj.stats.n_total_objects++;
 	pip->obj.stats.n_total_bytes += real_size;
+	pip->obj.stats.n_total_alloc_bytes += alloc->size;
 
 	pip->obj.stats.n_type_objects[oob->user_type]++;
 	pip->obj.stats.n_type_bytes[oob->user_type] += real_size;
@@ -643,6 +694,7 @@ info_obj_chunk_hdr(struct pmem_info *pip, int v, struct pmemobjpool *pop,
 
 			stats->class_stats[class].n_units += units;
 			stats->class_stats[class].n_used += used;
+			stats->n_runs_util[get_run_util(used, units)]++;
 
 			outv_field(v, "Block size", "%s",
 					out_get_size_str(run->block_size,
@@ -664,6 +716,35 @@ info_obj_chunk_hdr(struct pmem_info *pip, int v, struct pmemobjpool *pop,
 	}
 }
 
+/*
+ * info_obj_zone_free_extent -- get size of the largest free chunk extent
+ *
+ * Adjacent free chunks are counted as a single extent because the allocator
+ * coalesces them on free.
+ */
+static uint64_t
+info_obj_zone_free_extent(struct zone *zone)
+{
+	uint64_t max = 0;
+	uint64_t cur = 0;
+	for (uint64_t c = 0; c < zone->header.size_idx; ) {
+		struct chunk_header *hdr = &zone->chunk_headers[c];
+		uint64_t size_idx = hdr->size_idx ? hdr->size_idx : 1;
+
+		if (hdr->type == CHUNK_TYPE_FREE) {
+			cur += size_idx;
+			if (cur > max)
+				max = cur;
+		} else {
+			cur = 0;
+		}
+
+		c += size_idx;
+	}
+
+	return max;
+}
+
 /*
  * info_obj_zone_chunks -- print chunk headers from specified zone
  */
@@ -671,6 +752,8 @@ static void
 info_obj_zone_chunks(struct pmem_info *pip, int v, struct pmemobjpool *pop,
 		struct zone *zone, struct pmem_obj_zone_stats *stats)
 {
+	stats->max_free_chunks = info_obj_zone_free_extent(zone);
+
 	for (uint64_t c = 0; c < zone->header.size_idx; c++) {
 		enum chunk_type type = zone->chunk_headers[c].type;
 		/* check range and types of chunks */
@@ -943,6 +1026,68 @@ info_obj_stats_chunks(struct pmem_info *pip, int v,
 
 	}
 	out_indent(-1);
+
+	outv_nl(v);
+	outv_field(v, "Largest free extent", "%s",
+			out_get_size_str(stats->max_free_chunks * CHUNKSIZE,
+				pip->args.human));
+}
+
+/*
+ * info_obj_stats_runs -- print run utilization histogram
+ */
+static void
+info_obj_stats_runs(struct pmem_info *pip, int v,
+		struct pmem_obj_zone_stats *stats)
+{
+	uint64_t n_runs = stats->n_chunks_type[CHUNK_TYPE_RUN];
+
+	outv_field(v, "Number of runs", "%lu", n_runs);
+	if (!n_runs)
+		return;
+
+	out_indent(1);
+	for (int util = 0; util < RUN_UTIL_MAX; util++) {
+		double util_perc = 100.0 *
+			(double)stats->n_runs_util[util] / (double)n_runs;
+		if (stats->n_runs_util[util]) {
+			outv_field(v, get_run_util_str(util),
+				"%lu [%s]",
+				stats->n_runs_util[util],
+				out_get_percentage(util_perc));
+		}
+	}
+	out_indent(-1);
+}
+
+/*
+ * info_obj_stats_fragmentation -- print heap fragmentation statistics
+ */
+static void
+info_obj_stats_fragmentation(struct pmem_info *pip, int v,
+		struct pmem_obj_stats *stats, struct pmem_obj_zone_stats *total)
+{
+	outv_title(v, "Runs utilization");
+	info_obj_stats_runs(pip, v, total);
+
+	outv_nl(v);
+	outv_field(v, "Largest free extent", "%s",
+			out_get_size_str(total->max_free_chunks * CHUNKSIZE,
+				pip->args.human));
+
+	if (!stats->n_total_alloc_bytes)
+		return;
+
+	double internal_perc = 100.0 *
+		(double)(stats->n_total_alloc_bytes - stats->n_total_bytes) /
+		(double)stats->n_total_alloc_bytes;
+
+	outv_field(v, "Allocated bytes", "%s", out_get_size_str(
+			stats->n_total_alloc_bytes, pip->args.human));
+	outv_field(v, "Usable bytes", "%s", out_get_size_str(
+			stats->n_total_bytes, pip->args.human));
+	outv_field(v, "Internal fragmentation", "%s",
+			out_get_percentage(internal_perc));
 }
 
 /*
@@ -955,6 +1100,12 @@ info_obj_add_zone_stats(struct pmem_obj_zone_stats *total,
 	total->n_chunks += stats->n_chunks;
 	total->size_chunks += stats->size_chunks;
 
+	if (stats->max_free_chunks > total->max_free_chunks)
+		total->max_free_chunks = stats->max_free_chunks;
+
+	for (int util = 0; util < RUN_UTIL_MAX; util++)
+		total->n_runs_util[util] += stats->n_runs_util[util];
+
 	for (int type = 0; type < MAX_CHUNK_TYPE; type++) {
 		total->n_chunks_type[type] +=
 			stats->n_chunks_type[type];
@@ -1030,6 +1181,152 @@ info_obj_stats(struct pmem_info *pip, int v)
 		info_obj_stats_alloc_classes(pip, v, &total);
 	}
 
+	outv_title(v, "Fragmentation");
+	info_obj_stats_fragmentation(pip, v, stats, &total);
+}
+
+/*
+ * info_obj_stats_shm_open -- (internal) map the runtime statistics published
+ * by the process pid
+ */
+static struct obj_stats *
+info_obj_stats_shm_open(uint64_t uuid_lo, uint64_t pid)
+{
+	/* left behind by a process which did not close the pool */
+	if (kill((pid_t)pid, 0) && errno != EPERM)
+		return NULL;
+
+	char name[OBJ_STATS_SHM_NAME_MAX];
+	snprintf(name, sizeof (name), OBJ_STATS_SHM_NAME, (uintmax_t)uuid_lo,
+			(uintmax_t)pid);
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	struct stat buf;
+	if (fstat(fd, &buf) || buf.st_size < sizeof (struct obj_stats)) {
+		close(fd);
+		return NULL;
+	}
+
+	struct obj_stats *s = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED,
+			fd, 0);
+	close(fd);
+	if (s == MAP_FAILED)
+		return NULL;
+
+	if (memcmp(s->signature, OBJ_STATS_SIG, sizeof (s->signature)) ||
+		s->major != OBJ_STATS_FORMAT_MAJOR ||
+		s->uuid_lo != uuid_lo || s->pid != pid ||
+		s->size != buf.st_size ||
+		s->nclasses > PMEMOBJ_MAX_ALLOC_CLASSES ||
+		sizeof (*s) + s->nshards * sizeof (s->shards[0]) > s->size) {
+		munmap(s, buf.st_size);
+		return NULL;
+	}
+
+	return s;
+}
+
+/*
+ * info_obj_stats_shm_map -- (internal) map the runtime statistics of the pool
+ *
+ * The shared memory objects of the pool are named after the processes which
+ * publish them, the first one whose process is alive is used.  Returns NULL
+ * if the pool is not open in a process which publishes its statistics.
+ */
+static struct obj_stats *
+info_obj_stats_shm_map(struct pmemobjpool *pop)
+{
+	uint64_t uuid_lo = 0;
+	for (int i = 0; i < 8; i++) {
+		uuid_lo = (uuid_lo << 8) |
+			(pop->hdr.poolset_uuid[i] ^
+				pop->hdr.poolset_uuid[8 + i]);
+	}
+
+	/* the name without the leading slash and the pid */
+	char prefix[OBJ_STATS_SHM_NAME_MAX];
+	snprintf(prefix, sizeof (prefix), OBJ_STATS_SHM_NAME,
+			(uintmax_t)uuid_lo, (uintmax_t)0);
+	size_t prefix_len = strlen(prefix) - 2;
+
+	DIR *dir = opendir(OBJ_STATS_SHM_DIR);
+	if (dir == NULL)
+		return NULL;
+
+	struct obj_stats *s = NULL;
+	struct dirent *d;
+	while (s == NULL && (d = readdir(dir)) != NULL) {
+		if (strncmp(d->d_name, prefix + 1, prefix_len))
+			continue;
+
+		char *end;
+		errno = 0;
+		uintmax_t pid = strtoumax(d->d_name + prefix_len, &end, 10);
+		if (errno || *end != '\0' || end == d->d_name + prefix_len)
+			continue;
+
+		s = info_obj_stats_shm_open(uuid_lo, pid);
+	}
+
+	closedir(dir);
+
+	return s;
+}
+
+/*
+ * info_obj_stats_runtime -- print runtime statistics of an open pool
+ */
+static void
+info_obj_stats_runtime(struct pmem_info *pip, int v, struct pmemobjpool *pop)
+{
+	if (!outv_check(v))
+		return;
+
+	struct obj_stats *s = info_obj_stats_shm_map(pop);
+	if (s == NULL)
+		return;
+
+	struct pobj_stats stats;
+	obj_stats_merge(s, &stats);
+
+	outv_title(v, "Runtime statistics");
+	outv_field(v, "Process", "%ju", s->pid);
+
+	double contended_perc = stats.lane_holds ? 100.0 *
+		(double)stats.lane_contended / (double)stats.lane_holds : 0;
+
+	outv_field(v, "Lane holds", "%ju", stats.lane_holds);
+	outv_field(v, "Contended lane holds", "%ju [%s]",
+			stats.lane_contended,
+			out_get_percentage(contended_perc));
+	outv_field(v, "Committed transactions", "%ju", stats.tx_commits);
+	outv_field(v, "Aborted transactions", "%ju", stats.tx_aborts);
+	outv_field(v, "Snapshots", "%ju", stats.tx_snapshots);
+	outv_field(v, "Snapshot bytes", "%s", out_get_size_str(
+			stats.tx_snapshot_bytes, pip->args.human));
+	outv_field(v, "Bucket refills", "%ju", stats.bucket_refills);
+	outv_field(v, "Zone populations", "%ju", stats.zone_populations);
+	outv_field(v, "Run degradations", "%ju", stats.run_degradations);
+
+	outv_title(v, "Allocation classes");
+	out_indent(1);
+	for (unsigned i = 0; i < stats.nclasses; i++) {
+		struct pobj_class_counters *c = &stats.classes[i];
+		if (!c->allocs && !c->frees)
+			continue;
+
+		outv_nl(v);
+		outv_field(v, "Unit size", "%s", out_get_size_str(
+				c->unit_size, pip->args.human));
+		outv_field(v, "Allocations", "%ju", c->allocs);
+		outv_field(v, "Frees", "%ju", c->frees);
+	}
+	out_indent(-1);
+
+	munmap(s, s->size);
 }
 
 static struct pmem_info *Pip;
@@ -1081,6 +1378,7 @@ pmempool_info_obj(struct pmem_info *pip)
 	info_obj_heap(pip, pip->args.obj.vheap, pop);
 	info_obj_zones_chunks(pip, pop);
 	info_obj_stats(pip, pip->args.vstats);
+	info_obj_stats_runtime(pip, pip->args.vstats, pop);
 
 	munmap(pip->obj.addr, buf.st_size);
 
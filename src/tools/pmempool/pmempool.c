@@ -47,6 +47,8 @@
 #include "create.h"
 #include "dump.h"
 #include "check.h"
+#include "compact.h"
+#include "trace_cmd.h"
 
 /*
  * command -- struct for pmempool commands definition
@@ -130,6 +132,18 @@ struct command commands[] = {
 		.func = pmempool_check_func,
 		.help = pmempool_check_help,
 	},
+	{
+		.name = "compact",
+		.brief = "compact heap of a pool",
+		.func = pmempool_compact_func,
+		.help = pmempool_compact_help,
+	},
+	{
+		.name = "trace",
+		.brief = "convert events traced by libpmemobj",
+		.func = pmempool_trace_func,
+		.help = pmempool_trace_help,
+	},
 	{
 		.name = "help",
 		.brief = "print help text about a command",
@@ -0,0 +1,387 @@
+/*
+ * Copyright (c) 2015, Intel Corporation
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Intel Corporation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * trace_cmd.c -- pmempool trace command source file
+ *
+ * Converts the events dumped by libpmemobj (see PMEMOBJ_TRACE) to the
+ * Chrome trace event format or to text in the style of perf script.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <err.h>
+#include "common.h"
+#include "output.h"
+#include "trace_cmd.h"
+#include "trace.h"
+
+/*
+ * trace_event_desc -- names of an event type
+ */
+struct trace_event_desc {
+	const char *name;
+	const char *category;
+	const char *arg;	/* name of the argument, NULL if none */
+};
+
+static const struct trace_event_desc trace_events[MAX_TRACE_EVENT] = {
+	[TRACE_LANE_WAIT] = {"lane_wait", "lane", "lane"},
+	[TRACE_LANE_HOLD] = {"lane_hold", "lane", "lane"},
+	[TRACE_BUCKET_REFILL] = {"bucket_refill", "heap", "unit_size"},
+	[TRACE_HEAP_POPULATE] = {"heap_populate", "heap", "zone"},
+	[TRACE_REDO_PROCESS] = {"redo_process", "redo", "entries"},
+	[TRACE_TX] = {"tx", "tx", "snapshot_bytes"},
+	[TRACE_TX_COMMIT] = {"tx_commit", "tx", "snapshot_bytes"},
+	[TRACE_TX_ABORT] = {"tx_abort", "tx", "snapshot_bytes"},
+	[TRACE_TX_SNAPSHOT] = {"tx_snapshot", "tx", "size"},
+	[TRACE_LIST_INSERT_NEW] = {"list_insert_new", "list", NULL},
+	[TRACE_LIST_INSERT] = {"list_insert", "list", NULL},
+	[TRACE_LIST_REMOVE_FREE] = {"list_remove_free", "list", NULL},
+	[TRACE_LIST_REMOVE] = {"list_remove", "list", NULL},
+	[TRACE_LIST_MOVE_OOB] = {"list_move_oob", "list", NULL},
+	[TRACE_LIST_MOVE] = {"list_move", "list", NULL},
+	[TRACE_LIST_REALLOC] = {"list_realloc", "list", NULL},
+	[TRACE_LIST_REALLOC_MOVE] = {"list_realloc_move", "list", NULL},
+};
+
+enum trace_format {
+	TRACE_FORMAT_CHROME,
+	TRACE_FORMAT_PERF,
+};
+
+/*
+ * trace_entry -- record with its position in the dump file
+ */
+struct trace_entry {
+	struct trace_record rec;
+	size_t idx;
+};
+
+/*
+ * pmempool_trace -- context and arguments for trace command
+ */
+struct pmempool_trace {
+	char *fname;
+	char *ofname;
+	FILE *ofh;
+	enum trace_format format;
+	uint32_t pid;
+	struct trace_entry *entries;
+	size_t nentries;
+};
+
+/*
+ * pmempool_trace_default -- default arguments and context values
+ */
+static const struct pmempool_trace pmempool_trace_default = {
+	.fname		= NULL,
+	.ofname		= NULL,
+	.ofh		= NULL,
+	.format		= TRACE_FORMAT_CHROME,
+};
+
+/*
+ * long_options -- command line options
+ */
+static const struct option long_options[] = {
+	{"format",	required_argument,	0,	'f'},
+	{"output",	required_argument,	0,	'o'},
+	{"help",	no_argument,		0,	'h'},
+	{0,		0,			0,	 0 },
+};
+
+/*
+ * help_str -- string for help message
+ */
+static const char *help_str =
+"Convert events traced by libpmemobj\n"
+"\n"
+"Available options:\n"
+"  -f, --format <fmt>   output format: chrome (default) or perf\n"
+"  -o, --output <file>  output file name\n"
+"  -h, --help           display this help and exit\n"
+"\n"
+"For complete documentation see %s-trace(1) manual page.\n"
+;
+
+/*
+ * print_usage -- print application usage short description
+ */
+static void
+print_usage(char *appname)
+{
+	printf("Usage: %s trace [<args>] <file>\n", appname);
+}
+
+/*
+ * print_version -- print version string
+ */
+static void
+print_version(char *appname)
+{
+	printf("%s %s\n", appname, SRCVERSION);
+}
+
+/*
+ * pmempool_trace_help -- print help message for trace command
+ */
+void
+pmempool_trace_help(char *appname)
+{
+	print_usage(appname);
+	print_version(appname);
+	printf(help_str, appname);
+}
+
+/*
+ * trace_read -- (internal) read all the records of a dump file
+ */
+static int
+trace_read(struct pmempool_trace *ptp)
+{
+	FILE *fh = fopen(ptp->fname, "rb");
+	if (!fh) {
+		warn("%s", ptp->fname);
+		return -1;
+	}
+
+	struct trace_file_header hdr;
+	if (fread(&hdr, sizeof (hdr), 1, fh) != 1 ||
+		memcmp(hdr.signature, TRACE_HDR_SIG,
+			sizeof (hdr.signature)) != 0) {
+		out_err("%s: not a libpmemobj trace file\n", ptp->fname);
+		goto err;
+	}
+
+	if (hdr.major != TRACE_FORMAT_MAJOR ||
+		hdr.record_size != sizeof (struct trace_record)) {
+		out_err("%s: unsupported trace format %u\n", ptp->fname,
+			hdr.major);
+		goto err;
+	}
+
+	ptp->pid = hdr.pid;
+	ptp->nentries = hdr.nrecords;
+	ptp->entries = malloc(ptp->nentries * sizeof (struct trace_entry));
+	if (ptp->nentries && !ptp->entries)
+		err(1, "Cannot allocate memory for records");
+
+	for (size_t i = 0; i < ptp->nentries; i++) {
+		if (fread(&ptp->entries[i].rec, sizeof (struct trace_record),
+				1, fh) != 1) {
+			out_err("%s: truncated trace file\n", ptp->fname);
+			goto err;
+		}
+		ptp->entries[i].idx = i;
+	}
+
+	fclose(fh);
+	return 0;
+err:
+	fclose(fh);
+	return -1;
+}
+
+/*
+ * trace_entry_cmp -- (internal) order the records by time
+ *
+ * The records of a thread are dumped in order, so equal times keep the
+ * position in the file to not swap the ends of nested events.
+ */
+static int
+trace_entry_cmp(const void *a, const void *b)
+{
+	const struct trace_entry *ea = a;
+	const struct trace_entry *eb = b;
+
+	if (ea->rec.time != eb->rec.time)
+		return ea->rec.time < eb->rec.time ? -1 : 1;
+
+	return ea->idx < eb->idx ? -1 : ea->idx > eb->idx;
+}
+
+/*
+ * trace_print_chrome -- (internal) print a record as a trace event
+ */
+static void
+trace_print_chrome(struct pmempool_trace *ptp, struct trace_record *rec,
+		int first)
+{
+	static const char phases[MAX_TRACE_PHASE] = {
+		[TRACE_BEGIN] = 'B',
+		[TRACE_END] = 'E',
+		[TRACE_INSTANT] = 'i',
+	};
+	const struct trace_event_desc *desc = &trace_events[rec->type];
+
+	fprintf(ptp->ofh, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+		"\"ts\":%ju.%03ju,\"pid\":%u,\"tid\":%u",
+		first ? "" : ",\n", desc->name, desc->category,
+		phases[rec->phase], rec->time / 1000, rec->time % 1000,
+		ptp->pid, rec->tid);
+
+	if (rec->phase == TRACE_INSTANT)
+		fprintf(ptp->ofh, ",\"s\":\"t\"");
+
+	/* the argument of a begin event is not known yet */
+	if (desc->arg && (rec->phase != TRACE_BEGIN || rec->arg))
+		fprintf(ptp->ofh, ",\"args\":{\"%s\":%ju}", desc->arg,
+			rec->arg);
+
+	fprintf(ptp->ofh, "}");
+}
+
+/*
+ * trace_print_perf -- (internal) print a record like perf script does
+ */
+static void
+trace_print_perf(struct pmempool_trace *ptp, struct trace_record *rec)
+{
+	static const char *phases[MAX_TRACE_PHASE] = {
+		[TRACE_BEGIN] = "_begin",
+		[TRACE_END] = "_end",
+		[TRACE_INSTANT] = "",
+	};
+	const struct trace_event_desc *desc = &trace_events[rec->type];
+
+	fprintf(ptp->ofh, "%16s %5u/%-5u %5ju.%06ju: pmemobj:%s%s:",
+		"pmemobj", ptp->pid, rec->tid, rec->time / 1000000000,
+		rec->time % 1000000000 / 1000, desc->name,
+		phases[rec->phase]);
+
+	if (desc->arg)
+		fprintf(ptp->ofh, " %s=%ju", desc->arg, rec->arg);
+
+	fprintf(ptp->ofh, "\n");
+}
+
+/*
+ * trace_print -- (internal) print all the valid records
+ */
+static void
+trace_print(struct pmempool_trace *ptp)
+{
+	qsort(ptp->entries, ptp->nentries, sizeof (struct trace_entry),
+		trace_entry_cmp);
+
+	if (ptp->format == TRACE_FORMAT_CHROME)
+		fprintf(ptp->ofh, "{\"traceEvents\":[\n");
+
+	size_t nprinted = 0;
+	for (size_t i = 0; i < ptp->nentries; i++) {
+		struct trace_record *rec = &ptp->entries[i].rec;
+
+		/* records overwritten during the dump */
+		if (rec->type >= MAX_TRACE_EVENT ||
+			rec->phase >= MAX_TRACE_PHASE)
+			continue;
+
+		if (ptp->format == TRACE_FORMAT_CHROME)
+			trace_print_chrome(ptp, rec, nprinted == 0);
+		else
+			trace_print_perf(ptp, rec);
+
+		nprinted++;
+	}
+
+	if (ptp->format == TRACE_FORMAT_CHROME)
+		fprintf(ptp->ofh, "\n],\"displayTimeUnit\":\"ns\"}\n");
+}
+
+/*
+ * pmempool_trace_func -- trace command main function
+ */
+int
+pmempool_trace_func(char *appname, int argc, char *argv[])
+{
+	struct pmempool_trace pt = pmempool_trace_default;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "f:o:h",
+				long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			if (strcmp(optarg, "chrome") == 0) {
+				pt.format = TRACE_FORMAT_CHROME;
+			} else if (strcmp(optarg, "perf") == 0) {
+				pt.format = TRACE_FORMAT_PERF;
+			} else {
+				out_err("invalid format '%s'\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'o':
+			pt.ofname = optarg;
+			break;
+		case 'h':
+			pmempool_trace_help(appname);
+			exit(EXIT_SUCCESS);
+		default:
+			print_usage(appname);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind < argc) {
+		pt.fname = argv[optind];
+	} else {
+		print_usage(appname);
+		exit(EXIT_FAILURE);
+	}
+
+	if (trace_read(&pt)) {
+		free(pt.entries);
+		exit(EXIT_FAILURE);
+	}
+
+	if (pt.ofname == NULL) {
+		pt.ofh = stdout;
+	} else {
+		pt.ofh = fopen(pt.ofname, "w");
+		if (!pt.ofh) {
+			warn("%s", pt.ofname);
+			free(pt.entries);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	trace_print(&pt);
+
+	if (pt.ofh != stdout)
+		fclose(pt.ofh);
+	free(pt.entries);
+
+	return 0;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014, Intel Corporation
+ * Copyright (c) 2015, Intel Corporation
  *
  * Redistribution and use in source and binary forms, with or without
  * modification, are permitted provided that the following conditions
@@ -31,24 +31,8 @@
  */
 
 /*
- * blk_mt.h -- definitions for the PMEMBLK benchmark
+ * trace_cmd.h -- pmempool trace command header file
  */
 
-struct measurements {
-	struct timespec start_time;
-	struct timespec stop_time;
-	unsigned long long total_ops;
-	double ops_per_second;
-	double mean_ops_time;
-	double total_run_time;
-};
-
-struct blk_arguments {
-	unsigned long block_size;
-	unsigned int num_ops;
-	unsigned int thread_count;
-	char *file_path;
-	unsigned int file_size;
-	int file_io;
-	int prep_blk_file;
-};
+int pmempool_trace_func(char *appname, int argc, char *argv[]);
+void pmempool_trace_help(char *appname);